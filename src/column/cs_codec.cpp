@@ -0,0 +1,255 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "cs_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "errors.h"
+
+/**
+ * @description: 压缩一个段中某个字段的值，在可用的编码方式中选择压缩后最小的一种
+ * INT可以使用RLE和参考系编码，CHAR/VARCHAR可以使用RLE和字典编码，FLOAT可以使用RLE
+ * @return {int} 选择的编码方式，见CsEncoding
+ * @param {ColType} type 字段类型
+ * @param {int} len 字段长度
+ * @param {char*} values 按字段长度连续存放的num_values个值
+ * @param {int} num_values 值的个数
+ * @param {vector<char>&} out 压缩后的数据
+ */
+int CsCodec::encode(ColType type, int len, const char *values, int num_values, std::vector<char> &out) {
+    int encoding = CS_ENC_PLAIN;
+    encode_plain(len, values, num_values, out);
+
+    std::vector<char> candidate;
+    auto try_candidate = [&](int candidate_encoding) {
+        if (candidate.size() < out.size()) {
+            out.swap(candidate);
+            encoding = candidate_encoding;
+        }
+        candidate.clear();
+    };
+    encode_rle(len, values, num_values, candidate);
+    try_candidate(CS_ENC_RLE);
+    if (type == TYPE_STRING || type == TYPE_VARCHAR) {
+        if (encode_dict(len, values, num_values, candidate)) {
+            try_candidate(CS_ENC_DICT);
+        }
+    } else if (type == TYPE_INT) {
+        encode_for(values, num_values, candidate);
+        try_candidate(CS_ENC_FOR);
+    }
+    return encoding;
+}
+
+/**
+ * @description: 将压缩数据解码为按字段长度连续存放的值向量
+ * @param {int} encoding 编码方式
+ * @param {int} len 字段长度
+ * @param {char*} data 压缩数据
+ * @param {int} num_values 值的个数
+ * @param {char*} values 输出的值向量，大小至少为num_values * len
+ */
+void CsCodec::decode(int encoding, int len, const char *data, int num_values, char *values) {
+    switch (encoding) {
+        case CS_ENC_PLAIN: {
+            memcpy(values, data, (size_t)num_values * len);
+            break;
+        }
+        case CS_ENC_RLE: {
+            int row = 0;
+            while (row < num_values) {
+                int run;
+                memcpy(&run, data, sizeof(int));
+                run = std::min(run, num_values - row);
+                for (int i = 0; i < run; ++i) {
+                    memcpy(values + (size_t)(row + i) * len, data + sizeof(int), len);
+                }
+                row += run;
+                data += sizeof(int) + len;
+            }
+            break;
+        }
+        case CS_ENC_DICT: {
+            int dict_size, width;
+            memcpy(&dict_size, data, sizeof(int));
+            memcpy(&width, data + sizeof(int), sizeof(int));
+            const char *dict = data + 2 * sizeof(int);
+            const char *packed = dict + (size_t)dict_size * len;
+            for (int i = 0; i < num_values; ++i) {
+                memcpy(values + (size_t)i * len, dict + (size_t)unpack_bits(packed, width, i) * len, len);
+            }
+            break;
+        }
+        case CS_ENC_FOR: {
+            int base, width;
+            memcpy(&base, data, sizeof(int));
+            memcpy(&width, data + sizeof(int), sizeof(int));
+            const char *packed = data + 2 * sizeof(int);
+            int *out = reinterpret_cast<int *>(values);
+            for (int i = 0; i < num_values; ++i) {
+                out[i] = static_cast<int>(static_cast<int64_t>(base) + unpack_bits(packed, width, i));
+            }
+            break;
+        }
+        default:
+            throw InternalError("CsCodec::decode: unknown encoding");
+    }
+}
+
+/**
+ * @description: 从压缩数据中解码出第row个值，除RLE需要从头查找游程外都可以直接定位
+ * @param {int} encoding 编码方式
+ * @param {int} len 字段长度
+ * @param {char*} data 压缩数据
+ * @param {int} row 值的下标
+ * @param {char*} value 输出的值，大小至少为len
+ */
+void CsCodec::decode_value(int encoding, int len, const char *data, int row, char *value) {
+    switch (encoding) {
+        case CS_ENC_PLAIN: {
+            memcpy(value, data + (size_t)row * len, len);
+            break;
+        }
+        case CS_ENC_RLE: {
+            while (true) {
+                int run;
+                memcpy(&run, data, sizeof(int));
+                if (row < run) {
+                    memcpy(value, data + sizeof(int), len);
+                    break;
+                }
+                row -= run;
+                data += sizeof(int) + len;
+            }
+            break;
+        }
+        case CS_ENC_DICT: {
+            int dict_size, width;
+            memcpy(&dict_size, data, sizeof(int));
+            memcpy(&width, data + sizeof(int), sizeof(int));
+            const char *dict = data + 2 * sizeof(int);
+            const char *packed = dict + (size_t)dict_size * len;
+            memcpy(value, dict + (size_t)unpack_bits(packed, width, row) * len, len);
+            break;
+        }
+        case CS_ENC_FOR: {
+            int base, width;
+            memcpy(&base, data, sizeof(int));
+            memcpy(&width, data + sizeof(int), sizeof(int));
+            int v = static_cast<int>(static_cast<int64_t>(base) + unpack_bits(data + 2 * sizeof(int), width, row));
+            memcpy(value, &v, sizeof(int));
+            break;
+        }
+        default:
+            throw InternalError("CsCodec::decode_value: unknown encoding");
+    }
+}
+
+void CsCodec::encode_plain(int len, const char *values, int num_values, std::vector<char> &out) {
+    out.assign(values, values + (size_t)num_values * len);
+}
+
+// 游程编码：每个游程写入4字节的游程长度和一个值
+void CsCodec::encode_rle(int len, const char *values, int num_values, std::vector<char> &out) {
+    int row = 0;
+    while (row < num_values) {
+        const char *value = values + (size_t)row * len;
+        int run = 1;
+        while (row + run < num_values && memcmp(values + (size_t)(row + run) * len, value, len) == 0) {
+            run++;
+        }
+        out.insert(out.end(), reinterpret_cast<const char *>(&run), reinterpret_cast<const char *>(&run) + sizeof(int));
+        out.insert(out.end(), value, value + len);
+        row += run;
+    }
+}
+
+// 字典编码：字典按值排序，字典下标按所需的最小位宽压缩存放
+bool CsCodec::encode_dict(int len, const char *values, int num_values, std::vector<char> &out) {
+    std::vector<std::string> dict;
+    dict.reserve(num_values);
+    for (int i = 0; i < num_values; ++i) {
+        dict.emplace_back(values + (size_t)i * len, len);
+    }
+    std::sort(dict.begin(), dict.end());
+    dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
+    // 字典不小于原始数据的一半时压缩效果不会好于PLAIN
+    if (dict.size() * 2 > (size_t)num_values) {
+        return false;
+    }
+
+    int dict_size = dict.size();
+    int width = bit_width(dict_size - 1);
+    out.insert(out.end(), reinterpret_cast<const char *>(&dict_size), reinterpret_cast<const char *>(&dict_size) + sizeof(int));
+    out.insert(out.end(), reinterpret_cast<const char *>(&width), reinterpret_cast<const char *>(&width) + sizeof(int));
+    for (auto &entry : dict) {
+        out.insert(out.end(), entry.begin(), entry.end());
+    }
+    std::vector<uint32_t> codes(num_values);
+    for (int i = 0; i < num_values; ++i) {
+        std::string value(values + (size_t)i * len, len);
+        codes[i] = std::lower_bound(dict.begin(), dict.end(), value) - dict.begin();
+    }
+    pack_bits(codes, width, out);
+    return true;
+}
+
+// 参考系编码：记录最小值，每个值与最小值的差按所需的最小位宽压缩存放
+void CsCodec::encode_for(const char *values, int num_values, std::vector<char> &out) {
+    std::vector<int> ints(num_values);
+    memcpy(ints.data(), values, (size_t)num_values * sizeof(int));
+    int base = num_values > 0 ? *std::min_element(ints.begin(), ints.end()) : 0;
+    std::vector<uint32_t> diffs(num_values);
+    uint32_t max_diff = 0;
+    for (int i = 0; i < num_values; ++i) {
+        diffs[i] = static_cast<uint32_t>(static_cast<int64_t>(ints[i]) - base);
+        max_diff = std::max(max_diff, diffs[i]);
+    }
+    int width = bit_width(max_diff);
+    out.insert(out.end(), reinterpret_cast<const char *>(&base), reinterpret_cast<const char *>(&base) + sizeof(int));
+    out.insert(out.end(), reinterpret_cast<const char *>(&width), reinterpret_cast<const char *>(&width) + sizeof(int));
+    pack_bits(diffs, width, out);
+}
+
+// 表示max_value所需的最少位数
+int CsCodec::bit_width(uint32_t max_value) {
+    int width = 0;
+    while (width < 32 && (max_value >> width) != 0) {
+        width++;
+    }
+    return width;
+}
+
+/**
+ * @description: 将codes按width位依次紧密存放，末尾额外补8个字节，解码时总是可以整字读取
+ */
+void CsCodec::pack_bits(const std::vector<uint32_t> &codes, int width, std::vector<char> &out) {
+    size_t start = out.size();
+    out.resize(start + ((size_t)codes.size() * width + 7) / 8 + sizeof(uint64_t), 0);
+    char *packed = out.data() + start;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        uint64_t pos = (uint64_t)i * width;
+        uint64_t word;
+        memcpy(&word, packed + pos / 8, sizeof(uint64_t));
+        word |= static_cast<uint64_t>(codes[i]) << (pos % 8);
+        memcpy(packed + pos / 8, &word, sizeof(uint64_t));
+    }
+}
+
+uint32_t CsCodec::unpack_bits(const char *packed, int width, int i) {
+    uint64_t pos = (uint64_t)i * width;
+    uint64_t word;
+    memcpy(&word, packed + pos / 8, sizeof(uint64_t));
+    uint64_t mask = (width == 32) ? 0xffffffffull : ((1ull << width) - 1);
+    return static_cast<uint32_t>((word >> (pos % 8)) & mask);
+}
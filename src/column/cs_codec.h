@@ -0,0 +1,40 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <vector>
+
+#include "cs_defs.h"
+
+/* 列压缩段的编码和解码，一段中某个字段的值以定长向量的形式输入和输出 */
+class CsCodec {
+   public:
+    static int encode(ColType type, int len, const char *values, int num_values, std::vector<char> &out);
+
+    static void decode(int encoding, int len, const char *data, int num_values, char *values);
+
+    static void decode_value(int encoding, int len, const char *data, int row, char *value);
+
+   private:
+    static void encode_plain(int len, const char *values, int num_values, std::vector<char> &out);
+
+    static void encode_rle(int len, const char *values, int num_values, std::vector<char> &out);
+
+    static bool encode_dict(int len, const char *values, int num_values, std::vector<char> &out);
+
+    static void encode_for(const char *values, int num_values, std::vector<char> &out);
+
+    static int bit_width(uint32_t max_value);
+
+    static void pack_bits(const std::vector<uint32_t> &codes, int width, std::vector<char> &out);
+
+    static uint32_t unpack_bits(const char *packed, int width, int i);
+};
@@ -0,0 +1,53 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <string>
+
+#include "common/config.h"
+#include "defs.h"
+
+constexpr int CS_TABLE_HDR_PAGE = 0;
+constexpr int CS_SEGMENT_ROWS = 4096;   // 每个段最多包含的行数，追加的行攒满一个段后整体压缩写入列文件
+
+/* 列压缩段的编码方式 */
+enum CsEncoding {
+    CS_ENC_PLAIN = 0,   // 不压缩，值按字段长度连续存放
+    CS_ENC_RLE = 1,     // 游程编码：(游程长度, 值)序列，适用于有序或重复较多的列
+    CS_ENC_DICT = 2,    // 字典编码：有序字典 + 位压缩的字典下标，适用于CHAR/VARCHAR
+    CS_ENC_FOR = 3      // 参考系编码(frame of reference)：最小值 + 位压缩的差值，适用于INT
+};
+
+/* 表文件头，写入表文件的开头，其后依次是各字段描述和各段的元数据 */
+struct CsTableHdr {
+    int num_cols;       // 字段个数
+    int record_size;    // 记录在内存中的大小
+    int num_segments;   // 已经压缩写入列文件的段的个数
+};
+
+/* 字段描述 */
+struct CsColDesc {
+    int type;           // 字段类型，见ColType
+    int len;            // 字段长度
+    int offset;         // 字段在记录中的偏移
+};
+
+/* 一个段中某个字段的压缩数据在列文件中的位置 */
+struct CsChunkMeta {
+    int encoding;       // 编码方式，见CsEncoding
+    int page_no;        // 起始页面号，压缩数据从页面开头连续存放
+    int num_bytes;      // 压缩数据的字节数
+};
+
+/* 表的第col_idx个字段对应的列文件名 */
+inline std::string cs_column_file_name(const std::string &tab_name, int col_idx) {
+    return tab_name + ".c" + std::to_string(col_idx);
+}
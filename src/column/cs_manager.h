@@ -0,0 +1,88 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "cs_table_handle.h"
+#include "system/sm_meta.h"
+
+/* 列存表管理器，负责列存表的表文件和列文件的创建、删除、打开和关闭 */
+class CsManager {
+   private:
+    DiskManager *disk_manager_;
+
+   public:
+    explicit CsManager(DiskManager *disk_manager) : disk_manager_(disk_manager) {}
+
+    /**
+     * @description: 创建列存表的表文件和各字段的列文件
+     * @param {string&} tab_name 表名称，同时作为表文件名
+     * @param {vector<ColMeta>&} cols 表的字段，按偏移递增排列
+     */
+    void create_file(const std::string &tab_name, const std::vector<ColMeta> &cols) {
+        disk_manager_->create_file(tab_name);
+        for (size_t i = 0; i < cols.size(); ++i) {
+            disk_manager_->create_file(cs_column_file_name(tab_name, i));
+        }
+
+        CsTableHdr hdr{};
+        hdr.num_cols = cols.size();
+        hdr.record_size = cols.back().offset + cols.back().len;
+        hdr.num_segments = 0;
+        std::vector<char> buf(sizeof(hdr) + sizeof(CsColDesc) * cols.size());
+        memcpy(buf.data(), &hdr, sizeof(hdr));
+        for (size_t i = 0; i < cols.size(); ++i) {
+            CsColDesc desc{cols[i].type, cols[i].len, cols[i].offset};
+            memcpy(buf.data() + sizeof(hdr) + sizeof(CsColDesc) * i, &desc, sizeof(desc));
+        }
+        int fd = disk_manager_->open_file(tab_name);
+        disk_manager_->write_page(fd, CS_TABLE_HDR_PAGE, buf.data(), buf.size());
+        disk_manager_->close_file(fd);
+    }
+
+    /**
+     * @description: 删除列存表的表文件和各字段的列文件
+     * @param {string&} tab_name 表名称
+     * @param {int} num_cols 字段个数
+     */
+    void destroy_file(const std::string &tab_name, int num_cols) {
+        disk_manager_->destroy_file(tab_name);
+        for (int i = 0; i < num_cols; ++i) {
+            disk_manager_->destroy_file(cs_column_file_name(tab_name, i));
+        }
+    }
+
+    /**
+     * @description: 打开列存表，返回表的句柄
+     * @param {string&} tab_name 表名称
+     * @param {int} num_cols 字段个数
+     */
+    std::unique_ptr<CsTableHandle> open_file(const std::string &tab_name, int num_cols) {
+        int fd = disk_manager_->open_file(tab_name);
+        std::vector<int> col_fds;
+        for (int i = 0; i < num_cols; ++i) {
+            col_fds.push_back(disk_manager_->open_file(cs_column_file_name(tab_name, i)));
+        }
+        return std::make_unique<CsTableHandle>(disk_manager_, fd, std::move(col_fds));
+    }
+
+    /**
+     * @description: 关闭列存表，开放段中剩余的行会先压缩写入列文件
+     * @param {CsTableHandle*} table_handle 要关闭的表的句柄
+     */
+    void close_file(CsTableHandle *table_handle) {
+        table_handle->seal_segment();
+        table_handle->flush();
+        for (int fd : table_handle->col_fds_) {
+            disk_manager_->close_file(fd);
+        }
+        disk_manager_->close_file(table_handle->fd_);
+    }
+};
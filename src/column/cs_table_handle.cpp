@@ -0,0 +1,271 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "cs_table_handle.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "record/bitmap.h"
+
+constexpr int CS_BITMAP_BYTES = (CS_SEGMENT_ROWS + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+
+/**
+ * @description: 从表文件中加载字段描述和段目录
+ * @param {DiskManager*} disk_manager
+ * @param {int} fd 表文件
+ * @param {vector<int>} col_fds 各字段的列文件，按字段顺序排列
+ */
+CsTableHandle::CsTableHandle(DiskManager *disk_manager, int fd, std::vector<int> col_fds)
+    : disk_manager_(disk_manager), fd_(fd), col_fds_(std::move(col_fds)) {
+    int size = disk_manager_->get_file_size(disk_manager_->get_file_name(fd_));
+    std::vector<char> buf(size);
+    disk_manager_->read_page(fd_, CS_TABLE_HDR_PAGE, buf.data(), size);
+
+    const char *pos = buf.data();
+    auto read = [&](void *dst, size_t n) {
+        memcpy(dst, pos, n);
+        pos += n;
+    };
+    read(&hdr_, sizeof(hdr_));
+    cols_.resize(hdr_.num_cols);
+    read(cols_.data(), sizeof(CsColDesc) * hdr_.num_cols);
+    col_num_pages_.assign(hdr_.num_cols, 0);
+    segments_.resize(hdr_.num_segments);
+    for (auto &seg : segments_) {
+        read(&seg.num_rows, sizeof(int));
+        seg.chunks.resize(hdr_.num_cols);
+        read(seg.chunks.data(), sizeof(CsChunkMeta) * hdr_.num_cols);
+        seg.deleted.resize((seg.num_rows + BITMAP_WIDTH - 1) / BITMAP_WIDTH);
+        read(seg.deleted.data(), seg.deleted.size());
+        for (int i = 0; i < hdr_.num_cols; ++i) {
+            int num_pages = std::max(1, (seg.chunks[i].num_bytes + PAGE_SIZE - 1) / PAGE_SIZE);
+            col_num_pages_[i] = std::max(col_num_pages_[i], seg.chunks[i].page_no + num_pages);
+        }
+    }
+    tail_deleted_.assign(CS_BITMAP_BYTES, 0);
+}
+
+/**
+ * @description: 段的个数，包括还没有写入列文件的开放段
+ */
+int CsTableHandle::num_segments() const {
+    std::lock_guard<std::mutex> guard(latch_);
+    return segments_.size() + (num_tail_rows_ > 0 ? 1 : 0);
+}
+
+/**
+ * @description: 在表的末尾追加一行，开放段写满时压缩写入列文件
+ * @return {Rid} 新记录的记录号
+ * @param {char*} buf 记录数据
+ */
+Rid CsTableHandle::insert_record(const char *buf) {
+    std::lock_guard<std::mutex> guard(latch_);
+    Rid rid{(int)segments_.size(), num_tail_rows_};
+    tail_.insert(tail_.end(), buf, buf + hdr_.record_size);
+    num_tail_rows_++;
+    if (num_tail_rows_ == CS_SEGMENT_ROWS) {
+        seal_segment_locked();
+    }
+    return rid;
+}
+
+/**
+ * @description: 恢复一条被删除的记录，用于事务回滚
+ * 列存表中被删除的行的数据仍然保留在段中，只需要清除删除标记
+ * @param {Rid&} rid 被删除的记录的记录号
+ * @param {char*} buf 记录数据，与删除前相同
+ */
+void CsTableHandle::insert_record(const Rid &rid, const char *buf) {
+    std::lock_guard<std::mutex> guard(latch_);
+    char *bitmap = deleted_bitmap(rid.page_no, rid.slot_no);
+    if (bitmap == nullptr) {
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
+    }
+    Bitmap::reset(bitmap, rid.slot_no);
+}
+
+/**
+ * @description: 删除一条记录，只在删除位图中做标记
+ * @param {Rid&} rid 要删除的记录的记录号
+ */
+void CsTableHandle::delete_record(const Rid &rid) {
+    std::lock_guard<std::mutex> guard(latch_);
+    char *bitmap = deleted_bitmap(rid.page_no, rid.slot_no);
+    if (bitmap == nullptr || Bitmap::is_set(bitmap, rid.slot_no)) {
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
+    }
+    Bitmap::set(bitmap, rid.slot_no);
+}
+
+bool CsTableHandle::is_record(const Rid &rid) const {
+    std::lock_guard<std::mutex> guard(latch_);
+    const char *bitmap = deleted_bitmap(rid.page_no, rid.slot_no);
+    return bitmap != nullptr && !Bitmap::is_set(bitmap, rid.slot_no);
+}
+
+/**
+ * @description: 获取一条记录，已写入列文件的段需要从每个字段的压缩数据中分别解码出该行的值
+ * @return {unique_ptr<RmRecord>} 记录
+ * @param {Rid&} rid 记录号
+ */
+std::unique_ptr<RmRecord> CsTableHandle::get_record(const Rid &rid) const {
+    std::lock_guard<std::mutex> guard(latch_);
+    const char *bitmap = deleted_bitmap(rid.page_no, rid.slot_no);
+    if (bitmap == nullptr || Bitmap::is_set(bitmap, rid.slot_no)) {
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
+    }
+    auto record = std::make_unique<RmRecord>(hdr_.record_size);
+    if (rid.page_no == (int)segments_.size()) {
+        memcpy(record->data, tail_.data() + (size_t)rid.slot_no * hdr_.record_size, hdr_.record_size);
+        return record;
+    }
+    auto &seg = segments_[rid.page_no];
+    for (int i = 0; i < hdr_.num_cols; ++i) {
+        auto data = read_chunk(i, seg.chunks[i]);
+        CsCodec::decode_value(seg.chunks[i].encoding, cols_[i].len, data.data(), rid.slot_no,
+                              record->data + cols_[i].offset);
+    }
+    return record;
+}
+
+/**
+ * @description: 获取段中每一行是否可见
+ * @return {int} 段中的行数
+ * @param {int} seg_no 段号
+ * @param {vector<uint8_t>&} sel 第i行没有被删除时sel[i]为1，否则为0
+ */
+int CsTableHandle::read_visibility(int seg_no, std::vector<uint8_t> &sel) const {
+    std::lock_guard<std::mutex> guard(latch_);
+    int num_rows = seg_no < (int)segments_.size() ? segments_[seg_no].num_rows : num_tail_rows_;
+    const char *bitmap = seg_no < (int)segments_.size() ? segments_[seg_no].deleted.data() : tail_deleted_.data();
+    sel.resize(num_rows);
+    for (int i = 0; i < num_rows; ++i) {
+        sel[i] = !Bitmap::is_set(bitmap, i);
+    }
+    return num_rows;
+}
+
+/**
+ * @description: 将段中某个字段的前num_rows个值解码为按字段长度连续存放的值向量
+ * @param {int} seg_no 段号
+ * @param {int} col_idx 字段下标
+ * @param {int} num_rows 行数，不超过read_visibility返回的行数
+ * @param {vector<char>&} values 输出的值向量
+ */
+void CsTableHandle::read_column(int seg_no, int col_idx, int num_rows, std::vector<char> &values) const {
+    auto &col = cols_[col_idx];
+    values.resize((size_t)num_rows * col.len);
+    CsChunkMeta chunk;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        if (seg_no == (int)segments_.size()) {
+            for (int i = 0; i < num_rows; ++i) {
+                memcpy(values.data() + (size_t)i * col.len, tail_.data() + (size_t)i * hdr_.record_size + col.offset,
+                       col.len);
+            }
+            return;
+        }
+        chunk = segments_[seg_no].chunks[col_idx];
+    }
+    // 已写入的段不会再改变，解码时不需要持有latch_
+    auto data = read_chunk(col_idx, chunk);
+    CsCodec::decode(chunk.encoding, col.len, data.data(), num_rows, values.data());
+}
+
+/**
+ * @description: 将开放段中的行压缩写入列文件
+ */
+void CsTableHandle::seal_segment() {
+    std::lock_guard<std::mutex> guard(latch_);
+    seal_segment_locked();
+}
+
+/**
+ * @description: 将字段描述、段目录和删除位图写回表文件
+ */
+void CsTableHandle::flush() {
+    std::lock_guard<std::mutex> guard(latch_);
+    flush_locked();
+}
+
+void CsTableHandle::seal_segment_locked() {
+    if (num_tail_rows_ == 0) {
+        return;
+    }
+    CsSegment seg;
+    seg.num_rows = num_tail_rows_;
+    std::vector<char> values;
+    std::vector<char> data;
+    for (int i = 0; i < hdr_.num_cols; ++i) {
+        auto &col = cols_[i];
+        values.resize((size_t)num_tail_rows_ * col.len);
+        for (int row = 0; row < num_tail_rows_; ++row) {
+            memcpy(values.data() + (size_t)row * col.len, tail_.data() + (size_t)row * hdr_.record_size + col.offset,
+                   col.len);
+        }
+        data.clear();
+        CsChunkMeta chunk;
+        chunk.encoding = CsCodec::encode(static_cast<ColType>(col.type), col.len, values.data(), num_tail_rows_, data);
+        chunk.page_no = col_num_pages_[i];
+        chunk.num_bytes = data.size();
+        disk_manager_->write_page(col_fds_[i], chunk.page_no, data.data(), chunk.num_bytes);
+        col_num_pages_[i] += std::max(1, (chunk.num_bytes + PAGE_SIZE - 1) / PAGE_SIZE);
+        seg.chunks.push_back(chunk);
+    }
+    seg.deleted.assign(tail_deleted_.begin(), tail_deleted_.begin() + (num_tail_rows_ + BITMAP_WIDTH - 1) / BITMAP_WIDTH);
+    segments_.push_back(std::move(seg));
+    hdr_.num_segments++;
+
+    tail_.clear();
+    tail_deleted_.assign(CS_BITMAP_BYTES, 0);
+    num_tail_rows_ = 0;
+    flush_locked();
+}
+
+void CsTableHandle::flush_locked() {
+    std::vector<char> buf;
+    auto write = [&](const void *src, size_t n) {
+        buf.insert(buf.end(), static_cast<const char *>(src), static_cast<const char *>(src) + n);
+    };
+    write(&hdr_, sizeof(hdr_));
+    write(cols_.data(), sizeof(CsColDesc) * hdr_.num_cols);
+    for (auto &seg : segments_) {
+        write(&seg.num_rows, sizeof(int));
+        write(seg.chunks.data(), sizeof(CsChunkMeta) * hdr_.num_cols);
+        write(seg.deleted.data(), seg.deleted.size());
+    }
+    disk_manager_->write_page(fd_, CS_TABLE_HDR_PAGE, buf.data(), buf.size());
+}
+
+// 读出某个字段在一个段中的全部压缩数据
+std::vector<char> CsTableHandle::read_chunk(int col_idx, const CsChunkMeta &chunk) const {
+    std::vector<char> data(chunk.num_bytes);
+    disk_manager_->read_page(col_fds_[col_idx], chunk.page_no, data.data(), chunk.num_bytes);
+    return data;
+}
+
+// 返回记录所在段的删除位图，记录号不存在时返回nullptr，调用者需要持有latch_
+char *CsTableHandle::deleted_bitmap(int seg_no, int slot_no) {
+    return const_cast<char *>(static_cast<const CsTableHandle *>(this)->deleted_bitmap(seg_no, slot_no));
+}
+
+const char *CsTableHandle::deleted_bitmap(int seg_no, int slot_no) const {
+    if (seg_no < 0 || slot_no < 0) {
+        return nullptr;
+    }
+    if (seg_no < (int)segments_.size()) {
+        return slot_no < segments_[seg_no].num_rows ? segments_[seg_no].deleted.data() : nullptr;
+    }
+    if (seg_no == (int)segments_.size() && slot_no < num_tail_rows_) {
+        return tail_deleted_.data();
+    }
+    return nullptr;
+}
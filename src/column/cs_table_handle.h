@@ -0,0 +1,91 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "record/rm_defs.h"
+#include "cs_codec.h"
+#include "cs_defs.h"
+#include "storage/disk_manager.h"
+
+class CsManager;
+
+/* 已经压缩写入列文件的段 */
+struct CsSegment {
+    int num_rows;                       // 段中的行数
+    std::vector<CsChunkMeta> chunks;    // 每个字段的压缩数据的位置
+    std::vector<char> deleted;          // 删除位图，第i位为1表示第i行已经被删除
+};
+
+/**
+ * 列存表的句柄
+ * 表由一个表文件和每个字段一个的列文件组成：表文件记录字段描述、段目录和删除位图，列文件存放各段压缩后的数据。
+ * 新插入的行先追加到内存中的开放段，攒满CS_SEGMENT_ROWS行后按列压缩写入列文件，关闭表时不足一段的行也会写入。
+ * 记录号Rid的page_no为段号，slot_no为行在段中的下标，开放段的段号为已写入的段的个数，写入后记录号保持不变。
+ * 列文件只在写入新段时追加，读取时直接通过DiskManager读出整段压缩数据再解码，不经过缓冲池。
+ */
+class CsTableHandle {
+    friend class CsManager;
+
+   private:
+    DiskManager *disk_manager_;
+    int fd_;                            // 表文件
+    std::vector<int> col_fds_;          // 各字段的列文件
+    std::vector<int> col_num_pages_;    // 各列文件已经使用的页面个数
+    CsTableHdr hdr_;
+    std::vector<CsColDesc> cols_;
+    std::vector<CsSegment> segments_;
+    std::vector<char> tail_;            // 开放段中的行，按记录格式连续存放
+    std::vector<char> tail_deleted_;    // 开放段的删除位图
+    int num_tail_rows_ = 0;
+    mutable std::mutex latch_;          // 保护段目录、开放段和删除位图
+
+   public:
+    CsTableHandle(DiskManager *disk_manager, int fd, std::vector<int> col_fds);
+
+    const std::vector<CsColDesc> &get_cols() const { return cols_; }
+
+    int get_record_size() const { return hdr_.record_size; }
+
+    int num_segments() const;
+
+    Rid insert_record(const char *buf);
+
+    void insert_record(const Rid &rid, const char *buf);
+
+    void delete_record(const Rid &rid);
+
+    bool is_record(const Rid &rid) const;
+
+    std::unique_ptr<RmRecord> get_record(const Rid &rid) const;
+
+    int read_visibility(int seg_no, std::vector<uint8_t> &sel) const;
+
+    void read_column(int seg_no, int col_idx, int num_rows, std::vector<char> &values) const;
+
+    void seal_segment();
+
+    void flush();
+
+   private:
+    void seal_segment_locked();
+
+    void flush_locked();
+
+    std::vector<char> read_chunk(int col_idx, const CsChunkMeta &chunk) const;
+
+    char *deleted_bitmap(int seg_no, int slot_no);
+
+    const char *deleted_bitmap(int seg_no, int slot_no) const;
+};
@@ -62,7 +62,7 @@ struct Value {
         } else if (type == TYPE_FLOAT) {
             assert(len == sizeof(float));
             *(float *)(raw->data) = float_val;
-        } else if (type == TYPE_STRING) {
+        } else if (type == TYPE_STRING || type == TYPE_VARCHAR) {
             if (len < (int)str_val.size()) {
                 throw StringOverflowError();
             }
@@ -52,3 +52,5 @@ static const std::string LOG_FILE_NAME = "db.log";
 static const std::string REPLACER_TYPE = "LRU";
 
 static const std::string DB_META_NAME = "db.meta";
+
+static const std::string DB_STATS_NAME = "db.stats";  // ANALYZE收集的统计信息，与db.meta放在一起
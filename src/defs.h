@@ -37,21 +37,33 @@ struct Rid {
     }
 
     friend bool operator!=(const Rid &x, const Rid &y) { return !(x == y); }
+
+    // 按页号、槽号排序，按这个顺序访问记录时对表文件是顺序读
+    friend bool operator<(const Rid &x, const Rid &y) {
+        return x.page_no < y.page_no || (x.page_no == y.page_no && x.slot_no < y.slot_no);
+    }
 };
 
 enum ColType {
-    TYPE_INT, TYPE_FLOAT, TYPE_STRING
+    TYPE_INT, TYPE_FLOAT, TYPE_STRING, TYPE_VARCHAR
 };
 
 inline std::string coltype2str(ColType type) {
     std::map<ColType, std::string> m = {
             {TYPE_INT,    "INT"},
             {TYPE_FLOAT,  "FLOAT"},
-            {TYPE_STRING, "STRING"}
+            {TYPE_STRING, "STRING"},
+            {TYPE_VARCHAR, "VARCHAR"}
     };
     return m.at(type);
 }
 
+// VARCHAR在内存中与CHAR一样按最大长度补0存储，字符串常量可以直接赋值给两者
+inline bool is_compatible_type(ColType lhs, ColType rhs) {
+    auto is_str = [](ColType type) { return type == TYPE_STRING || type == TYPE_VARCHAR; };
+    return lhs == rhs || (is_str(lhs) && is_str(rhs));
+}
+
 class RecScan {
 public:
     virtual ~RecScan() = default;
@@ -71,12 +71,27 @@ class InvalidRecordSizeError : public RMDBError {
     InvalidRecordSizeError(int record_size) : RMDBError("Invalid record size: " + std::to_string(record_size)) {}
 };
 
+class RecordFormatVersionError : public RMDBError {
+   public:
+    RecordFormatVersionError(const std::string &filename, int version, int expected)
+        : RMDBError("Unsupported record file format version " + std::to_string(version) + " (expected " +
+                    std::to_string(expected) + "), recreate the database: " + filename) {}
+};
+
 // IX errors
 class InvalidColLengthError : public RMDBError {
    public:
     InvalidColLengthError(int col_len) : RMDBError("Invalid column length: " + std::to_string(col_len)) {}
 };
 
+class IndexFormatVersionError : public RMDBError {
+   public:
+    IndexFormatVersionError(const std::string &filename, int version)
+        : RMDBError((version < 0 ? std::string("Index file has no format version")
+                                 : "Unsupported index file format version " + std::to_string(version)) +
+                    ", rebuild the index: " + filename) {}
+};
+
 class IndexEntryNotFoundError : public RMDBError {
    public:
     IndexEntryNotFoundError() : RMDBError("Index entry not found") {}
@@ -103,6 +118,32 @@ class TableExistsError : public RMDBError {
     TableExistsError(const std::string &tab_name) : RMDBError("Table already exists: " + tab_name) {}
 };
 
+class UnknownStorageError : public RMDBError {
+   public:
+    UnknownStorageError(const std::string &storage) : RMDBError("Unknown table storage: " + storage) {}
+};
+
+class UnknownIndexTypeError : public RMDBError {
+   public:
+    UnknownIndexTypeError(const std::string &method) : RMDBError("Unknown index type: " + method) {}
+};
+
+class HashIndexUnsupportedError : public RMDBError {
+   public:
+    HashIndexUnsupportedError(const std::string &op) : RMDBError("Hash index does not support " + op) {}
+};
+
+class LsmIndexUnsupportedError : public RMDBError {
+   public:
+    LsmIndexUnsupportedError(const std::string &op) : RMDBError("LSM index does not support " + op) {}
+};
+
+class ColumnarUnsupportedError : public RMDBError {
+   public:
+    ColumnarUnsupportedError(const std::string &tab_name, const std::string &op)
+        : RMDBError("Columnar table does not support " + op + ": " + tab_name) {}
+};
+
 class ColumnNotFoundError : public RMDBError {
    public:
     ColumnNotFoundError(const std::string &col_name) : RMDBError("Column not found: " + col_name) {}
@@ -132,6 +173,29 @@ class IndexExistsError : public RMDBError {
     }
 };
 
+class UniqueIndexUnsupportedError : public RMDBError {
+   public:
+    UniqueIndexUnsupportedError(const std::string &op) : RMDBError("Unique index does not support " + op) {}
+};
+
+class UniqueKeyViolationError : public RMDBError {
+   public:
+    UniqueKeyViolationError(const std::string &tab_name, const std::vector<std::string> &col_names) {
+        _msg += "Duplicate key in unique index: " + tab_name + ".(";
+        for(size_t i = 0; i < col_names.size(); ++i) {
+            if(i > 0) _msg += ", ";
+            _msg += col_names[i];
+        }
+        _msg += ")";
+    }
+};
+
+class IndexBuildInProgressError : public RMDBError {
+   public:
+    IndexBuildInProgressError(const std::string &tab_name)
+        : RMDBError("Another concurrent index build is in progress on table: " + tab_name) {}
+};
+
 // QL errors
 class InvalidValueCountError : public RMDBError {
    public:
@@ -0,0 +1,87 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "common/common.h"
+#include "errors.h"
+
+/**
+ * 按列计算"字段 op 常量"谓词的过滤器
+ * 输入为按字段长度连续存放的值向量（PAX页面的minipage或列存表解码后的列），
+ * 不满足谓词的值在选择向量sel中对应的位置被清0
+ */
+class ColumnFilter {
+   public:
+    using Eval = std::function<void(const char *values, int num_values, uint8_t *sel)>;
+
+    /**
+     * @description: 根据字段类型和比较运算符生成过滤器
+     * @param {ColType} type 字段类型
+     * @param {int} len 字段长度
+     * @param {CompOp} op 比较运算符
+     * @param {shared_ptr<RmRecord>&} raw 常量按字段长度编码后的值
+     */
+    static Eval make(ColType type, int len, CompOp op, const std::shared_ptr<RmRecord> &raw) {
+        switch (type) {
+            case TYPE_INT: {
+                int rhs;
+                memcpy(&rhs, raw->data, sizeof(int));
+                return make_numeric<int>(op, rhs);
+            }
+            case TYPE_FLOAT: {
+                float rhs;
+                memcpy(&rhs, raw->data, sizeof(float));
+                return make_numeric<float>(op, rhs);
+            }
+            default: {
+                std::string rhs(raw->data, len);
+                return [rhs, len, op](const char *v, int n, uint8_t *sel) {
+                    for (int i = 0; i < n; ++i) {
+                        int res = memcmp(v + (size_t)i * len, rhs.data(), len);
+                        bool ok = (op == OP_EQ && res == 0) || (op == OP_NE && res != 0) || (op == OP_LT && res < 0) ||
+                                  (op == OP_GT && res > 0) || (op == OP_LE && res <= 0) || (op == OP_GE && res >= 0);
+                        sel[i] &= static_cast<uint8_t>(ok);
+                    }
+                };
+            }
+        }
+    }
+
+   private:
+    // 定长数值列的过滤核心，循环体没有分支，编译器可以将其向量化
+    template <typename T, typename Cmp>
+    static void filter_column(const char *values, int num_values, uint8_t *sel, T rhs) {
+        Cmp cmp;
+        for (int i = 0; i < num_values; ++i) {
+            T value;
+            memcpy(&value, values + i * sizeof(T), sizeof(T));
+            sel[i] &= static_cast<uint8_t>(cmp(value, rhs));
+        }
+    }
+
+    template <typename T>
+    static Eval make_numeric(CompOp op, T rhs) {
+        switch (op) {
+            case OP_EQ: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::equal_to<T>>(v, n, sel, rhs); };
+            case OP_NE: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::not_equal_to<T>>(v, n, sel, rhs); };
+            case OP_LT: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::less<T>>(v, n, sel, rhs); };
+            case OP_GT: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::greater<T>>(v, n, sel, rhs); };
+            case OP_LE: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::less_equal<T>>(v, n, sel, rhs); };
+            case OP_GE: return [rhs](const char *v, int n, uint8_t *sel) { filter_column<T, std::greater_equal<T>>(v, n, sel, rhs); };
+            default: throw InternalError("Unexpected op type");
+        }
+    }
+};
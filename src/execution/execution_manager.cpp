@@ -23,16 +23,17 @@ See the Mulan PSL v2 for more details. */
 const char *help_info = "Supported SQL syntax:\n"
                    "  command ;\n"
                    "command:\n"
-                   "  CREATE TABLE table_name (column_name type [, column_name type ...])\n"
+                   "  CREATE TABLE table_name (column_name type [, column_name type ...]) [USING {ROW | PAX | COLUMNAR}]\n"
                    "  DROP TABLE table_name\n"
-                   "  CREATE INDEX table_name (column_name)\n"
+                   "  CREATE INDEX [CONCURRENTLY] table_name (column_name)\n"
                    "  DROP INDEX table_name (column_name)\n"
+                   "  ANALYZE table_name\n"
                    "  INSERT INTO table_name VALUES (value [, value ...])\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
                    "  SELECT selector FROM table_name [WHERE where_clause]\n"
                    "type:\n"
-                   "  {INT | FLOAT | CHAR(n)}\n"
+                   "  {INT | FLOAT | CHAR(n) | VARCHAR(n)}\n"
                    "where_clause:\n"
                    "  condition [AND condition ...]\n"
                    "condition:\n"
@@ -50,7 +51,7 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
         switch(x->tag) {
             case T_CreateTable:
             {
-                sm_manager_->create_table(x->tab_name_, x->cols_, context);
+                sm_manager_->create_table(x->tab_name_, x->cols_, context, x->storage_);
                 break;
             }
             case T_DropTable:
@@ -60,7 +61,13 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
             }
             case T_CreateIndex:
             {
-                sm_manager_->create_index(x->tab_name_, x->tab_col_names_, context);
+                if (x->concurrently_) {
+                    sm_manager_->create_indexes_concurrently(x->tab_name_, x->index_col_names_, x->include_col_names_,
+                                                             x->index_type_, context);
+                } else {
+                    sm_manager_->create_indexes(x->tab_name_, x->index_col_names_, x->include_col_names_, x->index_type_,
+                                                x->unique_, context);
+                }
                 break;
             }
             case T_DropIndex:
@@ -75,7 +82,7 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
     }
 }
 
-// 执行help; show tables; desc table; begin; commit; abort;语句
+// 执行help; show tables; desc table; analyze table; begin; commit; abort;语句
 void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Context *context) {
     if (auto x = std::dynamic_pointer_cast<OtherPlan>(plan)) {
         switch(x->tag) {
@@ -95,6 +102,11 @@ void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Co
                 sm_manager_->desc_table(x->tab_name_, context);
                 break;
             }
+            case T_Analyze:
+            {
+                sm_manager_->analyze_table(x->tab_name_, context);
+                break;
+            }
             case T_Transaction_begin:
             {
                 // 显示开启一个事务
@@ -163,7 +175,7 @@ void QlManager::select_from(std::unique_ptr<AbstractExecutor> executorTreeRoot,
                 col_str = std::to_string(*(int *)rec_buf);
             } else if (col.type == TYPE_FLOAT) {
                 col_str = std::to_string(*(float *)rec_buf);
-            } else if (col.type == TYPE_STRING) {
+            } else if (col.type == TYPE_STRING || col.type == TYPE_VARCHAR) {
                 col_str = std::string((char *)rec_buf, col.len);
                 col_str.resize(strlen(col_str.c_str()));
             }
@@ -0,0 +1,218 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "executor_index_scan.h"
+#include "index/ix.h"
+#include "rid_bitmap.h"
+#include "system/sm.h"
+
+/**
+ * @brief 位图堆扫描：先从一个或多个索引中取出满足条件的rid，合并成按页面有序的位图，再按页号顺序访问堆表，
+ * 每个页面只读取一次。多个索引的位图按AND求交，所有条件在读取记录之后重新检查，输出顺序与顺序扫描相同
+ */
+class BitmapHeapScanExecutor : public AbstractExecutor {
+   private:
+    std::string tab_name_;                      // 表名称
+    TabMeta tab_;                               // 表的元数据
+    std::vector<Condition> fed_conds_;          // 扫描条件，左侧都是本表的字段
+    RmFileHandle *fh_;                          // 表的数据文件句柄
+    std::vector<ColMeta> cols_;                 // 需要读取的字段
+    size_t len_;                                // 选取出来的一条记录的长度
+    std::vector<IndexMeta> index_metas_;        // 参与求交的索引
+
+    RidBitmap bitmap_;                          // 所有索引的rid求交之后的结果
+    std::map<int, std::vector<uint64_t>>::const_iterator page_;     // 当前访问的页面
+    std::vector<int> slot_nos_;                 // 当前页面中被选中的槽号
+    std::vector<std::unique_ptr<RmRecord>> recs_;   // 当前页面中被选中的记录，与slot_nos_一一对应
+    size_t pos_ = 0;                            // 当前记录在recs_中的下标
+
+    Rid rid_;
+    SmManager *sm_manager_;
+
+   public:
+    BitmapHeapScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                           const std::vector<std::vector<std::string>> &index_col_names, Context *context) {
+        sm_manager_ = sm_manager;
+        context_ = context;
+        tab_name_ = std::move(tab_name);
+        tab_ = sm_manager_->db_.get_table(tab_name_);
+        for (auto &col_names : index_col_names) {
+            index_metas_.push_back(*(tab_.get_index_meta(col_names)));
+        }
+        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        cols_ = tab_.cols;
+        len_ = cols_.back().offset + cols_.back().len;
+        std::map<CompOp, CompOp> swap_op = {
+            {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+        };
+        for (auto &cond : conds) {
+            if (cond.lhs_col.tab_name != tab_name_) {
+                // lhs is on other table, now rhs must be on this table
+                assert(!cond.is_rhs_val && cond.rhs_col.tab_name == tab_name_);
+                std::swap(cond.lhs_col, cond.rhs_col);
+                cond.op = swap_op.at(cond.op);
+            }
+        }
+        fed_conds_ = std::move(conds);
+        page_ = bitmap_.pages().end();
+
+        if (context) {
+            context->lock_mgr_->lock_shared_on_table(context->txn_, fh_->GetFd());
+        }
+    }
+
+    bool is_end() const override { return page_ == bitmap_.pages().end(); }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "BitmapHeapScanExecutor"; }
+
+    void beginTuple() override {
+        build_bitmap();
+        page_ = bitmap_.pages().begin();
+        load_page();
+        seek_match();
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        pos_++;
+        seek_match();
+    }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(*recs_[pos_]);
+    }
+
+    Rid &rid() override { return rid_; }
+
+   private:
+    /* 每个索引取出满足其条件的rid组成位图，各个位图求交 */
+    void build_bitmap() {
+        bitmap_ = RidBitmap();
+        std::vector<Rid> rids;
+        for (size_t i = 0; i < index_metas_.size(); ++i) {
+            auto &index = index_metas_[i];
+            rids.clear();
+            index_rids(index, &rids);
+            RidBitmap bitmap;
+            for (auto &rid : rids) {
+                bitmap.add(rid);
+            }
+            if (i == 0) {
+                bitmap_ = std::move(bitmap);
+            } else {
+                bitmap_.intersect_with(bitmap);
+            }
+            if (bitmap_.empty()) {
+                break;
+            }
+        }
+    }
+
+    /* 取出一个索引中可能满足条件的rid：B+树和LSM索引按第一个字段上的条件取范围，哈希索引按完整的key点查 */
+    void index_rids(const IndexMeta &index, std::vector<Rid> *rids) {
+        Transaction *txn = context_ == nullptr ? nullptr : context_->txn_;
+        if (index.type == INDEX_HASH) {
+            char key[IX_MAX_COL_LEN];
+            int offset = 0;
+            for (auto &col : index.cols) {
+                auto cond = std::find_if(fed_conds_.begin(), fed_conds_.end(), [&](const Condition &cond) {
+                    return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.col_name == col.name;
+                });
+                if (cond == fed_conds_.end()) {
+                    throw InternalError("Hash index scan needs an equality condition on " + col.name);
+                }
+                memcpy(key + offset, cond->rhs_val.raw->data, col.len);
+                offset += col.len;
+            }
+            sm_manager_->get_index_handle(tab_name_, index)->get_value(key, rids, txn);
+            return;
+        }
+        if (index.type == INDEX_LSM) {
+            auto ih = static_cast<IxLsmHandle *>(sm_manager_->get_index_handle(tab_name_, index));
+            IxLsmBound lower, upper;
+            IndexScanExecutor::scan_range(ih, index, fed_conds_, &lower, &upper);
+            for (IxLsmScan scan(ih, lower, upper); !scan.is_end(); scan.next()) {
+                rids->push_back(scan.rid());
+            }
+            return;
+        }
+        auto ih = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(tab_name_, index));
+        Iid lower, upper;
+        IndexScanExecutor::scan_range(ih, index, fed_conds_, &lower, &upper);
+        // 位图负责按页面排序，这里不需要对rid排序
+        ih->get_rids(lower, upper, rids, false);
+    }
+
+    /* 读取page_指向的页面中被选中的所有记录 */
+    void load_page() {
+        pos_ = 0;
+        recs_.clear();
+        if (page_ != bitmap_.pages().end()) {
+            RidBitmap::to_slots(page_->second, &slot_nos_);
+            fh_->get_records(page_->first, slot_nos_, recs_);
+        }
+    }
+
+    /* 从当前位置开始跳过不满足谓词条件的记录，当前页面读完时转到下一个页面 */
+    void seek_match() {
+        while (page_ != bitmap_.pages().end()) {
+            for (; pos_ < recs_.size(); ++pos_) {
+                if (eval_conds(cols_, fed_conds_, recs_[pos_].get())) {
+                    rid_ = {page_->first, slot_nos_[pos_]};
+                    return;
+                }
+            }
+            ++page_;
+            load_page();
+        }
+    }
+
+    bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
+        auto lhs_col = get_col(rec_cols, cond.lhs_col);
+        char *lhs = rec->data + lhs_col->offset;
+        char *rhs;
+        ColType rhs_type;
+        if (cond.is_rhs_val) {
+            rhs_type = cond.rhs_val.type;
+            rhs = cond.rhs_val.raw->data;
+        } else {
+            // rhs is a column
+            auto rhs_col = get_col(rec_cols, cond.rhs_col);
+            rhs_type = rhs_col->type;
+            rhs = rec->data + rhs_col->offset;
+        }
+        assert(rhs_type == lhs_col->type);  // TODO convert to common type
+        int cmp = ix_compare(lhs, rhs, rhs_type, lhs_col->len);
+        switch (cond.op) {
+            case OP_EQ: return cmp == 0;
+            case OP_NE: return cmp != 0;
+            case OP_LT: return cmp < 0;
+            case OP_GT: return cmp > 0;
+            case OP_LE: return cmp <= 0;
+            case OP_GE: return cmp >= 0;
+            default: throw InternalError("Unexpected op type");
+        }
+    }
+
+    bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const RmRecord *rec) {
+        return std::all_of(conds.begin(), conds.end(),
+                           [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
+    }
+};
@@ -0,0 +1,210 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "column_filter.h"
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * 列存表的顺序扫描
+ * 以段为单位扫描：先解码谓词涉及的字段并按列批量计算谓词，段中有满足条件的行时才解码其余字段，
+ * 最后只为满足条件的行拼接出元组
+ */
+class ColumnarScanExecutor : public AbstractExecutor {
+   private:
+    struct ColFilter {
+        size_t col_idx;             // 谓词左侧字段在cols_中的下标
+        ColumnFilter::Eval eval;
+    };
+
+    std::string tab_name_;              // 表的名称
+    std::vector<Condition> conds_;      // scan的条件
+    CsTableHandle *ch_;                 // 列存表的句柄
+    std::vector<ColMeta> cols_;         // scan后生成的记录的字段
+    size_t len_;                        // scan后生成的每条记录的长度
+    std::vector<Condition> fed_conds_;  // 同conds_，两个字段相同
+
+    std::vector<ColFilter> col_filters_;    // 可以按列计算的谓词
+    std::vector<Condition> row_conds_;      // 需要在完整元组上计算的谓词
+
+    int seg_no_ = -1;                           // 当前扫描到的段
+    std::vector<std::vector<char>> vectors_;    // 当前段中各字段解码后的值向量，没有解码的字段为空
+    std::vector<int> seg_rows_;                 // 当前段中满足col_filters_的行
+    size_t row_idx_ = 0;                        // 当前行在seg_rows_中的下标
+
+    Rid rid_;
+    SmManager *sm_manager_;
+
+   public:
+    ColumnarScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, Context *context) {
+        sm_manager_ = sm_manager;
+        tab_name_ = std::move(tab_name);
+        conds_ = std::move(conds);
+        TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
+        ch_ = sm_manager_->chs_.at(tab_name_).get();
+        cols_ = tab.cols;
+        len_ = cols_.back().offset + cols_.back().len;
+
+        context_ = context;
+
+        fed_conds_ = conds_;
+        build_column_filters();
+    }
+
+    bool is_end() const override { return seg_no_ == -1; }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override {
+        seg_no_ = -1;
+        next_segment(0);
+    }
+
+    void nextTuple() override {
+        row_idx_++;
+        if (!seek_tuple()) {
+            next_segment(seg_no_ + 1);
+        }
+    }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        auto rec = std::make_unique<RmRecord>(len_);
+        materialize(seg_rows_[row_idx_], rec.get());
+        return rec;
+    }
+
+    Rid &rid() override { return rid_; }
+
+   private:
+    /**
+     * @description: 将fed_conds_中"字段 op 常量"的谓词转换为按列计算的过滤器，其余谓词在拼接出的元组上计算
+     */
+    void build_column_filters() {
+        for (auto &cond : fed_conds_) {
+            if (!cond.is_rhs_val || cond.lhs_col.tab_name != tab_name_) {
+                row_conds_.push_back(cond);
+                continue;
+            }
+            auto lhs_col = get_col(cols_, cond.lhs_col);
+            if (!is_compatible_type(lhs_col->type, cond.rhs_val.type)) {
+                row_conds_.push_back(cond);
+                continue;
+            }
+            size_t col_idx = lhs_col - cols_.cbegin();
+            col_filters_.push_back({col_idx, ColumnFilter::make(lhs_col->type, lhs_col->len, cond.op, cond.rhs_val.raw)});
+        }
+    }
+
+    /**
+     * @description: 从第seg_no个段开始，找到第一个包含满足所有谓词的行的段
+     */
+    void next_segment(int seg_no) {
+        int num_segments = ch_->num_segments();
+        std::vector<uint8_t> sel;
+        for (seg_no_ = seg_no; seg_no_ < num_segments; seg_no_++) {
+            int num_rows = ch_->read_visibility(seg_no_, sel);
+            vectors_.assign(cols_.size(), std::vector<char>());
+            for (auto &filter : col_filters_) {
+                auto &values = vectors_[filter.col_idx];
+                if (values.empty()) {
+                    ch_->read_column(seg_no_, filter.col_idx, num_rows, values);
+                }
+                filter.eval(values.data(), num_rows, sel.data());
+            }
+            seg_rows_.clear();
+            for (int i = 0; i < num_rows; ++i) {
+                if (sel[i]) {
+                    seg_rows_.push_back(i);
+                }
+            }
+            if (seg_rows_.empty()) {
+                continue;
+            }
+            // 段中有满足条件的行，解码其余字段
+            for (size_t i = 0; i < cols_.size(); ++i) {
+                if (vectors_[i].empty()) {
+                    ch_->read_column(seg_no_, i, num_rows, vectors_[i]);
+                }
+            }
+            row_idx_ = 0;
+            if (seek_tuple()) {
+                return;
+            }
+        }
+        seg_no_ = -1;
+    }
+
+    /**
+     * @description: 从row_idx_开始找到当前段中第一个满足row_conds_的行
+     */
+    bool seek_tuple() {
+        RmRecord rec(len_);
+        for (; row_idx_ < seg_rows_.size(); row_idx_++) {
+            rid_ = {seg_no_, seg_rows_[row_idx_]};
+            if (row_conds_.empty()) {
+                return true;
+            }
+            materialize(seg_rows_[row_idx_], &rec);
+            if (eval_conds(cols_, row_conds_, &rec)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 将当前段的第row行拼接为元组
+    void materialize(int row, RmRecord *rec) const {
+        for (size_t i = 0; i < cols_.size(); ++i) {
+            memcpy(rec->data + cols_[i].offset, vectors_[i].data() + (size_t)row * cols_[i].len, cols_[i].len);
+        }
+    }
+
+    bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
+        auto lhs_col = get_col(rec_cols, cond.lhs_col);
+        char *lhs = rec->data + lhs_col->offset;
+        ColType rhs_type;
+        char *rhs;
+        if (cond.is_rhs_val) {
+            rhs_type = cond.rhs_val.type;
+            rhs = cond.rhs_val.raw->data;
+        } else {
+            auto rhs_col = get_col(rec_cols, cond.rhs_col);
+            rhs_type = rhs_col->type;
+            rhs = rec->data + rhs_col->offset;
+        }
+        int result = ix_compare(lhs, rhs, rhs_type, lhs_col->len);
+        switch (cond.op) {
+            case OP_EQ: return result == 0;
+            case OP_NE: return result != 0;
+            case OP_LT: return result < 0;
+            case OP_GT: return result > 0;
+            case OP_LE: return result <= 0;
+            case OP_GE: return result >= 0;
+            default: return false;
+        }
+    }
+
+    bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const RmRecord *rec) {
+        for (auto &cond : conds) {
+            if (!eval_cond(rec_cols, cond, rec)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -20,6 +20,7 @@ class DeleteExecutor : public AbstractExecutor {
     TabMeta tab_;                   // 表的元数据
     std::vector<Condition> conds_;  // delete的条件
     RmFileHandle *fh_;              // 表的数据文件句柄
+    CsTableHandle *ch_;             // 列存表的句柄，行存表为nullptr
     std::vector<Rid> rids_;         // 需要删除的记录的位置
     std::string tab_name_;          // 表名称
     SmManager *sm_manager_;
@@ -30,7 +31,13 @@ class DeleteExecutor : public AbstractExecutor {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        if (sm_manager_->is_columnar(tab_name)) {
+            fh_ = nullptr;
+            ch_ = sm_manager_->chs_.at(tab_name).get();
+        } else {
+            fh_ = sm_manager_->fhs_.at(tab_name).get();
+            ch_ = nullptr;
+        }
         conds_ = conds;
         rids_ = rids;
         context_ = context;
@@ -40,17 +47,33 @@ class DeleteExecutor : public AbstractExecutor {
     // 删除记录组rids，需要先删除这些记录上的索引，然后再删除这些记录
     // 首先获得所有的索引句柄
     // Get all index files
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
-        for (size_t col_i = 0; col_i < tab_.cols.size(); col_i++) {
-            if (tab_.cols[col_i].index) {
-                // lab3 task3 Todo
-                // 获取需要的索引句柄,填充vector ihs
-                auto index = tab_.indexes[col_i];
-                ihs[col_i]=sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_,index.cols)).get();
-                // lab3 task3 Todo end
+        // 持有到索引维护完成，期间在线建索引不会切换；构造之后可能有在线建索引加入了新的索引，重新读取索引列表
+        IndexBuildLog *build_log;
+        auto build_lock = sm_manager_->lock_table_write(tab_name_, &build_log);
+        tab_.indexes = sm_manager_->db_.get_table(tab_name_).indexes;
+        // ihs[i]对应tab_.indexes[i]
+        std::vector<IxIndex *> ihs(tab_.indexes.size(), nullptr);
+        for (size_t i = 0; i < tab_.indexes.size(); i++) {
+            // lab3 task3 Todo
+            // 获取需要的索引句柄,填充vector ihs
+            auto &index = tab_.indexes[i];
+            ihs[i] = sm_manager_->get_index_handle(tab_name_, index);
+            // lab3 task3 Todo end
+        }
+        // 列存表上没有索引，只需要在删除位图中标记
+        if (ch_ != nullptr) {
+            for (auto &rid : rids_) {
+                auto rec = ch_->get_record(rid);
+                WriteRecord* wr = new WriteRecord(WType::DELETE_TUPLE, tab_name_, rid, *rec);
+                context_->txn_->append_write_record(wr);
+                ch_->delete_record(rid);
             }
+            return nullptr;
         }
         // Delete each rid from record file and index file
+        // 先读出所有要删除的记录，再按索引批量删除索引项，最后删除记录
+        std::vector<std::unique_ptr<RmRecord>> recs;
+        recs.reserve(rids_.size());
         for (auto &rid : rids_) {
             auto rec = fh_->get_record(rid, context_);
             // lab3 task3 Todo
@@ -58,18 +81,35 @@ class DeleteExecutor : public AbstractExecutor {
             // Delete from record file
             WriteRecord* wr = new WriteRecord(WType::DELETE_TUPLE, tab_name_, rid, *rec);
             context_->txn_->append_write_record(wr);
-            for(int i=0;i<tab_.cols.size();i++){
-                if(!ihs[i])continue;
-                ihs[i]->delete_entry(rec->data+tab_.cols[i].offset,nullptr);
+            recs.push_back(std::move(rec));
+        }
+        // 索引中可能有重复的key，按(key, rid)删除这条记录自己的项
+        // B+树把所有项按key排序之后逐个叶子删除，删除期间不合并结点；哈希索引和LSM索引逐项删除
+        for (size_t i = 0; i < tab_.indexes.size(); i++) {
+            auto &index = tab_.indexes[i];
+            if (index.type != INDEX_BTREE) {
+                char key[IX_MAX_COL_LEN];
+                for (size_t j = 0; j < rids_.size(); j++) {
+                    index.make_key(recs[j]->data, key);
+                    ihs[i]->delete_entry(key, rids_[j], context_->txn_);
+                }
+                continue;
+            }
+            int key_len = index.col_tot_len + index.include_len();
+            std::vector<char> keys(rids_.size() * key_len);
+            for (size_t j = 0; j < rids_.size(); j++) {
+                index.make_key(recs[j]->data, keys.data() + j * key_len);
+            }
+            static_cast<IxIndexHandle *>(ihs[i])->delete_entries(keys.data(), rids_.data(),
+                                                                 static_cast<int>(rids_.size()), context_->txn_);
+        }
+        for (size_t j = 0; j < rids_.size(); j++) {
+            fh_->delete_record(rids_[j], context_);
+            if (build_log != nullptr) {
+                build_log->append(false, rids_[j], recs[j]->data, recs[j]->size);
             }
-            fh_->delete_record(rid,context_);
-            
-            // lab3 task3 Todo end
-
-            // record a delete operation into the transaction
-            RmRecord delete_record{rec->size};
-            memcpy(delete_record.data, rec->data, rec->size);
         }
+        // lab3 task3 Todo end
         return nullptr;
     }
 
@@ -0,0 +1,154 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief 哈希索引扫描：planner保证每个索引字段上都有等值条件，用这些值拼出完整的key点查一次，
+ * 得到的rid按堆表位置有序，逐条读取记录并检查其余条件。开启了key缓存的B+树索引也使用这种扫描
+ */
+class HashIndexScanExecutor : public AbstractExecutor {
+   private:
+    std::string tab_name_;                      // 表名称
+    TabMeta tab_;                               // 表的元数据
+    std::vector<Condition> fed_conds_;          // 扫描条件，左侧都是本表的字段
+    RmFileHandle *fh_;                          // 表的数据文件句柄
+    std::vector<ColMeta> cols_;                 // 需要读取的字段
+    size_t len_;                                // 选取出来的一条记录的长度
+
+    IndexMeta index_meta_;                      // 使用的哈希索引
+    IxIndex *ih_;
+    std::vector<Rid> rids_;                     // key对应的所有记录
+    size_t pos_ = 0;                            // 当前记录在rids_中的下标
+
+    Rid rid_;
+    SmManager *sm_manager_;
+
+   public:
+    HashIndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                          std::vector<std::string> index_col_names, Context *context) {
+        sm_manager_ = sm_manager;
+        context_ = context;
+        tab_name_ = std::move(tab_name);
+        tab_ = sm_manager_->db_.get_table(tab_name_);
+        index_meta_ = *(tab_.get_index_meta(index_col_names));
+        ih_ = sm_manager_->get_index_handle(tab_name_, index_meta_);
+        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        cols_ = tab_.cols;
+        len_ = cols_.back().offset + cols_.back().len;
+        std::map<CompOp, CompOp> swap_op = {
+            {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+        };
+        for (auto &cond : conds) {
+            if (cond.lhs_col.tab_name != tab_name_) {
+                // lhs is on other table, now rhs must be on this table
+                assert(!cond.is_rhs_val && cond.rhs_col.tab_name == tab_name_);
+                std::swap(cond.lhs_col, cond.rhs_col);
+                cond.op = swap_op.at(cond.op);
+            }
+        }
+        fed_conds_ = std::move(conds);
+
+        if (context) {
+            context->lock_mgr_->lock_shared_on_table(context->txn_, fh_->GetFd());
+        }
+    }
+
+    bool is_end() const override { return pos_ >= rids_.size(); }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "HashIndexScanExecutor"; }
+
+    void beginTuple() override {
+        // 按索引字段的顺序拼出key
+        char key[IX_MAX_COL_LEN];
+        int offset = 0;
+        for (auto &col : index_meta_.cols) {
+            auto cond = std::find_if(fed_conds_.begin(), fed_conds_.end(), [&](const Condition &cond) {
+                return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.col_name == col.name;
+            });
+            if (cond == fed_conds_.end()) {
+                throw InternalError("Hash index scan needs an equality condition on " + col.name);
+            }
+            memcpy(key + offset, cond->rhs_val.raw->data, col.len);
+            offset += col.len;
+        }
+        rids_.clear();
+        ih_->get_value(key, &rids_, context_ == nullptr ? nullptr : context_->txn_);
+        pos_ = 0;
+        seek_match();
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        pos_++;
+        seek_match();
+    }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return fh_->get_record(rid_, context_);
+    }
+
+    Rid &rid() override { return rid_; }
+
+   private:
+    /* 从pos_开始跳过不满足谓词条件的记录 */
+    void seek_match() {
+        for (; pos_ < rids_.size(); ++pos_) {
+            rid_ = rids_[pos_];
+            auto rec = fh_->get_record(rid_, context_);
+            if (eval_conds(cols_, fed_conds_, rec.get())) {
+                break;
+            }
+        }
+    }
+
+    bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
+        auto lhs_col = get_col(rec_cols, cond.lhs_col);
+        char *lhs = rec->data + lhs_col->offset;
+        char *rhs;
+        ColType rhs_type;
+        if (cond.is_rhs_val) {
+            rhs_type = cond.rhs_val.type;
+            rhs = cond.rhs_val.raw->data;
+        } else {
+            // rhs is a column
+            auto rhs_col = get_col(rec_cols, cond.rhs_col);
+            rhs_type = rhs_col->type;
+            rhs = rec->data + rhs_col->offset;
+        }
+        assert(rhs_type == lhs_col->type);  // TODO convert to common type
+        int cmp = ix_compare(lhs, rhs, rhs_type, lhs_col->len);
+        switch (cond.op) {
+            case OP_EQ: return cmp == 0;
+            case OP_NE: return cmp != 0;
+            case OP_LT: return cmp < 0;
+            case OP_GT: return cmp > 0;
+            case OP_LE: return cmp <= 0;
+            case OP_GE: return cmp >= 0;
+            default: throw InternalError("Unexpected op type");
+        }
+    }
+
+    bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const RmRecord *rec) {
+        return std::all_of(conds.begin(), conds.end(),
+                           [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
+    }
+};
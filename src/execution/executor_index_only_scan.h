@@ -0,0 +1,66 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "executor_index_scan.h"
+
+/**
+ * @brief 只访问索引的扫描：查询涉及的字段都是索引字段或INCLUDE字段时，由planner选择
+ * 扫描范围与IndexScanExecutor相同，但记录直接从叶子中的索引项还原，不读取表的数据页。
+ * 还原出的记录与表的记录等长，索引之外的字段填'\0'，planner保证上层不会访问这些字段
+ */
+class IndexOnlyScanExecutor : public IndexScanExecutor {
+   private:
+    struct ColCopy {
+        int rec_offset;     // 字段在表的记录中的位置
+        int key_offset;     // 字段在解码之后的索引项中的位置
+        int len;
+    };
+    std::vector<ColCopy> copies_;       // 从索引项还原记录时需要拷贝的字段
+
+   public:
+    IndexOnlyScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                          std::vector<std::string> index_col_names, Context *context)
+        : IndexScanExecutor(sm_manager, std::move(tab_name), std::move(conds), std::move(index_col_names), context) {
+        scan_keys_ = true;
+        int key_offset = 0;
+        for (auto &col : index_meta_.cols) {
+            copies_.push_back({col.offset, key_offset, col.len});
+            key_offset += col.len;
+        }
+        // INCLUDE列排在rid之后
+        key_offset = ih_->get_file_hdr()->include_offset();
+        for (auto &col : index_meta_.include_cols) {
+            copies_.push_back({col.offset, key_offset, col.len});
+            key_offset += col.len;
+        }
+    }
+
+    std::string getType() override { return "IndexOnlyScanExecutor"; }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(*rec_);
+    }
+
+   protected:
+    void fetch_record() override {
+        rid_ = scan_->rid();
+        const char *key = static_cast<IxScan *>(scan_.get())->key();   // 只访问索引的扫描只使用B+树
+        if (rec_ == nullptr) {
+            rec_ = std::make_unique<RmRecord>(static_cast<int>(len_));
+            memset(rec_->data, 0, len_);
+        }
+        for (auto &copy : copies_) {
+            memcpy(rec_->data + copy.rec_offset, key + copy.key_offset, copy.len);
+        }
+    }
+};
@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <limits>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
@@ -17,7 +19,7 @@ See the Mulan PSL v2 for more details. */
 #include "system/sm.h"
 
 class IndexScanExecutor : public AbstractExecutor {
-   private:
+   protected:
     std::string tab_name_;                      // 表名称
     TabMeta tab_;                               // 表的元数据
     std::vector<Condition> conds_;              // 扫描条件
@@ -30,7 +32,11 @@ class IndexScanExecutor : public AbstractExecutor {
     IndexMeta index_meta_;                      // index scan涉及到的索引元数据
 
     Rid rid_;
-    std::unique_ptr<RecScan> scan_;
+    std::unique_ptr<RmRecord> rec_;             // 扫描位置上的记录
+    IxIndexHandle *ih_ = nullptr;               // index scan使用的B+树索引
+    IxLsmHandle *lsm_ih_ = nullptr;             // 或者LSM索引
+    std::unique_ptr<RecScan> scan_;             // B+树为IxScan，LSM索引为IxLsmScan
+    bool scan_keys_ = false;                    // 扫描时是否同时拷贝索引项的key
 
     SmManager *sm_manager_;
 
@@ -62,6 +68,11 @@ class IndexScanExecutor : public AbstractExecutor {
             }
         }
         fed_conds_ = conds_;
+        if (index_meta_.type == INDEX_LSM) {
+            lsm_ih_ = static_cast<IxLsmHandle *>(sm_manager_->get_index_handle(tab_name_, index_meta_));
+        } else {
+            ih_ = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(tab_name_, index_meta_));
+        }
 
         if(context)
         {
@@ -77,71 +88,21 @@ class IndexScanExecutor : public AbstractExecutor {
 
 
     void beginTuple() override {
-        // 获取索引句柄
-        auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_meta_.cols)).get();
-
         // 基于索引的扫描：寻找满足谓词条件的叶子节点，由于叶子节点是连续有序的，因此只需要找到满足条件的第一个和最后一个叶子节点
         // 即可获得满足谓词条件的记录集合
-        Iid lower = ih->leaf_begin();
-        Iid upper = ih->leaf_end();
-        bool has_index_cond = false;
-
-        for (auto &index_name : index_col_names_) {
-            auto index_col = tab_.get_col(index_name);
-
-            for (auto &cond : fed_conds_) {
-                // 只有cond左侧为索引字段，右侧为值才能使用索引扫描。注意：索引扫描不支持OP_NE运算
-                if (cond.is_rhs_val && cond.op != OP_NE && cond.lhs_col.col_name == index_col->name) {
-                    char *rhs_key = cond.rhs_val.raw->data;
-
-                    // 根据条件设置上下边界
-                    switch (cond.op) {
-                        case OP_EQ:
-                            lower = ih->lower_bound(rhs_key);
-                            upper = ih->upper_bound(rhs_key);
-                            break;
-                        case OP_GE:
-                            lower = ih->lower_bound(rhs_key);
-                            break;
-                        case OP_GT:
-                            lower = ih->upper_bound(rhs_key);
-                            break;
-                        case OP_LE:
-                            upper = ih->upper_bound(rhs_key);
-                            break;
-                        case OP_LT:
-                            upper = ih->lower_bound(rhs_key);
-                            break;
-                        default:
-                            throw InternalError("Unexpected op type");
-                    }
-
-                    has_index_cond = true;
-                    break;
-                }
-            }
-
-            // 如果找到了索引条件，停止继续扫描其他列
-            if (has_index_cond) {
-                break;
-            }
-        }
-
         // 根据确定的边界初始化索引扫描
-        scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm());
+        if (lsm_ih_ != nullptr) {
+            IxLsmBound lower, upper;
+            scan_range(lsm_ih_, index_meta_, fed_conds_, &lower, &upper);
+            scan_ = std::make_unique<IxLsmScan>(lsm_ih_, lower, upper);
+        } else {
+            Iid lower, upper;
+            scan_range(ih_, index_meta_, fed_conds_, &lower, &upper);
+            scan_ = std::make_unique<IxScan>(ih_, lower, upper, sm_manager_->get_bpm(), scan_keys_);
+        }
 
         // 获取第一个满足谓词条件的记录
-        while (!scan_->is_end()) {
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
-
-            // 判断记录是否满足谓词条件
-            if (eval_conds(cols_, fed_conds_, rec.get())) {
-                break;
-            }
-
-            scan_->next();
-        }
+        seek_match();
     }
 
 
@@ -150,14 +111,7 @@ class IndexScanExecutor : public AbstractExecutor {
         // lab3 task2 todo
         // 扫描到下一个满足条件的记录,赋rid_,中止循环
         scan_->next();
-        while(!scan_->is_end()){
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
-            if (eval_conds(cols_, fed_conds_, rec.get())) {
-                break;
-            }
-            scan_->next();
-        }
+        seek_match();
     }
 
     std::unique_ptr<RmRecord> Next() override {
@@ -167,6 +121,89 @@ class IndexScanExecutor : public AbstractExecutor {
 
     Rid &rid() override { return rid_; }
 
+    /**
+     * @brief 根据索引第一个字段上的条件确定扫描范围[lower, upper)，没有可用条件时为整个索引
+     * 索引按第一个字段排序，同一字段上有多个条件时取最紧的上下界，其余条件在读取记录之后检查
+     * B+树(IxIndexHandle, Iid)和LSM索引(IxLsmHandle, IxLsmBound)提供相同的lower_bound/upper_bound/leaf_begin/leaf_end
+     */
+    template <typename IndexHandle, typename Position>
+    static void scan_range(IndexHandle *ih, const IndexMeta &index_meta, const std::vector<Condition> &conds,
+                           Position *lower, Position *upper) {
+        auto &index_col = index_meta.cols[0];
+        const char *lo = nullptr;   // 下界的值
+        bool lo_incl = false;       // 下界是否包含该值
+        const char *hi = nullptr;
+        bool hi_incl = false;
+        auto cmp = [&](const char *a, const char *b) { return ix_compare(a, b, index_col.type, index_col.len); };
+        auto tighten_lo = [&](const char *v, bool incl) {
+            int c = lo == nullptr ? 1 : cmp(v, lo);
+            if (c > 0 || (c == 0 && !incl)) {
+                lo = v;
+                lo_incl = incl;
+            }
+        };
+        auto tighten_hi = [&](const char *v, bool incl) {
+            int c = hi == nullptr ? -1 : cmp(v, hi);
+            if (c < 0 || (c == 0 && !incl)) {
+                hi = v;
+                hi_incl = incl;
+            }
+        };
+        for (auto &cond : conds) {
+            // 只有cond左侧为索引字段，右侧为值才能使用索引扫描。注意：索引扫描不支持OP_NE运算
+            if (!cond.is_rhs_val || cond.op == OP_NE || cond.lhs_col.col_name != index_col.name) {
+                continue;
+            }
+            const char *v = cond.rhs_val.raw->data;
+            switch (cond.op) {
+                case OP_EQ: tighten_lo(v, true); tighten_hi(v, true); break;
+                case OP_GE: tighten_lo(v, true); break;
+                case OP_GT: tighten_lo(v, false); break;
+                case OP_LE: tighten_hi(v, true); break;
+                case OP_LT: tighten_hi(v, false); break;
+                default: throw InternalError("Unexpected op type");
+            }
+        }
+
+        // 多列索引的key由所有字段组成，其余字段取最小值/最大值，使lower_bound/upper_bound覆盖第一个字段等于该值的所有项
+        char key[IX_MAX_COL_LEN];
+        *lower = ih->leaf_begin();
+        *upper = ih->leaf_end();
+        if (lo != nullptr) {
+            make_bound_key(index_meta, lo, !lo_incl, key);
+            *lower = lo_incl ? ih->lower_bound(key) : ih->upper_bound(key);
+        }
+        if (hi != nullptr) {
+            if (lo != nullptr) {
+                int c = cmp(lo, hi);
+                if (c > 0 || (c == 0 && !(lo_incl && hi_incl))) {
+                    *upper = *lower;    // 范围为空
+                    return;
+                }
+            }
+            make_bound_key(index_meta, hi, hi_incl, key);
+            *upper = hi_incl ? ih->upper_bound(key) : ih->lower_bound(key);
+        }
+    }
+
+   protected:
+    /* 读取扫描位置上的记录到rec_并设置rid_，只访问索引的扫描从索引项中还原记录 */
+    virtual void fetch_record() {
+        rid_ = scan_->rid();
+        rec_ = fh_->get_record(rid_, context_);
+    }
+
+    /* 从当前扫描位置开始，跳过不满足谓词条件的记录 */
+    void seek_match() {
+        while (!scan_->is_end()) {
+            fetch_record();
+            if (eval_conds(cols_, fed_conds_, rec_.get())) {
+                break;
+            }
+            scan_->next();
+        }
+    }
+
     bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
         auto lhs_col = get_col(rec_cols, cond.lhs_col);
         char *lhs = rec->data + lhs_col->offset;
@@ -200,6 +237,29 @@ class IndexScanExecutor : public AbstractExecutor {
         }
     }
 
+    /**
+     * @brief 构造索引的key：第一个字段为first_val，其余字段为该类型的最小值(is_max为false)或最大值
+     */
+    static void make_bound_key(const IndexMeta &index_meta, const char *first_val, bool is_max, char *key) {
+        int offset = 0;
+        for (size_t i = 0; i < index_meta.cols.size(); ++i) {
+            auto &col = index_meta.cols[i];
+            char *dest = key + offset;
+            offset += col.len;
+            if (i == 0) {
+                memcpy(dest, first_val, col.len);
+            } else if (col.type == TYPE_INT) {
+                int v = is_max ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+                memcpy(dest, &v, sizeof(int));
+            } else if (col.type == TYPE_FLOAT) {
+                float v = is_max ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+                memcpy(dest, &v, sizeof(float));
+            } else {
+                memset(dest, is_max ? 0xff : 0, col.len);
+            }
+        }
+    }
+
     bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const RmRecord *rec) {
         return std::all_of(conds.begin(), conds.end(),
                            [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
@@ -20,6 +20,7 @@ class InsertExecutor : public AbstractExecutor {
     TabMeta tab_;                   // 表的元数据
     std::vector<Value> values_;     // 需要插入的数据
     RmFileHandle *fh_;              // 表的数据文件句柄
+    CsTableHandle *ch_;             // 列存表的句柄，行存表为nullptr
     std::string tab_name_;          // 表名称
     Rid rid_;                       // 插入的位置，由于系统默认插入时不指定位置，因此当前rid_在插入后才赋值
     SmManager *sm_manager_;
@@ -33,42 +34,74 @@ class InsertExecutor : public AbstractExecutor {
         if (values.size() != tab_.cols.size()) {
             throw InvalidValueCountError();
         }
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        if (sm_manager_->is_columnar(tab_name)) {
+            fh_ = nullptr;
+            ch_ = sm_manager_->chs_.at(tab_name).get();
+        } else {
+            fh_ = sm_manager_->fhs_.at(tab_name).get();
+            ch_ = nullptr;
+        }
         context_ = context;
     };
 
     std::unique_ptr<RmRecord> Next() override {
         // Make record buffer
-        RmRecord rec(fh_->get_file_hdr().record_size);
+        RmRecord rec(ch_ != nullptr ? ch_->get_record_size() : fh_->get_file_hdr().record_size);
         for (size_t i = 0; i < values_.size(); i++) {
             auto &col = tab_.cols[i];
             auto &val = values_[i];
-            if (col.type != val.type) {
+            if (!is_compatible_type(col.type, val.type)) {
                 throw IncompatibleTypeError(coltype2str(col.type), coltype2str(val.type));
             }
             val.init_raw(col.len);
             memcpy(rec.data + col.offset, val.raw->data, col.len);
         }
+        // 持有到索引维护完成，期间在线建索引不会切换；构造之后可能有在线建索引加入了新的索引，重新读取索引列表
+        IndexBuildLog *build_log;
+        auto build_lock = sm_manager_->lock_table_write(tab_name_, &build_log);
+        tab_.indexes = sm_manager_->db_.get_table(tab_name_).indexes;
         // Insert into record file
-        rid_ = fh_->insert_record(rec.data, context_);
+        rid_ = ch_ != nullptr ? ch_->insert_record(rec.data) : fh_->insert_record(rec.data, context_);
+        if (build_log != nullptr) {
+            build_log->append(true, rid_, rec.data, rec.size);
+        }
 
-        // record a update operation into the transaction
-        WriteRecord* wr = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_);
-        context_->txn_->append_write_record(wr);
-        
         // Insert into index
         for(size_t i = 0; i < tab_.indexes.size(); ++i) {
             auto& index = tab_.indexes[i];
-            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-            char* key = new char[index.col_tot_len];
-            int offset = 0;
-            for(size_t i = 0; i < index.col_num; ++i) {
-                memcpy(key + offset, rec.data + index.cols[i].offset, index.cols[i].len);
-                offset += index.cols[i].len;
+            auto ih = sm_manager_->get_index_handle(tab_name_, index);
+            char key[IX_MAX_COL_LEN];
+            index.make_key(rec.data, key);
+            if (ih->insert_entry(key, rid_, context_->txn_) == -1 && index.unique) {
+                // 唯一索引中已有这个key，撤销这条记录已经做的插入
+                undo_insert(rec, i, build_log);
+                throw UniqueKeyViolationError(tab_name_, index.col_names());
             }
-            ih->insert_entry(key, rid_, context_->txn_);
         }
+
+        // record a update operation into the transaction
+        WriteRecord* wr = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_);
+        context_->txn_->append_write_record(wr);
         return nullptr;
     }
+
     Rid &rid() override { return rid_; }
+
+   private:
+    /* 删除记录rid_在前num_indexes个索引中的项和记录本身 */
+    void undo_insert(const RmRecord &rec, size_t num_indexes, IndexBuildLog *build_log) {
+        char key[IX_MAX_COL_LEN];
+        for (size_t i = 0; i < num_indexes; ++i) {
+            tab_.indexes[i].make_key(rec.data, key);
+            sm_manager_->get_index_handle(tab_name_, tab_.indexes[i])->delete_entry(key, rid_, context_->txn_);
+        }
+        if (ch_ != nullptr) {
+            ch_->delete_record(rid_);
+        } else {
+            fh_->delete_record(rid_, context_);
+        }
+        if (build_log != nullptr) {
+            build_log->append(false, rid_, rec.data, rec.size);
+        }
+    }
 };
\ No newline at end of file
@@ -10,6 +10,7 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "column_filter.h"
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
@@ -30,6 +31,14 @@ class SeqScanExecutor : public AbstractExecutor {
 
     SmManager *sm_manager_;
 
+    // PAX页面：谓词按列在minipage上批量计算，剩余谓词在拼接出的元组上计算
+    bool pax_ = false;
+    std::vector<RmColumnFilter> col_filters_;  // 可以按列计算的谓词
+    std::vector<Condition> row_conds_;         // 需要在完整元组上计算的谓词
+    int page_no_ = RM_NO_PAGE;                 // 当前扫描到的页面
+    std::vector<int> page_slots_;              // 当前页面中满足col_filters_的记录的槽号
+    size_t slot_idx_ = 0;                      // 当前记录在page_slots_中的下标
+
    public:
     SeqScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, Context *context) {
         sm_manager_ = sm_manager;
@@ -43,9 +52,14 @@ class SeqScanExecutor : public AbstractExecutor {
         context_ = context;
 
         fed_conds_ = conds_;
+
+        pax_ = fh_->get_file_hdr().page_format == RM_PAGE_PAX;
+        if (pax_) {
+            build_column_filters();
+        }
     }
 
-    bool is_end() const override { return scan_->is_end(); }
+    bool is_end() const override { return pax_ ? page_no_ == RM_NO_PAGE : scan_->is_end(); }
 
     size_t tupleLen() const override { return len_; }
 
@@ -60,6 +74,11 @@ class SeqScanExecutor : public AbstractExecutor {
      *
      */
     void beginTuple() override {
+        if (pax_) {
+            page_no_ = RM_FIRST_RECORD_PAGE - 1;
+            next_pax_page();
+            return;
+        }
         // 初始化表迭代器scan_，使它指向表的第一个记录的位置
         scan_ = std::make_unique<RmScan>(fh_); 
         // 迭代查找每个记录，判断是否符合所有的谓词条件，在第一个符合所有谓词条件的记录处停下
@@ -80,6 +99,11 @@ class SeqScanExecutor : public AbstractExecutor {
      *
      */
     void nextTuple() override {
+        if (pax_) {
+            slot_idx_++;
+            seek_pax_tuple();
+            return;
+        }
         // 迭代查找，扫描到满足谓词条件的记录即可，逻辑与begin一样
         for(scan_->next(); !scan_->is_end(); scan_->next())
         {
@@ -162,4 +186,65 @@ class SeqScanExecutor : public AbstractExecutor {
         }
         return true;
     }
+
+   private:
+    /**
+     * @description: PAX页面：将fed_conds_中"字段 op 常量"且字段单独占用一个minipage的谓词转换为按列计算的过滤器
+     */
+    void build_column_filters() {
+        for (auto &cond : fed_conds_) {
+            if (!cond.is_rhs_val || cond.lhs_col.tab_name != tab_name_) {
+                row_conds_.push_back(cond);
+                continue;
+            }
+            auto lhs_col = get_col(cols_, cond.lhs_col);
+            if (!fh_->is_pax_column(lhs_col->offset, lhs_col->len) ||
+                !is_compatible_type(lhs_col->type, cond.rhs_val.type)) {
+                row_conds_.push_back(cond);
+                continue;
+            }
+            col_filters_.push_back({lhs_col->offset, ColumnFilter::make(lhs_col->type, lhs_col->len, cond.op, cond.rhs_val.raw)});
+        }
+    }
+
+    /**
+     * @description: PAX页面：移动到下一个有候选记录的页面，并定位到其中第一个满足所有谓词的记录
+     */
+    void next_pax_page() {
+        int num_pages = fh_->get_file_hdr().num_pages;
+        for (page_no_++; page_no_ < num_pages; page_no_++) {
+            fh_->filter_page(page_no_, col_filters_, page_slots_);
+            if (page_slots_.empty()) {
+                continue;
+            }
+            slot_idx_ = 0;
+            if (seek_pax_tuple_in_page()) {
+                return;
+            }
+        }
+        page_no_ = RM_NO_PAGE;
+    }
+
+    /**
+     * @description: PAX页面：从slot_idx_开始找到满足row_conds_的记录，当前页面没有时继续扫描后面的页面
+     */
+    void seek_pax_tuple() {
+        if (!seek_pax_tuple_in_page()) {
+            next_pax_page();
+        }
+    }
+
+    bool seek_pax_tuple_in_page() {
+        for (; slot_idx_ < page_slots_.size(); slot_idx_++) {
+            rid_ = {page_no_, page_slots_[slot_idx_]};
+            if (row_conds_.empty()) {
+                return true;
+            }
+            auto rec = fh_->get_record(rid_, context_);
+            if (eval_conds(cols_, row_conds_, rec.get())) {
+                return true;
+            }
+        }
+        return false;
+    }
 };
\ No newline at end of file
@@ -9,6 +9,10 @@ MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
 See the Mulan PSL v2 for more details. */
 
 #pragma once
+
+#include <algorithm>
+#include <set>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
@@ -35,6 +39,10 @@ class UpdateExecutor : public AbstractExecutor {
         tab_name_ = tab_name;
         set_clauses_ = set_clauses;
         tab_ = sm_manager_->db_.get_table(tab_name);          // 获取表元数据
+        // 列存表的段写入后不再修改，只支持追加和删除
+        if (tab_.storage == STORAGE_COLUMNAR) {
+            throw ColumnarUnsupportedError(tab_name, "update");
+        }
         fh_ = sm_manager_->fhs_.at(tab_name).get();           // 获取表文件句柄
         conds_ = conds;
         rids_ = rids;
@@ -47,8 +55,12 @@ class UpdateExecutor : public AbstractExecutor {
      * 对rids_记录组，遍历每个记录，先删除记录上的索引，然后更新记录数据，最后再重新创建索引
      */
     std::unique_ptr<RmRecord> Next() override {
-        // 创建索引句柄向量，保存与列相关的索引句柄
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
+        // 持有到索引维护完成，期间在线建索引不会切换；构造之后可能有在线建索引加入了新的索引，重新读取索引列表
+        IndexBuildLog *build_log;
+        auto build_lock = sm_manager_->lock_table_write(tab_name_, &build_log);
+        tab_.indexes = sm_manager_->db_.get_table(tab_name_).indexes;
+        // 创建索引句柄向量，ihs[i]对应tab_.indexes[i]，不包含被更新的列的索引不需要维护，为nullptr
+        std::vector<IxIndex *> ihs(tab_.indexes.size(), nullptr);
         
         // 创建一个向量，用于标记每列是否需要更新及其新值
         std::vector<std::pair<bool, Value>> values(tab_.cols.size());
@@ -56,14 +68,12 @@ class UpdateExecutor : public AbstractExecutor {
 
         // 遍历Set从句，标记需要更新的列及其对应索引
         for (auto &set_clause : set_clauses_) {
-            auto lhs_col = tab_.get_col(set_clause.lhs.col_name); // 获取左侧列信息
-            if (lhs_col->index) { // 如果列有索引
-                size_t lhs_col_idx = lhs_col - tab_.cols.begin();
-                // 填充索引句柄到向量中
-                auto index = tab_.indexes[lhs_col_idx];
-                ihs[lhs_col_idx] = sm_manager_->ihs_.at(
-                    sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)
-                ).get();
+            for (size_t i = 0; i < tab_.indexes.size(); i++) {
+                auto &index = tab_.indexes[i];
+                if (ihs[i] == nullptr && index.has_col(set_clause.lhs.col_name)) {
+                    // 填充索引句柄到向量中
+                    ihs[i] = sm_manager_->get_index_handle(tab_name_, index);
+                }
             }
             // 标记需要更新的列及其新值
             for (int i = 0; i < tab_.cols.size(); i++) {
@@ -75,6 +85,9 @@ class UpdateExecutor : public AbstractExecutor {
             }
         }
 
+        // 先检查更新之后唯一索引中不会出现重复的key，之后才修改记录和索引
+        check_unique(ihs, values);
+
         // 遍历每个需要更新的记录
         for (auto &rid : rids_) {
             auto rec = fh_->get_record(rid, context_); // 获取当前记录
@@ -83,9 +96,11 @@ class UpdateExecutor : public AbstractExecutor {
             WriteRecord *wr = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, rid, *rec);
             context_->txn_->append_write_record(wr); // 将更新记录写入事务日志
 
-            for (int i = 0; i < tab_.cols.size(); i++) {
-                if (!ihs[i]) continue; // 跳过无索引的列
-                ihs[i]->delete_entry(rec->data + tab_.cols[i].offset, nullptr); // 删除索引项
+            char key[IX_MAX_COL_LEN];
+            for (size_t i = 0; i < tab_.indexes.size(); i++) {
+                if (!ihs[i]) continue; // 跳过不需要维护的索引
+                tab_.indexes[i].make_key(rec->data, key);
+                ihs[i]->delete_entry(key, rid, context_->txn_); // 删除这条记录的索引项
             }
 
             // 创建更新前的记录备份（事务日志）
@@ -93,20 +108,58 @@ class UpdateExecutor : public AbstractExecutor {
             memcpy(update_record.data, rec->data, rec->size);
 
             // 更新记录数据
-            for (int i = 0; i < tab_.cols.size(); i++) {
-                if (!values[i].first) continue; // 跳过不需要更新的列
-                memcpy(rec->data + tab_.cols[i].offset, values[i].second.raw->data, tab_.cols[i].len);
-            }
+            set_values(rec->data, values);
             fh_->update_record(rid, rec->data, context_); // 更新记录
+            // 在线建索引的旁路日志中记为删除旧记录、插入新记录
+            if (build_log != nullptr) {
+                build_log->append(false, rid, update_record.data, update_record.size);
+                build_log->append(true, rid, rec->data, rec->size);
+            }
 
             // 插入新的索引项
-            for (int i = 0; i < tab_.cols.size(); i++) {
-                if (!ihs[i]) continue; // 跳过无索引的列
-                ihs[i]->insert_entry(rec->data + tab_.cols[i].offset, rid, nullptr); // 插入索引项
+            for (size_t i = 0; i < tab_.indexes.size(); i++) {
+                if (!ihs[i]) continue; // 跳过不需要维护的索引
+                tab_.indexes[i].make_key(rec->data, key);
+                ihs[i]->insert_entry(key, rid, context_->txn_); // 插入索引项
             }
         }
         return nullptr; // 表示更新操作完成
     }
 
     Rid &rid() override { return _abstract_rid; } // 返回当前RID（未使用）
+
+   private:
+    // 把需要更新的列的新值写入记录
+    void set_values(char *data, const std::vector<std::pair<bool, Value>> &values) {
+        for (size_t i = 0; i < tab_.cols.size(); i++) {
+            if (!values[i].first) continue; // 跳过不需要更新的列
+            memcpy(data + tab_.cols[i].offset, values[i].second.raw->data, tab_.cols[i].len);
+        }
+    }
+
+    /**
+     * @brief 检查被更新的唯一索引：更新之后的key两两不同，并且索引中已有的相同key只属于这次更新的记录，
+     * 这些记录的旧key会被删除，不会与新key重复
+     */
+    void check_unique(const std::vector<IxIndex *> &ihs, const std::vector<std::pair<bool, Value>> &values) {
+        std::set<Rid> updated(rids_.begin(), rids_.end());
+        char key[IX_MAX_COL_LEN];
+        for (size_t i = 0; i < tab_.indexes.size(); i++) {
+            auto &index = tab_.indexes[i];
+            if (!ihs[i] || !index.unique) continue;
+            std::set<std::string> new_keys;
+            for (auto &rid : rids_) {
+                auto rec = fh_->get_record(rid, context_);
+                set_values(rec->data, values);
+                index.make_key(rec->data, key);
+                std::vector<Rid> owners;
+                ihs[i]->get_value(key, &owners, context_->txn_);
+                bool taken = std::any_of(owners.begin(), owners.end(),
+                                         [&](const Rid &owner) { return updated.count(owner) == 0; });
+                if (taken || !new_keys.emplace(key, index.col_tot_len).second) {
+                    throw UniqueKeyViolationError(tab_name_, index.col_names());
+                }
+            }
+        }
+    }
 };
\ No newline at end of file
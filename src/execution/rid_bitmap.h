@@ -0,0 +1,90 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "defs.h"
+
+/**
+ * 记录位置的位图：按页号有序，每个页面用一组64位的字表示哪些slot_no被选中
+ * 多个索引得到的位图可以按位求交(AND)，遍历时每个堆表页面只出现一次，页面内按slot_no有序
+ */
+class RidBitmap {
+   private:
+    static constexpr int BITS_PER_WORD = 64;
+    std::map<int, std::vector<uint64_t>> pages_;    // page_no -> 该页面中被选中的slot_no
+    size_t size_ = 0;                               // 被选中的记录数
+
+   public:
+    void add(const Rid &rid) {
+        auto &words = pages_[rid.page_no];
+        size_t w = rid.slot_no / BITS_PER_WORD;
+        if (words.size() <= w) {
+            words.resize(w + 1, 0);
+        }
+        uint64_t bit = uint64_t(1) << (rid.slot_no % BITS_PER_WORD);
+        if ((words[w] & bit) == 0) {
+            words[w] |= bit;
+            size_++;
+        }
+    }
+
+    /* 只保留同时出现在other中的记录 */
+    void intersect_with(const RidBitmap &other) {
+        size_ = 0;
+        for (auto it = pages_.begin(); it != pages_.end();) {
+            auto pos = other.pages_.find(it->first);
+            if (pos == other.pages_.end()) {
+                it = pages_.erase(it);
+                continue;
+            }
+            auto &words = it->second;
+            auto &other_words = pos->second;
+            if (words.size() > other_words.size()) {
+                words.resize(other_words.size());
+            }
+            int count = 0;
+            for (size_t i = 0; i < words.size(); ++i) {
+                words[i] &= other_words[i];
+                count += __builtin_popcountll(words[i]);
+            }
+            if (count == 0) {
+                it = pages_.erase(it);
+                continue;
+            }
+            size_ += count;
+            ++it;
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t num_pages() const { return pages_.size(); }
+
+    const std::map<int, std::vector<uint64_t>> &pages() const { return pages_; }
+
+    /* 把一个页面的位转换为有序的slot_no */
+    static void to_slots(const std::vector<uint64_t> &words, std::vector<int> *slot_nos) {
+        slot_nos->clear();
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t word = words[i];
+            while (word != 0) {
+                slot_nos->push_back(static_cast<int>(i * BITS_PER_WORD + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+};
@@ -12,3 +12,6 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_scan.h"
 #include "ix_manager.h"
+#include "ix_bulk.h"
+#include "ix_hash.h"
+#include "ix_lsm.h"
@@ -0,0 +1,360 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_bulk.h"
+
+#include <algorithm>
+#include <thread>
+
+/* 顺序读取一个run：run文件每次读入一批记录；file为nullptr时读取分区内存中排好序的记录 */
+struct IxSorter::RunReader {
+    FILE *file = nullptr;
+    int record_len;
+    std::vector<char> buf;
+    size_t len = 0;     // buf中有效的字节数
+    size_t pos = 0;     // 当前记录在buf中的偏移，内存中的run为sorted中的下标
+    const std::vector<const char *> *sorted = nullptr;
+
+    RunReader(const std::string &name, int record_len_) : record_len(record_len_), buf(record_len_ * 4096) {
+        file = fopen(name.c_str(), "rb");
+        if (file == nullptr) {
+            throw UnixError();
+        }
+        fill();
+    }
+
+    RunReader(const std::vector<const char *> *sorted_, int record_len_)
+        : record_len(record_len_), len(sorted_->size()), sorted(sorted_) {}
+
+    ~RunReader() {
+        if (file != nullptr) {
+            fclose(file);
+        }
+    }
+
+    void fill() {
+        len = fread(buf.data(), 1, buf.size(), file);
+        pos = 0;
+    }
+
+    bool valid() const { return pos < len; }
+
+    const char *current() const { return file != nullptr ? buf.data() + pos : (*sorted)[pos]; }
+
+    void advance() {
+        if (file == nullptr) {
+            pos++;
+            return;
+        }
+        pos += record_len;
+        if (pos >= len) {
+            fill();
+        }
+    }
+};
+
+IxSorter::IxSorter(const IxFileHdr *hdr, std::string run_prefix, size_t memory_budget, int num_threads,
+                   int num_partitions)
+    : hdr_(hdr), run_prefix_(std::move(run_prefix)), num_threads_(num_threads), parts_(num_partitions) {
+    if (num_threads_ <= 0) {
+        num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    partition_budget_ = memory_budget / num_partitions;
+    key_len_ = hdr_->col_tot_len_;
+    record_len_ = key_len_ + static_cast<int>(sizeof(Rid));
+}
+
+IxSorter::~IxSorter() {
+    readers_.clear();
+    for (auto &part : parts_) {
+        for (auto &run : part.runs) {
+            std::remove(run.c_str());
+        }
+    }
+}
+
+void IxSorter::add(const char *key, const Rid &rid, int part) {
+    std::vector<char> &buffer = parts_[part].buffer;
+    size_t offset = buffer.size();
+    buffer.resize(offset + record_len_);
+    char *record = buffer.data() + offset;
+    if (ix_index_key(hdr_, key, rid, record, key + hdr_->key_len()) == key) {
+        memcpy(record, key, key_len_);
+    }
+    memcpy(record + key_len_, &rid, sizeof(Rid));
+    if (buffer.size() >= partition_budget_) {
+        spill(part);
+    }
+}
+
+size_t IxSorter::num_runs() const {
+    size_t runs = 0;
+    for (auto &part : parts_) {
+        runs += part.runs.size();
+    }
+    return runs;
+}
+
+/**
+ * @brief 对分区buffer中的记录排序，结果保存在sorted中
+ * 记录平均分给num_threads个线程各自排序，然后逐轮两两归并，同一轮的归并也并行执行；
+ * 排序是稳定的，key相同的记录保持add的顺序
+ */
+void IxSorter::sort_partition(Partition *part, int num_threads) {
+    std::vector<const char *> &sorted = part->sorted;
+    size_t n = part->buffer.size() / record_len_;
+    sorted.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        sorted[i] = part->buffer.data() + i * record_len_;
+    }
+    auto less = [this](const char *a, const char *b) { return compare(a, b) < 0; };
+    // 数据量较小时不值得创建线程
+    size_t threads = std::min<size_t>(num_threads, std::max<size_t>(1, n / 4096));
+    if (threads <= 1) {
+        std::stable_sort(sorted.begin(), sorted.end(), less);
+        return;
+    }
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t lo = 0; lo < n; lo += chunk) {
+        size_t hi = std::min(n, lo + chunk);
+        workers.emplace_back([&sorted, lo, hi, &less] {
+            std::stable_sort(sorted.begin() + lo, sorted.begin() + hi, less);
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (size_t width = chunk; width < n; width *= 2) {
+        workers.clear();
+        for (size_t lo = 0; lo + width < n; lo += 2 * width) {
+            size_t mid = lo + width;
+            size_t hi = std::min(n, lo + 2 * width);
+            workers.emplace_back([&sorted, lo, mid, hi, &less] {
+                std::inplace_merge(sorted.begin() + lo, sorted.begin() + mid, sorted.begin() + hi, less);
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+}
+
+/**
+ * @brief 将分区内存中的记录排序之后写入一个新的run文件
+ * 由向该分区add的线程调用，多个分区同时写出时各自使用一个线程排序
+ */
+void IxSorter::spill(int part_no) {
+    Partition &part = parts_[part_no];
+    sort_partition(&part, parts_.size() == 1 ? num_threads_ : 1);
+    std::string name = run_prefix_ + "." + std::to_string(part_no) + ".run" + std::to_string(part.runs.size());
+    FILE *file = fopen(name.c_str(), "wb");
+    if (file == nullptr) {
+        throw UnixError();
+    }
+    part.runs.push_back(name);
+    for (const char *record : part.sorted) {
+        if (fwrite(record, record_len_, 1, file) != 1) {
+            fclose(file);
+            throw UnixError();
+        }
+    }
+    fclose(file);
+    part.buffer.clear();
+    part.sorted.clear();
+}
+
+void IxSorter::finish() {
+    // 各分区剩余的数据留在内存中，并行排序，线程由各分区平分
+    int threads_per_part = std::max<int>(1, num_threads_ / static_cast<int>(parts_.size()));
+    std::vector<std::thread> workers;
+    for (auto &part : parts_) {
+        if (part.buffer.empty()) {
+            continue;
+        }
+        if (parts_.size() == 1) {
+            sort_partition(&part, num_threads_);
+        } else {
+            workers.emplace_back([this, &part, threads_per_part] { sort_partition(&part, threads_per_part); });
+        }
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &part : parts_) {
+        for (auto &run : part.runs) {
+            readers_.push_back(std::make_unique<RunReader>(run, record_len_));
+        }
+        if (!part.sorted.empty()) {
+            readers_.push_back(std::make_unique<RunReader>(&part.sorted, record_len_));
+        }
+    }
+    for (size_t i = 0; i < readers_.size(); ++i) {
+        if (readers_[i]->valid()) {
+            heap_.push_back(static_cast<int>(i));
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [this](int a, int b) { return run_greater(a, b); });
+}
+
+/**
+ * @brief 多路归并的堆序：key相同时下标小的reader在前，保证归并结果与稳定排序一致
+ */
+bool IxSorter::run_greater(int a, int b) const {
+    int res = compare(readers_[a]->current(), readers_[b]->current());
+    return res > 0 || (res == 0 && a > b);
+}
+
+bool IxSorter::next(const char **key, Rid *rid) {
+    auto greater = [this](int a, int b) { return run_greater(a, b); };
+    // 上一次返回的记录在调用者使用完之后才能被覆盖，因此在这里才前进
+    if (current_ >= 0) {
+        readers_[current_]->advance();
+        if (readers_[current_]->valid()) {
+            heap_.push_back(current_);
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        }
+        current_ = -1;
+    }
+    if (heap_.empty()) {
+        return false;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    current_ = heap_.back();
+    heap_.pop_back();
+    const char *record = readers_[current_]->current();
+    *key = record;
+    memcpy(rid, record + key_len_, sizeof(Rid));
+    return true;
+}
+
+IxBulkBuilder::IxBulkBuilder(IxIndexHandle *ih, double fill_factor) : ih_(ih), fill_factor_(fill_factor) {}
+
+bool IxBulkBuilder::append(const char *key, const Rid &rid) {
+    const IxFileHdr *hdr = ih_->file_hdr_;
+    if (num_entries_ > 0) {
+        int res = ix_compare(key, last_key_, hdr);
+        assert(res >= 0);
+        if (res == 0) {
+            return false;
+        }
+    }
+    memcpy(last_key_, key, hdr->col_tot_len_);
+    append_to_level(0, key, rid);
+    num_entries_++;
+    return true;
+}
+
+/**
+ * @brief 创建第level层的新结点，第一个叶子结点使用索引创建时的根结点(IX_INIT_ROOT_PAGE)
+ */
+IxNodeGuard IxBulkBuilder::new_node(size_t level) {
+    IxNodeGuard node = levels_.empty() ? ih_->fetch_node(IX_INIT_ROOT_PAGE) : ih_->create_node();
+    node.mark_dirty();
+    node->init_node();
+    node->set_level(static_cast<int>(level));
+    if (level == 0) {
+        node->page_hdr->is_leaf = true;
+        node->set_prev_leaf(IX_LEAF_HEADER_PAGE);
+        node->set_next_leaf(IX_LEAF_HEADER_PAGE);
+    }
+    return node;
+}
+
+/**
+ * @brief 向第level层追加键值对，当前结点达到填充率时开始该层的下一个结点，并把分隔key追加到上一层
+ * @note 递归调用可能让levels_扩容，因此递归之后只能通过下标访问levels_
+ */
+void IxBulkBuilder::append_to_level(size_t level, const char *key, const Rid &rid) {
+    if (level == levels_.size()) {
+        levels_.push_back(new_node(level));
+    }
+    int len = ih_->file_hdr_->col_tot_len_;
+    if (!levels_[level]->can_append(key, fill_factor_)) {
+        IxNodeGuard next = new_node(level);
+        IxNodeHandle *node = levels_[level].get();
+        char separator[IX_MAX_COL_LEN];
+        memcpy(separator, key, len);
+        if (level == 0 && node->is_compressed()) {
+            char last[IX_MAX_COL_LEN];
+            node->copy_key(node->get_size() - 1, last);
+            ix_shortest_separator(last, key, len, separator);
+        }
+        node->set_high_key(separator);
+        if (level == 0) {
+            node->set_next_leaf(next->get_page_no());
+            next->set_prev_leaf(node->get_page_no());
+        } else {
+            node->set_right_sibling(next->get_page_no());
+        }
+        if (level + 1 == levels_.size()) {
+            // 这一层第一次出现第二个结点，上一层的第一个孩子是这一层的第一个结点
+            char first[IX_MAX_COL_LEN];
+            node->copy_key(0, first);
+            append_to_level(level + 1, first, Rid{node->get_page_no(), -1});
+        }
+        page_id_t next_page_no = next->get_page_no();
+        levels_[level] = std::move(next);
+        append_to_level(level + 1, separator, Rid{next_page_no, -1});
+    }
+    IxNodeHandle *node = levels_[level].get();
+    node->insert_pairs(node->get_size(), key, &rid, 1);
+    if (level > 0) {
+        IxNodeGuard child = ih_->fetch_node(rid.page_no);
+        child->set_parent_page_no(node->get_page_no());
+        child.mark_dirty();
+    }
+}
+
+void IxBulkBuilder::finish() {
+    if (levels_.empty()) {
+        return;
+    }
+    page_id_t last_leaf = levels_[0]->get_page_no();
+    IxNodeGuard header = ih_->fetch_node(IX_LEAF_HEADER_PAGE);
+    header.mark_dirty();
+    header->set_next_leaf(IX_INIT_ROOT_PAGE);
+    header->set_prev_leaf(last_leaf);
+    ih_->file_hdr_->first_leaf_ = IX_INIT_ROOT_PAGE;
+    ih_->file_hdr_->last_leaf_ = last_leaf;
+    {
+        std::lock_guard<std::shared_mutex> lock(ih_->root_latch_);
+        ih_->file_hdr_->root_page_ = levels_.back()->get_page_no();
+    }
+    levels_.clear();
+}
+
+/**
+ * @brief 用排好序的键值对自底向上地构建B+树，只能用于刚创建的空索引
+ *
+ * @param sorter 已经调用过finish的外部排序
+ * @param fill_factor 结点的填充率
+ * @return 唯一索引中出现重复的key时停止构建并返回false，此时索引中只有重复的key之前的项
+ */
+bool IxIndexHandle::bulk_load(IxSorter *sorter, double fill_factor) {
+    IxTreeWriteLock tree_lock(this);
+    if (file_hdr_->root_page_ != IX_INIT_ROOT_PAGE || fetch_node(IX_INIT_ROOT_PAGE)->get_size() != 0) {
+        throw InternalError("IxIndexHandle::bulk_load: index is not empty");
+    }
+    IxBulkBuilder builder(this, fill_factor);
+    const char *key;
+    Rid rid;
+    bool unique = true;
+    while (unique && sorter->next(&key, &rid)) {
+        unique = builder.append(key, rid);
+    }
+    builder.finish();
+    tree_lock.unlock();
+    if (key_cache_ != nullptr) {
+        IxKeyCacheOptions options = key_cache_->options();
+        enable_key_cache(options);  // 缓存建立在空树上，按构建好的树重建
+    }
+    return unique;
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ix_index_handle.h"
+
+// 批量构建时结点的默认填充率，留出一部分空间给之后的插入，避免建好索引之后马上分裂
+constexpr double IX_BULK_FILL_FACTOR = 0.9;
+// 外部排序在内存中缓存的(key, rid)数据量，超过之后排序并写入临时文件
+constexpr size_t IX_SORT_MEMORY_BUDGET = 64 << 20;
+// 建索引时每个扫描线程至少分到的堆表页面数，表很小时不值得创建线程
+constexpr int IX_BUILD_MIN_PAGES_PER_THREAD = 64;
+
+/**
+ * 外部排序：收集(key, rid)，内存中的数据超过预算时排序后写入临时文件(run)，最后多路归并输出
+ * key按索引中存储的格式排序，顺序与ix_compare(a, b, hdr)相同
+ *
+ * 数据可以分成多个分区(partition)，不同分区由不同的线程并发地add，每个分区独立地缓存和写出run；
+ * 归并时key相同的记录按分区编号、分区内add的顺序输出，因此各分区按表的页面顺序划分时，
+ * 结果与单线程稳定排序整张表相同
+ */
+class IxSorter {
+   public:
+    /**
+     * @param hdr 索引文件头，决定key的长度、编码和顺序
+     * @param run_prefix 临时文件名的前缀，临时文件在析构时删除
+     * @param memory_budget 内存中缓存的数据量上限，由各个分区平分
+     * @param num_threads 排序使用的线程数，0表示使用硬件线程数
+     * @param num_partitions 分区数，也就是可以并发调用add的线程数
+     */
+    IxSorter(const IxFileHdr *hdr, std::string run_prefix, size_t memory_budget = IX_SORT_MEMORY_BUDGET,
+             int num_threads = 0, int num_partitions = 1);
+
+    ~IxSorter();
+
+    IxSorter(const IxSorter &) = delete;
+
+    IxSorter &operator=(const IxSorter &) = delete;
+
+    /* 向分区part添加一个键值对，key为上层传入的原始格式；不同的part可以在不同线程中并发调用 */
+    void add(const char *key, const Rid &rid, int part = 0);
+
+    /* 所有分区添加完成，并行地排序各分区剩余的数据，之后可以调用next按key有序地读取 */
+    void finish();
+
+    /**
+     * @brief 按key有序地读取下一个键值对
+     * @param[out] key 索引格式的key，在下一次调用next之前有效
+     * @return 是否还有键值对
+     */
+    bool next(const char **key, Rid *rid);
+
+    /* 写入临时文件的run数量，全部数据都在内存中排序时为0 */
+    size_t num_runs() const;
+
+   private:
+    struct Partition {
+        std::vector<char> buffer;               // 内存中尚未排序的记录
+        std::vector<const char *> sorted;       // 排好序的记录
+        std::vector<std::string> runs;          // 已经写出的临时文件名
+    };
+
+    struct RunReader;
+
+    void sort_partition(Partition *part, int num_threads);
+
+    void spill(int part);
+
+    int compare(const char *a, const char *b) const { return ix_compare(a, b, hdr_); }
+
+    bool run_greater(int a, int b) const;
+
+    const IxFileHdr *hdr_;
+    std::string run_prefix_;
+    size_t partition_budget_;
+    int num_threads_;
+    int key_len_;
+    int record_len_;                        // 每条记录为|key|rid|
+    std::vector<Partition> parts_;
+    std::vector<std::unique_ptr<RunReader>> readers_;   // 按分区编号、写出顺序排列，最后是内存中的记录
+    std::vector<int> heap_;                 // 多路归并的小顶堆，元素为readers_的下标
+    int current_ = -1;                      // 上一次next返回的记录所在的reader，下一次next时再前进
+};
+
+/**
+ * 自底向上构建B+树：按key有序地追加键值对，每个结点填充到fill_factor后开始下一个结点，
+ * 结点开始下一个结点时把分隔key追加到上一层，只能用于空索引
+ */
+class IxBulkBuilder {
+   public:
+    IxBulkBuilder(IxIndexHandle *ih, double fill_factor);
+
+    /* key为索引格式，不能小于之前追加的key；与上一个key相同时忽略并返回false（唯一索引，允许重复key时key中包括rid，不会相同） */
+    bool append(const char *key, const Rid &rid);
+
+    /* 链接叶子链表的首尾，更新根结点和last_leaf */
+    void finish();
+
+    size_t num_entries() const { return num_entries_; }
+
+   private:
+    void append_to_level(size_t level, const char *key, const Rid &rid);
+
+    IxNodeGuard new_node(size_t level);
+
+    IxIndexHandle *ih_;
+    double fill_factor_;
+    std::vector<IxNodeGuard> levels_;       // 每一层正在填充的结点，levels_[0]为叶子
+    char last_key_[IX_MAX_COL_LEN];
+    size_t num_entries_ = 0;
+};
@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <climits>
+#include <cstdint>
 #include <vector>
 
 #include "defs.h"
@@ -22,6 +24,28 @@ constexpr int IX_INIT_ROOT_PAGE = 2;
 constexpr int IX_INIT_NUM_PAGES = 3;
 constexpr int IX_MAX_COL_LEN = 512;
 
+// 索引文件格式的版本
+constexpr int IX_FORMAT_RAW_KEYS = 0;           // key按列原样存储，逐列调用ix_compare比较
+constexpr int IX_FORMAT_NORMALIZED_KEYS = 1;    // 多列key按规范化编码存储，直接memcmp比较（见ix_key.h）
+constexpr int IX_FORMAT_COMPRESSED_NODES = 2;   // 可以memcmp比较的key使用前缀压缩的结点，叶子分裂时截断分隔key
+constexpr int IX_FORMAT_DUPLICATE_KEYS = 3;     // 允许重复key：存储的key之后追加rid，见IxFileHdr::rid_suffix()
+// 文件头中没有版本字段的旧文件：版本字段在B+树改为B-link的页面布局之后才加入，这样的文件可能是旧的页面布局，
+// 也可能是新的页面布局，无法区分，不能打开，需要重建索引
+constexpr int IX_FORMAT_UNVERSIONED = -1;
+// 新建唯一索引使用的格式：单列key仍使用专用的查找内核，允许重复key的非唯一索引需要显式指定IX_FORMAT_DUPLICATE_KEYS
+constexpr int IX_FORMAT_VERSION = IX_FORMAT_COMPRESSED_NODES;
+
+// 允许重复key的索引中，rid作为两个INT列(page_no, slot_no)追加在key之后
+constexpr int IX_RID_SUFFIX_LEN = 2 * sizeof(int);
+// 查找某个key的所有rid时，分别以这两个rid作为下界和上界
+constexpr Rid IX_MIN_RID = {INT_MIN, INT_MIN};
+constexpr Rid IX_MAX_RID = {INT_MAX, INT_MAX};
+
+class IxFileHdr;
+
+// 结点内查找内核：返回keys[0,num)中第一个>=target(lower)或>target(upper)的下标
+using IxSearchFn = int (*)(const IxFileHdr *hdr, const char *keys, int num, const char *target);
+
 class IxFileHdr {
 public: 
     page_id_t first_free_page_no_;      // 文件中第一个空闲的磁盘页面的页面号
@@ -37,21 +61,66 @@ public:
     page_id_t first_leaf_;              // 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf_;               // 尾叶节点对应的页号
     int tot_len_;                       // 记录结构体的整体长度
+    int format_version_;                // 索引文件格式的版本，旧文件中没有该字段，读出为IX_FORMAT_UNVERSIONED
+    int include_num_;                   // col_types_/col_lens_末尾的INCLUDE列数量，旧文件中没有该字段，视为0
+    // 以下两个成员不持久化，打开索引时由ix_init_search_kernels()根据key的布局选择
+    IxSearchFn lower_bound_fn_ = nullptr;
+    IxSearchFn upper_bound_fn_ = nullptr;
 
     IxFileHdr() {
-        tot_len_ = col_num_ = 0;
+        tot_len_ = col_num_ = include_num_ = 0;
+        format_version_ = IX_FORMAT_RAW_KEYS;
     }
 
     IxFileHdr(page_id_t first_free_page_no, int num_pages, page_id_t root_page, int col_num,
                 int col_tot_len, int btree_order, int keys_size, page_id_t first_leaf, page_id_t last_leaf)
                 : first_free_page_no_(first_free_page_no), num_pages_(num_pages), root_page_(root_page), col_num_(col_num),
                 col_tot_len_(col_tot_len), btree_order_(btree_order), keys_size_(keys_size), first_leaf_(first_leaf), last_leaf_(last_leaf) {
-                    tot_len_ = 0;
-                } 
+                    tot_len_ = include_num_ = 0;
+                    format_version_ = IX_FORMAT_VERSION;
+                }
+
+    // 带版本字段的格式都使用当前的页面布局，没有版本字段或版本未知的文件不能打开
+    bool supported_format() const {
+        return format_version_ >= IX_FORMAT_RAW_KEYS && format_version_ <= IX_FORMAT_DUPLICATE_KEYS;
+    }
+
+    // 单列key已经有专用的查找内核（单列CHAR本身就可以memcmp），只有多列key需要规范化编码
+    bool normalized_keys() const { return format_version_ >= IX_FORMAT_NORMALIZED_KEYS && col_num_ > 1; }
+
+    /* 允许重复key：col_types_/col_lens_的最后两列是追加的rid(INT, INT)，存储的key为规范化的(key, rid)，
+     * 因此每一项都是唯一的，相同key的项按rid有序地相邻存放，并且在压缩结点中共享前缀 */
+    bool rid_suffix() const { return format_version_ >= IX_FORMAT_DUPLICATE_KEYS; }
+
+    /* INCLUDE列：只存放在索引项中、不参与查找的列，排在rid之后，因此不影响(key, rid)的顺序，
+     * 只能用于允许重复key的格式，用于让索引覆盖更多的查询（见IndexOnlyScanExecutor） */
+    int include_len() const {
+        int len = 0;
+        for (int i = col_num_ - include_num_; i < col_num_; ++i) {
+            len += col_lens_[i];
+        }
+        return len;
+    }
+
+    // 上层传入的key的长度，不包括追加的rid和INCLUDE列
+    int key_len() const {
+        return (rid_suffix() ? col_tot_len_ - IX_RID_SUFFIX_LEN : col_tot_len_) - include_len();
+    }
+
+    // 解码之后的key中INCLUDE列的起始位置
+    int include_offset() const { return col_tot_len_ - include_len(); }
+
+    // 结点内的key按memcmp有序（规范化的多列key或单列字符串）时才能做前缀压缩和后缀截断
+    bool compressed_nodes() const {
+        if (format_version_ < IX_FORMAT_COMPRESSED_NODES) {
+            return false;
+        }
+        return normalized_keys() || (col_num_ == 1 && (col_types_[0] == TYPE_STRING || col_types_[0] == TYPE_VARCHAR));
+    }
 
     void update_tot_len() {
         tot_len_ = 0;
-        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 6;
+        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 8;
         tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
     }
 
@@ -85,6 +154,10 @@ public:
         offset += sizeof(page_id_t);
         memcpy(dest + offset, &last_leaf_, sizeof(page_id_t));
         offset += sizeof(page_id_t);
+        memcpy(dest + offset, &format_version_, sizeof(int));
+        offset += sizeof(int);
+        memcpy(dest + offset, &include_num_, sizeof(int));
+        offset += sizeof(int);
         assert(offset == tot_len_);
     }
 
@@ -123,6 +196,16 @@ public:
         offset += sizeof(page_id_t);
         last_leaf_ = *reinterpret_cast<const page_id_t*>(src + offset);
         offset += sizeof(page_id_t);
+        format_version_ = IX_FORMAT_UNVERSIONED;
+        if(offset < tot_len_) {
+            format_version_ = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+        }
+        include_num_ = 0;
+        if(offset < tot_len_) {
+            include_num_ = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+        }
         assert(offset == tot_len_);
     }
 };
@@ -133,10 +216,19 @@ public:
     page_id_t parent;               // 父亲节点所在页面的叶号
     int num_key;                    // # current keys (always equals to #child - 1) 已插入的keys数量，key_idx∈[0,num_key)
     bool is_leaf;                   // 是否为叶节点
+    int16_t prefix_len;             // 压缩结点：结点内所有key的公共前缀长度（占用is_leaf之后的对齐空隙，不改变页头大小）
     page_id_t prev_leaf;            // previous leaf node's page_no, effective only when is_leaf is true
     page_id_t next_leaf;            // next leaf node's page_no, effective only when is_leaf is true
+    bool has_high_key;              // 是否有high key，每一层最右侧的结点没有high key（相当于正无穷）
+    int16_t key_len;                // 压缩结点：每个key去掉公共前缀之后保存的长度
+    page_id_t right_sibling;        // 内部结点的右兄弟(B-link)，叶子结点使用next_leaf
+    int level;                      // 结点所在的层数，叶子结点为0，结点创建后不再改变
 };
 
+// 固定当前的页头布局：修改页头会改变所有结点中key和rid的位置，需要同时修改IX_FORMAT_VERSION并重建索引文件；
+// 页头比最初的24字节更大，在此之前创建的索引文件不能读取，需要重新建立
+static_assert(sizeof(IxPageHdr) == 36, "IxPageHdr layout is pinned; changing it requires a new index format version");
+
 class Iid {
 public:
     int page_no;
@@ -145,4 +237,18 @@ public:
     friend bool operator==(const Iid &x, const Iid &y) { return x.page_no == y.page_no && x.slot_no == y.slot_no; }
 
     friend bool operator!=(const Iid &x, const Iid &y) { return !(x == y); }
-};
\ No newline at end of file
+};
+
+class Transaction;
+
+/* 索引的公共接口：执行器维护索引、按key点查时不需要区分B+树(IxIndexHandle)与哈希索引(IxHashHandle) */
+class IxIndex {
+   public:
+    virtual ~IxIndex() = default;
+
+    virtual bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) = 0;
+
+    virtual page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) = 0;
+
+    virtual bool delete_entry(const char *key, const Rid &rid, Transaction *transaction) = 0;
+};
@@ -0,0 +1,375 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_hash.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+void IxHashFileHdr::serialize(char *dest) const {
+    int *p = reinterpret_cast<int *>(dest);
+    *p++ = num_pages_;
+    *p++ = first_free_page_;
+    *p++ = global_depth_;
+    *p++ = key_len_;
+    *p++ = bucket_capacity_;
+    *p++ = static_cast<int>(col_types_.size());
+    for (size_t i = 0; i < col_types_.size(); ++i) {
+        *p++ = col_types_[i];
+        *p++ = col_lens_[i];
+    }
+    *p++ = static_cast<int>(dir_pages_.size());
+    for (page_id_t page_no : dir_pages_) {
+        *p++ = page_no;
+    }
+    assert(reinterpret_cast<char *>(p) - dest <= PAGE_SIZE);
+}
+
+void IxHashFileHdr::deserialize(const char *src) {
+    const int *p = reinterpret_cast<const int *>(src);
+    num_pages_ = *p++;
+    first_free_page_ = *p++;
+    global_depth_ = *p++;
+    key_len_ = *p++;
+    bucket_capacity_ = *p++;
+    int col_num = *p++;
+    col_types_.clear();
+    col_lens_.clear();
+    for (int i = 0; i < col_num; ++i) {
+        col_types_.push_back(static_cast<ColType>(*p++));
+        col_lens_.push_back(*p++);
+    }
+    int dir_page_num = *p++;
+    dir_pages_.assign(p, p + dir_page_num);
+}
+
+IxHashHandle::IxHashHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
+    : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
+    char buf[PAGE_SIZE];
+    disk_manager_->read_page(fd, IX_HASH_FILE_HDR_PAGE, buf, PAGE_SIZE);
+    file_hdr_.deserialize(buf);
+    // 新分配的页面接在文件已有的页面之后
+    disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages_);
+
+    directory_.resize(1 << file_hdr_.global_depth_);
+    for (size_t i = 0; i < file_hdr_.dir_pages_.size(); ++i) {
+        Page *page = fetch_page(file_hdr_.dir_pages_[i]);
+        size_t begin = i * IX_HASH_DIR_ENTRIES_PER_PAGE;
+        size_t n = std::min(directory_.size() - begin, static_cast<size_t>(IX_HASH_DIR_ENTRIES_PER_PAGE));
+        memcpy(directory_.data() + begin, page->get_data(), n * sizeof(page_id_t));
+        unpin(page, false);
+    }
+}
+
+/**
+ * @brief 查找key对应的所有记录
+ *
+ * @param key 要查找的key，长度为key_len_
+ * @param result 追加key对应的rid，按rid有序
+ * @return 是否找到
+ */
+bool IxHashHandle::get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    char ckey[IX_MAX_COL_LEN];
+    canonical_key(key, ckey);
+    uint32_t hash = hash_key(ckey);
+    size_t begin = result->size();
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    page_id_t page_no = directory_[hash & ((1u << file_hdr_.global_depth_) - 1)];
+    while (page_no != IX_NO_PAGE) {
+        Page *page = fetch_page(page_no);
+        auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        for (int pos = 0; pos < hdr->num_entries; ++pos) {
+            if (memcmp(entry_key(page->get_data(), pos), ckey, file_hdr_.key_len_) == 0) {
+                result->push_back(*entry_rid(page->get_data(), pos));
+            }
+        }
+        page_no = hdr->overflow;
+        unpin(page, false);
+    }
+    std::sort(result->begin() + begin, result->end());
+    return result->size() > begin;
+}
+
+/**
+ * @brief 插入(key, rid)
+ *
+ * @return page_id_t 插入到的页面，(key, rid)已经存在时返回-1
+ */
+page_id_t IxHashHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    char ckey[IX_MAX_COL_LEN];
+    canonical_key(key, ckey);
+    uint32_t hash = hash_key(ckey);
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    while (true) {
+        page_id_t head = directory_[hash & ((1u << file_hdr_.global_depth_) - 1)];
+        page_id_t target = IX_NO_PAGE;      // 链上第一个有空位的页面
+        page_id_t tail = head;
+        int local_depth = 0;
+        bool splittable = false;            // 链上是否有哈希值不同的key，分裂之后可以分开
+        uint32_t max_mask = (1u << IX_HASH_MAX_GLOBAL_DEPTH) - 1;
+        for (page_id_t page_no = head; page_no != IX_NO_PAGE;) {
+            Page *page = fetch_page(page_no);
+            auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+            for (int pos = 0; pos < hdr->num_entries; ++pos) {
+                const char *entry = entry_key(page->get_data(), pos);
+                if (memcmp(entry, ckey, file_hdr_.key_len_) == 0) {
+                    if (*entry_rid(page->get_data(), pos) == value) {
+                        unpin(page, false);
+                        return -1;
+                    }
+                } else if (!splittable && target == IX_NO_PAGE && (hash_key(entry) & max_mask) != (hash & max_mask)) {
+                    splittable = true;
+                }
+            }
+            if (target == IX_NO_PAGE && hdr->num_entries < file_hdr_.bucket_capacity_) {
+                target = page_no;
+            }
+            if (page_no == head) {
+                local_depth = hdr->local_depth;
+            }
+            tail = page_no;
+            page_no = hdr->overflow;
+            unpin(page, false);
+        }
+        if (target == IX_NO_PAGE && splittable && local_depth < IX_HASH_MAX_GLOBAL_DEPTH) {
+            // 桶满了：分裂之后重新查找
+            split_bucket(hash);
+            continue;
+        }
+        Page *page;
+        if (target != IX_NO_PAGE) {
+            page = fetch_page(target);
+        } else {
+            // 桶中都是哈希值相同的key，或者目录已经不能再加倍：链接一个溢出页
+            page = allocate_page(local_depth);
+            Page *tail_page = fetch_page(tail);
+            reinterpret_cast<IxHashBucketHdr *>(tail_page->get_data())->overflow = page->get_page_id().page_no;
+            unpin(tail_page, true);
+        }
+        auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        memcpy(entry_key(page->get_data(), hdr->num_entries), ckey, file_hdr_.key_len_);
+        *entry_rid(page->get_data(), hdr->num_entries) = value;
+        hdr->num_entries++;
+        page_id_t page_no = page->get_page_id().page_no;
+        unpin(page, true);
+        return page_no;
+    }
+}
+
+/**
+ * @brief 删除(key, rid)，溢出页删空之后放回空闲页链表；桶不合并
+ *
+ * @return 是否找到并删除
+ */
+bool IxHashHandle::delete_entry(const char *key, const Rid &rid, Transaction *transaction) {
+    char ckey[IX_MAX_COL_LEN];
+    canonical_key(key, ckey);
+    uint32_t hash = hash_key(ckey);
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    page_id_t prev = IX_NO_PAGE;
+    page_id_t page_no = directory_[hash & ((1u << file_hdr_.global_depth_) - 1)];
+    while (page_no != IX_NO_PAGE) {
+        Page *page = fetch_page(page_no);
+        auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        for (int pos = 0; pos < hdr->num_entries; ++pos) {
+            if (memcmp(entry_key(page->get_data(), pos), ckey, file_hdr_.key_len_) != 0 ||
+                !(*entry_rid(page->get_data(), pos) == rid)) {
+                continue;
+            }
+            // 用最后一项填补空位
+            int last = hdr->num_entries - 1;
+            memmove(entry_key(page->get_data(), pos), entry_key(page->get_data(), last), file_hdr_.key_len_ + sizeof(Rid));
+            hdr->num_entries--;
+            if (hdr->num_entries == 0 && prev != IX_NO_PAGE) {
+                Page *prev_page = fetch_page(prev);
+                reinterpret_cast<IxHashBucketHdr *>(prev_page->get_data())->overflow = hdr->overflow;
+                unpin(prev_page, true);
+                free_page(page);
+            } else {
+                unpin(page, true);
+            }
+            return true;
+        }
+        prev = page_no;
+        page_no = hdr->overflow;
+        unpin(page, false);
+    }
+    return false;
+}
+
+/**
+ * @brief 把内存中的目录写回目录页面
+ */
+void IxHashHandle::flush_directory() {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    for (size_t i = 0; i < file_hdr_.dir_pages_.size(); ++i) {
+        Page *page = fetch_page(file_hdr_.dir_pages_[i]);
+        size_t begin = i * IX_HASH_DIR_ENTRIES_PER_PAGE;
+        size_t n = std::min(directory_.size() - begin, static_cast<size_t>(IX_HASH_DIR_ENTRIES_PER_PAGE));
+        memcpy(page->get_data(), directory_.data() + begin, n * sizeof(page_id_t));
+        unpin(page, true);
+    }
+}
+
+/* FNV-1a之后再做一次混合，使低位也足够均匀；哈希值决定了key所在的桶，必须与平台无关 */
+uint32_t IxHashHandle::hash_key(const char *key) const {
+    uint64_t h = 1469598103934665603ULL;
+    for (int i = 0; i < file_hdr_.key_len_; ++i) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+}
+
+/* 按字节比较key之前统一-0.0和0.0，它们在ix_compare中相等 */
+void IxHashHandle::canonical_key(const char *key, char *dest) const {
+    memcpy(dest, key, file_hdr_.key_len_);
+    int offset = 0;
+    for (size_t i = 0; i < file_hdr_.col_types_.size(); ++i) {
+        if (file_hdr_.col_types_[i] == TYPE_FLOAT) {
+            float v;
+            memcpy(&v, dest + offset, sizeof(float));
+            if (v == 0.0f) {
+                v = 0.0f;
+                memcpy(dest + offset, &v, sizeof(float));
+            }
+        }
+        offset += file_hdr_.col_lens_[i];
+    }
+}
+
+Page *IxHashHandle::fetch_page(page_id_t page_no) {
+    Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+    if (page == nullptr) {
+        throw InternalError("IxHashHandle: buffer pool is full");
+    }
+    return page;
+}
+
+void IxHashHandle::unpin(Page *page, bool dirty) { buffer_pool_manager_->unpin_page(page->get_page_id(), dirty); }
+
+/**
+ * @brief 分配一个空的桶页面，优先复用空闲页链表中的页面
+ * @return pin住的页面，调用者负责unpin
+ */
+Page *IxHashHandle::allocate_page(int local_depth) {
+    Page *page;
+    if (file_hdr_.first_free_page_ != IX_NO_PAGE) {
+        page = fetch_page(file_hdr_.first_free_page_);
+        file_hdr_.first_free_page_ = reinterpret_cast<IxHashBucketHdr *>(page->get_data())->overflow;
+    } else {
+        PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+        page = buffer_pool_manager_->new_page(&page_id);
+        if (page == nullptr) {
+            throw InternalError("IxHashHandle: buffer pool is full");
+        }
+        file_hdr_.num_pages_++;
+    }
+    memset(page->get_data(), 0, PAGE_SIZE);
+    auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+    hdr->local_depth = local_depth;
+    hdr->num_entries = 0;
+    hdr->overflow = IX_NO_PAGE;
+    return page;
+}
+
+/* 把页面放回空闲页链表并unpin */
+void IxHashHandle::free_page(Page *page) {
+    auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+    hdr->num_entries = 0;
+    hdr->overflow = file_hdr_.first_free_page_;
+    file_hdr_.first_free_page_ = page->get_page_id().page_no;
+    unpin(page, true);
+}
+
+/**
+ * @brief 分裂hash所在的桶：局部深度加一，按哈希值的第local_depth位把桶(包括溢出页)中的项分到两个桶中
+ * 局部深度等于全局深度时先把目录加倍
+ */
+bool IxHashHandle::split_bucket(uint32_t hash) {
+    page_id_t head = directory_[hash & ((1u << file_hdr_.global_depth_) - 1)];
+    Page *head_page = fetch_page(head);
+    auto head_hdr = reinterpret_cast<IxHashBucketHdr *>(head_page->get_data());
+    int local_depth = head_hdr->local_depth;
+    if (local_depth == file_hdr_.global_depth_) {
+        if (file_hdr_.global_depth_ == IX_HASH_MAX_GLOBAL_DEPTH) {
+            unpin(head_page, false);
+            return false;
+        }
+        size_t size = directory_.size();
+        directory_.resize(size * 2);
+        std::copy(directory_.begin(), directory_.begin() + size, directory_.begin() + size);
+        file_hdr_.global_depth_++;
+        while (file_hdr_.dir_pages_.size() * IX_HASH_DIR_ENTRIES_PER_PAGE < directory_.size()) {
+            Page *dir_page = allocate_page(0);
+            file_hdr_.dir_pages_.push_back(dir_page->get_page_id().page_no);
+            unpin(dir_page, true);
+        }
+    }
+
+    // 取出桶中的所有项，释放溢出页
+    std::vector<char> entries;
+    int entry_len = file_hdr_.key_len_ + sizeof(Rid);
+    for (page_id_t page_no = head; page_no != IX_NO_PAGE;) {
+        Page *page = page_no == head ? head_page : fetch_page(page_no);
+        auto hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        const char *begin = entry_key(page->get_data(), 0);
+        entries.insert(entries.end(), begin, begin + hdr->num_entries * entry_len);
+        page_no = hdr->overflow;
+        if (page != head_page) {
+            free_page(page);
+        }
+    }
+    head_hdr->local_depth = local_depth + 1;
+    head_hdr->num_entries = 0;
+    head_hdr->overflow = IX_NO_PAGE;
+    Page *new_page = allocate_page(local_depth + 1);
+
+    // 重新分配，桶放不下时链接溢出页
+    Page *tails[2] = {head_page, new_page};
+    for (size_t offset = 0; offset < entries.size(); offset += entry_len) {
+        const char *entry = entries.data() + offset;
+        Page *&tail = tails[(hash_key(entry) >> local_depth) & 1];
+        auto hdr = reinterpret_cast<IxHashBucketHdr *>(tail->get_data());
+        if (hdr->num_entries == file_hdr_.bucket_capacity_) {
+            Page *overflow = allocate_page(local_depth + 1);
+            hdr->overflow = overflow->get_page_id().page_no;
+            if (tail != head_page && tail != new_page) {
+                unpin(tail, true);
+            }
+            tail = overflow;
+            hdr = reinterpret_cast<IxHashBucketHdr *>(tail->get_data());
+        }
+        memcpy(entry_key(tail->get_data(), hdr->num_entries), entry, entry_len);
+        hdr->num_entries++;
+    }
+    for (Page *tail : tails) {
+        if (tail != head_page && tail != new_page) {
+            unpin(tail, true);
+        }
+    }
+
+    // 目录中低local_depth位与该桶相同的项，按第local_depth位指向两个桶
+    uint32_t low_mask = (1u << local_depth) - 1;
+    page_id_t new_page_no = new_page->get_page_id().page_no;
+    for (size_t i = 0; i < directory_.size(); ++i) {
+        if ((i & low_mask) == (hash & low_mask)) {
+            directory_[i] = ((i >> local_depth) & 1) ? new_page_no : head;
+        }
+    }
+    unpin(head_page, true);
+    unpin(new_page, true);
+    return true;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <shared_mutex>
+#include <vector>
+
+#include "ix_defs.h"
+#include "transaction/transaction.h"
+
+/*
+ * 可扩展哈希索引：只支持等值查找，一次查找只需要读取key所在的桶页面（桶溢出时再读取溢出页）
+ * - 第0页为文件头，目录(2^global_depth个桶页号)常驻内存，按页存放在dir_pages_中，关闭时写回
+ * - 每个桶一个页面，存放(key, rid)，同一个key可以对应多条记录
+ * - 桶满时分裂，局部深度等于全局深度时目录加倍；桶中全是哈希值相同的key(重复key)时分裂无效，改为链接溢出页
+ */
+
+constexpr int IX_HASH_FILE_HDR_PAGE = 0;
+constexpr int IX_HASH_INIT_DIR_PAGE = 1;
+constexpr int IX_HASH_INIT_BUCKET_PAGE = 2;
+constexpr int IX_HASH_INIT_NUM_PAGES = 3;
+constexpr int IX_HASH_MAX_GLOBAL_DEPTH = 18;    // 目录最多2^18项，存放目录的页号必须能放进文件头
+constexpr int IX_HASH_DIR_ENTRIES_PER_PAGE = PAGE_SIZE / sizeof(page_id_t);
+
+/* 哈希索引的文件头 */
+class IxHashFileHdr {
+   public:
+    int num_pages_ = IX_HASH_INIT_NUM_PAGES;    // 文件中已经分配的页面数
+    int first_free_page_ = IX_NO_PAGE;          // 释放的溢出页组成的链表
+    int global_depth_ = 0;                      // 目录的全局深度
+    int key_len_ = 0;                           // key的长度，即各列长度之和
+    int bucket_capacity_ = 0;                   // 每个桶页面最多存放的(key, rid)数量
+    std::vector<ColType> col_types_;
+    std::vector<int> col_lens_;
+    std::vector<page_id_t> dir_pages_;          // 存放目录的页面，第i页存放目录的第[i * PER_PAGE, (i + 1) * PER_PAGE)项
+
+    void serialize(char *dest) const;
+
+    void deserialize(const char *src);
+};
+
+/* 桶页面的页头，之后紧跟bucket_capacity_个(key, rid) */
+struct IxHashBucketHdr {
+    int local_depth;        // 桶的局部深度，目录中低local_depth位相同的项指向该桶
+    int num_entries;        // 该页面中(key, rid)的数量
+    page_id_t overflow;     // 溢出页，IX_NO_PAGE表示没有；释放的溢出页用它链接空闲页链表
+};
+
+/* 哈希索引 */
+class IxHashHandle : public IxIndex {
+    friend class IxManager;
+
+   private:
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    int fd_;
+    IxHashFileHdr file_hdr_;
+    std::vector<page_id_t> directory_;  // 目录，下标为哈希值的低global_depth_位
+    std::shared_mutex latch_;           // 查找共享，插入删除独占整个索引
+
+   public:
+    IxHashHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
+
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) override;
+
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) override;
+
+    bool delete_entry(const char *key, const Rid &rid, Transaction *transaction) override;
+
+    const IxHashFileHdr &get_file_hdr() const { return file_hdr_; }
+
+    /* 把目录写回目录页面，关闭索引之前调用 */
+    void flush_directory();
+
+   private:
+    uint32_t hash_key(const char *key) const;
+
+    void canonical_key(const char *key, char *dest) const;
+
+    char *entry_key(char *page_data, int pos) const {
+        return page_data + sizeof(IxHashBucketHdr) + pos * (file_hdr_.key_len_ + sizeof(Rid));
+    }
+
+    Rid *entry_rid(char *page_data, int pos) const {
+        return reinterpret_cast<Rid *>(entry_key(page_data, pos) + file_hdr_.key_len_);
+    }
+
+    Page *fetch_page(page_id_t page_no);
+
+    Page *allocate_page(int local_depth);
+
+    void free_page(Page *page);
+
+    void unpin(Page *page, bool dirty);
+
+    bool split_bucket(uint32_t hash);
+};
@@ -10,7 +10,10 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_index_handle.h"
 
+#include <vector>
+
 #include "ix_scan.h"
+#include "ix_search.h"
 
 /**
  * @brief 在当前node中查找第一个>=target的key_idx
@@ -22,25 +25,12 @@ int IxNodeHandle::lower_bound(const char *target) const {
     // Todo:
     // 查找当前节点中第一个大于等于target的key，并返回key的位置给上层
     // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用ix_compare()函数进行比较
-    // 二分查找
-    int left = 0, right = page_hdr->num_key - 1;
-    while(left <= right)    // 需要加上等号，保证target大于所有元素时，left = num_key
+    // 使用打开索引时按key类型选好的查找内核（见ix_search.h）
+    if(compressed)
     {
-        int mid = (left + right) / 2;
-        int res = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-        if(res == 0)
-        {
-            return mid;
-        }else if(res == 1)
-        {
-            right = mid - 1;    // 说明target在mid的左侧
-        }else
-        {
-            left = mid + 1;
-        }
+        return compressed_search(target, 0, false);
     }
-
-    return left;
+    return file_hdr->lower_bound_fn_(file_hdr, keys, page_hdr->num_key, target);
 }
 
 /**
@@ -53,24 +43,212 @@ int IxNodeHandle::upper_bound(const char *target) const {
     // Todo:
     // 查找当前节点中第一个大于target的key，并返回key的位置给上层
     // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用ix_compare()函数进行比较
-    int left = 1, right = page_hdr->num_key - 1;
-    while(left <= right)
+    if(page_hdr->num_key <= 1)
     {
-        int mid = (left + right) / 2;
-        int res = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-        if(res == 0)
-        {
-            return mid + 1;
-        }else if(res == 1)
-        {
-            right = mid - 1;
-        }else
-        {
-            left = mid + 1;
-        }
+        return 1;
+    }
+    if(compressed)
+    {
+        return compressed_search(target, 1, true);
+    }
+    return 1 + file_hdr->upper_bound_fn_(file_hdr, get_key(1), page_hdr->num_key - 1, target);
+}
+
+/**
+ * @brief 压缩结点中的查找：先和公共前缀比较，前缀相同时对每个key保存的key_len个字节做无分支二分查找
+ *
+ * @param from 从第from个key开始查找
+ * @param upper 为true时查找第一个>target的key，否则查找第一个>=target的key
+ */
+int IxNodeHandle::compressed_search(const char *target, int from, bool upper) const {
+    int num = page_hdr->num_key;
+    if(from >= num)
+    {
+        return num;
+    }
+    int len = file_hdr->col_tot_len_;
+    int p = page_hdr->prefix_len;
+    int w = page_hdr->key_len;
+    int res = memcmp(target, prefix, p);
+    if(res != 0)
+    {
+        return res < 0 ? from : num;    // target小于/大于结点内所有的key
     }
+    const char *suffix = target + p;
+    // target在p+w之后还有非'\0'字节时，前p+w个字节与target相同的key也小于target
+    bool tail = ix_significant_len(suffix + w, len - p - w) > 0;
+    bool le = upper || tail;    // 前p+w个字节相同的key是否算作在target之前
+    int stride = entry_size(w);
+    const char *base_key = entries + sizeof(Rid);
+    int base = from;
+    int n = num - from;
+    while(n > 1)
+    {
+        int half = n / 2;
+        int c = memcmp(base_key + (base + half) * stride, suffix, w);
+        base = (le ? c <= 0 : c < 0) ? base + half : base;
+        n -= half;
+    }
+    int c = memcmp(base_key + base * stride, suffix, w);
+    return base + (le ? c <= 0 : c < 0);
+}
 
-    return left;
+void IxNodeHandle::copy_key(int key_idx, char *dest) const {
+    int len = file_hdr->col_tot_len_;
+    if(!compressed)
+    {
+        memcpy(dest, get_key(key_idx), len);
+        return;
+    }
+    int p = page_hdr->prefix_len;
+    int w = page_hdr->key_len;
+    memcpy(dest, prefix, p);
+    memcpy(dest + p, entry_key(key_idx), w);
+    memset(dest + p + w, 0, len - p - w);
+}
+
+int IxNodeHandle::compare_key(int key_idx, const char *key) const {
+    if(!compressed)
+    {
+        return ix_compare(get_key(key_idx), key, file_hdr);
+    }
+    int p = page_hdr->prefix_len;
+    int w = page_hdr->key_len;
+    int res = memcmp(prefix, key, p);
+    if(res == 0)
+    {
+        res = memcmp(entry_key(key_idx), key + p, w);
+    }
+    if(res == 0)
+    {
+        return ix_significant_len(key + p + w, file_hdr->col_tot_len_ - p - w) > 0 ? -1 : 0;
+    }
+    return (res > 0) - (res < 0);
+}
+
+void IxNodeHandle::copy_pairs(int pos, int n, char *keys_out, Rid *rids_out) const {
+    for(int i = 0; i < n; ++i)
+    {
+        copy_key(pos + i, keys_out + i * file_hdr->col_tot_len_);
+        rids_out[i] = *get_rid(pos + i);
+    }
+}
+
+/**
+ * @brief 计算同时容纳结点中现有的key和new_keys中的n个key所需的公共前缀长度和key_len
+ * 现有key的公共前缀可能比prefix_len更长（删除之后没有重新压缩），这里直接沿用prefix_len
+ */
+void IxNodeHandle::encoding_for(const char *new_keys, int n, int *prefix_len, int *key_len) const {
+    int len = file_hdr->col_tot_len_;
+    const char *base = new_keys;
+    int p = len;
+    int end = 0;    // 所有key去掉末尾'\0'之后的最大长度
+    if(page_hdr->num_key > 0)
+    {
+        base = prefix;
+        p = page_hdr->prefix_len;
+        end = page_hdr->prefix_len + page_hdr->key_len;
+    }
+    for(int i = 0; i < n; ++i)
+    {
+        const char *key = new_keys + i * len;
+        p = ix_common_prefix(base, key, p);
+        end = std::max(end, ix_significant_len(key, len));
+    }
+    *prefix_len = p;
+    *key_len = std::max(end - p, 0);
+}
+
+void IxNodeHandle::reencode(int prefix_len, int key_len) {
+    int size = page_hdr->num_key;
+    int len = file_hdr->col_tot_len_;
+    std::vector<char> old_keys(size * len);
+    std::vector<Rid> old_rids(size);
+    copy_pairs(0, size, old_keys.data(), old_rids.data());
+    if(size > 0)
+    {
+        memcpy(prefix, old_keys.data(), prefix_len);
+    }
+    page_hdr->prefix_len = prefix_len;
+    page_hdr->key_len = key_len;
+    for(int i = 0; i < size; ++i)
+    {
+        *get_rid(i) = old_rids[i];
+        memcpy(entry_key(i), old_keys.data() + i * len + prefix_len, key_len);
+    }
+}
+
+void IxNodeHandle::recompress() {
+    if(!compressed)
+    {
+        return;
+    }
+    int size = page_hdr->num_key;
+    if(size == 0)
+    {
+        page_hdr->prefix_len = 0;
+        page_hdr->key_len = 0;
+        return;
+    }
+    int len = file_hdr->col_tot_len_;
+    char first[IX_MAX_COL_LEN];
+    copy_key(0, first);
+    // 内部结点的第一个key不参与查找，不保证小于后面的key，因此逐个计算公共前缀
+    int p = len;
+    int end = 0;
+    char key[IX_MAX_COL_LEN];
+    for(int i = 0; i < size; ++i)
+    {
+        copy_key(i, key);
+        p = ix_common_prefix(first, key, p);
+        end = std::max(end, ix_significant_len(key, len));
+    }
+    int w = std::max(end - p, 0);
+    if(p != page_hdr->prefix_len || w != page_hdr->key_len)
+    {
+        reencode(p, w);
+    }
+}
+
+bool IxNodeHandle::can_insert(const char *key) const {
+    if(!compressed)
+    {
+        return page_hdr->num_key + 1 <= file_hdr->btree_order_ + 1;   // 未压缩结点插入之后达到上限时再分裂
+    }
+    int p, w;
+    encoding_for(key, 1, &p, &w);
+    return page_hdr->num_key + 1 <= capacity(w);
+}
+
+bool IxNodeHandle::can_append(const char *key, double fill_factor) const {
+    int cap = file_hdr->btree_order_ + 1;
+    if(compressed)
+    {
+        int p, w;
+        encoding_for(key, 1, &p, &w);
+        cap = capacity(w);
+    }
+    // 结点达到最大容量时会分裂，因此最多填充cap-1个键值对；内部结点至少要有两个孩子
+    int limit = std::min(cap - 1, std::max(2, static_cast<int>(cap * fill_factor)));
+    return page_hdr->num_key + 1 <= limit;
+}
+
+bool IxNodeHandle::can_absorb(const IxNodeHandle *node) const {
+    int total = page_hdr->num_key + node->page_hdr->num_key;
+    if(!compressed)
+    {
+        return total <= file_hdr->btree_order_;
+    }
+    if(node->page_hdr->num_key == 0 || page_hdr->num_key == 0)
+    {
+        const IxPageHdr *hdr = page_hdr->num_key == 0 ? node->page_hdr : page_hdr;
+        return total <= capacity(hdr->key_len);
+    }
+    int p = std::min(page_hdr->prefix_len, node->page_hdr->prefix_len);
+    p = ix_common_prefix(prefix, node->prefix, p);
+    int end = std::max(page_hdr->prefix_len + page_hdr->key_len,
+                       node->page_hdr->prefix_len + node->page_hdr->key_len);
+    return total <= capacity(end - p);
 }
 
 /**
@@ -89,7 +267,7 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
     // 提示：可以调用lower_bound()和get_rid()函数。
     int key_pos = lower_bound(key);
     // 如果key_pos超出num_key或者与key不相等，则返回false
-    if(key_pos >= page_hdr->num_key || ix_compare(get_key(key_pos), key, file_hdr->col_types_, file_hdr->col_lens_) != 0)
+    if(key_pos >= page_hdr->num_key || compare_key(key_pos, key) != 0)
     {
         return false;
     }
@@ -134,8 +312,35 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
     // 4. 更新当前节点的键数量
     int size = page_hdr->num_key;
     // 判断pos的合法性
-    if(pos < 0 || pos > size)
+    // 合并两个空结点时n为0，此时key可能是空指针
+    if(pos < 0 || pos > size || n == 0)
+    {
+        return;
+    }
+    if(compressed)
     {
+        // 新的key可能缩短公共前缀或加长key_len，此时先按新的编码重写已有的键值对
+        int len = file_hdr->col_tot_len_;
+        int p, w;
+        encoding_for(key, n, &p, &w);
+        if(size == 0)
+        {
+            memcpy(prefix, key, p);
+            page_hdr->prefix_len = p;
+            page_hdr->key_len = w;
+        }else if(p != page_hdr->prefix_len || w != page_hdr->key_len)
+        {
+            reencode(p, w);
+        }
+        int stride = entry_size(w);
+        assert(entries_offset(file_hdr) + (size + n) * stride <= PAGE_SIZE);
+        memmove(entries + (pos + n) * stride, entries + pos * stride, (size - pos) * stride);
+        for(int i = 0; i < n; ++i)
+        {
+            *get_rid(pos + i) = rid[i];
+            memcpy(entry_key(pos + i), key + i * len + p, w);
+        }
+        set_size(size + n);
         return;
     }
     // 首先移走pos~num_key的键值对
@@ -169,7 +374,7 @@ int IxNodeHandle::insert(const char *key, const Rid &value) {
     // 4. 返回完成插入操作之后的键值对数量
     int insert_pos = lower_bound(key);
     // 查看key是否重复
-    if(ix_compare(get_key(insert_pos), key, file_hdr->col_types_, file_hdr->col_lens_) == 0)
+    if(insert_pos < get_size() && compare_key(insert_pos, key) == 0)
     {
         return -1;  // key重复了，不能插入
     }
@@ -188,6 +393,13 @@ void IxNodeHandle::erase_pair(int pos) {
     // 1. 删除该位置的key
     // 2. 删除该位置的rid
     // 3. 更新结点的键值对数量
+    if(compressed)
+    {
+        int stride = entry_size(page_hdr->key_len);
+        memmove(entries + pos * stride, entries + (pos + 1) * stride, (get_size() - pos - 1) * stride);
+        set_size(get_size() - 1);
+        return;
+    }
     // 向前覆盖即可
     for(int i = pos; i < get_size(); ++i)
     {
@@ -197,6 +409,25 @@ void IxNodeHandle::erase_pair(int pos) {
     set_size(get_size() - 1);   // 更新键值对
 }
 
+/**
+ * @brief 删除[pos, pos+n)这n个连续的键值对，用于范围删除
+ */
+void IxNodeHandle::erase_pairs(int pos, int n) {
+    int size = get_size();
+    assert(pos >= 0 && n >= 0 && pos + n <= size);
+    if(compressed)
+    {
+        int stride = entry_size(page_hdr->key_len);
+        memmove(entries + pos * stride, entries + (pos + n) * stride, (size - pos - n) * stride);
+    }else
+    {
+        int len = file_hdr->col_tot_len_;
+        memmove(keys + pos * len, keys + (pos + n) * len, (size - pos - n) * len);
+        memmove(rids + pos, rids + pos + n, (size - pos - n) * sizeof(Rid));
+    }
+    set_size(size - n);
+}
+
 /**
  * @brief 用于在结点中删除指定key的键值对。函数返回删除后的键值对数量
  *
@@ -210,7 +441,7 @@ int IxNodeHandle::remove(const char *key) {
     // 3. 返回完成删除操作后的键值对数量
     int remove_pos = lower_bound(key);
     // 如果要删除的键值对存在，则调用erase函数
-    if(ix_compare(get_key(remove_pos), key, file_hdr->col_types_, file_hdr->col_lens_) == 0)
+    if(remove_pos < get_size() && compare_key(remove_pos, key) == 0)
     {
         erase_pair(remove_pos);
         return get_size();
@@ -228,35 +459,203 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
     file_hdr_ = new IxFileHdr();
     file_hdr_->deserialize(buf);
+    ix_init_search_kernels(file_hdr_);
     
     // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
-    int now_page_no = disk_manager_->get_fd2pageno(fd);
-    disk_manager_->set_fd2pageno(fd, now_page_no + 1);
+    disk_manager_->set_fd2pageno(fd, file_hdr_->num_pages_);
+}
+
+IxIndexHandle::~IxIndexHandle() {
+    if(compactor_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(compact_latch_);
+            stop_compactor_ = true;
+        }
+        compact_cv_.notify_all();
+        compactor_.join();
+    }
+}
+
+/**
+ * @brief 从根结点开始下降到叶子结点，每次只持有一个结点的锁(B-link)
+ * 释放父结点之后再锁住孩子结点，其间孩子结点可能被分裂，由move_right沿右兄弟找到目标结点；
+ * 有内部结点快照时跳过快照中的层，快照过期造成的偏差同样由move_right纠正
+ * @note 调用者需要共享持有tree_latch_，保证下降过程中结点不会被合并删除
+ *
+ * @param key 要查找的目标key值
+ * @param latch_leaf_exclusive 叶子结点是否加写锁（插入/删除只对叶子结点加写锁）
+ * @param find_first 是否总是沿着第一个孩子下降
+ * @param path 传出参数：下降时经过的内部结点，插入时用于查找父结点
+ * @return 加了锁并pin住的叶子结点
+ */
+IxNodeGuard IxIndexHandle::descend_shared(const char *key, bool latch_leaf_exclusive, bool find_first, IxPath *path) {
+    // 有内部结点快照时从快照最底层之下的结点开始下降，快照中经过的结点也记录在path中
+    std::shared_ptr<const IxInnerCache> cache = inner_cache_for_descent();
+    page_id_t page_no;
+    if(cache != nullptr && cache->num_levels() > 0)
+    {
+        page_no = cache->route(key, find_first, path);
+    }else
+    {
+        cache.reset();
+        root_latch_.lock_shared();
+        page_no = file_hdr_->root_page_;
+        root_latch_.unlock_shared();
+    }
+    while(true)
+    {
+        IxNodeGuard node = fetch_node(page_no);
+        // 结点被创建之后is_leaf不会再改变，因此可以在加锁之前读取
+        bool exclusive = latch_leaf_exclusive && node->is_leaf_page();
+        if(exclusive)
+        {
+            node.wlatch();
+        }else
+        {
+            node.rlatch();
+        }
+        // 快照建立之后有结点分裂并且因此需要右移时，下次下降之前重建快照
+        if(!find_first && move_right(node, key, exclusive) > 0 && cache != nullptr && inner_cache_splits_ > 0)
+        {
+            inner_cache_stale_ = true;
+        }
+        if(node->is_leaf_page())
+        {
+            return node;
+        }
+        if(path != nullptr)
+        {
+            path->push(node->get_page_no());
+        }
+        page_no = find_first ? node->value_at(0) : node->internal_lookup(key);
+    }   // 离开作用域时node释放读锁并unpin，然后再锁住孩子结点
+}
+
+/**
+ * @brief key >= node的high key时，沿着右兄弟指针向右移动，直到找到范围包含key的结点
+ * node可能在加锁之前被其他线程分裂，分裂出的新结点一定在它的右侧
+ *
+ * @param node 已经加锁的结点，返回时指向范围包含key的结点
+ * @param key 目标key
+ * @param exclusive node上加的是否为写锁，右兄弟结点加同样的锁
+ * @return 向右移动的次数
+ */
+int IxIndexHandle::move_right(IxNodeGuard &node, const char *key, bool exclusive) {
+    int hops = 0;
+    while(node->need_move_right(key))
+    {
+        hops++;
+        page_id_t right_no = node->get_right_link();
+        node.reset();
+        node = fetch_node(right_no);
+        if(exclusive)
+        {
+            node.wlatch();
+        }else
+        {
+            node.rlatch();
+        }
+    }
+    return hops;
+}
+
+/**
+ * @brief 从根结点重新下降，找到第level层中范围包含key的结点
+ * 用于分裂之后查找父结点：下降时记录的路径已经失效（树长高了，或者父结点刚被分裂）
+ *
+ * @return 加了写锁的结点，调用者还需要对它调用move_right
+ */
+IxNodeGuard IxIndexHandle::find_node_by_level(const char *key, int level) {
+    root_latch_.lock_shared();
+    page_id_t page_no = file_hdr_->root_page_;
+    root_latch_.unlock_shared();
+    while(true)
+    {
+        IxNodeGuard node = fetch_node(page_no);
+        // 结点的层数在创建后不会改变，因此可以在加锁之前读取
+        if(node->get_level() == level)
+        {
+            node.wlatch();
+            return node;
+        }
+        node.rlatch();
+        move_right(node, key, false);
+        page_no = node->internal_lookup(key);
+    }
+}
+
+/**
+ * @brief 判断在node上执行operation之后，修改是否一定不会传播到node的祖先结点
+ * 删除时如果叶子是安全的，只需要共享持有tree_latch_并锁住叶子
+ *
+ * @param node 已经加了写锁的结点
+ * @param key 要插入/删除的key
+ * @param operation 插入或删除
+ */
+bool IxIndexHandle::is_safe(IxNodeHandle *node, const char *key, Operation operation) {
+    if(operation == Operation::INSERT)
+    {
+        // 插入之后不会分裂
+        return node->get_size() + 1 < node->get_max_size();
+    }
+    if(node->is_root_page())
+    {
+        // 根结点不需要满足min_size，只有删空（叶子）或只剩一个孩子（内部结点）时才需要调整根
+        return node->is_leaf_page() ? node->get_size() > 1 : node->get_size() > 2;
+    }
+    if(node->get_size() - 1 < node->get_min_size())
+    {
+        return false;   // 删除之后可能需要合并或重分配
+    }
+    // 压缩结点的父结点中保存的是截断之后的分隔key，不需要和孩子的第一个key保持一致
+    if(node->is_compressed())
+    {
+        return true;
+    }
+    // 删除了结点的第一个key时，maintain_parent会修改父结点中对应的key
+    if(node->is_leaf_page())
+    {
+        return node->compare_key(0, key) != 0;
+    }
+    return node->upper_bound(key) - 1 != 0;
 }
 
 /**
  * @brief 用于查找指定键所在的叶子结点
+ * 查找时每次只持有一个结点的读锁(B-link右移)；删除时调用者独占tree_latch_，树结构不会被其他线程修改，
+ * 直接沿内部结点下降，只对返回的叶子加写锁
+ *
  * @param key 要查找的目标key值
- * @param operation 查找到目标键值对后要进行的操作类型
- * @param transaction 事务参数，如果不需要则默认传入nullptr
- * @return [leaf node] and [root_is_latched] 返回目标叶子结点以及根结点是否加锁
- * @note need to Unlatch and unpin the leaf node outside!
- * 注意：用了FindLeafPage之后一定要unlatch叶结点，否则下次latch该结点会堵塞！
- */
-std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,
-                                                            Transaction *transaction, bool find_first) {
+ * @param operation 查找到目标键值对后要进行的操作类型，只能是FIND或DELETE
+ * @param find_first 是否总是沿最左侧的孩子下降
+ * @return 目标叶子结点，查找时加了读锁，删除时加了写锁并标记为脏页
+ * @note 查找时调用者需要共享持有tree_latch_；删除时调用者需要独占tree_latch_，
+ * 此时只有不持有tree_latch_的IxScan会读取叶子，内部结点不需要加锁。
+ * 插入共享持有tree_latch_，通过descend_shared下降，不经过这里
+ */
+IxNodeGuard IxIndexHandle::find_leaf_page(const char *key, Operation operation, bool find_first) {
     // Todo:
     // 1. 获取根节点
     // 2. 从根节点开始不断向下查找目标key
     // 3. 找到包含该key值的叶子结点停止查找，并返回叶子节点
-    auto root = fetch_node(file_hdr_->root_page_);  // 获得根节点
-    while(!root->is_leaf_page())
+    assert(operation != Operation::INSERT);
+    if(operation == Operation::FIND)
     {
-        page_id_t page_no = root->internal_lookup(key);
-        buffer_pool_manager_->unpin_page(root->get_page_id(), false);
-        root = fetch_node(page_no);
+        return descend_shared(key, false, find_first);
+    }
+    page_id_t page_no = file_hdr_->root_page_;
+    while(true)
+    {
+        IxNodeGuard node = fetch_node(page_no);
+        if(node->is_leaf_page())
+        {
+            node.wlatch();
+            node.mark_dirty();
+            return node;
+        }
+        page_no = find_first ? node->value_at(0) : node->internal_lookup(key);
     }
-    return std::make_pair(root, true);  // 调用了fetch_node，需要在外面unpin叶子节点
 }
 
 /**
@@ -273,115 +672,303 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
     // 2. 在叶子节点中查找目标key值的位置，并读取key对应的rid
     // 3. 把rid存入result参数中
     // 提示：使用完buffer_pool提供的page之后，记得unpin page；记得处理并发的上锁
-    std::scoped_lock{root_latch_};
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key(key, IX_MIN_RID, key_buf);    // 允许重复key时从该key最小的rid开始查找
+    uint64_t version = 0;
+    if(key_cache_ != nullptr)
+    {
+        // 缓存的key是规范化key，不包括rid后缀
+        switch(key_cache_->lookup(key, result, &version))
+        {
+            case IxKeyCache::Lookup::HIT: return true;
+            case IxKeyCache::Lookup::ABSENT: return false;
+            case IxKeyCache::Lookup::MISS: break;
+        }
+    }
+    size_t begin = result->size();
+    bool found;
+    {
+        std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+        IxNodeGuard leaf_node = find_leaf_page(key, Operation::FIND);
+        found = collect_matches(leaf_node, key, result) > 0;   // leaf_node离开作用域时释放读锁并unpin
+    }
+    if(key_cache_ != nullptr)
+    {
+        key_cache_->fill(key, std::vector<Rid>(result->begin() + begin, result->end()), version);
+    }
+    return found;
+}
 
-    auto leaf_node = find_leaf_page(key, Operation::FIND, transaction, false).first;
-    Rid* rid;
-    bool exist = leaf_node->leaf_lookup(key, &rid);
-    if(exist)
+/**
+ * @brief 从leaf开始收集与key匹配的所有项的rid
+ * 唯一索引中最多有一项；允许重复key时只比较不包括rid的前key_len()个字节，匹配的项按rid有序，可能延续到后面的叶子中
+ *
+ * @param leaf 加了读锁、范围包含key的叶子，返回时指向最后访问的叶子，仍然持有读锁
+ * @param key 存储格式的key，允许重复key时追加的是IX_MIN_RID
+ * @param[out] result 依次追加匹配项的rid
+ * @return 匹配的项数
+ */
+int IxIndexHandle::collect_matches(IxNodeGuard &leaf, const char *key, std::vector<Rid> *result) {
+    if(!file_hdr_->rid_suffix())
     {
+        Rid *rid;
+        if(!leaf->leaf_lookup(key, &rid))
+        {
+            return 0;
+        }
         result->push_back(*rid);
+        return 1;
     }
-    // 调用find_leaf_page需要unpin page
-    buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), false);
+    int len = file_hdr_->key_len();
+    int count = 0;
+    char buf[IX_MAX_COL_LEN];
+    int pos = leaf->lower_bound(key);
+    while(true)
+    {
+        for(; pos < leaf->get_size(); ++pos)
+        {
+            leaf->copy_key(pos, buf);
+            if(memcmp(buf, key, len) != 0)
+            {
+                return count;
+            }
+            result->push_back(*leaf->get_rid(pos));
+            count++;
+        }
+        // 右边的叶子从high key开始，high key去掉rid之后已经大于key时不会再有匹配项
+        if(!leaf->has_high_key() || memcmp(leaf->get_high_key(), key, len) > 0)
+        {
+            return count;
+        }
+        page_id_t next_no = leaf->get_next_leaf();
+        leaf.reset();
+        leaf = fetch_node(next_no);
+        leaf.rlatch();
+        pos = 0;
+    }
+}
 
-    return exist;
+/**
+ * @brief 批量点查：按key升序依次查找一批key，只有key落在当前叶子之外时才离开这个叶子
+ * key仍小于当前叶子的high key时直接在该叶子中查找；否则先尝试它的右兄弟，右兄弟也不包含key时再从根结点下降。
+ * 因此相邻的key落在同一个叶子或相邻叶子中时，每个叶子只需要下降一次
+ *
+ * @param keys num_keys个连续存放的原始key，按key升序排列(可以有重复)
+ * @param num_keys key的数量
+ * @param[out] result 依次追加每个存在的key对应的rid，允许重复key时一个key可能对应多个rid
+ * @param transaction 事务指针
+ * @param[out] key_index 不为nullptr时，依次追加result中每个rid对应的key在keys中的下标
+ * @return 存在的key的数量
+ */
+int IxIndexHandle::get_values(const char *keys, int num_keys, std::vector<Rid> *result, Transaction *transaction,
+                              std::vector<int> *key_index) {
+    int len = file_hdr_->key_len();
+    int found = 0;
+    char key_buf[IX_MAX_COL_LEN];
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    IxNodeGuard leaf;   // 上一个key所在的叶子，持有读锁
+    size_t prev_begin = 0;  // 上一个key的匹配项在result中的位置
+    int prev_matches = 0;
+    for(int i = 0; i < num_keys; ++i)
+    {
+        // 允许重复key时leaf可能已经越过了上一个key的项，与上一个key相同时直接复制它的结果
+        if(i > 0 && memcmp(keys + i * len, keys + (i - 1) * len, len) == 0)
+        {
+            for(int j = 0; j < prev_matches; ++j)
+            {
+                result->push_back((*result)[prev_begin + j]);
+            }
+            if(key_index != nullptr)
+            {
+                key_index->insert(key_index->end(), prev_matches, i);
+            }
+            found += prev_matches > 0;
+            prev_begin = result->size() - prev_matches;
+            continue;
+        }
+        const char *key = to_index_key(keys + i * len, IX_MIN_RID, key_buf);
+        if(leaf && leaf->need_move_right(key))
+        {
+            // 有序的key离开当前叶子时通常落在右兄弟中，它的下界就是当前叶子的high key
+            page_id_t right_no = leaf->get_right_link();
+            leaf.reset();
+            leaf = fetch_node(right_no);
+            leaf.rlatch();
+            if(leaf->need_move_right(key))
+            {
+                leaf.reset();
+            }
+        }
+        if(!leaf)
+        {
+            leaf = find_leaf_page(key, Operation::FIND);
+        }
+        prev_begin = result->size();
+        prev_matches = collect_matches(leaf, key, result);
+        if(key_index != nullptr)
+        {
+            key_index->insert(key_index->end(), prev_matches, i);
+        }
+        found += prev_matches > 0;
+    }
+    return found;   // leaf离开作用域时释放读锁并unpin
 }
 
 /**
  * @brief  将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
  * @param node 需要拆分的结点
  * @return 拆分得到的new_node
- * @note need to unpin the new node outside
- * 注意：本函数执行完毕后，原node和new node都需要在函数外面进行unpin
  */
-IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
+IxNodeGuard IxIndexHandle::split(IxNodeHandle *node) {
     // Todo:
     // 1. 将原结点的键值对平均分配，右半部分分裂为新的右兄弟结点
     //    需要初始化新节点的page_hdr内容
     // 2. 如果新的右兄弟结点是叶子结点，更新新旧节点的prev_leaf和next_leaf指针
     //    为新节点分配键值对，更新旧节点的键值对数记录
     // 3. 如果新的右兄弟结点不是叶子结点，更新该结点的所有孩子结点的父节点信息(使用IxIndexHandle::maintain_child())
-    auto new_node = create_node();
+    IxNodeGuard new_node = create_node();
     new_node->init_node();  // 初始化新节点
+    new_node->set_level(node->get_level());
     // 首先平均分配键值对
     int pos = (node->get_size() + 1) / 2; // 将[pos,num_key)的键值对都给new_node
     int new_size = (node->get_size()) / 2;  
-    new_node->insert_pairs(0, node->get_key(pos), node->get_rid(pos), new_size); 
-    // 更新键值对数量，insert_pairs中更新了new_node的num_key
-    node->set_size(pos);
+    if(node->is_compressed())
+    {
+        // 压缩结点中的key需要先解码，new_node按自己的key重新计算公共前缀
+        std::vector<char> moved_keys(new_size * file_hdr_->col_tot_len_);
+        std::vector<Rid> moved_rids(new_size);
+        node->copy_pairs(pos, new_size, moved_keys.data(), moved_rids.data());
+        new_node->insert_pairs(0, moved_keys.data(), moved_rids.data(), new_size);
+        node->set_size(pos);
+        node->recompress();
+    }else
+    {
+        new_node->insert_pairs(0, node->get_key(pos), node->get_rid(pos), new_size); 
+        // 更新键值对数量，insert_pairs中更新了new_node的num_key
+        node->set_size(pos);
+    }
+    // B-link：new_node继承node原来的high key，node的high key就是插入父结点的分隔key
+    if(node->has_high_key())
+    {
+        new_node->set_high_key(node->get_high_key());
+    }
+    char separator[IX_MAX_COL_LEN];
+    new_node->copy_key(0, separator);
+    if(node->is_compressed() && node->is_leaf_page())
+    {
+        // 后缀截断：叶子结点的分隔key只需要区分node的最后一个key和new_node的第一个key
+        char last[IX_MAX_COL_LEN];
+        node->copy_key(pos - 1, last);
+        ix_shortest_separator(last, separator, file_hdr_->col_tot_len_, separator);
+    }
+    node->set_high_key(separator);
     // 如果new_node是叶子结点
     if(node->is_leaf_page())
     {
         new_node->page_hdr->is_leaf = true;
         // 更新new_node、next_node 和 node的左右兄弟
-        auto next_node = fetch_node(node->get_next_leaf());
+        // 向右加锁不会和其他线程形成环
+        IxNodeGuard next_node = fetch_node(node->get_next_leaf());
+        next_node.wlatch();
         new_node->set_next_leaf(next_node->get_page_no());
         new_node->set_prev_leaf(node->get_page_no());
         node->set_next_leaf(new_node->get_page_no());
         next_node->set_prev_leaf(new_node->get_page_no());
-        buffer_pool_manager_->unpin_page(next_node->get_page_id(), true);
     }else // node不是叶子节点，则需要更新该节点的所有孩子节点的父节点信息
     {
+        new_node->set_right_sibling(node->get_right_link());
+        node->set_right_sibling(new_node->get_page_no());
         for(int i = 0; i < new_node->get_size(); ++i)
         {
-            maintain_child(new_node, i);    // 将new_node获得的孩子节点的父节点信息都更新为new_node
+            maintain_child(new_node.get(), i);    // 将new_node获得的孩子节点的父节点信息都更新为new_node
         }
     }
-    return new_node;    // 记得在该函数外unpin node和new_node
+    return new_node;
 }
 
 /**
  * @brief Insert key & value pair into internal page after split
- * 拆分(Split)后，向上找到old_node的父结点
+ * 拆分(Split)后，找到old_node上一层中范围包含key的结点作为父结点
  * 将new_node的第一个key插入到父结点，其位置在 父结点指向old_node的孩子指针 之后
  * 如果插入后>=maxsize，则必须继续拆分父结点，然后在其父结点的父结点再插入，即需要递归
  * 直到找到的old_node为根结点时，结束递归（此时将会新建一个根R，关键字为key，old_node和new_node为其孩子）
  *
  * @param (old_node, new_node) 原结点为old_node，old_node被分裂之后产生了新的右兄弟结点new_node
  * @param key 要插入parent的key
- * @note 一个结点插入了键值对之后需要分裂，分裂后左半部分的键值对保留在原结点，在参数中称为old_node，
- * 右半部分的键值对分裂为新的右兄弟节点，在参数中称为new_node（参考Split函数来理解old_node和new_node）
- * @note 本函数执行完毕后，new node和old node都需要在函数外面进行unpin
+ * @param path 下降时经过的内部结点，末尾是old_node上一层的结点
+ * @note old_node由调用者加写锁，本函数锁住父结点之后释放old_node；
+ * 加锁顺序总是自下而上、自左向右，不会和其他插入形成环
  */
-void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node,
-                                     Transaction *transaction) {
+void IxIndexHandle::insert_into_parent(IxNodeGuard old_node, const char *key, IxNodeHandle *new_node, IxPath *path) {
     // Todo:
     // 1. 分裂前的结点（原结点, old_node）是否为根结点，如果为根结点需要分配新的root
     // 2. 获取原结点（old_node）的父亲结点
     // 3. 获取key对应的rid，并将(key, rid)插入到父亲结点
     // 4. 如果父亲结点仍需要继续分裂，则进行递归插入
-    // 提示：记得unpin page
-    IxNodeHandle* parent;   // 记录原节点的父亲节点
-    if(old_node->is_root_page())
-    {
-        auto new_root_node = create_node();  // 创建一个新的根节点
-        new_root_node->init_node(); // 初始化该节点
-        file_hdr_->root_page_ = new_root_node->get_page_no();
-        // 向new_root_node中插入old_node的第一个键值对，因为new_root要指向old_node
-        new_root_node->insert_pair(0, old_node->get_key(0), Rid{old_node->get_page_no(), -1});
-        old_node->set_parent_page_no(new_root_node->get_page_no()); // 设置old_node的父节点信息
-        parent = new_root_node;
+    IxNodeGuard parent;   // 记录原节点的父亲节点
+    if(path->empty())
+    {
+        root_latch_.lock();
+        if(file_hdr_->root_page_ == old_node->get_page_no())
+        {
+            IxNodeGuard new_root_node = create_node();  // 创建一个新的根节点
+            new_root_node->init_node(); // 初始化该节点
+            new_root_node->set_level(old_node->get_level() + 1);
+            // new_root_node指向old_node和new_node
+            char first_key[IX_MAX_COL_LEN];
+            old_node->copy_key(0, first_key);
+            new_root_node->insert_pair(0, first_key, Rid{old_node->get_page_no(), -1});
+            new_root_node->insert_pair(1, key, Rid{new_node->get_page_no(), -1});
+            old_node->set_parent_page_no(new_root_node->get_page_no()); // 设置old_node的父节点信息
+            new_node->set_parent_page_no(new_root_node->get_page_no());
+            file_hdr_->root_page_ = new_root_node->get_page_no();
+            inner_cache_splits_++;
+            root_latch_.unlock();
+            return;
+        }
+        root_latch_.unlock();
+        // 下降之后其他线程让树长高了，重新从根结点下降到old_node的上一层
+        parent = find_node_by_level(key, old_node->get_level() + 1);
     }else
     {
-        // parent = fetch_node(old_node->get_page_no());    // 注意是get_parent_page_no，而不是get_page_no
-        parent = fetch_node(old_node->get_parent_page_no());
+        parent = fetch_node(path->pop());
+        parent.wlatch();
+    }
+    // 下降之后父结点可能已经被分裂，key所在的范围可能已经移动到了右兄弟中
+    move_right(parent, key, true);
+    old_node.reset();
+
+    // 压缩结点插入key之后可能放不下，此时先分裂父结点，再重新找到范围包含key的结点
+    while(!parent->can_insert(key))
+    {
+        assert(parent->is_compressed());
+        int level = parent->get_level();
+        IxNodeGuard parent_new_node = split(parent.get());
+        char separator[IX_MAX_COL_LEN];
+        memcpy(separator, parent->get_high_key(), file_hdr_->col_tot_len_);
+        insert_into_parent(std::move(parent), separator, parent_new_node.get(), path);
+        parent_new_node.reset();
+        parent = find_node_by_level(key, level);
+        move_right(parent, key, true);
     }
-    // 由于这两种情况都需要插入new_node的第一个键，因此合并写在一起
-    parent->insert(key, Rid{new_node->get_page_no(), -1});
+    // 父结点的第一个key不参与查找，可能大于key（截断的分隔key），因此用upper_bound确定插入位置
+    parent->insert_pair(parent->upper_bound(key), key, Rid{new_node->get_page_no(), -1});
+    inner_cache_splits_++;
     new_node->set_parent_page_no(parent->get_page_no());    // 设置new_node的父节点信息
     // 判断是否需要继续分裂parent节点
     if(parent->get_size() >= parent->get_max_size())
     {
-        auto parent_new_node = split(parent);
-        insert_into_parent(parent, parent_new_node->get_key(0), parent_new_node, transaction);
-        buffer_pool_manager_->unpin_page(parent_new_node->get_page_id(), true);
+        IxNodeGuard parent_new_node = split(parent.get());
+        char separator[IX_MAX_COL_LEN];
+        memcpy(separator, parent->get_high_key(), file_hdr_->col_tot_len_);
+        insert_into_parent(std::move(parent), separator, parent_new_node.get(), path);
     }
-    buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
 }
 
 /**
  * @brief 将指定键值对插入到B+树中
+ * 下降时每次只持有一个结点的锁，只对叶子结点加写锁；叶子结点分裂时自下而上地向父结点插入(B-link)
+ *
  * @param (key, value) 要插入的键值对
  * @param transaction 事务指针
  * @return page_id_t 插入到的叶结点的page_no
@@ -391,74 +978,466 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
     // 1. 查找key值应该插入到哪个叶子节点
     // 2. 在该叶子节点中插入键值对
     // 3. 如果结点已满，分裂结点，并把新结点的相关信息插入父节点
-    // 提示：记得unpin page；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
-    std::scoped_lock{root_latch_};
-    auto leaf_node = find_leaf_page(key, Operation::INSERT, transaction, false).first;
-    // 将key插入到该叶子节点中，比较插入前后的节点个数，判断是否插入成功
-    int before = leaf_node->get_size();
-    int after = leaf_node->insert(key, value);
-    if(before == after)
-    {
-        // 插入失败，返回-1
-        return -1;
-    }
-    // 检查是否需要分裂
-    if(leaf_node->get_size() == leaf_node->get_max_size())
+    // 提示：若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key_with_include(key, value, key_buf);    // 索引中存储的是规范化的key，允许重复key时包括rid
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    while(true)
     {
-        auto new_node = split(leaf_node);
-        insert_into_parent(leaf_node, new_node->get_key(0), new_node, transaction);
-        if(leaf_node->get_page_no() == file_hdr_->last_leaf_)
+        IxPath path;
+        IxNodeGuard leaf_node = descend_shared(key, true, false, &path);
+        Rid *exist_rid;
+        if(leaf_node->is_compressed() && !leaf_node->can_insert(key) && !leaf_node->leaf_lookup(key, &exist_rid))
         {
-            file_hdr_->last_leaf_ = new_node->get_page_no();
+            // 压缩结点插入key之后放不下，先分裂叶子结点，再重新下降插入
+            IxNodeGuard new_node = split(leaf_node.get());
+            if(leaf_node->get_page_no() == file_hdr_->last_leaf_)
+            {
+                file_hdr_->last_leaf_ = new_node->get_page_no();
+            }
+            char separator[IX_MAX_COL_LEN];
+            memcpy(separator, leaf_node->get_high_key(), file_hdr_->col_tot_len_);
+            insert_into_parent(std::move(leaf_node), separator, new_node.get(), &path);
+            continue;
         }
-        buffer_pool_manager_->unpin_page(new_node->get_page_id(), true);
+        page_id_t page_no = leaf_node->get_page_no();
+        // 将key插入到该叶子节点中，key重复(允许重复key时为(key, rid)重复)时插入失败
+        if(leaf_node->insert(key, value) == -1)
+        {
+            return -1;
+        }
+        if(key_cache_ != nullptr)
+        {
+            key_cache_->on_insert(key, value);
+        }
+        // 检查是否需要分裂
+        if(leaf_node->get_size() == leaf_node->get_max_size())
+        {
+            IxNodeGuard new_node = split(leaf_node.get());
+            if(leaf_node->get_page_no() == file_hdr_->last_leaf_)
+            {
+                file_hdr_->last_leaf_ = new_node->get_page_no();
+            }
+            // key可能被分到了new_node中
+            if(leaf_node->need_move_right(key))
+            {
+                page_no = new_node->get_page_no();
+            }
+            char separator[IX_MAX_COL_LEN];
+            memcpy(separator, leaf_node->get_high_key(), file_hdr_->col_tot_len_);
+            insert_into_parent(std::move(leaf_node), separator, new_node.get(), &path);
+        }
+        return page_no;
     }
-    buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), true);
-    // 由于key可能插入到leaf_node或new_node，因此还需要调用find_leaf_page找到含有key的leaf
-    auto insert_node = find_leaf_page(key, Operation::FIND, transaction, false).first;
-    page_id_t page_no = insert_node->get_page_no();
-    buffer_pool_manager_->unpin_page(insert_node->get_page_id(), false);
-    return page_no;
 }
 
 /**
  * @brief 用于删除B+树中含有指定key的键值对
+ * 允许重复key时删除该key的第一项，删除某条记录对应的项应该使用delete_entry(key, rid, transaction)
  * @param key 要删除的key值
  * @param transaction 事务指针
  */
 bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
+    if(file_hdr_->rid_suffix())
+    {
+        std::vector<Rid> rids;
+        if(!get_value(key, &rids, transaction))
+        {
+            return false;
+        }
+        return delete_entry(key, rids[0], transaction);
+    }
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key(key, IX_MIN_RID, key_buf);
+    bool removed = delete_index_key(key, nullptr, transaction);
+    if(removed && key_cache_ != nullptr)
+    {
+        key_cache_->on_delete(key, nullptr);
+    }
+    return removed;
+}
+
+/**
+ * @brief 删除rid这条记录在索引中的项(key, rid)
+ * 唯一索引中key对应的项不是rid时不删除
+ * @param key 要删除的key值
+ * @param rid 记录的位置
+ * @param transaction 事务指针
+ */
+bool IxIndexHandle::delete_entry(const char *key, const Rid &rid, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key_with_include(key, rid, key_buf);
+    bool removed = delete_index_key(key, &rid, transaction);
+    if(removed && key_cache_ != nullptr)
+    {
+        key_cache_->on_delete(key, &rid);
+    }
+    return removed;
+}
+
+/**
+ * @brief 删除存储格式的key
+ * @param key 存储格式的key
+ * @param rid 不为nullptr时，唯一索引只在key对应的项属于rid这条记录时删除
+ */
+bool IxIndexHandle::delete_index_key(const char *key, const Rid *rid, Transaction *transaction) {
     // Todo:
     // 1. 获取该键值对所在的叶子结点
     // 2. 在该叶子结点中删除键值对
     // 3. 如果删除成功需要调用CoalesceOrRedistribute来进行合并或重分配操作，并根据函数返回结果判断是否有结点需要删除
     // 4. 如果需要并发，并且需要删除叶子结点，则需要在事务的delete_page_set中添加删除结点的对应页面；记得处理并发的上锁
-    std::scoped_lock{root_latch_};
-    auto leaf_node = find_leaf_page(key, Operation::DELETE, transaction, false).first;
-    int before = leaf_node->get_size();
-    int after = leaf_node->remove(key);
-    if(before == after)
-    {
-        buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), false);
-        return false;   // 删除失败
-    }
-    maintain_parent(leaf_node); // 更新父亲节点的第一个键值
-    coalesce_or_redistribute(leaf_node, transaction);
-    buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), true);
-    return true;
+    // 唯一索引中key对应的项属于其他记录时不删除
+    auto owned = [&](IxNodeHandle *leaf) {
+        Rid *exist_rid;
+        return rid == nullptr || file_hdr_->rid_suffix() || !leaf->leaf_lookup(key, &exist_rid) || *exist_rid == *rid;
+    };
+    bool lazy_removed = false;
+    bool underfull = false;
+    {
+        // 大多数删除只修改叶子结点，可以和其他查找、插入并发执行
+        std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+        IxNodeGuard leaf_node = descend_shared(key, true, false);
+        if(!owned(leaf_node.get()))
+        {
+            return false;
+        }
+        if(is_safe(leaf_node.get(), key, Operation::DELETE))
+        {
+            return leaf_node->remove(key) != -1;
+        }
+        if(lazy_merge_)
+        {
+            // 延迟合并：只在叶子中删除，不维护父结点中的key，欠满的叶子交给后台线程整理
+            if(leaf_node->remove(key) == -1)
+            {
+                return false;
+            }
+            underfull = !leaf_node->is_root_page() && leaf_node->get_size() < leaf_node->get_min_size();
+            lazy_removed = true;
+        }
+    }
+    if(lazy_removed)
+    {
+        if(underfull)
+        {
+            handle_underflow({std::string(key, file_hdr_->col_tot_len_)});
+        }
+        return true;
+    }
+    // 删除可能引起合并、重分配或修改祖先结点的key，B-link的右移无法处理这些修改，因此独占整棵树
+    IxTreeWriteLock tree_lock(this);
+    IxNodeGuard leaf_node = find_leaf_page(key, Operation::DELETE);
+    // 只有删除叶子结点的第一个key时才需要更新祖先结点
+    // 压缩结点的父结点中保存的是截断之后的分隔key，不需要维护
+    bool remove_first = !leaf_node->is_compressed() && leaf_node->get_size() > 0 &&
+                        leaf_node->compare_key(0, key) == 0;
+    bool removed = owned(leaf_node.get()) && leaf_node->remove(key) != -1;
+    if(removed)
+    {
+        // 延迟合并留下的叶子可能被删空，此时没有第一个key可以维护
+        if(remove_first && leaf_node->get_size() > 0)
+        {
+            maintain_parent(leaf_node.get()); // 更新父亲节点的第一个键值
+        }
+        coalesce_or_redistribute(leaf_node.get());
+    }
+    return removed;
+}
+
+/**
+ * @brief 批量删除n条记录在索引中的项，同一个叶子中的项只下降一次
+ * 按存储格式的key排序之后从左到右处理，只在叶子中删除，不在每一项之后合并或重分配；
+ * 全部删除之后再统一整理欠满的叶子(延迟合并时交给后台线程)
+ *
+ * @param keys n个连续存放的原始key，每个key之后紧跟INCLUDE列的值(与insert_entry相同)
+ * @param rids 与keys一一对应的记录位置
+ * @param n 项数
+ * @param transaction 事务指针
+ * @return 实际删除的项数
+ */
+int IxIndexHandle::delete_entries(const char *keys, const Rid *rids, int n, Transaction *transaction) {
+    int raw_len = file_hdr_->key_len() + file_hdr_->include_len();
+    int len = file_hdr_->col_tot_len_;
+    std::vector<char> stored(static_cast<size_t>(n) * len);
+    char key_buf[IX_MAX_COL_LEN];
+    for(int i = 0; i < n; ++i)
+    {
+        memcpy(stored.data() + i * len, to_index_key_with_include(keys + i * raw_len, rids[i], key_buf), len);
+    }
+    std::vector<int> order(n);
+    for(int i = 0; i < n; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return ix_compare(stored.data() + a * len, stored.data() + b * len, file_hdr_) < 0;
+    });
+    int removed = 0;
+    std::vector<std::string> underflow;
+    {
+        std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+        IxNodeGuard leaf;               // 当前叶子，持有写锁
+        const char *last = nullptr;     // 在当前叶子中删除的最后一个key，用来重新找到这个叶子
+        auto leave = [&]() {
+            if(last != nullptr && !leaf->is_root_page() && leaf->get_size() < leaf->get_min_size())
+            {
+                underflow.emplace_back(last, len);
+            }
+            last = nullptr;
+            leaf.reset();
+        };
+        for(int i : order)
+        {
+            const char *key = stored.data() + i * len;
+            if(leaf && leaf->need_move_right(key))
+            {
+                // 有序的key离开当前叶子时通常落在右兄弟中
+                page_id_t right_no = leaf->get_right_link();
+                leave();
+                leaf = fetch_node(right_no);
+                leaf.wlatch();
+                if(leaf->need_move_right(key))
+                {
+                    leaf.reset();
+                }
+            }
+            if(!leaf)
+            {
+                leaf = descend_shared(key, true, false);
+            }
+            int pos = leaf->lower_bound(key);
+            if(pos >= leaf->get_size() || leaf->compare_key(pos, key) != 0)
+            {
+                continue;
+            }
+            // 唯一索引中key对应的项属于其他记录时不删除
+            if(!file_hdr_->rid_suffix() && *leaf->get_rid(pos) != rids[i])
+            {
+                continue;
+            }
+            leaf->erase_pair(pos);
+            if(key_cache_ != nullptr)
+            {
+                key_cache_->on_delete(key, &rids[i]);
+            }
+            last = key;
+            removed++;
+        }
+        if(leaf)
+        {
+            leave();
+        }
+    }
+    handle_underflow(std::move(underflow));
+    return removed;
+}
+
+/**
+ * @brief 删除key位于[lower, upper)之间的所有项，从lower所在的叶子开始沿叶子链表逐个叶子删除
+ * 每个叶子只加一次写锁，一次移走范围内连续的项；欠满的叶子在全部删除之后统一整理(延迟合并时交给后台线程)
+ *
+ * @param lower 原始格式的下界(包括)，nullptr表示从第一项开始
+ * @param upper 原始格式的上界(不包括)，nullptr表示一直删除到最后一项
+ * @param transaction 事务指针
+ * @return 删除的项数
+ */
+int IxIndexHandle::delete_range(const char *lower, const char *upper, Transaction *transaction) {
+    // 允许重复key时，以IX_MIN_RID为后缀的key小于该key的所有项
+    char lower_buf[IX_MAX_COL_LEN];
+    char upper_buf[IX_MAX_COL_LEN];
+    if(lower != nullptr)
+    {
+        lower = to_index_key(lower, IX_MIN_RID, lower_buf);
+    }
+    if(upper != nullptr)
+    {
+        upper = to_index_key(upper, IX_MIN_RID, upper_buf);
+    }
+    if(lower != nullptr && upper != nullptr && ix_compare(lower, upper, file_hdr_) >= 0)
+    {
+        return 0;
+    }
+    int len = file_hdr_->col_tot_len_;
+    int removed = 0;
+    std::vector<std::string> underflow;
+    {
+        std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+        IxNodeGuard leaf = descend_shared(lower, true, lower == nullptr);
+        char key[IX_MAX_COL_LEN];
+        while(true)
+        {
+            int size = leaf->get_size();
+            int from = lower == nullptr ? 0 : leaf->lower_bound(lower);
+            int to = upper == nullptr ? size : leaf->lower_bound(upper);
+            if(from < to)
+            {
+                if(key_cache_ != nullptr)
+                {
+                    for(int pos = from; pos < to; ++pos)
+                    {
+                        leaf->copy_key(pos, key);
+                        key_cache_->on_delete(key, leaf->get_rid(pos));
+                    }
+                }
+                leaf->copy_key(from, key);    // 被删除的key仍然位于这个叶子的范围内，用来重新找到它
+                leaf->erase_pairs(from, to - from);
+                removed += to - from;
+                if(!leaf->is_root_page() && leaf->get_size() < leaf->get_min_size())
+                {
+                    underflow.emplace_back(key, len);
+                }
+            }
+            // 右兄弟中的key都不小于当前叶子的high key，high key >= upper时后面没有范围内的项
+            if(to < size || !leaf->has_high_key() || (upper != nullptr && !leaf->need_move_right(upper)))
+            {
+                break;
+            }
+            page_id_t right_no = leaf->get_right_link();
+            leaf.reset();
+            leaf = fetch_node(right_no);
+            leaf.wlatch();
+            lower = nullptr;    // 右兄弟中的key都不小于lower
+        }
+    }
+    handle_underflow(std::move(underflow));
+    return removed;
+}
+
+/**
+ * @brief 整理只在叶子中删除之后留下的欠满叶子
+ * 延迟合并时放入等待队列，积累到IX_COMPACT_BATCH个时唤醒后台线程；否则立即独占整棵树逐个整理
+ * @note 调用者不能持有tree_latch_
+ *
+ * @param keys 每个欠满的叶子范围内的一个存储格式的key
+ */
+void IxIndexHandle::handle_underflow(std::vector<std::string> keys) {
+    if(keys.empty())
+    {
+        return;
+    }
+    if(lazy_merge_)
+    {
+        std::lock_guard<std::mutex> lock(compact_latch_);
+        underflow_keys_.insert(underflow_keys_.end(), std::make_move_iterator(keys.begin()),
+                               std::make_move_iterator(keys.end()));
+        if(underflow_keys_.size() >= IX_COMPACT_BATCH)
+        {
+            compact_cv_.notify_one();
+        }
+        return;
+    }
+    IxTreeWriteLock tree_lock(this);
+    for(auto &key : keys)
+    {
+        rebalance_leaf(key.data());
+    }
+}
+
+/**
+ * @brief 整理key所在的叶子：欠满时与兄弟结点重分配或合并，直到不再欠满或者无法继续
+ * 叶子可能在记录之后已经被其他操作整理过，因此按key重新下降并检查
+ * @note 调用者独占tree_latch_
+ *
+ * @param key 存储格式的key
+ * @return 释放的结点数量
+ */
+int IxIndexHandle::rebalance_leaf(const char *key) {
+    int freed = 0;
+    while(true)
+    {
+        int num_pages = file_hdr_->num_pages_;
+        IxNodeGuard leaf_node = find_leaf_page(key, Operation::DELETE);
+        bool progress = false;
+        int size = leaf_node->get_size();
+        if(!leaf_node->is_root_page() && size < leaf_node->get_min_size())
+        {
+            // 合并之后key所在的叶子可能仍然欠满；重分配每次只移动一个键值对，两种情况都需要再检查一次
+            bool merged = coalesce_or_redistribute(leaf_node.get());
+            progress = merged || leaf_node->get_size() != size;
+        }
+        leaf_node.reset();
+        freed += num_pages - file_hdr_->num_pages_;
+        if(!progress)
+        {
+            return freed;
+        }
+    }
+}
+
+/**
+ * @brief 整理等待队列中所有欠满的叶子，每个叶子单独独占整棵树，期间其他操作可以穿插执行
+ * @return 释放的结点数量
+ */
+int IxIndexHandle::compact() {
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(compact_latch_);
+        keys.swap(underflow_keys_);
+    }
+    int freed = 0;
+    for(auto &key : keys)
+    {
+        IxTreeWriteLock tree_lock(this);
+        freed += rebalance_leaf(key.data());
+    }
+    return freed;
+}
+
+/**
+ * @brief 开启或关闭延迟合并
+ * 开启时启动后台整理线程；关闭时停止后台线程，并整理所有还在等待的叶子
+ */
+void IxIndexHandle::set_lazy_merge(bool lazy) {
+    if(lazy == lazy_merge_)
+    {
+        return;
+    }
+    if(lazy)
+    {
+        stop_compactor_ = false;
+        lazy_merge_ = true;
+        compactor_ = std::thread(&IxIndexHandle::run_compactor, this);
+        return;
+    }
+    lazy_merge_ = false;
+    {
+        std::lock_guard<std::mutex> lock(compact_latch_);
+        stop_compactor_ = true;
+    }
+    compact_cv_.notify_all();
+    compactor_.join();
+    compact();
+}
+
+/**
+ * @brief 后台整理线程：等待队列积累到IX_COMPACT_BATCH个叶子时整理一批
+ */
+void IxIndexHandle::run_compactor() {
+    std::unique_lock<std::mutex> lock(compact_latch_);
+    while(true)
+    {
+        compact_cv_.wait(lock, [&] { return stop_compactor_ || underflow_keys_.size() >= IX_COMPACT_BATCH; });
+        if(stop_compactor_)
+        {
+            return;
+        }
+        lock.unlock();
+        compact();
+        lock.lock();
+    }
 }
 
 /**
  * @brief 用于处理合并和重分配的逻辑，用于删除键值对后调用
  *
  * @param node 执行完删除操作的结点
- * @param transaction 事务指针
- * @param root_is_latched 传出参数：根节点是否上锁，用于并发操作
  * @return 是否需要删除结点
+ * @note 调用者独占tree_latch_，只有叶子结点可能被IxScan读取，因此只对叶子加写锁
  * @note User needs to first find the sibling of input page.
  * If sibling's size + input page's size >= 2 * page's minsize, then redistribute.
  * Otherwise, merge(Coalesce).
  */
-bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched) {
+bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node) {
     // Todo:
     // 1. 判断node结点是否为根节点
     //    1.1 如果是根节点，需要调用AdjustRoot() 函数来进行处理，返回根节点是否需要被删除
@@ -480,25 +1459,42 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
         return false;
     }
     // 下面是需要进行合并或重分配操作的情况
-    IxNodeHandle* parent_node = fetch_node(node->get_parent_page_no());
+    IxNodeGuard parent_node = fetch_node(node->get_parent_page_no());
+    parent_node.mark_dirty();
+    // 压缩结点不做重分配，合并不了的父结点可能只剩一个孩子，此时没有可以合并的兄弟结点
+    if(parent_node->get_size() < 2)
+    {
+        return false;
+    }
     int index = parent_node->find_child(node);
     // 获得兄弟节点,如果node是第一个键，则选则它的后驱节点；否则选取它的前驱节点
-    IxNodeHandle* neighbor_node = index ? fetch_node(parent_node->value_at(index - 1)) : fetch_node(parent_node->value_at(index + 1));
-    bool need_delete = false;
-    // 判断进行合并还是重分配操作
-    if(node->get_size() + neighbor_node->get_size() >= 2 * node->get_min_size())
+    IxNodeGuard neighbor_node = fetch_node(parent_node->value_at(index ? index - 1 : index + 1));
+    neighbor_node.mark_dirty();
+    // 兄弟结点是叶子时可能正在被IxScan读取
+    if(neighbor_node->is_leaf_page())
     {
-        redistribute(neighbor_node, node, parent_node, index);  // 需要执行重分配操作
-        maintain_parent(node);  // 由于更改了node/neighbor_node的第一个键，所以要更新其父亲节点的第一个键，使它的值为孩子中的最小键值，并一直更新到root根节点
-        maintain_parent(neighbor_node);
-    }else
+        neighbor_node.wlatch();
+    }
+    // 压缩结点的大小取决于key的编码，只在两个结点合并之后放得下时合并，不做重分配
+    if(node->is_compressed())
     {
-        coalesce(&neighbor_node, &node, &parent_node, index, transaction, root_is_latched); // 需要进行合并，并删除node
-        need_delete = true;
+        IxNodeHandle *left = index ? neighbor_node.get() : node;
+        IxNodeHandle *right = index ? node : neighbor_node.get();
+        if(!left->can_absorb(right))
+        {
+            return false;
+        }
+    }else if(node->get_size() + neighbor_node->get_size() >= 2 * node->get_min_size())
+    {
+        redistribute(neighbor_node.get(), node, parent_node.get(), index);  // 需要执行重分配操作
+        maintain_parent(node);  // 由于更改了node/neighbor_node的第一个键，所以要更新其父亲节点的第一个键，使它的值为孩子中的最小键值，并一直更新到root根节点
+        maintain_parent(neighbor_node.get());
+        return false;
     }
-    buffer_pool_manager_->unpin_page(parent_node->get_page_id(), true);
-    buffer_pool_manager_->unpin_page(neighbor_node->get_page_id(), true);
-    return need_delete;
+    IxNodeHandle *neighbor = neighbor_node.get();
+    IxNodeHandle *parent = parent_node.get();
+    coalesce(&neighbor, &node, &parent, index); // 需要进行合并，并删除node
+    return true;
 }
 
 /**
@@ -519,17 +1515,15 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
     {
         page_id_t new_root_no = old_root_node->remove_and_return_only_child();  // 孩子节点的页号
         update_root_page_no(new_root_no);
-        auto new_root_node = fetch_node(new_root_no);
+        IxNodeGuard new_root_node = fetch_node(new_root_no);
         new_root_node->set_parent_page_no(INVALID_PAGE_ID);  // 更新父亲节点信息
+        new_root_node.mark_dirty();
         release_node_handle(*old_root_node);    // 删除old_root_node，因此要更新file_hdr的num_pages
-        buffer_pool_manager_->unpin_page(new_root_node->get_page_id(), true);
         need_delete = true;
         
-    }else if(old_root_node->is_leaf_page() && old_root_node->get_size() == 0)
-    {
-        // 若old_root_node是叶子节点（实际上当前B+树只有这个节点），且删除后old_root_node没有键值对了，则需要修改root_page_no为INVALID
-        update_root_page_no(INVALID_PAGE_ID);   // 不需要删除old_root_node了
     }
+    // old_root_node是叶子结点且删除后没有键值对时，仍然保留它作为根结点和唯一的叶子，
+    // 之后的插入可以直接下降到它（允许重复key的索引中经常会删空再插入）
 
     return need_delete;
 }
@@ -586,8 +1580,7 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
  * @return true means parent node should be deleted, false means no deletion happend
  * @note Assume that *neighbor_node is the left sibling of *node (neighbor -> node)
  */
-bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                             Transaction *transaction, bool *root_is_latched) {
+bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index) {
     // Todo:
     // 1. 用index判断neighbor_node是否为node的前驱结点，若不是则交换两个结点，让neighbor_node作为左结点，node作为右结点
     // 2. 把node结点的键值对移动到neighbor_node中，并更新node结点孩子结点的父节点信息（调用maintain_child函数）
@@ -602,12 +1595,33 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
     int neighbor_size = (*neighbor_node)->get_size();
     int node_size = (*node)->get_size();
     // 将node的所有键值对移动到neighbor_node中
-    (*neighbor_node)->insert_pairs(neighbor_size, (*node)->keys, (*node)->rids, node_size);
+    if((*node)->is_compressed())
+    {
+        std::vector<char> moved_keys(node_size * file_hdr_->col_tot_len_);
+        std::vector<Rid> moved_rids(node_size);
+        (*node)->copy_pairs(0, node_size, moved_keys.data(), moved_rids.data());
+        (*neighbor_node)->insert_pairs(neighbor_size, moved_keys.data(), moved_rids.data(), node_size);
+    }else
+    {
+        (*neighbor_node)->insert_pairs(neighbor_size, (*node)->keys, (*node)->rids, node_size);
+    }
     // 更新孩子节点的父节点信息
     for(int i = 0; i < node_size; ++i)
     {
         maintain_child(*neighbor_node, neighbor_size + i);
     }
+    // neighbor_node接管了node的范围，继承它的high key和右兄弟
+    if((*node)->has_high_key())
+    {
+        (*neighbor_node)->set_high_key((*node)->get_high_key());
+    }else
+    {
+        (*neighbor_node)->clear_high_key();
+    }
+    if(!(*node)->is_leaf_page())
+    {
+        (*neighbor_node)->set_right_sibling((*node)->get_right_link());
+    }
     // 如果node是叶子节点，则调用erase_leaf函数，更新neighbor_node的兄弟节点
     if((*node)->is_leaf_page())
     {
@@ -615,13 +1629,13 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
         {
             file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
         }
-        erase_leaf(*node);
+        erase_leaf(*node, *neighbor_node);    // neighbor_node就是node的前驱叶子，已经加了写锁
     }
     // 删除node，并更新parent的孩子节点信息
     release_node_handle(**node);
     (*parent)->erase_pair(index);
     // 返回是否需要删除parent节点
-    return coalesce_or_redistribute(*parent, transaction, root_is_latched);
+    return coalesce_or_redistribute(*parent);
 }
 
 /**
@@ -634,14 +1648,43 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
  * @note iid和rid存的不是一个东西，rid是上层传过来的记录位置，iid是索引内部生成的索引槽位置
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const {
-    IxNodeHandle *node = fetch_node(iid.page_no);
+    IxNodeGuard node = fetch_node(iid.page_no);
+    node.rlatch();
     if (iid.slot_no >= node->get_size()) {
         throw IndexEntryNotFoundError();
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
     return *node->get_rid(iid.slot_no);
 }
 
+/**
+ * @brief 读取iid处的索引项，用于只访问索引的扫描
+ *
+ * @param key 输出解码之后的key，布局为 key | [rid] | INCLUDE列，长度为col_tot_len_
+ * @return Rid 该项指向的记录
+ */
+Rid IxIndexHandle::get_entry(const Iid &iid, char *key) const {
+    IxNodeGuard node = fetch_node(iid.page_no);
+    node.rlatch();
+    if (iid.slot_no >= node->get_size()) {
+        throw IndexEntryNotFoundError();
+    }
+    decode_key(node.get(), iid.slot_no, key);
+    return *node->get_rid(iid.slot_no);
+}
+
+/**
+ * @brief 把叶子第pos项的key解码为上层的格式，调用者持有该叶子的读锁
+ */
+void IxIndexHandle::decode_key(IxNodeHandle *node, int pos, char *key) const {
+    if (file_hdr_->normalized_keys()) {
+        char norm[IX_MAX_COL_LEN];
+        node->copy_key(pos, norm);
+        ix_denormalize_key(file_hdr_, norm, key);
+    } else {
+        node->copy_key(pos, key);
+    }
+}
+
 /**
  * @brief FindLeafPage + lower_bound
  *
@@ -651,10 +1694,11 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const {
  * 可用*(int *)key转换回去
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
-    auto leaf_node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
-    int slot_no = leaf_node->lower_bound(key);
-    buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), false);
-    return Iid{leaf_node->get_page_no(), slot_no};
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key(key, IX_MIN_RID, key_buf);  // 允许重复key时定位到该key的第一项
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    IxNodeGuard leaf_node = find_leaf_page(key, Operation::FIND);
+    return Iid{leaf_node->get_page_no(), leaf_node->lower_bound(key)};
 }
 
 /**
@@ -664,17 +1708,199 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
-    auto leaf_node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
-    int slot_no = leaf_node->upper_bound(key);
-    if(slot_no == leaf_node->get_size())
+    char key_buf[IX_MAX_COL_LEN];
+    key = to_index_key(key, IX_MAX_RID, key_buf);  // 允许重复key时定位到该key最后一项之后
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    IxNodeGuard leaf_node = find_leaf_page(key, Operation::FIND);
+    // IxNodeHandle::upper_bound按内部结点的语义从第1个key开始查找，会跳过叶子的第0个key，
+    // 因此用lower_bound定位，key存在时再后移一位
+    Iid iid = {.page_no = leaf_node->get_page_no(), .slot_no = leaf_node->lower_bound(key)};
+    Rid *rid;
+    if(leaf_node->leaf_lookup(key, &rid))
+    {
+        iid.slot_no++;
+    }
+    if(iid.slot_no == leaf_node->get_size() && leaf_node->get_next_leaf() != IX_LEAF_HEADER_PAGE)
+    {
+        iid = {.page_no = leaf_node->get_next_leaf(), .slot_no = 0};
+    }
+    return iid;
+}
+
+/**
+ * @brief 收集[lower, upper)范围内所有项的rid，用于先从索引取出rid、再按页面顺序访问堆表
+ * 允许重复key时同一个key的项已经按rid有序，sort_by_rid把整个范围的rid排序，使堆表页面只需顺序访问一遍
+ *
+ * @param lower 起始位置，通常来自lower_bound或leaf_begin
+ * @param upper 结束位置(不包括)，通常来自upper_bound或leaf_end
+ * @param[out] result 追加范围内的rid
+ * @param sort_by_rid 是否把追加的rid按(page_no, slot_no)排序，否则按key的顺序
+ * @return 追加的rid数量
+ */
+int IxIndexHandle::get_rids(const Iid &lower, const Iid &upper, std::vector<Rid> *result, bool sort_by_rid) {
+    size_t begin = result->size();
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    page_id_t page_no = lower.page_no;
+    int slot_no = lower.slot_no;
+    while(page_no != IX_LEAF_HEADER_PAGE)
     {
-        if(leaf_node->get_page_no() != file_hdr_->last_leaf_)
+        IxNodeGuard leaf = fetch_node(page_no);
+        leaf.rlatch();
+        int end = page_no == upper.page_no ? std::min(upper.slot_no, leaf->get_size()) : leaf->get_size();
+        for(; slot_no < end; ++slot_no)
         {
-            buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), false);
-            return Iid{leaf_node->get_next_leaf(), 0};
+            result->push_back(*leaf->get_rid(slot_no));
+        }
+        if(page_no == upper.page_no)
+        {
+            break;
         }
+        page_no = leaf->get_next_leaf();
+        slot_no = 0;
     }
-    return Iid{leaf_node->get_page_no(), slot_no};
+    if(sort_by_rid)
+    {
+        std::sort(result->begin() + begin, result->end());
+    }
+    return static_cast<int>(result->size() - begin);
+}
+
+/**
+ * @brief 开启点查使用的内存key缓存，已经开启时按新的配置重建
+ * FULL模式顺序读取所有叶子建立完整的缓存，超过内存预算时缓存不可用；LAZY模式从空缓存开始
+ * @note 调用期间不能有并发的插入和删除，通常在打开索引之后立即调用
+ *
+ * @param options 缓存模式和内存预算，模式为IX_KEY_CACHE_OFF时关闭缓存
+ */
+void IxIndexHandle::enable_key_cache(const IxKeyCacheOptions &options) {
+    key_cache_.reset();
+    if(options.mode == IX_KEY_CACHE_OFF)
+    {
+        return;
+    }
+    auto cache = std::make_unique<IxKeyCache>(options, file_hdr_->key_len());
+    if(options.mode == IX_KEY_CACHE_FULL)
+    {
+        std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+        char key[IX_MAX_COL_LEN];
+        page_id_t page_no = file_hdr_->first_leaf_;
+        while(page_no != IX_LEAF_HEADER_PAGE)
+        {
+            IxNodeGuard leaf = fetch_node(page_no);
+            leaf.rlatch();
+            for(int pos = 0; pos < leaf->get_size(); ++pos)
+            {
+                leaf->copy_key(pos, key);
+                if(!cache->load(key, *leaf->get_rid(pos)))
+                {
+                    break;
+                }
+            }
+            if(!cache->usable())
+            {
+                break;
+            }
+            page_no = leaf->get_next_leaf();
+        }
+    }
+    key_cache_ = std::move(cache);
+}
+
+void IxIndexHandle::set_inner_cache_budget(size_t budget) {
+    inner_cache_budget_ = budget;
+    std::atomic_store(&inner_cache_, std::shared_ptr<const IxInnerCache>());
+}
+
+/**
+ * @brief 下降时使用的内部结点快照，还没有建立或已经过期时先重建
+ * 其他线程正在重建时不等待，使用旧的快照或者从根结点下降
+ * @note 调用者共享持有tree_latch_并且没有持有任何结点的锁
+ *
+ * @return 快照，不使用快照时为nullptr
+ */
+std::shared_ptr<const IxInnerCache> IxIndexHandle::inner_cache_for_descent() {
+    if(inner_cache_budget_ == 0 || tree_exclusive_)
+    {
+        return nullptr;
+    }
+    // 根结点是叶子时建立的快照没有任何层，树长高之后重建
+    auto need_build = [&](const std::shared_ptr<const IxInnerCache> &cache) {
+        return cache == nullptr || inner_cache_stale_ || (cache->num_levels() == 0 && inner_cache_splits_ > 0);
+    };
+    std::shared_ptr<const IxInnerCache> cache = std::atomic_load(&inner_cache_);
+    if(need_build(cache) && inner_cache_build_latch_.try_lock())
+    {
+        std::lock_guard<std::mutex> build_lock(inner_cache_build_latch_, std::adopt_lock);
+        cache = std::atomic_load(&inner_cache_);
+        if(need_build(cache))
+        {
+            cache = build_inner_cache();
+            std::atomic_store(&inner_cache_, cache);
+        }
+    }
+    return cache;
+}
+
+/**
+ * @brief 自顶向下逐层拷贝内部结点建立快照，每层从最左的结点开始沿右兄弟遍历，超过预算的层和之下的层不缓存
+ * 共享持有tree_latch_，结点只会分裂不会被释放，每层最左的结点不变；每次只持有一个结点的读锁，
+ * 拷贝期间其他线程的分裂使快照中上下层的结点不完全一致，下降时由右移纠正
+ */
+std::shared_ptr<const IxInnerCache> IxIndexHandle::build_inner_cache() {
+    // 之后的分裂可能没有反映在快照中
+    inner_cache_stale_ = false;
+    inner_cache_splits_ = 0;
+    auto cache = std::make_shared<IxInnerCache>(file_hdr_);
+    int len = file_hdr_->col_tot_len_;
+    std::vector<char> keys;
+    std::vector<page_id_t> children;
+    root_latch_.lock_shared();
+    page_id_t leftmost = file_hdr_->root_page_;
+    root_latch_.unlock_shared();
+    bool full = false;
+    while(!full)
+    {
+        IxNodeGuard node = fetch_node(leftmost);
+        node.rlatch();
+        if(node->is_leaf_page())
+        {
+            break;
+        }
+        leftmost = node->value_at(0);
+        cache->begin_level();
+        while(true)
+        {
+            int num_key = node->get_size();
+            if(num_key == 0)
+            {
+                full = true;    // 内部结点不会为空，遇到时不缓存这一层
+                break;
+            }
+            keys.resize(static_cast<size_t>(num_key) * len);
+            children.resize(num_key);
+            for(int i = 0; i < num_key; ++i)
+            {
+                node->copy_key(i, keys.data() + i * len);
+                children[i] = node->value_at(i);
+            }
+            page_id_t right = node->get_right_link();
+            cache->add_node(node->get_page_no(), num_key, keys.data(), children.data(),
+                            node->has_high_key() ? node->get_high_key() : nullptr, right);
+            node.reset();
+            if(right == IX_NO_PAGE)
+            {
+                break;
+            }
+            node = fetch_node(right);
+            node.rlatch();
+        }
+        if(!cache->end_level(full ? 0 : inner_cache_budget_))
+        {
+            full = true;
+        }
+    }
+    cache->finish();
+    return cache;
 }
 
 /**
@@ -684,10 +1910,9 @@ Iid IxIndexHandle::upper_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::leaf_end() const {
-    IxNodeHandle *node = fetch_node(file_hdr_->last_leaf_);
-    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node->get_size()};
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
-    return iid;
+    IxNodeGuard node = fetch_node(file_hdr_->last_leaf_);
+    node.rlatch();
+    return Iid{node->get_page_no(), node->get_size()};
 }
 
 /**
@@ -701,38 +1926,52 @@ Iid IxIndexHandle::leaf_begin() const {
     return iid;
 }
 
+/**
+ * @brief 树的层数：根结点的层数加一，只有一个根叶子时为1，空树为0
+ */
+int IxIndexHandle::get_height() {
+    std::shared_lock<std::shared_mutex> tree_lock(tree_latch_);
+    std::shared_lock<std::shared_mutex> root_lock(root_latch_);
+    if (is_empty()) {
+        return 0;
+    }
+    // 结点的层数在创建后不会改变，不需要加锁读取
+    return fetch_node(file_hdr_->root_page_)->get_level() + 1;
+}
+
 /**
  * @brief 获取一个指定结点
  *
  * @param page_no
- * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
+ * @return IxNodeGuard
+ * @note pin the page, guard离开作用域时自动unpin
  */
-IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
+IxNodeGuard IxIndexHandle::fetch_node(int page_no) const {
     Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
-    IxNodeHandle *node = new IxNodeHandle(file_hdr_, page);
-    
-    return node;
+    return IxNodeGuard(buffer_pool_manager_, file_hdr_, page);
 }
 
 /**
  * @brief 创建一个新结点
  *
- * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
+ * @return IxNodeGuard
+ * @note pin the page, guard离开作用域时按脏页unpin
  * 注意：对于Index的处理是，删除某个页面后，认为该被删除的页面是free_page
  * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
  * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
  * 与Record的处理不同，Record将未插入满的记录页认为是free_page
  */
-IxNodeHandle *IxIndexHandle::create_node() {
-    IxNodeHandle *node;
-    file_hdr_->num_pages_++;
+IxNodeGuard IxIndexHandle::create_node() {
+    {
+        std::lock_guard<std::mutex> lock(hdr_latch_);
+        file_hdr_->num_pages_++;
+    }
 
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
     // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
     Page *page = buffer_pool_manager_->new_page(&new_page_id);
-    node = new IxNodeHandle(file_hdr_, page);
+    IxNodeGuard node(buffer_pool_manager_, file_hdr_, page);
+    node.mark_dirty();
     return node;
 }
 
@@ -743,20 +1982,42 @@ IxNodeHandle *IxIndexHandle::create_node() {
  */
 void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
     IxNodeHandle *curr = node;
+    IxNodeGuard parent;     // pin住curr的父结点
     while (curr->get_parent_page_no() != IX_NO_PAGE) {
         // Load its parent
-        IxNodeHandle *parent = fetch_node(curr->get_parent_page_no());
-        int rank = parent->find_child(curr);
-        char *parent_key = parent->get_key(rank);
+        IxNodeGuard next = fetch_node(curr->get_parent_page_no());
+        int rank = next->find_child(curr);
+        char *parent_key = next->get_key(rank);
         char *child_first_key = curr->get_key(0);
         if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) {
-            assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
             break;
         }
         memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
-        curr = parent;
+        next.mark_dirty();
+        // curr不是parent的第一个孩子时，parent的第一个key没有变化，不需要继续向上更新
+        if (rank != 0) {
+            // 左侧相邻子树最右侧路径上结点的high key就是这个分隔key
+            update_high_keys(next->value_at(rank - 1), child_first_key);
+            break;
+        }
+        parent = std::move(next);
+        curr = parent.get();
+    }
+}
 
-        assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
+/**
+ * @brief 从page_no开始沿最右侧的孩子向下，将路径上所有结点的high key更新为key
+ * @note 只在独占tree_latch_时调用，high key只会被下降的线程读取，因此不需要加锁
+ */
+void IxIndexHandle::update_high_keys(page_id_t page_no, const char *key) {
+    while (true) {
+        IxNodeGuard node = fetch_node(page_no);
+        node->set_high_key(key);
+        node.mark_dirty();
+        if (node->is_leaf_page()) {
+            break;
+        }
+        page_no = node->value_at(node->get_size() - 1);
     }
 }
 
@@ -764,17 +2025,17 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
  * @brief 要删除leaf之前调用此函数，更新leaf前驱结点的next指针和后继结点的prev指针
  *
  * @param leaf 要删除的leaf
+ * @param prev leaf的前驱结点，由调用者加锁并pin住
  */
-void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
+void IxIndexHandle::erase_leaf(IxNodeHandle *leaf, IxNodeHandle *prev) {
     assert(leaf->is_leaf_page());
+    assert(prev->get_page_no() == leaf->get_prev_leaf());
 
-    IxNodeHandle *prev = fetch_node(leaf->get_prev_leaf());
     prev->set_next_leaf(leaf->get_next_leaf());
-    buffer_pool_manager_->unpin_page(prev->get_page_id(), true);
 
-    IxNodeHandle *next = fetch_node(leaf->get_next_leaf());
+    IxNodeGuard next = fetch_node(leaf->get_next_leaf());
+    next.wlatch();
     next->set_prev_leaf(leaf->get_prev_leaf());  // 注意此处是SetPrevLeaf()
-    buffer_pool_manager_->unpin_page(next->get_page_id(), true);
 }
 
 /**
@@ -783,6 +2044,7 @@ void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
  * @param node
  */
 void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
+    std::lock_guard<std::mutex> lock(hdr_latch_);
     file_hdr_->num_pages_--;
 }
 
@@ -793,8 +2055,8 @@ void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
     if (!node->is_leaf_page()) {
         //  Current node is inner node, load its child and set its parent to current node
         int child_page_no = node->value_at(child_idx);
-        IxNodeHandle *child = fetch_node(child_page_no);
+        IxNodeGuard child = fetch_node(child_page_no);
         child->set_parent_page_no(node->get_page_no());
-        buffer_pool_manager_->unpin_page(child->get_page_id(), true);
+        child.mark_dirty();
     }
 }
\ No newline at end of file
@@ -10,7 +10,22 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "ix_defs.h"
+#include "ix_inner_cache.h"
+#include "ix_key.h"
+#include "ix_key_cache.h"
 #include "transaction/transaction.h"
 
 enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
@@ -30,6 +45,7 @@ inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
             return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
         }
         case TYPE_STRING:
+        case TYPE_VARCHAR:
             return memcmp(a, b, col_len);
         default:
             throw InternalError("Unexpected data type");
@@ -46,36 +62,79 @@ inline int ix_compare(const char* a, const char* b, const std::vector<ColType>&
     return 0;
 }
 
+// 比较索引中存储的两个key：规范化的key直接memcmp，否则逐列比较
+inline int ix_compare(const char *a, const char *b, const IxFileHdr *hdr) {
+    if (hdr->normalized_keys()) {
+        int res = memcmp(a, b, hdr->col_tot_len_);
+        return (res > 0) - (res < 0);
+    }
+    return ix_compare(a, b, hdr->col_types_, hdr->col_lens_);
+}
+
 /* 管理B+树中的每个节点 */
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
+    friend class IxNodeGuard;
+    friend class IxBulkBuilder;
 
    private:
     const IxFileHdr *file_hdr;      // 节点所在文件的头部信息
-    Page *page;                     // 存储节点的页面
+    Page *page = nullptr;           // 存储节点的页面
     IxPageHdr *page_hdr;            // page->data的第一部分，指针指向首地址，长度为sizeof(IxPageHdr)
-    char *keys;                     // page->data的第二部分，指针指向首地址，长度为file_hdr->keys_size，每个key的长度为file_hdr->col_len
-    Rid *rids;                      // page->data的第三部分，指针指向首地址
+    char *high_key;                 // page->data的第二部分，结点中所有key的上界(B-link)，长度为file_hdr->col_tot_len
+    char *keys;                     // page->data的第三部分，指针指向首地址，长度为file_hdr->keys_size，每个key的长度为file_hdr->col_len
+    Rid *rids;                      // page->data的第四部分，指针指向首地址
+    /* 压缩结点(file_hdr->compressed_nodes())不使用keys和rids，high key之后的布局为：
+     * |prefix: 公共前缀，预留col_tot_len| entries: 每项为(rid, key去掉前缀之后的key_len个字节，按4字节对齐) |
+     * key = prefix[0,prefix_len) + suffix[0,key_len) + 补齐的'\0' */
+    bool compressed = false;
+    char *prefix;
+    char *entries;
 
    public:
     IxNodeHandle() = default;
 
     IxNodeHandle(const IxFileHdr *file_hdr_, Page *page_) : file_hdr(file_hdr_), page(page_) {
         page_hdr = reinterpret_cast<IxPageHdr *>(page->get_data());
-        keys = page->get_data() + sizeof(IxPageHdr);
+        high_key = page->get_data() + sizeof(IxPageHdr);
+        keys = high_key + file_hdr->col_tot_len_;
         rids = reinterpret_cast<Rid *>(keys + file_hdr->keys_size_);
+        compressed = file_hdr->compressed_nodes();
+        prefix = keys;
+        entries = page->get_data() + entries_offset(file_hdr);
     }
 
     int get_size() { return page_hdr->num_key; }
 
     void set_size(int size) { page_hdr->num_key = size; }
 
-    int get_max_size() { return file_hdr->btree_order_ + 1; }
+    // 压缩结点能容纳的键值对数量取决于结点当前的key_len
+    int get_max_size() { return compressed ? capacity(page_hdr->key_len) : file_hdr->btree_order_ + 1; }
+
+    // 压缩结点按key不做任何压缩时的容量计算下限，保证合并后的结点一定放得下
+    int get_min_size() { return compressed ? capacity(file_hdr->col_tot_len_) / 2 : get_max_size() / 2; }
+
+    bool is_compressed() const { return compressed; }
+
+    // 第i个key的第一列按INT解析，用于调试和测试
+    int key_at(int i) {
+        char key[IX_MAX_COL_LEN];
+        copy_key(i, key);
+        return file_hdr->normalized_keys() ? ix_decode_int(ix_load_be32(key)) : *(int *)key;
+    }
+
+    /* 压缩结点中第一个键值对在page->data中的偏移 */
+    static int entries_offset(const IxFileHdr *hdr) {
+        return static_cast<int>((sizeof(IxPageHdr) + 2 * hdr->col_tot_len_ + 3) / 4 * 4);
+    }
 
-    int get_min_size() { return get_max_size() / 2; }
+    static int entry_size(int key_len) { return static_cast<int>(sizeof(Rid)) + (key_len + 3) / 4 * 4; }
 
-    int key_at(int i) { return *(int *)get_key(i); }
+    /* key_len下压缩结点能容纳的键值对数量，与btree_order_取较小值（测试中会调小btree_order_） */
+    int capacity(int key_len) const {
+        return std::min((PAGE_SIZE - entries_offset(file_hdr)) / entry_size(key_len), file_hdr->btree_order_ + 1);
+    }
 
     /* 得到第i个孩子结点的page_no */
     page_id_t value_at(int i) { return get_rid(i)->page_no; }
@@ -94,15 +153,80 @@ class IxNodeHandle {
 
     bool is_root_page() { return get_parent_page_no() == INVALID_PAGE_ID; }
 
+    int get_level() { return page_hdr->level; }
+
+    void set_level(int level) { page_hdr->level = level; }
+
     void set_next_leaf(page_id_t page_no) { page_hdr->next_leaf = page_no; }
 
     void set_prev_leaf(page_id_t page_no) { page_hdr->prev_leaf = page_no; }
 
     void set_parent_page_no(page_id_t parent) { page_hdr->parent = parent; }
 
-    char *get_key(int key_idx) const { return keys + key_idx * file_hdr->col_tot_len_; }
+    bool has_high_key() { return page_hdr->has_high_key; }
+
+    char *get_high_key() const { return high_key; }
+
+    void set_high_key(const char *key) {
+        memcpy(high_key, key, file_hdr->col_tot_len_);
+        page_hdr->has_high_key = true;
+    }
+
+    void clear_high_key() { page_hdr->has_high_key = false; }
+
+    /* 同一层右兄弟结点的page_no，叶子结点的右兄弟就是next_leaf */
+    page_id_t get_right_link() { return is_leaf_page() ? get_next_leaf() : page_hdr->right_sibling; }
+
+    void set_right_sibling(page_id_t page_no) { page_hdr->right_sibling = page_no; }
+
+    /* key >= high key说明目标key已经被分裂到了右兄弟结点中，需要向右移动 */
+    bool need_move_right(const char *key) const {
+        return page_hdr->has_high_key && ix_compare(key, high_key, file_hdr) >= 0;
+    }
+
+   private:
+    /* 容纳现有的key和keys中新的n个key所需的公共前缀长度和key_len */
+    void encoding_for(const char *new_keys, int n, int *prefix_len, int *key_len) const;
+
+    /* 以新的公共前缀长度和key_len重新编码结点中的所有键值对 */
+    void reencode(int prefix_len, int key_len);
+
+    char *entry_key(int idx) const { return entries + idx * entry_size(page_hdr->key_len) + sizeof(Rid); }
+
+    int compressed_search(const char *target, int from, bool upper) const;
+
+   public:
+
+    /* 未压缩结点中第key_idx个key的地址，压缩结点使用copy_key/compare_key */
+    char *get_key(int key_idx) const {
+        assert(!compressed);
+        return keys + key_idx * file_hdr->col_tot_len_;
+    }
+
+    Rid *get_rid(int rid_idx) const {
+        return compressed ? reinterpret_cast<Rid *>(entries + rid_idx * entry_size(page_hdr->key_len)) : &rids[rid_idx];
+    }
+
+    /* 将第key_idx个完整的key拷贝到dest中，dest的长度为col_tot_len */
+    void copy_key(int key_idx, char *dest) const;
+
+    /* 第key_idx个key与key比较，返回值的含义与ix_compare相同 */
+    int compare_key(int key_idx, const char *key) const;
+
+    /* 插入key之后结点是否仍然放得下；压缩结点插入key可能缩短公共前缀或加长key_len */
+    bool can_insert(const char *key) const;
+
+    /* 批量构建时，在结点末尾追加key之后是否仍不超过fill_factor比例的容量 */
+    bool can_append(const char *key, double fill_factor) const;
 
-    Rid *get_rid(int rid_idx) const { return &rids[rid_idx]; }
+    /* node的所有键值对追加到当前结点之后是否放得下 */
+    bool can_absorb(const IxNodeHandle *node) const;
+
+    /* 拷贝[pos,pos+n)的键值对，key连续存放在keys中 */
+    void copy_pairs(int pos, int n, char *keys_out, Rid *rids_out) const;
+
+    /* 删除键值对之后按剩余的key重新计算公共前缀和key_len */
+    void recompress();
 
     void set_key(int key_idx, const char *key) { memcpy(keys + key_idx * file_hdr->col_tot_len_, key, file_hdr->col_tot_len_); }
 
@@ -125,6 +249,8 @@ class IxNodeHandle {
 
     void erase_pair(int pos);
 
+    void erase_pairs(int pos, int n);
+
     int remove(const char *key);
     // 创建一个节点后，初始化该节点
     void init_node()
@@ -133,6 +259,11 @@ class IxNodeHandle {
         this->page_hdr->is_leaf = false;
         this->page_hdr->num_key = 0;
         this->page_hdr->parent = IX_NO_PAGE;
+        this->page_hdr->has_high_key = false;
+        this->page_hdr->right_sibling = IX_NO_PAGE;
+        this->page_hdr->level = 0;
+        this->page_hdr->prefix_len = 0;
+        this->page_hdr->key_len = 0;
     }
 
     /**
@@ -165,45 +296,215 @@ class IxNodeHandle {
     }
 };
 
+/**
+ * RAII：持有一个pin住的结点，离开作用域时释放结点上的锁并unpin
+ * 结点按值存放在guard中，访问结点不需要堆分配；guard只能移动，不能拷贝
+ */
+class IxNodeGuard {
+   public:
+    IxNodeGuard() = default;
+
+    IxNodeGuard(BufferPoolManager *bpm, const IxFileHdr *file_hdr, Page *page) : bpm_(bpm), node_(file_hdr, page) {}
+
+    IxNodeGuard(const IxNodeGuard &) = delete;
+
+    IxNodeGuard &operator=(const IxNodeGuard &) = delete;
+
+    IxNodeGuard(IxNodeGuard &&other) noexcept { *this = std::move(other); }
+
+    IxNodeGuard &operator=(IxNodeGuard &&other) noexcept {
+        if (this != &other) {
+            reset();
+            bpm_ = other.bpm_;
+            node_ = other.node_;
+            latch_ = other.latch_;
+            dirty_ = other.dirty_;
+            other.node_.page = nullptr;
+            other.latch_ = LatchMode::NONE;
+            other.dirty_ = false;
+        }
+        return *this;
+    }
+
+    ~IxNodeGuard() { reset(); }
+
+    IxNodeHandle *operator->() { return &node_; }
+
+    IxNodeHandle &operator*() { return node_; }
+
+    IxNodeHandle *get() { return &node_; }
+
+    explicit operator bool() const { return node_.page != nullptr; }
+
+    void rlatch() {
+        node_.page->rlatch();
+        latch_ = LatchMode::READ;
+    }
+
+    /* 加写锁意味着要修改结点，释放时按脏页unpin */
+    void wlatch() {
+        node_.page->wlatch();
+        latch_ = LatchMode::WRITE;
+        dirty_ = true;
+    }
+
+    void unlatch() {
+        if (latch_ == LatchMode::READ) {
+            node_.page->runlatch();
+        } else if (latch_ == LatchMode::WRITE) {
+            node_.page->wunlatch();
+        }
+        latch_ = LatchMode::NONE;
+    }
+
+    /* 没有加写锁就修改了结点时(如调用者已经通过其他方式锁住了结点)，需要手动标记为脏页 */
+    void mark_dirty() { dirty_ = true; }
+
+    /* 释放结点上的锁并unpin */
+    void reset() {
+        if (node_.page == nullptr) {
+            return;
+        }
+        unlatch();
+        bpm_->unpin_page(node_.get_page_id(), dirty_);
+        node_.page = nullptr;
+        dirty_ = false;
+    }
+
+   private:
+    enum class LatchMode { NONE, READ, WRITE };
+
+    BufferPoolManager *bpm_ = nullptr;
+    IxNodeHandle node_;
+    LatchMode latch_ = LatchMode::NONE;
+    bool dirty_ = false;
+};
+
+/* 下降时经过的内部结点，分裂时自下而上地查找父结点；树高有限，用定长数组避免堆分配 */
+class IxPath {
+   public:
+    static constexpr int MAX_HEIGHT = 64;
+
+    void push(page_id_t page_no) {
+        assert(size_ < MAX_HEIGHT);
+        pages_[size_++] = page_no;
+    }
+
+    page_id_t pop() { return pages_[--size_]; }
+
+    bool empty() const { return size_ == 0; }
+
+   private:
+    page_id_t pages_[MAX_HEIGHT];
+    int size_ = 0;
+};
+
+class IxSorter;
+
+constexpr size_t IX_COMPACT_BATCH = 64;     // 延迟合并时积累这么多个欠满的叶子之后唤醒后台整理线程
+
 /* B+树 */
-class IxIndexHandle {
+class IxIndexHandle : public IxIndex {
     friend class IxScan;
     friend class IxManager;
+    friend class IxBulkBuilder;
+    friend class IxTreeWriteLock;
 
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     int fd_;                                    // 存储B+树的文件
     IxFileHdr* file_hdr_;                       // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;
+    std::shared_mutex root_latch_;              // 保护file_hdr_->root_page_，插入分裂根结点时与共享持有tree_latch_的读者互斥
+    std::shared_mutex tree_latch_;              // 会修改树结构的删除操作独占整棵树，其余操作共享
+    std::mutex hdr_latch_;                      // 保护file_hdr_->num_pages_
+    std::unique_ptr<IxKeyCache> key_cache_;     // 点查使用的内存key缓存，nullptr表示没有开启
+
+    // 内部结点缓存：上面若干层内部结点的只读快照，共享持有tree_latch_时用std::atomic_load/atomic_store访问
+    size_t inner_cache_budget_ = IX_INNER_CACHE_DEFAULT_BUDGET;     // 0表示不开启
+    std::shared_ptr<const IxInnerCache> inner_cache_;
+    std::mutex inner_cache_build_latch_;        // 同一时刻只有一个线程重建快照
+    std::atomic<int> inner_cache_splits_{0};    // 快照建立之后的分裂次数(内部结点中新插入的孩子和新的根结点)
+    std::atomic<bool> inner_cache_stale_{false};    // 下降时在快照之下发生了右移，下次下降之前重建
+    bool tree_exclusive_ = false;               // 有线程独占tree_latch_，期间不使用也不重建快照
+
+    // 延迟合并：删除只修改叶子结点，欠满的叶子由后台线程整理
+    std::atomic<bool> lazy_merge_{false};
+    std::mutex compact_latch_;                  // 保护underflow_keys_和stop_compactor_
+    std::condition_variable compact_cv_;
+    std::vector<std::string> underflow_keys_;   // 等待整理的欠满叶子，每个叶子用它范围内的一个存储格式的key表示
+    bool stop_compactor_ = false;
+    std::thread compactor_;
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
 
+    ~IxIndexHandle() override;
+
     // for search
-    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) override;
 
-    std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
-                                                 bool find_first = false);
+    int get_values(const char *keys, int num_keys, std::vector<Rid> *result, Transaction *transaction,
+                   std::vector<int> *key_index = nullptr);
+
+    int get_rids(const Iid &lower, const Iid &upper, std::vector<Rid> *result, bool sort_by_rid = true);
+
+    IxNodeGuard find_leaf_page(const char *key, Operation operation, bool find_first = false);
 
     // for insert
-    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) override;
 
-    IxNodeHandle *split(IxNodeHandle *node);
+    IxNodeGuard split(IxNodeHandle *node);
 
-    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
+    void insert_into_parent(IxNodeGuard old_node, const char *key, IxNodeHandle *new_node, IxPath *path);
 
     // for delete
     bool delete_entry(const char *key, Transaction *transaction);
 
-    bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
-                                bool *root_is_latched = nullptr);
+    bool delete_entry(const char *key, const Rid &rid, Transaction *transaction) override;
+
+    int delete_entries(const char *keys, const Rid *rids, int n, Transaction *transaction);
+
+    int delete_range(const char *lower, const char *upper, Transaction *transaction);
+
+    bool coalesce_or_redistribute(IxNodeHandle *node);
     bool adjust_root(IxNodeHandle *old_root_node);
 
     void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index);
 
-    bool coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                  Transaction *transaction, bool *root_is_latched);
+    bool coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index);
+
+    // for bulk build (ix_bulk.cpp)
+    bool bulk_load(IxSorter *sorter, double fill_factor);
+
+    const IxFileHdr *get_file_hdr() const { return file_hdr_; }
+
+    // for key cache
+    void enable_key_cache(const IxKeyCacheOptions &options);
+
+    void disable_key_cache() { key_cache_.reset(); }
+
+    /* 是否有可用的key缓存，有时点查不需要下降B+树 */
+    bool has_key_cache() const { return key_cache_ != nullptr && key_cache_->usable(); }
+
+    const IxKeyCache *get_key_cache() const { return key_cache_.get(); }
+
+    // for inner node cache
+    /* 缓存的内部结点最多使用多少字节，0表示不缓存；只在没有并发访问时调用 */
+    void set_inner_cache_budget(size_t budget);
+
+    /* 当前的内部结点快照，还没有建立或已经失效时为nullptr */
+    std::shared_ptr<const IxInnerCache> get_inner_cache() const { return std::atomic_load(&inner_cache_); }
+
+    // for lazy merge
+    void set_lazy_merge(bool lazy);
+
+    bool lazy_merge() const { return lazy_merge_; }
+
+    int compact();
+
+    // for statistics (ANALYZE)
+    int get_height();
 
     Iid lower_bound(const char *key);
 
@@ -219,15 +520,51 @@ class IxIndexHandle {
 
     bool is_empty() const { return file_hdr_->root_page_ == IX_NO_PAGE; }
 
+    // 将上层传入的原始key转换为索引中存储的格式，需要编码时写入buf并返回buf（见ix_index_key）
+    const char *to_index_key(const char *key, const Rid &rid, char *buf) const {
+        return ix_index_key(file_hdr_, key, rid, buf);
+    }
+
+    // 插入、删除时上层传入的key之后紧跟INCLUDE列的值
+    const char *to_index_key_with_include(const char *key, const Rid &rid, char *buf) const {
+        return ix_index_key(file_hdr_, key, rid, buf, key + file_hdr_->key_len());
+    }
+
+    int collect_matches(IxNodeGuard &leaf, const char *key, std::vector<Rid> *result);
+
+    bool delete_index_key(const char *key, const Rid *rid, Transaction *transaction);
+
+    void handle_underflow(std::vector<std::string> keys);
+
+    int rebalance_leaf(const char *key);
+
+    void run_compactor();
+
+    // for inner node cache
+    std::shared_ptr<const IxInnerCache> inner_cache_for_descent();
+
+    std::shared_ptr<const IxInnerCache> build_inner_cache();
+
+    // for latch crabbing
+    IxNodeGuard descend_shared(const char *key, bool latch_leaf_exclusive, bool find_first, IxPath *path = nullptr);
+
+    int move_right(IxNodeGuard &node, const char *key, bool exclusive);
+
+    IxNodeGuard find_node_by_level(const char *key, int level);
+
+    void update_high_keys(page_id_t page_no, const char *key);
+
+    bool is_safe(IxNodeHandle *node, const char *key, Operation operation);
+
     // for get/create node
-    IxNodeHandle *fetch_node(int page_no) const;
+    IxNodeGuard fetch_node(int page_no) const;
 
-    IxNodeHandle *create_node();
+    IxNodeGuard create_node();
 
     // for maintain data structure
     void maintain_parent(IxNodeHandle *node);
 
-    void erase_leaf(IxNodeHandle *leaf);
+    void erase_leaf(IxNodeHandle *leaf, IxNodeHandle *prev);
 
     void release_node_handle(IxNodeHandle &node);
 
@@ -235,4 +572,41 @@ class IxIndexHandle {
 
     // for index test
     Rid get_rid(const Iid &iid) const;
-};
\ No newline at end of file
+
+    void decode_key(IxNodeHandle *node, int pos, char *key) const;
+
+   public:
+    Rid get_entry(const Iid &iid, char *key) const;
+};
+/**
+ * RAII：独占tree_latch_
+ * 持有期间的删除可能合并、释放结点或修改内部结点中的key，B-link的右移无法纠正过期的内部结点快照，
+ * 因此加锁时丢弃快照，持有期间也不重建，释放之后的第一次下降重新建立
+ */
+class IxTreeWriteLock {
+   public:
+    explicit IxTreeWriteLock(IxIndexHandle *ih) : ih_(ih) {
+        ih_->tree_latch_.lock();
+        ih_->tree_exclusive_ = true;
+        std::atomic_store(&ih_->inner_cache_, std::shared_ptr<const IxInnerCache>());
+        locked_ = true;
+    }
+
+    IxTreeWriteLock(const IxTreeWriteLock &) = delete;
+
+    IxTreeWriteLock &operator=(const IxTreeWriteLock &) = delete;
+
+    ~IxTreeWriteLock() { unlock(); }
+
+    void unlock() {
+        if (locked_) {
+            ih_->tree_exclusive_ = false;
+            ih_->tree_latch_.unlock();
+            locked_ = false;
+        }
+    }
+
+   private:
+    IxIndexHandle *ih_;
+    bool locked_ = false;
+};
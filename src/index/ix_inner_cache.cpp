@@ -0,0 +1,104 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_inner_cache.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "ix_index_handle.h"
+
+void IxInnerCache::add_node(page_id_t page_no, int num_key, const char *keys, const page_id_t *children,
+                            const char *high_key, page_id_t right) {
+    int len = file_hdr_->col_tot_len_;
+    Node node = {page_no, num_key, right, high_key != nullptr, staging_.size()};
+    staging_.resize(staging_.size() + block_size(num_key), 0);
+    char *block = staging_.data() + node.offset;
+    if (high_key != nullptr) {
+        memcpy(block, high_key, len);
+    }
+    memcpy(block + len, keys, static_cast<size_t>(num_key) * len);
+    size_t keys_size = (static_cast<size_t>(num_key) + 1) * len;
+    memcpy(block + (keys_size + 3) / 4 * 4, children, num_key * sizeof(page_id_t));
+    nodes_.push_back(node);
+}
+
+bool IxInnerCache::end_level(size_t budget) {
+    int begin = level_begin_.back();
+    if (begin < static_cast<int>(nodes_.size()) && staging_.size() <= budget) {
+        return true;
+    }
+    staging_.resize(begin < static_cast<int>(nodes_.size()) ? nodes_[begin].offset : staging_.size());
+    nodes_.resize(begin);
+    level_begin_.pop_back();
+    return false;
+}
+
+/**
+ * @brief 把右兄弟和上层结点的孩子由page_no解析为快照中的下标，最底层结点的孩子仍然是page_no
+ * 快照建立期间没有结点被释放，上层结点拷贝时存在的孩子一定在之后沿右兄弟遍历下一层时被添加
+ */
+void IxInnerCache::finish() {
+    std::unordered_map<page_id_t, int> index;
+    for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+        index[nodes_[i].page_no] = i;
+    }
+    data_ = staging_.data();
+    int bottom = level_begin_.empty() ? 0 : level_begin_.back();
+    for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+        Node &node = nodes_[i];
+        auto right = index.find(node.right);
+        node.right = right == index.end() ? -1 : right->second;
+        if (i < bottom) {
+            page_id_t *child = const_cast<page_id_t *>(children(node));
+            for (int j = 0; j < node.num_key; ++j) {
+                assert(index.count(child[j]) > 0);
+                child[j] = index.at(child[j]);
+            }
+        }
+    }
+    size_ = staging_.size();
+    arena_.reset(new char[size_ + IX_INNER_CACHE_ALIGN]);
+    auto addr = reinterpret_cast<uintptr_t>(arena_.get());
+    data_ = arena_.get() + (IX_INNER_CACHE_ALIGN - addr % IX_INNER_CACHE_ALIGN) % IX_INNER_CACHE_ALIGN;
+    memcpy(data_, staging_.data(), size_);
+    std::vector<char>().swap(staging_);
+}
+
+/**
+ * @brief 与IxIndexHandle::descend_shared相同的下降规则：key >= high key时右移，
+ * 结点中第一个key不参与查找，沿第一个<=key的key对应的孩子下降
+ * 快照中右兄弟的拷贝可能比左边的结点更新，因此也在快照内右移
+ */
+page_id_t IxInnerCache::route(const char *key, bool find_first, IxPath *path) const {
+    int len = file_hdr_->col_tot_len_;
+    const Node *node = &nodes_[level_begin_[0]];
+    for (int level = 0;; ++level) {
+        if (!find_first) {
+            while (node->has_high_key && node->right >= 0 && ix_compare(key, high_key(*node), file_hdr_) >= 0) {
+                node = &nodes_[node->right];
+            }
+        }
+        if (path != nullptr) {
+            path->push(node->page_no);
+        }
+        int pos = 0;
+        if (!find_first && node->num_key > 1) {
+            pos = file_hdr_->upper_bound_fn_(file_hdr_, keys(*node) + len, node->num_key - 1, key);
+        }
+        page_id_t child = children(*node)[pos];
+        if (level + 1 == num_levels()) {
+            return child;
+        }
+        node = &nodes_[child];
+    }
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ix_defs.h"
+
+/*
+ * B+树上面若干层内部结点的只读快照：下降时先在快照中查找，只在快照之下的层(通常只有叶子)访问缓冲池
+ * - 每个结点占一个按缓存行对齐的块：high key | 解压之后的所有key | 孩子，所有块连续存放在一个数组中，
+ *   自顶向下、每层从左到右排列，查找使用与结点相同的查找内核
+ * - 快照建立之后不再修改：结点分裂时快照中的结点仍然覆盖目标key的左边界，
+ *   下降到快照之下的结点之后由B-link的move_right纠正；下降时发现需要右移才重新建立快照(写时复制)
+ * - 合并、重分配等删除操作会修改或释放结点，右移无法纠正，这些操作独占tree_latch_时丢弃快照
+ */
+
+class IxPath;
+
+constexpr size_t IX_INNER_CACHE_DEFAULT_BUDGET = 4 << 20;   // 每个索引缓存的内部结点默认最多使用4MB
+constexpr size_t IX_INNER_CACHE_ALIGN = 64;                 // 每个结点的块按缓存行对齐
+
+class IxInnerCache {
+   public:
+    explicit IxInnerCache(const IxFileHdr *file_hdr) : file_hdr_(file_hdr) {}
+
+    /* 开始添加下一层的结点，自顶向下逐层添加 */
+    void begin_level() { level_begin_.push_back(static_cast<int>(nodes_.size())); }
+
+    /**
+     * @brief 在当前层的末尾添加一个结点，同一层的结点按从左到右的顺序添加
+     *
+     * @param keys num_key个连续存放、解压之后的key
+     * @param children 每个key对应的孩子page_no
+     * @param high_key 结点的high key，nullptr表示没有
+     * @param right 右兄弟的page_no
+     */
+    void add_node(page_id_t page_no, int num_key, const char *keys, const page_id_t *children, const char *high_key,
+                  page_id_t right);
+
+    /* 当前层添加完成；这一层为空或者快照的大小超过budget时丢弃这一层并返回false，不再添加更下面的层 */
+    bool end_level(size_t budget);
+
+    /* 所有层添加完成之后调用：解析孩子和右兄弟在快照中的下标，拷贝到对齐的数组中 */
+    void finish();
+
+    /**
+     * @brief 在快照中从顶层下降
+     *
+     * @param key 存储格式的目标key
+     * @param find_first 是否总是沿着第一个孩子下降
+     * @param[out] path 不为nullptr时追加经过的结点
+     * @return 快照最底层之下范围包含key的结点(分裂之后可能需要右移)的page_no
+     */
+    page_id_t route(const char *key, bool find_first, IxPath *path) const;
+
+    int num_levels() const { return static_cast<int>(level_begin_.size()); }
+
+    int num_nodes() const { return static_cast<int>(nodes_.size()); }
+
+    size_t mem_used() const { return size_; }
+
+   private:
+    struct Node {
+        page_id_t page_no;
+        int num_key;
+        int right;              // 添加时为右兄弟的page_no，finish之后为右兄弟在nodes_中的下标，-1表示没有
+        bool has_high_key;
+        size_t offset;          // 结点的块在数组中的偏移
+    };
+
+    size_t block_size(int num_key) const {
+        size_t keys = (static_cast<size_t>(num_key) + 1) * file_hdr_->col_tot_len_;
+        size_t size = (keys + 3) / 4 * 4 + num_key * sizeof(page_id_t);
+        return (size + IX_INNER_CACHE_ALIGN - 1) / IX_INNER_CACHE_ALIGN * IX_INNER_CACHE_ALIGN;
+    }
+
+    const char *high_key(const Node &node) const { return data_ + node.offset; }
+
+    const char *keys(const Node &node) const { return data_ + node.offset + file_hdr_->col_tot_len_; }
+
+    const page_id_t *children(const Node &node) const {
+        size_t keys = (static_cast<size_t>(node.num_key) + 1) * file_hdr_->col_tot_len_;
+        return reinterpret_cast<const page_id_t *>(data_ + node.offset + (keys + 3) / 4 * 4);
+    }
+
+    const IxFileHdr *file_hdr_;
+    std::vector<Node> nodes_;           // 自顶向下、每层从左到右
+    std::vector<int> level_begin_;      // 每层第一个结点在nodes_中的下标
+    std::vector<char> staging_;         // 添加期间的块，finish之后拷贝到arena_
+    std::unique_ptr<char[]> arena_;
+    char *data_ = nullptr;              // arena_中按IX_INNER_CACHE_ALIGN对齐的起始地址
+    size_t size_ = 0;
+};
@@ -0,0 +1,187 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "ix_defs.h"
+
+/*
+ * key的规范化编码：把各列编码为一个定长字节串，字节串的memcmp顺序与逐列ix_compare的顺序相同
+ * - INT：翻转符号位后按大端序存储
+ * - FLOAT：正数翻转符号位，负数翻转所有位，然后按大端序存储（-0.0与0.0编码相同）
+ * - CHAR/VARCHAR：本身就是定长、以'\0'填充的字节串，原样拷贝
+ * 编码后的长度与原始key相同，都是col_tot_len
+ */
+
+inline void ix_store_be32(char *dest, uint32_t v) {
+    dest[0] = static_cast<char>(v >> 24);
+    dest[1] = static_cast<char>(v >> 16);
+    dest[2] = static_cast<char>(v >> 8);
+    dest[3] = static_cast<char>(v);
+}
+
+inline uint32_t ix_load_be32(const char *src) {
+    const auto *p = reinterpret_cast<const unsigned char *>(src);
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint32_t ix_encode_int(int v) { return static_cast<uint32_t>(v) ^ 0x80000000u; }
+
+inline int ix_decode_int(uint32_t u) { return static_cast<int>(u ^ 0x80000000u); }
+
+inline uint32_t ix_encode_float(float v) {
+    uint32_t bits;
+    if (v == 0.0f) {
+        v = 0.0f;   // -0.0和0.0在ix_compare中相等，编码也要相同
+    }
+    memcpy(&bits, &v, sizeof(float));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+inline float ix_decode_float(uint32_t u) {
+    uint32_t bits = (u & 0x80000000u) ? (u & 0x7fffffffu) : ~u;
+    float v;
+    memcpy(&v, &bits, sizeof(float));
+    return v;
+}
+
+/**
+ * @brief 将原始key编码为规范化key
+ *
+ * @param hdr 索引文件头，提供各列的类型和长度
+ * @param raw 原始key，按列依次存放
+ * @param dest 编码结果，长度为hdr->col_tot_len_，不能与raw重叠
+ */
+inline void ix_normalize_key(const IxFileHdr *hdr, const char *raw, char *dest) {
+    int offset = 0;
+    for (int i = 0; i < hdr->col_num_; ++i) {
+        switch (hdr->col_types_[i]) {
+            case TYPE_INT: {
+                int v;
+                memcpy(&v, raw + offset, sizeof(int));
+                ix_store_be32(dest + offset, ix_encode_int(v));
+                break;
+            }
+            case TYPE_FLOAT: {
+                float v;
+                memcpy(&v, raw + offset, sizeof(float));
+                ix_store_be32(dest + offset, ix_encode_float(v));
+                break;
+            }
+            default:
+                memcpy(dest + offset, raw + offset, hdr->col_lens_[i]);
+                break;
+        }
+        offset += hdr->col_lens_[i];
+    }
+}
+
+/**
+ * @brief 将规范化key解码为原始key，是ix_normalize_key的逆过程
+ */
+inline void ix_denormalize_key(const IxFileHdr *hdr, const char *norm, char *dest) {
+    int offset = 0;
+    for (int i = 0; i < hdr->col_num_; ++i) {
+        switch (hdr->col_types_[i]) {
+            case TYPE_INT: {
+                int v = ix_decode_int(ix_load_be32(norm + offset));
+                memcpy(dest + offset, &v, sizeof(int));
+                break;
+            }
+            case TYPE_FLOAT: {
+                float v = ix_decode_float(ix_load_be32(norm + offset));
+                memcpy(dest + offset, &v, sizeof(float));
+                break;
+            }
+            default:
+                memcpy(dest + offset, norm + offset, hdr->col_lens_[i]);
+                break;
+        }
+        offset += hdr->col_lens_[i];
+    }
+}
+
+/**
+ * @brief 将上层传入的原始key转换为索引中存储的格式
+ * 允许重复key的索引(hdr->rid_suffix())先在key之后追加rid和INCLUDE列，再整体规范化编码
+ *
+ * @param key 原始key，长度为hdr->key_len()
+ * @param rid 追加的rid，查找一个key的所有项时使用IX_MIN_RID/IX_MAX_RID
+ * @param buf 需要编码时的输出缓冲区，长度至少为hdr->col_tot_len_
+ * @param include INCLUDE列的值，长度为hdr->include_len()；查找时为nullptr，以'\0'填充
+ * @return 存储格式的key：不需要编码时直接返回key，否则返回buf
+ */
+inline const char *ix_index_key(const IxFileHdr *hdr, const char *key, const Rid &rid, char *buf,
+                                const char *include = nullptr) {
+    if (hdr->rid_suffix()) {
+        char raw[IX_MAX_COL_LEN];
+        int len = hdr->key_len();
+        memcpy(raw, key, len);
+        memcpy(raw + len, &rid.page_no, sizeof(int));
+        memcpy(raw + len + sizeof(int), &rid.slot_no, sizeof(int));
+        if (include != nullptr) {
+            memcpy(raw + hdr->include_offset(), include, hdr->include_len());
+        } else {
+            memset(raw + hdr->include_offset(), 0, hdr->include_len());
+        }
+        ix_normalize_key(hdr, raw, buf);
+        return buf;
+    }
+    if (!hdr->normalized_keys()) {
+        return key;
+    }
+    ix_normalize_key(hdr, key, buf);
+    return buf;
+}
+
+/*
+ * 前缀压缩和后缀截断（见IX_FORMAT_COMPRESSED_NODES）只作用于memcmp有序的key，
+ * 这类key末尾的'\0'可以省略：较短的key补齐'\0'之后与原key相同
+ */
+
+/**
+ * @brief a和b的公共前缀长度
+ */
+inline int ix_common_prefix(const char *a, const char *b, int len) {
+    int i = 0;
+    while (i < len && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * @brief 去掉末尾'\0'之后key的长度
+ */
+inline int ix_significant_len(const char *key, int len) {
+    while (len > 0 && key[len - 1] == '\0') {
+        --len;
+    }
+    return len;
+}
+
+/**
+ * @brief 后缀截断：生成满足 left < sep <= right 的最短分隔key，sep末尾补齐'\0'
+ * sep取right的前cp+1个字节，cp为left和right的公共前缀长度
+ *
+ * @param left 左侧结点的最后一个key
+ * @param right 右侧结点的第一个key，要求left < right
+ */
+inline void ix_shortest_separator(const char *left, const char *right, int len, char *sep) {
+    int n = ix_common_prefix(left, right, len) + 1;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(sep, right, n);
+    memset(sep + n, 0, len - n);
+}
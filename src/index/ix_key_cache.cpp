@@ -0,0 +1,164 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_key_cache.h"
+
+#include <algorithm>
+#include <mutex>
+
+/**
+ * @brief 在缓存中查找key
+ *
+ * @param key 规范化key
+ * @param[out] result 命中时按rid有序追加key的所有rid
+ * @param[out] version MISS时返回当前版本，查找B+树之后传给fill
+ * @return HIT：命中；ABSENT：确定key不存在；MISS：需要查找B+树
+ */
+IxKeyCache::Lookup IxKeyCache::lookup(const char *key, std::vector<Rid> *result, uint64_t *version) {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (!dropped_) {
+        auto it = map_.find(std::string(key, key_len_));
+        if (it != map_.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            if (it->second.empty()) {
+                return Lookup::ABSENT;  // LAZY模式缓存的"不存在"
+            }
+            result->insert(result->end(), it->second.begin(), it->second.end());
+            return Lookup::HIT;
+        }
+        if (options_.mode == IX_KEY_CACHE_FULL) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return Lookup::ABSENT;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    *version = version_;
+    return Lookup::MISS;
+}
+
+/**
+ * @brief LAZY模式：把B+树的查找结果放入缓存，查找期间缓存被修改过时放弃
+ *
+ * @param rids key的所有rid，为空表示key不存在
+ * @param version lookup返回的版本
+ */
+void IxKeyCache::fill(const char *key, const std::vector<Rid> &rids, uint64_t version) {
+    if (options_.mode != IX_KEY_CACHE_LAZY) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (version != version_) {
+        return;
+    }
+    std::vector<Rid> sorted(rids);
+    std::sort(sorted.begin(), sorted.end());
+    size_t need = entry_mem(sorted);
+    if (need > options_.memory_budget) {
+        return;
+    }
+    evict_for(need);
+    auto [it, inserted] = map_.emplace(std::string(key, key_len_), std::move(sorted));
+    if (inserted) {
+        mem_used_ += need;
+    }
+}
+
+/**
+ * @brief FULL模式建立缓存时加入一项
+ * @return 超过内存预算时丢弃缓存并返回false
+ */
+bool IxKeyCache::load(const char *key, const Rid &rid) {
+    on_insert(key, rid);
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    return !dropped_;
+}
+
+/**
+ * @brief 索引中插入了(key, rid)
+ */
+void IxKeyCache::on_insert(const char *key, const Rid &rid) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (dropped_) {
+        return;
+    }
+    std::string k(key, key_len_);
+    if (options_.mode == IX_KEY_CACHE_LAZY) {
+        // key的rid集合变了，使缓存失效，下次点查时重新从B+树读取
+        auto it = map_.find(k);
+        if (it != map_.end()) {
+            mem_used_ -= entry_mem(it->second);
+            map_.erase(it);
+        }
+        version_++;
+        return;
+    }
+    auto &rids = map_[k];
+    size_t old_mem = rids.empty() ? 0 : entry_mem(rids);
+    rids.insert(std::lower_bound(rids.begin(), rids.end(), rid), rid);
+    mem_used_ += entry_mem(rids) - old_mem;
+    if (mem_used_ > options_.memory_budget) {
+        drop();
+    }
+}
+
+/**
+ * @brief 索引中删除了(key, rid)
+ * @param rid 为nullptr时删除key的所有项(唯一索引按key删除)
+ */
+void IxKeyCache::on_delete(const char *key, const Rid *rid) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (dropped_) {
+        return;
+    }
+    if (options_.mode == IX_KEY_CACHE_LAZY) {
+        version_++;
+    }
+    auto it = map_.find(std::string(key, key_len_));
+    if (it == map_.end()) {
+        return;
+    }
+    auto &rids = it->second;
+    size_t old_mem = entry_mem(rids);
+    if (options_.mode == IX_KEY_CACHE_FULL && rid != nullptr) {
+        auto pos = std::lower_bound(rids.begin(), rids.end(), *rid);
+        if (pos != rids.end() && *pos == *rid) {
+            rids.erase(pos);
+        }
+        if (!rids.empty()) {
+            return;     // vector没有收缩，占用的内存不变
+        }
+    }
+    mem_used_ -= old_mem;
+    map_.erase(it);
+}
+
+void IxKeyCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    map_.clear();
+    mem_used_ = 0;
+    dropped_ = false;
+    version_++;
+}
+
+/* FULL模式超过预算：释放所有内存，之后不再使用缓存。调用者持有latch_ */
+void IxKeyCache::drop() {
+    std::unordered_map<std::string, std::vector<Rid>>().swap(map_);
+    mem_used_ = 0;
+    dropped_ = true;
+}
+
+/* LAZY模式：淘汰任意的项，直到能放下need字节。调用者持有latch_ */
+void IxKeyCache::evict_for(size_t need) {
+    while (!map_.empty() && mem_used_ + need > options_.memory_budget) {
+        auto it = map_.begin();
+        mem_used_ -= entry_mem(it->second);
+        map_.erase(it);
+    }
+}
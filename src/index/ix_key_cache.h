@@ -0,0 +1,100 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "defs.h"
+
+/*
+ * B+树前面的内存key缓存：规范化key -> 该key的所有rid，命中时点查不需要访问缓冲池
+ * - IX_KEY_CACHE_FULL：打开索引时读取所有叶子建立完整的缓存，插入删除同步修改缓存，未命中说明key不存在；
+ *   超过内存预算时丢弃整个缓存，之后的点查都访问B+树，直到重新打开索引
+ * - IX_KEY_CACHE_LAZY：点查未命中时把B+树的查找结果(包括key不存在)放入缓存，插入删除使该key的缓存失效；
+ *   超过内存预算时淘汰任意的项
+ */
+
+enum IxKeyCacheMode { IX_KEY_CACHE_OFF = 0, IX_KEY_CACHE_FULL = 1, IX_KEY_CACHE_LAZY = 2 };
+
+constexpr size_t IX_KEY_CACHE_DEFAULT_BUDGET = 64 << 20;    // 每个索引的缓存默认最多使用64MB
+constexpr size_t IX_KEY_CACHE_ENTRY_OVERHEAD = 64;          // 估算内存时每项额外的开销(哈希表结点、string和vector头部)
+
+struct IxKeyCacheOptions {
+    IxKeyCacheMode mode = IX_KEY_CACHE_OFF;
+    size_t memory_budget = IX_KEY_CACHE_DEFAULT_BUDGET;     // 缓存估算占用的内存上限，单位为字节
+};
+
+class IxKeyCache {
+   public:
+    enum class Lookup { HIT, ABSENT, MISS };    // 命中、确定不存在、需要查找B+树
+
+   private:
+    IxKeyCacheOptions options_;
+    int key_len_;                                           // 规范化key的长度，不包括rid后缀和INCLUDE列
+    std::unordered_map<std::string, std::vector<Rid>> map_; // 每个key的rid按(page_no, slot_no)有序
+    size_t mem_used_ = 0;                                   // 估算的内存占用
+    bool dropped_ = false;                                  // FULL模式下超过预算之后不再使用缓存
+    uint64_t version_ = 0;                                  // LAZY模式下每次失效加一，查找B+树期间有修改时不填充
+    mutable std::shared_mutex latch_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+   public:
+    IxKeyCache(const IxKeyCacheOptions &options, int key_len) : options_(options), key_len_(key_len) {}
+
+    const IxKeyCacheOptions &options() const { return options_; }
+
+    /* 缓存是否仍然可用，FULL模式超过预算之后不可用 */
+    bool usable() const {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        return !dropped_;
+    }
+
+    Lookup lookup(const char *key, std::vector<Rid> *result, uint64_t *version);
+
+    void fill(const char *key, const std::vector<Rid> &rids, uint64_t version);
+
+    bool load(const char *key, const Rid &rid);
+
+    void on_insert(const char *key, const Rid &rid);
+
+    void on_delete(const char *key, const Rid *rid);
+
+    void clear();
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        return map_.size();
+    }
+
+    size_t mem_used() const {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        return mem_used_;
+    }
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+   private:
+    size_t entry_mem(const std::vector<Rid> &rids) const {
+        return key_len_ + rids.capacity() * sizeof(Rid) + IX_KEY_CACHE_ENTRY_OVERHEAD;
+    }
+
+    void drop();
+
+    void evict_for(size_t need);
+};
@@ -0,0 +1,476 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_lsm.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+#include "ix_bulk.h"
+#include "ix_key.h"
+#include "ix_manager.h"
+
+/* 从规范化编码的(key, rid)中取出rid，key_len为原始key的长度 */
+static Rid decode_rid(const std::string &entry, int key_len) {
+    return {ix_decode_int(ix_load_be32(entry.data() + key_len)),
+            ix_decode_int(ix_load_be32(entry.data() + key_len + sizeof(int)))};
+}
+
+void IxLsmManifest::load(const std::string &path) {
+    std::ifstream ifs(path);
+    size_t num_cols = 0, num_runs = 0;
+    ifs >> num_cols;
+    col_types.resize(num_cols);
+    col_lens.resize(num_cols);
+    for (size_t i = 0; i < num_cols; ++i) {
+        int type;
+        ifs >> type >> col_lens[i];
+        col_types[i] = static_cast<ColType>(type);
+    }
+    ifs >> next_run_id >> num_runs;
+    runs.resize(num_runs);
+    for (auto &run : runs) {
+        ifs >> run.id >> run.level >> run.num_entries;
+    }
+    if (!ifs) {
+        throw InternalError("IxLsmManifest::load: broken manifest " + path);
+    }
+}
+
+void IxLsmManifest::save(const std::string &path) const {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream ofs(tmp);
+        ofs << col_types.size();
+        for (size_t i = 0; i < col_types.size(); ++i) {
+            ofs << ' ' << static_cast<int>(col_types[i]) << ' ' << col_lens[i];
+        }
+        ofs << '\n' << next_run_id << ' ' << runs.size() << '\n';
+        for (auto &run : runs) {
+            ofs << run.id << ' ' << run.level << ' ' << run.num_entries << '\n';
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) < 0) {
+        throw UnixError();
+    }
+}
+
+IxLsmRun::~IxLsmRun() {
+    ix_manager->close_index(ih.get());
+    ih.reset();
+    if (obsolete) {
+        disk_manager->destroy_file(file_name);
+    }
+}
+
+void IxLsmMergeIter::add_memtable(std::shared_ptr<const IxLsmMemtable> mem, IxLsmMemtable::const_iterator begin,
+                                  IxLsmMemtable::const_iterator end) {
+    Source src;
+    src.mem = std::move(mem);
+    src.it = begin;
+    src.end = end;
+    load(src);
+    sources_.push_back(std::move(src));
+}
+
+void IxLsmMergeIter::add_run(std::shared_ptr<IxLsmRun> run, const Iid &lower, const Iid &upper,
+                             BufferPoolManager *bpm) {
+    Source src;
+    src.scan = std::make_unique<IxScan>(run->ih.get(), lower, upper, bpm, true);
+    src.run = std::move(run);
+    load(src);
+    sources_.push_back(std::move(src));
+}
+
+/**
+ * @brief 读取来源的当前项；run中解码之后的项为key、rid和删除标记，重新编码为memtable中的格式
+ */
+void IxLsmMergeIter::load(Source &src) {
+    if (src.scan == nullptr) {
+        if (src.it == src.end) {
+            src.done = true;
+            return;
+        }
+        src.key = src.it->first;
+        src.tombstone = src.it->second;
+        return;
+    }
+    if (src.scan->is_end()) {
+        src.done = true;
+        return;
+    }
+    const IxFileHdr *hdr = src.run->ih->get_file_hdr();
+    const char *entry = src.scan->key();
+    char norm[IX_MAX_COL_LEN];
+    ix_normalize_key(hdr, entry, norm);
+    src.key.assign(norm, key_len_);
+    int flag;
+    memcpy(&flag, entry + hdr->include_offset(), sizeof(int));
+    src.tombstone = flag != 0;
+}
+
+/**
+ * @brief 取所有来源当前项中最小的(key, rid)，相同时取最新的来源，并让所有停在该项上的来源前进一项
+ */
+void IxLsmMergeIter::advance() {
+    Source *min = nullptr;
+    for (auto &src : sources_) {
+        if (!src.done && (min == nullptr || src.key < min->key)) {
+            min = &src;
+        }
+    }
+    if (min == nullptr) {
+        end_ = true;
+        return;
+    }
+    key_ = min->key;
+    tombstone_ = min->tombstone;
+    for (auto &src : sources_) {
+        if (src.done || src.key != key_) {
+            continue;
+        }
+        if (src.scan == nullptr) {
+            ++src.it;
+        } else {
+            src.scan->next();
+        }
+        load(src);
+    }
+}
+
+IxLsmHandle::IxLsmHandle(IxManager *ix_manager, DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+                         std::string name)
+    : ix_manager_(ix_manager),
+      disk_manager_(disk_manager),
+      buffer_pool_manager_(buffer_pool_manager),
+      name_(std::move(name)),
+      mem_(std::make_shared<IxLsmMemtable>()) {
+    IxLsmManifest manifest;
+    manifest.load(name_);
+    key_len_ = std::accumulate(manifest.col_lens.begin(), manifest.col_lens.end(), 0);
+    // 与run的文件头相同的列布局：索引字段、rid的两个INT列和作为INCLUDE列的删除标记
+    hdr_.format_version_ = IX_FORMAT_DUPLICATE_KEYS;
+    hdr_.col_types_ = manifest.col_types;
+    hdr_.col_lens_ = manifest.col_lens;
+    hdr_.col_types_.insert(hdr_.col_types_.end(), 3, TYPE_INT);
+    hdr_.col_lens_.insert(hdr_.col_lens_.end(), 3, static_cast<int>(sizeof(int)));
+    hdr_.col_num_ = static_cast<int>(hdr_.col_types_.size());
+    hdr_.col_tot_len_ = key_len_ + IX_RID_SUFFIX_LEN + IX_LSM_FLAG_LEN;
+    hdr_.include_num_ = 1;
+    next_run_id_ = manifest.next_run_id;
+    for (auto &meta : manifest.runs) {
+        runs_.push_back(open_run(meta));
+    }
+    worker_ = std::thread(&IxLsmHandle::background_work, this);
+}
+
+IxLsmHandle::~IxLsmHandle() {
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::shared_mutex> lock(latch_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        worker_.join();
+    }
+}
+
+/**
+ * @brief 查找key对应的所有rid
+ * @return 是否找到
+ */
+bool IxLsmHandle::get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    size_t begin = result->size();
+    for (IxLsmScan scan(this, lower_bound(key), upper_bound(key)); !scan.is_end(); scan.next()) {
+        result->push_back(scan.rid());
+    }
+    return result->size() > begin;
+}
+
+page_id_t IxLsmHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    put(key, value, false);
+    return 0;
+}
+
+bool IxLsmHandle::delete_entry(const char *key, const Rid &rid, Transaction *transaction) {
+    put(key, rid, true);
+    return true;
+}
+
+/**
+ * @brief 写入memtable，memtable写满时转为不可变memtable并唤醒后台线程；
+ * 等待写出的不可变memtable过多时等待后台线程，限制写入速度和内存占用
+ */
+void IxLsmHandle::put(const char *key, const Rid &rid, bool tombstone) {
+    std::string entry = make_entry(key, rid);
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    (*mem_)[std::move(entry)] = tombstone;
+    if (mem_->size() < memtable_entries_) {
+        return;
+    }
+    done_cv_.wait(lock, [&] { return imm_.size() < IX_LSM_MAX_IMMUTABLE; });
+    if (mem_->size() >= memtable_entries_) {    // 等待期间可能已经被其他线程转出
+        imm_.push_front(std::move(mem_));
+        mem_ = std::make_shared<IxLsmMemtable>();
+        work_cv_.notify_all();
+    }
+}
+
+void IxLsmHandle::flush() {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (!mem_->empty()) {
+        imm_.push_front(std::move(mem_));
+        mem_ = std::make_shared<IxLsmMemtable>();
+        work_cv_.notify_all();
+    }
+    done_cv_.wait(lock, [&] { return imm_.empty() && compact_level() < 0; });
+}
+
+void IxLsmHandle::close() {
+    flush();
+    {
+        std::lock_guard<std::shared_mutex> lock(latch_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    worker_.join();
+    save_manifest();
+    runs_.clear();
+}
+
+std::vector<IxLsmRunMeta> IxLsmHandle::get_runs() {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    std::vector<IxLsmRunMeta> metas;
+    for (auto &run : runs_) {
+        metas.push_back(run->meta);
+    }
+    return metas;
+}
+
+/* 规范化编码的(key, rid)，与run中存储的key去掉删除标记之后相同 */
+std::string IxLsmHandle::make_entry(const char *key, const Rid &rid) const {
+    char raw[IX_MAX_COL_LEN];
+    char norm[IX_MAX_COL_LEN];
+    memcpy(raw, key, key_len_);
+    memcpy(raw + key_len_, &rid.page_no, sizeof(int));
+    memcpy(raw + key_len_ + sizeof(int), &rid.slot_no, sizeof(int));
+    memset(raw + key_len_ + IX_RID_SUFFIX_LEN, 0, IX_LSM_FLAG_LEN);
+    ix_normalize_key(&hdr_, raw, norm);
+    return std::string(norm, key_len_ + IX_RID_SUFFIX_LEN);
+}
+
+/* 边界在memtable中的位置：key的所有项之前为(key, IX_MIN_RID)，之后为(key, IX_MAX_RID) */
+std::string IxLsmHandle::bound_entry(const IxLsmBound &bound) const {
+    return make_entry(bound.key.data(), bound.after ? IX_MAX_RID : IX_MIN_RID);
+}
+
+std::shared_ptr<IxLsmRun> IxLsmHandle::open_run(const IxLsmRunMeta &meta) {
+    auto run = std::make_shared<IxLsmRun>();
+    run->meta = meta;
+    run->file_name = run_file_name(name_, meta.id);
+    run->ix_manager = ix_manager_;
+    run->disk_manager = disk_manager_;
+    int fd = disk_manager_->open_file(run->file_name);
+    run->ih = std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+    if (!run->ih->get_file_hdr()->supported_format()) {
+        int version = run->ih->get_file_hdr()->format_version_;
+        disk_manager_->close_file(fd);
+        throw IndexFormatVersionError(run->file_name, version);
+    }
+    return run;
+}
+
+/**
+ * @brief 把归并的结果自底向上地写成第level层的一个新run，写完之后关闭文件，保证文件头和所有页面都已落盘
+ *
+ * @param drop_tombstones 没有比输入更旧的数据时丢弃删除标记
+ * @return 新的run，没有项时不创建run，返回nullptr
+ */
+std::shared_ptr<IxLsmRun> IxLsmHandle::write_run(IxLsmMergeIter &iter, int level, bool drop_tombstones) {
+    int id = next_run_id_++;
+    std::string file_name = run_file_name(name_, id);
+    ix_manager_->create_index_file(file_name, hdr_.col_types_, hdr_.col_lens_, IX_FORMAT_DUPLICATE_KEYS,
+                                   hdr_.include_num_);
+    long long num_entries;
+    {
+        int fd = disk_manager_->open_file(file_name);
+        IxIndexHandle ih(disk_manager_, buffer_pool_manager_, fd);
+        IxBulkBuilder builder(&ih, IX_LSM_FILL_FACTOR);
+        char stored[IX_MAX_COL_LEN];
+        for (; !iter.is_end(); iter.next()) {
+            if (drop_tombstones && iter.tombstone()) {
+                continue;
+            }
+            const std::string &entry = iter.key();
+            memcpy(stored, entry.data(), entry.size());
+            ix_store_be32(stored + entry.size(), ix_encode_int(iter.tombstone() ? 1 : 0));
+            builder.append(stored, decode_rid(entry, key_len_));
+        }
+        builder.finish();
+        num_entries = static_cast<long long>(builder.num_entries());
+        ix_manager_->close_index(&ih);
+    }
+    if (num_entries == 0) {
+        disk_manager_->destroy_file(file_name);
+        return nullptr;
+    }
+    return open_run({id, level, num_entries});
+}
+
+/* run数量达到IX_LSM_MERGE_FANIN的最低一层，没有时返回-1 */
+int IxLsmHandle::compact_level() const {
+    for (size_t i = 0; i < runs_.size();) {
+        size_t j = i;
+        while (j < runs_.size() && runs_[j]->meta.level == runs_[i]->meta.level) {
+            j++;
+        }
+        if (j - i >= static_cast<size_t>(IX_LSM_MERGE_FANIN)) {
+            return runs_[i]->meta.level;
+        }
+        i = j;
+    }
+    return -1;
+}
+
+/* 调用者持有latch_，或者后台线程已经停止 */
+void IxLsmHandle::save_manifest() {
+    IxLsmManifest manifest;
+    int num_cols = hdr_.col_num_ - 3;
+    manifest.col_types.assign(hdr_.col_types_.begin(), hdr_.col_types_.begin() + num_cols);
+    manifest.col_lens.assign(hdr_.col_lens_.begin(), hdr_.col_lens_.begin() + num_cols);
+    manifest.next_run_id = next_run_id_;
+    for (auto &run : runs_) {
+        manifest.runs.push_back(run->meta);
+    }
+    manifest.save(name_);
+}
+
+/**
+ * @brief 后台线程：先按从旧到新的顺序写出不可变memtable，再合并run数量达到上限的层，没有工作时等待
+ * 写run期间不持有latch_，读写可以继续；只有后台线程修改runs_的结构，新的run总是加在开头，
+ * 因此合并期间输入的run在runs_中仍然相邻，合并结果放回它们的位置，runs_的层号保持不减
+ */
+void IxLsmHandle::background_work() {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    while (true) {
+        work_cv_.wait(lock, [&] { return stop_ || !imm_.empty() || compact_level() >= 0; });
+        if (!imm_.empty()) {
+            auto mem = imm_.back();
+            bool bottom = runs_.empty();    // 更旧的数据只可能在run中
+            lock.unlock();
+            IxLsmMergeIter iter(key_len_ + IX_RID_SUFFIX_LEN);
+            iter.add_memtable(mem, mem->begin(), mem->end());
+            iter.start();
+            auto run = write_run(iter, 0, bottom);
+            lock.lock();
+            if (run != nullptr) {
+                runs_.insert(runs_.begin(), std::move(run));
+            }
+            imm_.pop_back();
+            save_manifest();
+            done_cv_.notify_all();
+            continue;
+        }
+        int level = compact_level();
+        if (level >= 0) {
+            auto first = std::find_if(runs_.begin(), runs_.end(), [&](auto &run) { return run->meta.level == level; });
+            auto last = std::find_if(first, runs_.end(), [&](auto &run) { return run->meta.level != level; });
+            std::vector<std::shared_ptr<IxLsmRun>> inputs(first, last);
+            bool bottom = last == runs_.end();
+            lock.unlock();
+            std::shared_ptr<IxLsmRun> run;
+            {
+                IxLsmMergeIter iter(key_len_ + IX_RID_SUFFIX_LEN);
+                for (auto &input : inputs) {
+                    iter.add_run(input, input->ih->leaf_begin(), input->ih->leaf_end(), buffer_pool_manager_);
+                }
+                iter.start();
+                run = write_run(iter, level + 1, bottom);
+            }
+            lock.lock();
+            auto pos = std::find(runs_.begin(), runs_.end(), inputs.front());
+            pos = runs_.erase(pos, pos + inputs.size());
+            if (run != nullptr) {
+                runs_.insert(pos, std::move(run));
+            }
+            save_manifest();
+            // 没有扫描在使用时，旧的run在这里关闭并删除
+            for (auto &input : inputs) {
+                input->obsolete = true;
+            }
+            inputs.clear();
+            done_cv_.notify_all();
+            continue;
+        }
+        if (stop_) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 在持有共享latch_时取快照：当前memtable仍在写入，拷贝其中范围内的项；
+ * 不可变memtable和run不会再修改，只持有引用
+ */
+IxLsmScan::IxLsmScan(IxLsmHandle *ih, const IxLsmBound &lower, const IxLsmBound &upper)
+    : ih_(ih), iter_(ih->key_len_ + IX_RID_SUFFIX_LEN) {
+    std::string lo = lower.key.empty() ? std::string() : ih->bound_entry(lower);
+    std::string hi = upper.key.empty() ? std::string() : ih->bound_entry(upper);
+    if (!lo.empty() && !hi.empty() && lo >= hi) {
+        iter_.start();  // 范围为空
+        return;
+    }
+    auto range = [&](const IxLsmMemtable &mem) {
+        return std::make_pair(lo.empty() ? mem.begin() : mem.lower_bound(lo),
+                              hi.empty() ? mem.end() : mem.lower_bound(hi));
+    };
+    std::vector<std::shared_ptr<IxLsmRun>> runs;
+    {
+        std::shared_lock<std::shared_mutex> lock(ih->latch_);
+        auto [begin, end] = range(*ih->mem_);
+        auto copy = std::make_shared<const IxLsmMemtable>(begin, end);
+        iter_.add_memtable(copy, copy->begin(), copy->end());
+        for (auto &mem : ih->imm_) {
+            auto [imm_begin, imm_end] = range(*mem);
+            iter_.add_memtable(mem, imm_begin, imm_end);
+        }
+        runs = ih->runs_;
+    }
+    for (auto &run : runs) {
+        IxIndexHandle *run_ih = run->ih.get();
+        auto locate = [&](const IxLsmBound &bound, const Iid &unbounded) {
+            if (bound.key.empty()) {
+                return unbounded;
+            }
+            return bound.after ? run_ih->upper_bound(bound.key.data()) : run_ih->lower_bound(bound.key.data());
+        };
+        iter_.add_run(run, locate(lower, run_ih->leaf_begin()), locate(upper, run_ih->leaf_end()),
+                      ih->buffer_pool_manager_);
+    }
+    iter_.start();
+    seek_live();
+}
+
+void IxLsmScan::next() {
+    iter_.next();
+    seek_live();
+}
+
+/* 跳过删除标记 */
+void IxLsmScan::seek_live() {
+    while (!iter_.is_end() && iter_.tombstone()) {
+        iter_.next();
+    }
+    if (!iter_.is_end()) {
+        rid_ = decode_rid(iter_.key(), ih_->key_len_);
+    }
+}
@@ -0,0 +1,233 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ix_defs.h"
+#include "ix_index_handle.h"
+#include "ix_scan.h"
+#include "transaction/transaction.h"
+
+/*
+ * 写优化的LSM索引：插入和删除只修改内存中的有序memtable，不访问磁盘页面
+ * - memtable中的项数达到上限时转为不可变memtable，由后台线程按顺序写成一个不可变的run
+ * - run是一个自底向上批量构建、填满结点的B+树文件，每一项的key为(key, rid)，之后的INCLUDE列是删除标记
+ * - 删除写入删除标记，覆盖更旧的memtable和run中相同的(key, rid)；合并到最底层时删除标记和被覆盖的项一起丢弃
+ * - 分层合并：写出的run在第0层，同一层的run达到IX_LSM_MERGE_FANIN个时由后台线程合并为下一层的一个run
+ * - 清单文件记录列的布局和当前所有的run，每次写出或合并run之后整体重写；memtable只在关闭索引时写出
+ * 读取时多路归并memtable和所有run，同一个(key, rid)以最新的版本为准
+ */
+
+constexpr size_t IX_LSM_MEMTABLE_ENTRIES = 1 << 16;     // memtable中的项数达到之后转为不可变memtable
+constexpr size_t IX_LSM_MAX_IMMUTABLE = 4;              // 等待写出的不可变memtable达到这个数量时，插入等待后台线程
+constexpr int IX_LSM_MERGE_FANIN = 4;                   // 同一层的run达到这个数量时合并为下一层的一个run
+constexpr double IX_LSM_FILL_FACTOR = 1.0;              // run不会再插入，结点全部填满
+constexpr int IX_LSM_FLAG_LEN = sizeof(int);            // run中删除标记的长度
+
+/* memtable：规范化编码的(key, rid) -> 是否为删除标记，std::string的字节序就是(key, rid)的顺序 */
+using IxLsmMemtable = std::map<std::string, bool>;
+
+/* 清单中记录的一个run */
+struct IxLsmRunMeta {
+    int id;                     // run的编号，决定文件名
+    int level;                  // 所在的层，写出memtable得到的run在第0层
+    long long num_entries;      // 项数，包括删除标记
+};
+
+/* LSM索引的清单文件 */
+struct IxLsmManifest {
+    std::vector<ColType> col_types;     // 索引字段的类型，不包括rid
+    std::vector<int> col_lens;
+    int next_run_id = 0;
+    std::vector<IxLsmRunMeta> runs;     // 从新到旧
+
+    void load(const std::string &path);
+
+    /* 先写临时文件再改名，写到一半时清单文件仍然完整 */
+    void save(const std::string &path) const;
+};
+
+/* LSM索引的扫描边界：位于key的所有项之前(lower_bound)或之后(upper_bound)，key为空表示索引的开头或结尾 */
+struct IxLsmBound {
+    std::string key;        // 原始key
+    bool after = false;     // 位于key的所有项之后
+};
+
+class IxManager;
+
+/* 打开的一个run，被合并之后仍然可以被进行中的扫描使用，最后一个引用释放时关闭并删除文件 */
+struct IxLsmRun {
+    IxLsmRunMeta meta;
+    std::string file_name;
+    IxManager *ix_manager;
+    DiskManager *disk_manager;
+    std::unique_ptr<IxIndexHandle> ih;
+    std::atomic<bool> obsolete{false};  // 已经被合并到新的run中
+
+    ~IxLsmRun();
+};
+
+/*
+ * 按(key, rid)的顺序多路归并若干个有序的来源，同一个(key, rid)只返回最新来源中的版本，
+ * 来源按从新到旧的顺序添加；当前项可能是删除标记，由调用者决定是否跳过
+ */
+class IxLsmMergeIter {
+   public:
+    explicit IxLsmMergeIter(int key_len) : key_len_(key_len) {}
+
+    /* [begin, end)范围内的memtable项，mem保证迭代器在归并期间有效 */
+    void add_memtable(std::shared_ptr<const IxLsmMemtable> mem, IxLsmMemtable::const_iterator begin,
+                      IxLsmMemtable::const_iterator end);
+
+    /* run中[lower, upper)范围内的项，run在归并期间保持打开 */
+    void add_run(std::shared_ptr<IxLsmRun> run, const Iid &lower, const Iid &upper, BufferPoolManager *bpm);
+
+    /* 所有来源添加完成之后定位到第一项 */
+    void start() { advance(); }
+
+    bool is_end() const { return end_; }
+
+    /* 当前项规范化编码的(key, rid) */
+    const std::string &key() const { return key_; }
+
+    bool tombstone() const { return tombstone_; }
+
+    void next() { advance(); }
+
+   private:
+    struct Source {
+        std::shared_ptr<const IxLsmMemtable> mem;
+        IxLsmMemtable::const_iterator it, end;
+        std::shared_ptr<IxLsmRun> run;
+        std::unique_ptr<IxScan> scan;
+        std::string key;                // 当前项规范化编码的(key, rid)
+        bool tombstone = false;
+        bool done = false;
+    };
+
+    void load(Source &src);
+
+    void advance();
+
+    int key_len_;                       // 规范化编码的(key, rid)的长度
+    std::vector<Source> sources_;       // 从新到旧
+    std::string key_;
+    bool tombstone_ = false;
+    bool end_ = false;
+};
+
+/* LSM索引，实现IxIndex接口，并提供与B+树相同的lower_bound/upper_bound/leaf_begin/leaf_end供IxLsmScan使用 */
+class IxLsmHandle : public IxIndex {
+    friend class IxLsmScan;
+
+   public:
+    IxLsmHandle(IxManager *ix_manager, DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+                std::string name);
+
+    ~IxLsmHandle() override;
+
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) override;
+
+    /* 只写入memtable，不检查(key, rid)是否已经存在；memtable没有页面，返回0 */
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) override;
+
+    /* 写入删除标记，不检查(key, rid)是否存在，总是返回true */
+    bool delete_entry(const char *key, const Rid &rid, Transaction *transaction) override;
+
+    IxLsmBound lower_bound(const char *key) const { return {std::string(key, key_len_), false}; }
+
+    IxLsmBound upper_bound(const char *key) const { return {std::string(key, key_len_), true}; }
+
+    IxLsmBound leaf_begin() const { return {}; }
+
+    IxLsmBound leaf_end() const { return {}; }
+
+    /* 把当前memtable转为不可变memtable，等待后台线程把它们全部写成run并完成合并 */
+    void flush();
+
+    /* flush之后停止后台线程，写回清单并关闭所有run，之后不能再使用 */
+    void close();
+
+    /* 之后的memtable达到多少项时转为不可变memtable */
+    void set_memtable_entries(size_t entries) { memtable_entries_ = entries; }
+
+    /* 当前所有run的清单，从新到旧 */
+    std::vector<IxLsmRunMeta> get_runs();
+
+    int get_key_len() const { return key_len_; }
+
+    static std::string run_file_name(const std::string &name, int run_id) {
+        return name + "." + std::to_string(run_id);
+    }
+
+   private:
+    std::string make_entry(const char *key, const Rid &rid) const;
+
+    std::string bound_entry(const IxLsmBound &bound) const;
+
+    void put(const char *key, const Rid &rid, bool tombstone);
+
+    std::shared_ptr<IxLsmRun> open_run(const IxLsmRunMeta &meta);
+
+    std::shared_ptr<IxLsmRun> write_run(IxLsmMergeIter &iter, int level, bool drop_tombstones);
+
+    int compact_level() const;
+
+    void save_manifest();
+
+    void background_work();
+
+    IxManager *ix_manager_;
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    std::string name_;                          // 清单文件名
+    IxFileHdr hdr_;                             // run的列布局：索引字段、rid和删除标记，用于规范化编码
+    int key_len_;                               // 原始key的长度
+    size_t memtable_entries_ = IX_LSM_MEMTABLE_ENTRIES;
+    int next_run_id_;
+
+    std::shared_ptr<IxLsmMemtable> mem_;                    // 接受写入的memtable
+    std::deque<std::shared_ptr<const IxLsmMemtable>> imm_;  // 等待写出的不可变memtable，从新到旧
+    std::vector<std::shared_ptr<IxLsmRun>> runs_;           // 从新到旧，层号不减
+    std::shared_mutex latch_;                   // 保护memtable、imm_和runs_
+    std::condition_variable_any work_cv_;       // 有不可变memtable或需要合并时唤醒后台线程
+    std::condition_variable_any done_cv_;       // 后台线程写出或合并完成一个run时唤醒等待者
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+/* 扫描LSM索引中[lower, upper)范围内的项：开始时取memtable和run的快照，之后的写入不影响扫描 */
+class IxLsmScan : public RecScan {
+   public:
+    IxLsmScan(IxLsmHandle *ih, const IxLsmBound &lower, const IxLsmBound &upper);
+
+    void next() override;
+
+    bool is_end() const override { return iter_.is_end(); }
+
+    Rid rid() const override { return rid_; }
+
+   private:
+    void seek_live();
+
+    IxLsmHandle *ih_;
+    IxLsmMergeIter iter_;
+    Rid rid_;
+};
@@ -11,16 +11,22 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include <memory>
+#include <numeric>
 #include <string>
 
 #include "system/sm_meta.h"
 #include "ix_defs.h"
 #include "ix_index_handle.h"
+#include "ix_hash.h"
+#include "ix_lsm.h"
 
 class IxManager {
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
+    IxKeyCacheOptions key_cache_options_;   // 打开B+树索引时使用的key缓存配置
+    bool lazy_merge_ = false;               // 打开B+树索引时是否开启延迟合并
+    size_t inner_cache_budget_ = IX_INNER_CACHE_DEFAULT_BUDGET;  // 打开B+树索引时内部结点缓存的内存预算
 
    public:
     IxManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
@@ -44,9 +50,31 @@ class IxManager {
         return index_name;
     }
 
+    /* 哈希索引的文件名，与同样字段上的B+树索引区分 */
+    std::string get_hash_index_name(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string index_name = filename;
+        for(size_t i = 0; i < index_cols.size(); ++i) 
+            index_name += "_" + index_cols[i].name;
+        index_name += ".hash";
+
+        return index_name;
+    }
+
+    /* LSM索引清单文件的文件名，各个run的文件名为清单文件名之后加上".<run编号>" */
+    std::string get_lsm_index_name(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string index_name = filename;
+        for(size_t i = 0; i < index_cols.size(); ++i) 
+            index_name += "_" + index_cols[i].name;
+        index_name += ".lsm";
+
+        return index_name;
+    }
+
+    /* 同样的字段上只能有一个索引，不论是B+树、哈希还是LSM索引 */
     bool exists(const std::string &filename, const std::vector<ColMeta>& index_cols) {
         auto ix_name = get_index_name(filename, index_cols);
-        return disk_manager_->is_file(ix_name);
+        return disk_manager_->is_file(ix_name) || disk_manager_->is_file(get_hash_index_name(filename, index_cols)) ||
+               disk_manager_->is_file(get_lsm_index_name(filename, index_cols));
     }
 
     bool exists(const std::string &filename, const std::vector<std::string>& index_cols) {
@@ -54,8 +82,41 @@ class IxManager {
         return disk_manager_->is_file(ix_name);
     }
 
-    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
-        std::string ix_name = get_index_name(filename, index_cols);
+    /**
+     * @brief 创建索引文件
+     * @param format_version 索引文件格式的版本，默认为唯一索引的格式，非唯一索引使用IX_FORMAT_DUPLICATE_KEYS，
+     * 测试时可以指定旧格式进行对比
+     * @param include_cols INCLUDE列，只存放在索引项中，要求格式允许重复key
+     */
+    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols,
+                      int format_version = IX_FORMAT_VERSION, const std::vector<ColMeta> &include_cols = {}) {
+        std::vector<ColType> col_types;
+        std::vector<int> col_lens;
+        for(auto& col: index_cols) {
+            col_types.push_back(col.type);
+            col_lens.push_back(col.len);
+        }
+        if (format_version >= IX_FORMAT_DUPLICATE_KEYS) {
+            // 允许重复key的索引把rid作为两个INT列追加在key之后
+            col_types.insert(col_types.end(), 2, TYPE_INT);
+            col_lens.insert(col_lens.end(), 2, static_cast<int>(sizeof(int)));
+        }
+        assert(include_cols.empty() || format_version >= IX_FORMAT_DUPLICATE_KEYS);
+        for (auto &col : include_cols) {
+            col_types.push_back(col.type);
+            col_lens.push_back(col.len);
+        }
+        create_index_file(get_index_name(filename, index_cols), col_types, col_lens, format_version,
+                          static_cast<int>(include_cols.size()));
+    }
+
+    /**
+     * @brief 按给定的列布局创建B+树索引文件
+     * @param col_types 存储的所有列，允许重复key的格式已经包括rid列，INCLUDE列排在最后
+     * @param include_num 末尾INCLUDE列的个数
+     */
+    void create_index_file(const std::string &ix_name, const std::vector<ColType> &col_types,
+                           const std::vector<int> &col_lens, int format_version, int include_num) {
         // Create index file
         disk_manager_->create_file(ix_name);
         // Open index file
@@ -66,25 +127,29 @@ class IxManager {
         // but we reserve one slot for convenient inserting and deleting, i.e.
         // |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE
         int col_tot_len = 0;
-        int col_num = index_cols.size();
-        for(auto& col: index_cols) {
-            col_tot_len += col.len;
+        int col_num = col_types.size();
+        for(int len: col_lens) {
+            col_tot_len += len;
         }
         if (col_tot_len > IX_MAX_COL_LEN) {
             throw InvalidColLengthError(col_tot_len);
         }
-        // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
+        // 根据 |page_hdr| + |high_key| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
         // 即 n <= btree_order，那么btree_order就是每个结点最多可插入的键值对数量（实际还多留了一个空位，但其不可插入）
-        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (col_tot_len + sizeof(Rid)) - 1);
+        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr) - col_tot_len) / (col_tot_len + sizeof(Rid)) - 1);
         assert(btree_order > 2);
 
         // Create file header and write to file
         IxFileHdr* fhdr = new IxFileHdr(IX_NO_PAGE, IX_INIT_NUM_PAGES, IX_INIT_ROOT_PAGE,
                                 col_num, col_tot_len, btree_order, (btree_order + 1) * col_tot_len,
                                 IX_INIT_ROOT_PAGE, IX_INIT_ROOT_PAGE);
-        for(int i = 0; i < col_num; ++i) {
-            fhdr->col_types_.push_back(index_cols[i].type);
-            fhdr->col_lens_.push_back(index_cols[i].len);
+        fhdr->format_version_ = format_version;
+        fhdr->include_num_ = include_num;
+        fhdr->col_types_ = col_types;
+        fhdr->col_lens_ = col_lens;
+        if (fhdr->compressed_nodes()) {
+            // 压缩结点的容量取决于结点中key的编码，btree_order只作为上限，取key完全被前缀覆盖时的容量
+            fhdr->btree_order_ = (PAGE_SIZE - IxNodeHandle::entries_offset(fhdr)) / IxNodeHandle::entry_size(0) - 1;
         }
         fhdr->update_tot_len();
         
@@ -105,8 +170,13 @@ class IxManager {
                 .parent = IX_NO_PAGE,
                 .num_key = 0,
                 .is_leaf = true,
+                .prefix_len = 0,
                 .prev_leaf = IX_INIT_ROOT_PAGE,
                 .next_leaf = IX_INIT_ROOT_PAGE,
+                .has_high_key = false,
+                .key_len = 0,
+                .right_sibling = IX_NO_PAGE,
+                .level = 0,
             };
             disk_manager_->write_page(fd, IX_LEAF_HEADER_PAGE, page_buf, PAGE_SIZE);
         }
@@ -120,8 +190,13 @@ class IxManager {
                 .parent = IX_NO_PAGE,
                 .num_key = 0,
                 .is_leaf = true,
+                .prefix_len = 0,
                 .prev_leaf = IX_LEAF_HEADER_PAGE,
                 .next_leaf = IX_LEAF_HEADER_PAGE,
+                .has_high_key = false,
+                .key_len = 0,
+                .right_sibling = IX_NO_PAGE,
+                .level = 0,
             };
             // Must write PAGE_SIZE here in case of future fetch_node()
             disk_manager_->write_page(fd, IX_INIT_ROOT_PAGE, page_buf, PAGE_SIZE);
@@ -145,23 +220,144 @@ class IxManager {
 
     // 注意这里打开文件，创建并返回了index file handle的指针
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
-        std::string ix_name = get_index_name(filename, index_cols);
-        int fd = disk_manager_->open_file(ix_name);
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        return open_index_file(get_index_name(filename, index_cols));
     }
 
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<std::string>& index_cols) {
-        std::string ix_name = get_index_name(filename, index_cols);
+        return open_index_file(get_index_name(filename, index_cols));
+    }
+
+    /**
+     * @brief 打开B+树索引文件；文件头中没有格式版本或版本未知时关闭文件并抛出异常，
+     * 这样的文件的页面布局可能与当前不同(见IX_FORMAT_UNVERSIONED)，按当前布局读取会读错每一个结点
+     */
+    std::unique_ptr<IxIndexHandle> open_index_file(const std::string &ix_name) {
         int fd = disk_manager_->open_file(ix_name);
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        auto ih = std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        if (!ih->file_hdr_->supported_format()) {
+            int version = ih->file_hdr_->format_version_;
+            disk_manager_->close_file(fd);
+            throw IndexFormatVersionError(ix_name, version);
+        }
+        ih->enable_key_cache(key_cache_options_);
+        ih->set_lazy_merge(lazy_merge_);
+        ih->set_inner_cache_budget(inner_cache_budget_);
+        return ih;
     }
 
-    void close_index(const IxIndexHandle *ih) {
+    /* 之后打开的B+树索引使用的key缓存配置，默认不开启；单个索引可以用IxIndexHandle::enable_key_cache单独配置 */
+    void set_key_cache_options(const IxKeyCacheOptions &options) { key_cache_options_ = options; }
+
+    const IxKeyCacheOptions &get_key_cache_options() const { return key_cache_options_; }
+
+    /* 之后打开的B+树索引是否开启延迟合并(删除只修改叶子，欠满的叶子由后台线程整理)，默认不开启 */
+    void set_lazy_merge(bool lazy) { lazy_merge_ = lazy; }
+
+    bool get_lazy_merge() const { return lazy_merge_; }
+
+    /* 之后打开的B+树索引最多缓存多少字节的内部结点，0表示不缓存，下降时每一层都访问缓冲池 */
+    void set_inner_cache_budget(size_t budget) { inner_cache_budget_ = budget; }
+
+    size_t get_inner_cache_budget() const { return inner_cache_budget_; }
+
+    void close_index(IxIndexHandle *ih) {
+        // 先停止后台整理线程并整理等待中的叶子，之后才能把页面刷到磁盘
+        ih->set_lazy_merge(false);
         char* data = new char[ih->file_hdr_->tot_len_];
         ih->file_hdr_->serialize(data);
         disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, data, ih->file_hdr_->tot_len_);
-        // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
-        buffer_pool_manager_->flush_all_pages(ih->fd_);
+        // 缓冲区的所有页刷到磁盘并移出缓冲池，注意这句话必须写在close_file前面
+        buffer_pool_manager_->remove_all_pages(ih->fd_);
+        disk_manager_->close_file(ih->fd_);
+    }
+
+    /**
+     * @brief 创建哈希索引文件：文件头、一个目录页和一个空桶，全局深度为0
+     */
+    void create_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        IxHashFileHdr hdr;
+        for (auto &col : index_cols) {
+            hdr.col_types_.push_back(col.type);
+            hdr.col_lens_.push_back(col.len);
+            hdr.key_len_ += col.len;
+        }
+        if (hdr.key_len_ > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(hdr.key_len_);
+        }
+        hdr.bucket_capacity_ = static_cast<int>((PAGE_SIZE - sizeof(IxHashBucketHdr)) / (hdr.key_len_ + sizeof(Rid)));
+        hdr.dir_pages_ = {IX_HASH_INIT_DIR_PAGE};
+
+        std::string ix_name = get_hash_index_name(filename, index_cols);
+        disk_manager_->create_file(ix_name);
+        int fd = disk_manager_->open_file(ix_name);
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        hdr.serialize(page_buf);
+        disk_manager_->write_page(fd, IX_HASH_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<page_id_t *>(page_buf) = IX_HASH_INIT_BUCKET_PAGE;
+        disk_manager_->write_page(fd, IX_HASH_INIT_DIR_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<IxHashBucketHdr *>(page_buf) = {.local_depth = 0, .num_entries = 0, .overflow = IX_NO_PAGE};
+        disk_manager_->write_page(fd, IX_HASH_INIT_BUCKET_PAGE, page_buf, PAGE_SIZE);
+        disk_manager_->close_file(fd);
+    }
+
+    void destroy_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        disk_manager_->destroy_file(get_hash_index_name(filename, index_cols));
+    }
+
+    std::unique_ptr<IxHashHandle> open_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        int fd = disk_manager_->open_file(get_hash_index_name(filename, index_cols));
+        return std::make_unique<IxHashHandle>(disk_manager_, buffer_pool_manager_, fd);
+    }
+
+    void close_hash_index(IxHashHandle *ih) {
+        ih->flush_directory();
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        ih->file_hdr_.serialize(page_buf);
+        disk_manager_->write_page(ih->fd_, IX_HASH_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        buffer_pool_manager_->remove_all_pages(ih->fd_);
         disk_manager_->close_file(ih->fd_);
     }
-};
\ No newline at end of file
+
+    /**
+     * @brief 创建LSM索引：只写一个没有run的清单文件，run在memtable写满之后由后台线程创建
+     */
+    void create_lsm_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        IxLsmManifest manifest;
+        for (auto &col : index_cols) {
+            manifest.col_types.push_back(col.type);
+            manifest.col_lens.push_back(col.len);
+        }
+        int key_len = std::accumulate(manifest.col_lens.begin(), manifest.col_lens.end(), 0);
+        if (key_len + IX_RID_SUFFIX_LEN + IX_LSM_FLAG_LEN > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(key_len + IX_RID_SUFFIX_LEN + IX_LSM_FLAG_LEN);
+        }
+        std::string ix_name = get_lsm_index_name(filename, index_cols);
+        disk_manager_->create_file(ix_name);
+        manifest.save(ix_name);
+    }
+
+    /* 删除清单文件和其中记录的所有run，索引必须已经关闭 */
+    void destroy_lsm_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string ix_name = get_lsm_index_name(filename, index_cols);
+        IxLsmManifest manifest;
+        manifest.load(ix_name);
+        for (auto &run : manifest.runs) {
+            disk_manager_->destroy_file(IxLsmHandle::run_file_name(ix_name, run.id));
+        }
+        disk_manager_->destroy_file(ix_name);
+    }
+
+    std::unique_ptr<IxLsmHandle> open_lsm_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        return std::make_unique<IxLsmHandle>(this, disk_manager_, buffer_pool_manager_,
+                                             get_lsm_index_name(filename, index_cols));
+    }
+
+    /* 把memtable写成run、等待后台合并结束，然后写回清单并关闭所有run */
+    void close_lsm_index(IxLsmHandle *ih) { ih->close(); }
+};
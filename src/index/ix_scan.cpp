@@ -10,24 +10,61 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_scan.h"
 
+IxScan::IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool with_keys)
+    : ih_(ih), iid_(lower), end_(upper), bpm_(bpm), with_keys_(with_keys) {
+    load_leaf();
+}
+
 /**
- * @brief 
- * @todo 加上读锁（需要使用缓冲池得到page）
+ * @brief 移动到下一项，当前叶子的批缓冲读完时读取右兄弟
  */
 void IxScan::next() {
     assert(!is_end());
-    IxNodeHandle *node = ih_->fetch_node(iid_.page_no);
-    assert(node->is_leaf_page());
-    assert(iid_.slot_no < node->get_size());
-    // increment slot no
+    pos_++;
     iid_.slot_no++;
-    if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == node->get_size()) {
-        // go to next leaf
-        iid_.slot_no = 0;
-        iid_.page_no = node->get_next_leaf();
+    if (pos_ < rids_.size()) {
+        return;
     }
+    if (iid_.page_no == end_.page_no || next_leaf_ == IX_LEAF_HEADER_PAGE) {
+        iid_ = end_;
+        return;
+    }
+    iid_ = {.page_no = next_leaf_, .slot_no = 0};
+    load_leaf();
 }
 
-Rid IxScan::rid() const {
-    return ih_->get_rid(iid_);
-}
\ No newline at end of file
+/**
+ * @brief 把iid_所在叶子中位于范围内的项拷贝到批缓冲中，跳过范围内没有项的叶子
+ * @note 读取叶子结点时加读锁，拷贝完之后释放读锁并unpin
+ */
+void IxScan::load_leaf() {
+    int key_len = ih_->file_hdr_->col_tot_len_;
+    while (!is_end()) {
+        rids_.clear();
+        keys_.clear();
+        pos_ = 0;
+        {
+            IxNodeGuard node = ih_->fetch_node(iid_.page_no);
+            node.rlatch();
+            assert(node->is_leaf_page());
+            int limit = iid_.page_no == end_.page_no ? std::min(end_.slot_no, node->get_size()) : node->get_size();
+            for (int slot_no = iid_.slot_no; slot_no < limit; ++slot_no) {
+                rids_.push_back(*node->get_rid(slot_no));
+                if (with_keys_) {
+                    keys_.resize(keys_.size() + key_len);
+                    ih_->decode_key(node.get(), slot_no, keys_.data() + keys_.size() - key_len);
+                }
+            }
+            next_leaf_ = node->get_next_leaf();
+        }
+        if (!rids_.empty()) {
+            return;
+        }
+        // 当前叶子中没有范围内的项
+        if (iid_.page_no == end_.page_no || next_leaf_ == IX_LEAF_HEADER_PAGE) {
+            iid_ = end_;
+            return;
+        }
+        iid_ = {.page_no = next_leaf_, .slot_no = 0};
+    }
+}
@@ -10,29 +10,43 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <vector>
+
 #include "ix_defs.h"
 #include "ix_index_handle.h"
 
-// class IxIndexHandle;
-
-// 用于遍历叶子结点
-// 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
-// TODO：对page遍历时，要加上读锁
+/*
+ * 按key的顺序遍历[lower, upper)范围内的叶子项
+ * 每到一个叶子只固定并加读锁一次，把该叶子在范围内的所有rid(以及需要时解码之后的key)拷贝到批缓冲中，
+ * 随即释放读锁并unpin，之后的next()/rid()只访问批缓冲，读完之后再转到右兄弟
+ */
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
-    Iid iid_;  // 初始为lower（用于遍历的指针）
+    Iid iid_;  // 当前项的位置，初始为lower
     Iid end_;  // 初始为upper
     BufferPoolManager *bpm_;
+    bool with_keys_;                // 是否同时拷贝解码之后的key，只访问索引的扫描需要
+
+    std::vector<Rid> rids_;         // 当前叶子中从iid_开始、位于范围内的项的rid
+    std::vector<char> keys_;        // 与rids_一一对应的解码之后的key，每个col_tot_len_字节
+    size_t pos_ = 0;                // 当前项在批缓冲中的下标
+    page_id_t next_leaf_;           // 当前叶子的右兄弟
 
    public:
-    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm)
-        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {}
+    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm,
+           bool with_keys = false);
 
     void next() override;
 
     bool is_end() const override { return iid_ == end_; }
 
-    Rid rid() const override;
+    Rid rid() const override { return rids_[pos_]; }
+
+    /* 当前项解码之后的key，布局与IxIndexHandle::get_entry相同，只能在with_keys为true时使用 */
+    const char *key() const { return keys_.data() + pos_ * ih_->file_hdr_->col_tot_len_; }
 
     const Iid &iid() const { return iid_; }
-};
\ No newline at end of file
+
+   private:
+    void load_leaf();
+};
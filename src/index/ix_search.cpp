@@ -0,0 +1,224 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_search.h"
+
+#include <cstring>
+
+#include "ix_index_handle.h"
+#include "ix_key.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define IX_HAVE_AVX2_KERNEL 1
+#else
+#define IX_HAVE_AVX2_KERNEL 0
+#endif
+
+namespace {
+
+/* 各种key布局的比较策略，cmp返回值的含义与ix_compare相同 */
+struct IxIntKey {
+    static int cmp(const char *a, const char *b, const IxFileHdr *) {
+        int ia, ib;
+        memcpy(&ia, a, sizeof(int));
+        memcpy(&ib, b, sizeof(int));
+        return (ia > ib) - (ia < ib);
+    }
+};
+
+struct IxFloatKey {
+    static int cmp(const char *a, const char *b, const IxFileHdr *) {
+        float fa, fb;
+        memcpy(&fa, a, sizeof(float));
+        memcpy(&fb, b, sizeof(float));
+        return (fa > fb) - (fa < fb);
+    }
+};
+
+struct IxCharKey {
+    static int cmp(const char *a, const char *b, const IxFileHdr *hdr) { return memcmp(a, b, hdr->col_tot_len_); }
+};
+
+struct IxNormalizedKey {
+    static int cmp(const char *a, const char *b, const IxFileHdr *hdr) {
+        int len = hdr->col_tot_len_;
+        if (len >= 8) {
+            // 大端序的前缀转换为整数之后的大小关系与memcmp相同，大多数比较在前缀处就能得出结果
+            uint64_t pa, pb;
+            memcpy(&pa, a, sizeof(uint64_t));
+            memcpy(&pb, b, sizeof(uint64_t));
+            pa = __builtin_bswap64(pa);
+            pb = __builtin_bswap64(pb);
+            if (pa != pb) {
+                return pa < pb ? -1 : 1;
+            }
+            return memcmp(a + 8, b + 8, len - 8);
+        }
+        if (len == 4) {
+            uint32_t ua = ix_load_be32(a), ub = ix_load_be32(b);
+            return (ua > ub) - (ua < ub);
+        }
+        return memcmp(a, b, len);
+    }
+};
+
+struct IxGenericKey {
+    static int cmp(const char *a, const char *b, const IxFileHdr *hdr) {
+        return ix_compare(a, b, hdr->col_types_, hdr->col_lens_);
+    }
+};
+
+/**
+ * @brief 无分支二分查找：返回keys[0,num)中第一个 > target(Upper) 或 >= target(!Upper) 的下标
+ * 每轮只根据比较结果选择base，不产生难以预测的分支
+ */
+template <typename Key, bool Upper>
+int ix_search_binary(const IxFileHdr *hdr, const char *keys, int num, const char *target) {
+    if (num <= 0) {
+        return 0;
+    }
+    const int stride = hdr->col_tot_len_;
+    int base = 0;
+    int len = num;
+    while (len > 1) {
+        int half = len / 2;
+        int res = Key::cmp(keys + (base + half) * stride, target, hdr);
+        base = (Upper ? res <= 0 : res < 0) ? base + half : base;
+        len -= half;
+    }
+    int res = Key::cmp(keys + base * stride, target, hdr);
+    return base + (Upper ? res <= 0 : res < 0);
+}
+
+#if IX_HAVE_AVX2_KERNEL
+/**
+ * @brief AVX2线性查找：key有序，因此满足 key < target(或 key <= target) 的key数量就是目标下标
+ * key数量较多时退化为无分支二分查找
+ */
+template <bool Upper>
+__attribute__((target("avx2"))) int ix_search_int_avx2(const IxFileHdr *hdr, const char *keys, int num,
+                                                         const char *target) {
+    if (num > IX_LINEAR_SEARCH_MAX) {
+        return ix_search_binary<IxIntKey, Upper>(hdr, keys, num, target);
+    }
+    int t;
+    memcpy(&t, target, sizeof(int));
+    const __m256i vt = _mm256_set1_epi32(t);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= num; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i * sizeof(int)));
+        // Upper统计key <= target，即!(key > target)；否则统计key < target
+        __m256i mask = Upper ? _mm256_cmpgt_epi32(v, vt) : _mm256_cmpgt_epi32(vt, v);
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+        count += Upper ? 8 - __builtin_popcount(bits) : __builtin_popcount(bits);
+    }
+    for (; i < num; ++i) {
+        int res = IxIntKey::cmp(keys + i * sizeof(int), target, hdr);
+        count += Upper ? res <= 0 : res < 0;
+    }
+    return count;
+}
+
+template <bool Upper>
+__attribute__((target("avx2"))) int ix_search_float_avx2(const IxFileHdr *hdr, const char *keys, int num,
+                                                           const char *target) {
+    if (num > IX_LINEAR_SEARCH_MAX) {
+        return ix_search_binary<IxFloatKey, Upper>(hdr, keys, num, target);
+    }
+    float t;
+    memcpy(&t, target, sizeof(float));
+    const __m256 vt = _mm256_set1_ps(t);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= num; i += 8) {
+        __m256 v = _mm256_loadu_ps(reinterpret_cast<const float *>(keys + i * sizeof(float)));
+        __m256 mask = Upper ? _mm256_cmp_ps(v, vt, _CMP_LE_OQ) : _mm256_cmp_ps(v, vt, _CMP_LT_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(mask));
+    }
+    for (; i < num; ++i) {
+        int res = IxFloatKey::cmp(keys + i * sizeof(float), target, hdr);
+        count += Upper ? res <= 0 : res < 0;
+    }
+    return count;
+}
+
+#endif
+
+bool ix_cpu_has_avx2() {
+#if IX_HAVE_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+}  // namespace
+
+IxKeyLayout ix_key_layout(const IxFileHdr *hdr) {
+    if (hdr->normalized_keys()) {
+        return IxKeyLayout::NORMALIZED;
+    }
+    if (hdr->col_num_ != 1) {
+        return IxKeyLayout::GENERIC;
+    }
+    switch (hdr->col_types_[0]) {
+        case TYPE_INT:
+            return hdr->col_lens_[0] == sizeof(int) ? IxKeyLayout::INT : IxKeyLayout::GENERIC;
+        case TYPE_FLOAT:
+            return hdr->col_lens_[0] == sizeof(float) ? IxKeyLayout::FLOAT : IxKeyLayout::GENERIC;
+        case TYPE_STRING:
+        case TYPE_VARCHAR:
+            return IxKeyLayout::CHAR;
+        default:
+            return IxKeyLayout::GENERIC;
+    }
+}
+
+void ix_init_search_kernels(IxFileHdr *hdr, IxKeyLayout layout) {
+    switch (layout) {
+        case IxKeyLayout::INT:
+#if IX_HAVE_AVX2_KERNEL
+            if (ix_cpu_has_avx2()) {
+                hdr->lower_bound_fn_ = ix_search_int_avx2<false>;
+                hdr->upper_bound_fn_ = ix_search_int_avx2<true>;
+                break;
+            }
+#endif
+            hdr->lower_bound_fn_ = ix_search_binary<IxIntKey, false>;
+            hdr->upper_bound_fn_ = ix_search_binary<IxIntKey, true>;
+            break;
+        case IxKeyLayout::FLOAT:
+#if IX_HAVE_AVX2_KERNEL
+            if (ix_cpu_has_avx2()) {
+                hdr->lower_bound_fn_ = ix_search_float_avx2<false>;
+                hdr->upper_bound_fn_ = ix_search_float_avx2<true>;
+                break;
+            }
+#endif
+            hdr->lower_bound_fn_ = ix_search_binary<IxFloatKey, false>;
+            hdr->upper_bound_fn_ = ix_search_binary<IxFloatKey, true>;
+            break;
+        case IxKeyLayout::CHAR:
+            hdr->lower_bound_fn_ = ix_search_binary<IxCharKey, false>;
+            hdr->upper_bound_fn_ = ix_search_binary<IxCharKey, true>;
+            break;
+        case IxKeyLayout::NORMALIZED:
+            hdr->lower_bound_fn_ = ix_search_binary<IxNormalizedKey, false>;
+            hdr->upper_bound_fn_ = ix_search_binary<IxNormalizedKey, true>;
+            break;
+        default:
+            hdr->lower_bound_fn_ = ix_search_binary<IxGenericKey, false>;
+            hdr->upper_bound_fn_ = ix_search_binary<IxGenericKey, true>;
+            break;
+    }
+}
@@ -0,0 +1,40 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "ix_defs.h"
+
+/* 结点内key的布局，决定使用哪一种查找内核 */
+enum class IxKeyLayout {
+    GENERIC = 0,    // 多列或其他情况：逐列调用ix_compare
+    INT,            // 单列INT
+    FLOAT,          // 单列FLOAT
+    CHAR,           // 单列定长字符串，直接memcmp
+    NORMALIZED      // 规范化编码的key（见ix_key.h），先比较8字节前缀再memcmp剩余部分
+};
+
+// key数量不超过该值时，INT/FLOAT使用AVX2线性查找，否则使用无分支二分查找
+constexpr int IX_LINEAR_SEARCH_MAX = 64;
+
+/**
+ * @brief 根据索引的字段类型得到key的布局
+ */
+IxKeyLayout ix_key_layout(const IxFileHdr *hdr);
+
+/**
+ * @brief 打开索引时调用，为hdr选择结点内的lower_bound/upper_bound查找内核
+ *
+ * @param hdr 索引文件头，选择的内核保存在hdr->lower_bound_fn_/upper_bound_fn_中
+ * @param layout 使用的key布局，测试时可以传入GENERIC强制使用通用内核
+ */
+void ix_init_search_kernels(IxFileHdr *hdr, IxKeyLayout layout);
+
+inline void ix_init_search_kernels(IxFileHdr *hdr) { ix_init_search_kernels(hdr, ix_key_layout(hdr)); }
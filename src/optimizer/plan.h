@@ -24,6 +24,7 @@ typedef enum PlanTag{
     T_Help,
     T_ShowTable,
     T_DescTable,
+    T_Analyze,
     T_CreateTable,
     T_DropTable,
     T_CreateIndex,
@@ -38,6 +39,10 @@ typedef enum PlanTag{
     T_Transaction_rollback,
     T_SeqScan,
     T_IndexScan,
+    T_IndexOnlyScan,
+    T_HashIndexScan,
+    T_BitmapHeapScan,
+    T_ColumnarScan,
     T_NestLoop,
     T_Sort,
     T_Projection
@@ -74,6 +79,7 @@ class ScanPlan : public Plan
         size_t len_;                               
         std::vector<Condition> fed_conds_;
         std::vector<std::string> index_col_names_;
+        std::vector<std::vector<std::string>> bitmap_index_col_names_;     // 位图堆扫描求交的各个索引
     
 };
 
@@ -170,9 +176,15 @@ class DDLPlan : public Plan
         std::string tab_name_;
         std::vector<std::string> tab_col_names_;
         std::vector<ColDef> cols_;
+        TabStorage storage_ = STORAGE_ROW;  // create table时指定的存储方式
+        std::vector<std::vector<std::string>> index_col_names_;    // create index一次构建的各个索引的列名
+        std::vector<std::string> include_col_names_;                // create index的INCLUDE列
+        IndexType index_type_ = INDEX_BTREE;                        // create index ... using指定的索引类型
+        bool concurrently_ = false;                                 // create index concurrently，不阻塞对表的写入
+        bool unique_ = false;                                       // create unique index，不允许重复的key
 };
 
-// help; show tables; desc tables; begin; abort; commit; rollback语句对应的plan
+// help; show tables; desc tables; analyze; begin; abort; commit; rollback语句对应的plan
 class OtherPlan : public Plan
 {
     public:
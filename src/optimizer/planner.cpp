@@ -11,6 +11,7 @@ See the Mulan PSL v2 for more details. */
 #include "planner.h"
 
 #include <memory>
+#include <set>
 
 #include "execution/executor_delete.h"
 #include "execution/executor_index_scan.h"
@@ -34,6 +35,101 @@ bool Planner::get_index_cols(std::string tab_name, std::vector<Condition> curr_c
     return false;
 }
 
+/**
+ * @brief 没有被等值条件完整匹配的索引时，尝试生成位图堆扫描
+ * 第一个字段上有"字段 op 常量"条件(op不是<>)的B+树索引、每个字段上都有等值条件的哈希索引都可以参与，
+ * 执行时各个索引的rid求交之后按页面顺序访问堆表
+ * 表ANALYZE过时按统计信息估计每个索引上的条件的选择率，超过BITMAP_SCAN_MAX_SELECTIVITY的索引不参与；
+ * 没有统计信息时无法估计，认为条件足够有选择性，使用所有可用的索引
+ *
+ * @return 没有可用的索引时返回nullptr
+ */
+std::shared_ptr<Plan> Planner::make_bitmap_scan(const std::string &tab_name, const std::vector<Condition> &curr_conds) {
+    auto is_index_cond = [&](const Condition &cond, const std::string &col_name, bool eq_only) {
+        return cond.is_rhs_val && cond.lhs_col.tab_name == tab_name && cond.lhs_col.col_name == col_name &&
+               (eq_only ? cond.op == OP_EQ : cond.op != OP_NE);
+    };
+    auto has_cond = [&](const std::string &col_name, bool eq_only) {
+        return std::any_of(curr_conds.begin(), curr_conds.end(),
+                           [&](const Condition &cond) { return is_index_cond(cond, col_name, eq_only); });
+    };
+    const TabStats *stats = sm_manager_->stats_.get_table(tab_name);
+    std::vector<std::vector<std::string>> index_col_names;
+    for (auto &index : sm_manager_->db_.get_table(tab_name).indexes) {
+        bool usable;
+        bool eq_only = index.type == INDEX_HASH;
+        if (eq_only) {
+            usable = std::all_of(index.cols.begin(), index.cols.end(),
+                                 [&](const ColMeta &col) { return has_cond(col.name, true); });
+        } else {
+            usable = has_cond(index.cols[0].name, false);
+        }
+        if (usable && stats != nullptr) {
+            // 这个索引取出的rid只由它的字段上的条件决定
+            std::vector<Condition> index_conds;
+            for (auto &cond : curr_conds) {
+                size_t num_cols = eq_only ? index.cols.size() : 1;
+                for (size_t i = 0; i < num_cols; ++i) {
+                    if (is_index_cond(cond, index.cols[i].name, eq_only)) {
+                        index_conds.push_back(cond);
+                        break;
+                    }
+                }
+            }
+            usable = stats->selectivity(index_conds) <= BITMAP_SCAN_MAX_SELECTIVITY;
+        }
+        if (usable) {
+            std::vector<std::string> col_names;
+            for (auto &col : index.cols) {
+                col_names.push_back(col.name);
+            }
+            index_col_names.push_back(std::move(col_names));
+        }
+    }
+    if (index_col_names.empty()) {
+        return nullptr;
+    }
+    auto plan = std::make_shared<ScanPlan>(T_BitmapHeapScan, sm_manager_, tab_name, curr_conds, std::vector<std::string>());
+    plan->bitmap_index_col_names_ = std::move(index_col_names);
+    return plan;
+}
+
+/**
+ * @brief 判断查询在tab_name上涉及的字段是否都存放在索引项中，是则可以只访问索引而不读取表
+ * 涉及的字段包括投影列、该表上的条件、尚未下推的连接条件以及order by的列
+ *
+ * @param index_col_names 已经根据条件选出的索引的字段名
+ */
+bool Planner::is_covering_index(const std::string &tab_name, std::shared_ptr<Query> query,
+                                const std::vector<Condition> &curr_conds, const std::vector<std::string> &index_col_names) {
+    TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    auto index = tab.get_index_meta(index_col_names);
+    if (index->type != INDEX_BTREE) {
+        return false;   // 只有B+树的扫描可以读出索引项中的字段
+    }
+    std::set<std::string> used;
+    auto use = [&](const TabCol &col) {
+        if (col.tab_name == tab_name) used.insert(col.col_name);
+    };
+    for (auto &col : query->cols) use(col);
+    auto use_conds = [&](const std::vector<Condition> &conds) {
+        for (auto &cond : conds) {
+            use(cond.lhs_col);
+            if (!cond.is_rhs_val) use(cond.rhs_col);
+        }
+    };
+    use_conds(curr_conds);
+    use_conds(query->conds);
+    auto x = std::dynamic_pointer_cast<ast::SelectStmt>(query->parse);
+    if (x != nullptr && x->has_sort && tab.is_col(x->order->cols->col_name)) {
+        used.insert(x->order->cols->col_name);
+    }
+    auto covers = [&](const IndexMeta &index) {
+        return std::all_of(used.begin(), used.end(), [&](const std::string &name) { return index.has_col(name); });
+    };
+    return covers(*index);
+}
+
 /**
  * @brief 表算子条件谓词生成
  *
@@ -150,13 +246,20 @@ std::shared_ptr<Plan> Planner::make_one_rel(std::shared_ptr<Query> query)
         // int index_no = get_indexNo(tables[i], curr_conds);
         std::vector<std::string> index_col_names;
         bool index_exist = get_index_cols(tables[i], curr_conds, index_col_names);
-        if (index_exist == false) {  // 该表没有索引
+        if (index_exist == false) {  // 没有被等值条件完整匹配的索引，能用范围条件缩小扫描时使用位图堆扫描
             index_col_names.clear();
-            table_scan_executors[i] = 
-                std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, tables[i], curr_conds, index_col_names);
+            table_scan_executors[i] = make_bitmap_scan(tables[i], curr_conds);
+            if (table_scan_executors[i] == nullptr) {
+                table_scan_executors[i] =
+                    std::make_shared<ScanPlan>(seq_scan_tag(tables[i]), sm_manager_, tables[i], curr_conds, index_col_names);
+            }
+        } else if (index_scan_tag(tables[i], index_col_names) == T_IndexScan &&
+                   is_covering_index(tables[i], query, curr_conds, index_col_names)) {  // 查询涉及的字段都在索引项中
+            table_scan_executors[i] =
+                std::make_shared<ScanPlan>(T_IndexOnlyScan, sm_manager_, tables[i], curr_conds, index_col_names);
         } else {  // 存在索引
             table_scan_executors[i] =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, tables[i], curr_conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(tables[i], index_col_names), sm_manager_, tables[i], curr_conds, index_col_names);
         }
     }
     // 只有一个表，不需要join。
@@ -309,13 +412,21 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
                 throw InternalError("Unexpected field type");
             }
         }
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        auto ddl_plan = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        ddl_plan->storage_ = interp_storage(x->storage);
+        plannerRoot = ddl_plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropTable>(query->parse)) {
         // drop table;
         plannerRoot = std::make_shared<DDLPlan>(T_DropTable, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
     } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(query->parse)) {
         // create index;
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        auto ddl_plan = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->index_col_names[0], std::vector<ColDef>());
+        ddl_plan->index_col_names_ = x->index_col_names;
+        ddl_plan->include_col_names_ = x->include_col_names;
+        ddl_plan->index_type_ = interp_index_type(x->method);
+        ddl_plan->concurrently_ = x->concurrently;
+        ddl_plan->unique_ = x->unique;
+        plannerRoot = ddl_plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(query->parse)) {
         // drop index
         plannerRoot = std::make_shared<DDLPlan>(T_DropIndex, x->tab_name, x->col_names, std::vector<ColDef>());
@@ -332,13 +443,16 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         std::vector<std::string> index_col_names;
         bool index_exist = get_index_cols(x->tab_name, query->conds, index_col_names);
         
-        if (index_exist == false) {  // 该表没有索引
+        if (index_exist == false) {  // 没有被等值条件完整匹配的索引
             index_col_names.clear();
-            table_scan_executors = 
-                std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+            table_scan_executors = make_bitmap_scan(x->tab_name, query->conds);
+            if (table_scan_executors == nullptr) {
+                table_scan_executors =
+                    std::make_shared<ScanPlan>(seq_scan_tag(x->tab_name), sm_manager_, x->tab_name, query->conds, index_col_names);
+            }
         } else {  // 存在索引
             table_scan_executors =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(x->tab_name, index_col_names), sm_manager_, x->tab_name, query->conds, index_col_names);
         }
 
         plannerRoot = std::make_shared<DMLPlan>(T_Delete, table_scan_executors, x->tab_name,  
@@ -352,13 +466,16 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         std::vector<std::string> index_col_names;
         bool index_exist = get_index_cols(x->tab_name, query->conds, index_col_names);
 
-        if (index_exist == false) {  // 该表没有索引
-        index_col_names.clear();
-            table_scan_executors = 
-                std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+        if (index_exist == false) {  // 没有被等值条件完整匹配的索引
+            index_col_names.clear();
+            table_scan_executors = make_bitmap_scan(x->tab_name, query->conds);
+            if (table_scan_executors == nullptr) {
+                table_scan_executors =
+                    std::make_shared<ScanPlan>(seq_scan_tag(x->tab_name), sm_manager_, x->tab_name, query->conds, index_col_names);
+            }
         } else {  // 存在索引
             table_scan_executors =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(x->tab_name, index_col_names), sm_manager_, x->tab_name, query->conds, index_col_names);
         }
         plannerRoot = std::make_shared<DMLPlan>(T_Update, table_scan_executors, x->tab_name,
                                                      std::vector<Value>(), query->conds, 
@@ -10,7 +10,9 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -26,6 +28,10 @@ See the Mulan PSL v2 for more details. */
 #include "common/common.h"
 #include "analyze/analyze.h"
 
+// 位图堆扫描中一个索引上的条件的估计选择率超过这个比例时不使用该索引：
+// 选出的记录分布在几乎所有页面上，按页面顺序读取的页面数与顺序扫描相同，取rid和建位图都是额外的开销
+constexpr double BITMAP_SCAN_MAX_SELECTIVITY = 0.2;
+
 class Planner {
    private:
     SmManager *sm_manager_;
@@ -50,9 +56,52 @@ class Planner {
     // int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
     bool get_index_cols(std::string tab_name, std::vector<Condition> curr_conds, std::vector<std::string>& index_col_names);
 
+    std::shared_ptr<Plan> make_bitmap_scan(const std::string &tab_name, const std::vector<Condition> &curr_conds);
+
+    bool is_covering_index(const std::string &tab_name, std::shared_ptr<Query> query,
+                           const std::vector<Condition> &curr_conds, const std::vector<std::string> &index_col_names);
+
+    // 等值条件完整匹配索引时的扫描方式：哈希索引只能按完整的key点查；LSM索引按范围归并扫描；
+    // B+树开启了key缓存时同样按key点查，命中缓存时不需要下降B+树，否则按范围扫描
+    PlanTag index_scan_tag(const std::string &tab_name, const std::vector<std::string> &index_col_names) {
+        auto index = sm_manager_->db_.get_table(tab_name).get_index_meta(index_col_names);
+        if (index->type == INDEX_HASH) {
+            return T_HashIndexScan;
+        }
+        if (index->type == INDEX_LSM) {
+            return T_IndexScan;
+        }
+        auto ih = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(tab_name, *index));
+        return ih->has_key_cache() ? T_HashIndexScan : T_IndexScan;
+    }
+
+    // 没有可用索引时的扫描方式：列存表使用按段解码的列存扫描，其余表使用顺序扫描
+    PlanTag seq_scan_tag(const std::string &tab_name) {
+        return sm_manager_->is_columnar(tab_name) ? T_ColumnarScan : T_SeqScan;
+    }
+
     ColType interp_sv_type(ast::SvType sv_type) {
         std::map<ast::SvType, ColType> m = {
-            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}};
+            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING},
+            {ast::SV_TYPE_VARCHAR, TYPE_VARCHAR}};
         return m.at(sv_type);
     }
+
+    TabStorage interp_storage(const std::string &storage) {
+        std::string upper = storage;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        if (upper.empty() || upper == "ROW") return STORAGE_ROW;
+        if (upper == "PAX") return STORAGE_PAX;
+        if (upper == "COLUMNAR") return STORAGE_COLUMNAR;
+        throw UnknownStorageError(storage);
+    }
+
+    IndexType interp_index_type(const std::string &method) {
+        std::string upper = method;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        if (upper.empty() || upper == "BTREE") return INDEX_BTREE;
+        if (upper == "HASH") return INDEX_HASH;
+        if (upper == "LSM") return INDEX_LSM;
+        throw UnknownIndexTypeError(method);
+    }
 };
@@ -19,7 +19,7 @@ enum JoinType {
 namespace ast {
 
 enum SvType {
-    SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING
+    SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING, SV_TYPE_VARCHAR
 };
 
 enum SvCompOp {
@@ -76,9 +76,10 @@ struct ColDef : public Field {
 struct CreateTable : public TreeNode {
     std::string tab_name;
     std::vector<std::shared_ptr<Field>> fields;
+    std::string storage;    // USING子句指定的表存储方式，为空表示默认的行存储
 
-    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_) :
-            tab_name(std::move(tab_name_)), fields(std::move(fields_)) {}
+    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_, std::string storage_ = "") :
+            tab_name(std::move(tab_name_)), fields(std::move(fields_)), storage(std::move(storage_)) {}
 };
 
 struct DropTable : public TreeNode {
@@ -93,12 +94,30 @@ struct DescTable : public TreeNode {
     DescTable(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
 };
 
+// analyze t收集表的统计信息(行数、每个字段的NDV和直方图、每个索引的高度和叶子数)
+struct AnalyzeTable : public TreeNode {
+    std::string tab_name;
+
+    AnalyzeTable(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
+// create index t(a), (b, c)在一次扫描中构建多个索引，每个索引的列名为index_col_names中的一项
+// create index t(a) include (b, c)把b、c存放在叶子的索引项中，使只涉及a、b、c的查询不必回表
+// create index t(a) using hash创建哈希索引，method为空时使用B+树
 struct CreateIndex : public TreeNode {
     std::string tab_name;
-    std::vector<std::string> col_names;
+    std::vector<std::vector<std::string>> index_col_names;
+    std::vector<std::string> include_col_names;
+    std::string method;
+    bool concurrently;      // CREATE INDEX CONCURRENTLY：建索引期间不阻塞对表的写入
+    bool unique;            // CREATE UNIQUE INDEX：不允许重复的key
 
-    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_) :
-            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)) {}
+    CreateIndex(std::string tab_name_, std::vector<std::vector<std::string>> index_col_names_,
+                std::vector<std::string> include_col_names_ = {}, std::string method_ = "",
+                bool concurrently_ = false, bool unique_ = false) :
+            tab_name(std::move(tab_name_)), index_col_names(std::move(index_col_names_)),
+            include_col_names(std::move(include_col_names_)), method(std::move(method_)),
+            concurrently(concurrently_), unique(unique_) {}
 };
 
 struct DropIndex : public TreeNode {
@@ -232,6 +251,7 @@ struct SemValue {
     std::string sv_str;
     OrderByDir sv_orderby_dir;
     std::vector<std::string> sv_strs;
+    std::vector<std::vector<std::string>> sv_str_lists;
 
     std::shared_ptr<TreeNode> sv_node;
 
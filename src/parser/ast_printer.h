@@ -46,6 +46,7 @@ private:
                 {SV_TYPE_INT,    "INT"},
                 {SV_TYPE_FLOAT,  "FLOAT"},
                 {SV_TYPE_STRING, "STRING"},
+                {SV_TYPE_VARCHAR, "VARCHAR"},
         };
         return m.at(type);
     }
@@ -89,12 +90,20 @@ private:
         } else if (auto x = std::dynamic_pointer_cast<DescTable>(node)) {
             std::cout << "DESC_TABLE\n";
             print_val(x->tab_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<AnalyzeTable>(node)) {
+            std::cout << "ANALYZE_TABLE\n";
+            print_val(x->tab_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<CreateIndex>(node)) {
             std::cout << "CREATE_INDEX\n";
             print_val(x->tab_name, offset);
             // print_val(x->col_name, offset);
-            for(auto col_name: x->col_names)
+            for(auto &col_names: x->index_col_names)
+                for(auto col_name: col_names)
+                    print_val(col_name, offset);
+            for(auto col_name: x->include_col_names)
                 print_val(col_name, offset);
+            if(!x->method.empty())
+                print_val(x->method, offset);
         } else if (auto x = std::dynamic_pointer_cast<DropIndex>(node)) {
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
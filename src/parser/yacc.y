@@ -22,7 +22,7 @@ using namespace ast;
 
 // keywords
 %token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM ASC ORDER BY
-WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY
+WHERE UPDATE SET SELECT INT CHAR VARCHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY USING INCLUDE ANALYZE CONCURRENTLY UNIQUE
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -42,6 +42,7 @@ WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_CO
 %type <sv_vals> valueList
 %type <sv_str> tbName colName
 %type <sv_strs> tableList colNameList
+%type <sv_str_lists> indexColsList
 %type <sv_col> col
 %type <sv_cols> colList selector
 %type <sv_set_clause> setClause
@@ -106,6 +107,10 @@ dbStmt:
     {
         $$ = std::make_shared<ShowTables>();
     }
+    |   ANALYZE tbName
+    {
+        $$ = std::make_shared<AnalyzeTable>($2);
+    }
     ;
 
 ddl:
@@ -113,6 +118,10 @@ ddl:
     {
         $$ = std::make_shared<CreateTable>($3, $5);
     }
+    |   CREATE TABLE tbName '(' fieldList ')' USING IDENTIFIER
+    {
+        $$ = std::make_shared<CreateTable>($3, $5, $8);
+    }
     |   DROP TABLE tbName
     {
         $$ = std::make_shared<DropTable>($3);
@@ -121,9 +130,29 @@ ddl:
     {
         $$ = std::make_shared<DescTable>($2);
     }
-    |   CREATE INDEX tbName '(' colNameList ')'
+    |   CREATE INDEX tbName indexColsList
+    {
+        $$ = std::make_shared<CreateIndex>($3, $4);
+    }
+    |   CREATE INDEX tbName indexColsList INCLUDE '(' colNameList ')'
+    {
+        $$ = std::make_shared<CreateIndex>($3, $4, $7);
+    }
+    |   CREATE INDEX tbName indexColsList USING IDENTIFIER
+    {
+        $$ = std::make_shared<CreateIndex>($3, $4, std::vector<std::string>(), $6);
+    }
+    |   CREATE UNIQUE INDEX tbName indexColsList
+    {
+        $$ = std::make_shared<CreateIndex>($4, $5, std::vector<std::string>(), "", false, true);
+    }
+    |   CREATE INDEX CONCURRENTLY tbName indexColsList
+    {
+        $$ = std::make_shared<CreateIndex>($4, $5, std::vector<std::string>(), "", true);
+    }
+    |   CREATE INDEX CONCURRENTLY tbName indexColsList INCLUDE '(' colNameList ')'
     {
-        $$ = std::make_shared<CreateIndex>($3, $5);
+        $$ = std::make_shared<CreateIndex>($4, $5, $8, "", true);
     }
     |   DROP INDEX tbName '(' colNameList ')'
     {
@@ -172,6 +201,17 @@ colNameList:
     }
     ;
 
+indexColsList:
+        '(' colNameList ')'
+    {
+        $$ = std::vector<std::vector<std::string>>{$2};
+    }
+    |   indexColsList ',' '(' colNameList ')'
+    {
+        $$.push_back($4);
+    }
+    ;
+
 field:
         colName type
     {
@@ -188,6 +228,10 @@ type:
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_STRING, $3);
     }
+    |   VARCHAR '(' VALUE_INT ')'
+    {
+        $$ = std::make_shared<TypeLen>(SV_TYPE_VARCHAR, $3);
+    }
     |   FLOAT
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_FLOAT, sizeof(float));
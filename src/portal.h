@@ -18,7 +18,11 @@ See the Mulan PSL v2 for more details. */
 #include "execution/executor_nestedloop_join.h"
 #include "execution/executor_projection.h"
 #include "execution/executor_seq_scan.h"
+#include "execution/executor_columnar_scan.h"
 #include "execution/executor_index_scan.h"
+#include "execution/executor_index_only_scan.h"
+#include "execution/executor_hash_index_scan.h"
+#include "execution/executor_bitmap_heap_scan.h"
 #include "execution/executor_update.h"
 #include "execution/executor_insert.h"
 #include "execution/executor_delete.h"
@@ -160,6 +164,18 @@ class Portal
             if(x->tag == T_SeqScan) {
                 return std::make_unique<SeqScanExecutor>(sm_manager_, x->tab_name_, x->conds_, context);
             }
+            else if(x->tag == T_ColumnarScan) {
+                return std::make_unique<ColumnarScanExecutor>(sm_manager_, x->tab_name_, x->conds_, context);
+            }
+            else if(x->tag == T_HashIndexScan) {
+                return std::make_unique<HashIndexScanExecutor>(sm_manager_, x->tab_name_, x->conds_, x->index_col_names_, context);
+            }
+            else if(x->tag == T_BitmapHeapScan) {
+                return std::make_unique<BitmapHeapScanExecutor>(sm_manager_, x->tab_name_, x->conds_, x->bitmap_index_col_names_, context);
+            }
+            else if(x->tag == T_IndexOnlyScan) {
+                return std::make_unique<IndexOnlyScanExecutor>(sm_manager_, x->tab_name_, x->conds_, x->index_col_names_, context);
+            }
             else {
                 return std::make_unique<IndexScanExecutor>(sm_manager_, x->tab_name_, x->conds_, x->index_col_names_, context);
             } 
@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <functional>
+
 #include "defs.h"
 #include "storage/buffer_pool_manager.h"
 
@@ -17,22 +19,66 @@ constexpr int RM_NO_PAGE = -1;
 constexpr int RM_FILE_HDR_PAGE = 0;
 constexpr int RM_FIRST_RECORD_PAGE = 1;
 constexpr int RM_MAX_RECORD_SIZE = 512;
+constexpr int RM_MAX_VAR_COLS = 32;             // slotted page格式下最多压缩存储的变长字段个数
+constexpr int RM_MAX_PAX_COLS = 64;             // PAX格式下每个页面最多划分的minipage个数
+constexpr int RM_FSM_BUCKETS = 16;              // 空闲空间映射中页面空闲程度的等级数，0表示放不下一条记录
+constexpr int RM_INSERT_TARGETS = 32;           // 插入目标页面的槽位数，并发插入的线程按线程id散列到不同槽位
+
+// 数据文件格式的版本，保存在RmFileHdr::format_version中。当前格式在数据页面之间穿插空闲空间映射页面，
+// 页面编号与最初的格式不同；最初的文件头中没有该字段，读出为0。版本不同的文件不能打开，需要重新建立数据库
+constexpr int RM_FORMAT_VERSION = 1;
+
+/* 表数据文件的页面组织格式 */
+enum RmPageFormat {
+    RM_PAGE_FIXED = 0,      // 定长槽位 + bitmap，适用于只包含定长字段的窄表
+    RM_PAGE_SLOTTED = 1,    // 槽目录 + 变长元组，适用于包含VARCHAR字段的表
+    RM_PAGE_PAX = 2         // 定长槽位 + bitmap，页面内每个字段的值连续存放在各自的minipage中
+};
 
 /* 文件头，记录表数据文件的元信息，写入磁盘中文件的第0号页面 */
 struct RmFileHdr {
-    int record_size;            // 表中每条记录的大小，由于不包含变长字段，因此当前字段初始化后保持不变
+    int record_size;            // 表中每条记录在内存中的大小（VARCHAR按最大长度计算），初始化后保持不变
     int num_pages;              // 文件中分配的页面个数（初始化为1）
-    int num_records_per_page;   // 每个页面最多能存储的元组个数
-    int first_free_page_no;     // 文件中当前第一个包含空闲空间的页面号（初始化为-1）
-    int bitmap_size;            // 每个页面bitmap大小
+    int num_records_per_page;   // 每个页面最多能存储的元组个数（slotted page为槽目录项个数的上限）
+    int first_free_page_no;     // 最近一次找到的包含空闲空间的页面号，作为查找空闲空间映射的起点（初始化为-1）
+    int bitmap_size;            // 每个页面bitmap大小（slotted page不使用bitmap，为0）
+    int page_format;            // 页面组织格式，见RmPageFormat
+    int num_var_cols;           // 变长字段个数
+    int var_col_offsets[RM_MAX_VAR_COLS];   // 变长字段在内存记录中的偏移，按偏移递增排列
+    int var_col_lens[RM_MAX_VAR_COLS];      // 变长字段的最大长度
+    int num_pax_cols;                       // PAX：每个页面中minipage的个数
+    int pax_col_lens[RM_MAX_PAX_COLS];      // PAX：各minipage中单个值的长度，按字段偏移递增排列，字段过多时剩余字段合并到最后一个minipage
+    int format_version;                     // 文件格式的版本，见RM_FORMAT_VERSION
 };
 
 /* 表数据文件中每个页面的页头，记录每个页面的元信息 */
 struct RmPageHdr {
-    int next_free_page_no;  // 当前页面满了之后，下一个包含空闲空间的页面号（初始化为-1）
     int num_records;        // 当前页面中当前已经存储的记录个数（初始化为0）
+    int num_slots;          // slotted page：槽目录项个数
+    int free_space_offset;  // slotted page：元组区的起始偏移，元组从页尾向前增长（初始化为PAGE_SIZE）
+};
+
+/**
+ * 空闲空间映射(free space map)页面的页头
+ * FSM页面与数据页面交替分布：从RM_FIRST_RECORD_PAGE开始，每个FSM页面之后紧跟RM_FSM_ENTRIES_PER_PAGE个数据页面，
+ * FSM页面中每个字节记录其后一个数据页面的空闲等级(0 ~ RM_FSM_BUCKETS-1)
+ */
+struct RmFsmPageHdr {
+    int max_bucket;         // 本FSM页面中空闲等级的上界，查找失败时收紧为实际的最大值
 };
 
+constexpr int RM_FSM_ENTRIES_PER_PAGE = PAGE_SIZE - (int)Page::OFFSET_PAGE_HDR - (int)sizeof(RmFsmPageHdr);
+
+/* slotted page的槽目录项，槽目录紧跟在页头之后，从前向后增长 */
+struct RmSlot {
+    uint16_t offset;    // 元组在页面中的偏移
+    uint16_t len;       // 低14位为元组占用的字节数，为0表示空槽；高2位为标志位
+};
+
+constexpr uint16_t RM_SLOT_LEN_MASK = 0x3fff;
+constexpr uint16_t RM_SLOT_REDIRECT = 0x8000;   // 槽中存放的是转发地址(Rid)，元组因更新变长而迁移到了其他页面
+constexpr uint16_t RM_SLOT_MOVED = 0x4000;      // 槽中存放的是从其他页面迁移来的元组，顺序扫描时跳过
+
 /* 表中的记录 */
 struct RmRecord {
     char* data;  // 记录的数据
@@ -90,3 +136,10 @@ struct RmRecord {
         data = nullptr;
     }
 };
+
+/* PAX页面上按列计算的谓词，由上层提供具体的比较逻辑 */
+struct RmColumnFilter {
+    int col_offset;     // 字段在记录中的偏移
+    // 对minipage中连续存放的num_values个值计算谓词，将不满足谓词的位置的sel置为0
+    std::function<void(const char *values, int num_values, uint8_t *sel)> eval;
+};
@@ -10,6 +10,9 @@ See the Mulan PSL v2 for more details. */
 
 #include "rm_file_handle.h"
 
+#include <algorithm>
+#include <thread>
+
 /**
  * @description: 获取当前表中记录号为rid的记录
  * @param {Rid&} rid 记录号，指定记录的位置
@@ -20,22 +23,71 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* cont
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+        page_handle.page->rlatch();
+        if (!page_handle.is_record(rid.slot_no)) {
+            page_handle.page->runlatch();
+            buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        auto record = std::make_unique<RmRecord>(file_hdr_.record_size);
+        read_slot(page_handle, rid.slot_no, record->data);
+        page_handle.page->runlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+        return record;
+    }
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->rlatch();
     // 判断是否存在记录
     if(!Bitmap::is_set(page_handle.bitmap, rid.slot_no))
     {
+        page_handle.page->runlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
         throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
     auto record = std::make_unique<RmRecord>(file_hdr_.record_size);
 
     // 构造这个record
-    memcpy(record->data, page_handle.get_slot(rid.slot_no), file_hdr_.record_size);
+    page_handle.read_row(rid.slot_no, record->data);
     record->size = file_hdr_.record_size;
+    page_handle.page->runlatch();
     buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
 
     return record;
 }
 
+/**
+ * @description: 读取同一个页面上的多条记录，页面只固定和加读锁一次
+ * 用于按页面顺序访问堆表的扫描（如位图堆扫描），避免每条记录都查找一次缓冲池
+ * @param {int} page_no 页面号
+ * @param {vector<int>&} slot_nos 要读取的槽号
+ * @param {vector<unique_ptr<RmRecord>>&} records 与slot_nos一一对应的记录
+ */
+void RmFileHandle::get_records(int page_no, const std::vector<int> &slot_nos,
+                               std::vector<std::unique_ptr<RmRecord>> &records) const {
+    records.clear();
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    page_handle.page->rlatch();
+    bool slotted = file_hdr_.page_format == RM_PAGE_SLOTTED;
+    for (int slot_no : slot_nos) {
+        if (slotted ? !page_handle.is_record(slot_no) : !Bitmap::is_set(page_handle.bitmap, slot_no)) {
+            page_handle.page->runlatch();
+            buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+            throw RecordNotFoundError(page_no, slot_no);
+        }
+        auto record = std::make_unique<RmRecord>(file_hdr_.record_size);
+        if (slotted) {
+            read_slot(page_handle, slot_no, record->data);  // 只有迁移走的元组需要访问其他页面
+        } else {
+            page_handle.read_row(slot_no, record->data);
+        }
+        records.push_back(std::move(record));
+    }
+    page_handle.page->runlatch();
+    buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+}
+
 /**
  * @description: 在当前表中插入一条记录，不指定插入位置
  * @param {char*} buf 要插入的记录的数据
@@ -48,21 +100,23 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
     // 2. 在page handle中找到空闲slot位置
     // 3. 将buf复制到空闲slot位置
     // 4. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
-    auto page_handle = create_page_handle();    // 找到一个空闲的page
+    // 注意考虑插入一条记录后页面已满的情况，需要更新空闲空间映射
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        char tuple[PAGE_SIZE];
+        int len = encode_record(buf, tuple);
+        return place_tuple(tuple, len, 0, RM_NO_PAGE);
+    }
+    auto page_handle = create_page_handle(RM_NO_PAGE);    // 找到一个空闲的page，已经加了写锁
+    int page_no = page_handle.page->get_page_id().page_no;
     int slot_no = Bitmap::first_bit(false, page_handle.bitmap, file_hdr_.num_records_per_page);
-    auto record = page_handle.get_slot(slot_no);
-    memcpy(record, buf, file_hdr_.record_size);
+    page_handle.write_row(slot_no, buf);
     Bitmap::set(page_handle.bitmap, slot_no);
-    // 检测当前页是否已经满了
     page_handle.page_hdr->num_records++;
-    if(page_handle.page_hdr->num_records == file_hdr_.num_records_per_page)
-    {
-        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
-    }
-    buffer_pool_manager_->unpin_page({fd_, page_handle.page->get_page_id().page_no}, true);
+    update_free_space_map(page_handle);
+    page_handle.page->wunlatch();
+    buffer_pool_manager_->unpin_page({fd_, page_no}, true);
 
-    return Rid{page_handle.page->get_page_id().page_no, slot_no};
+    return Rid{page_no, slot_no};
 }
 
 /**
@@ -71,9 +125,28 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
  * @param {char*} buf 要插入记录的数据
  */
 void RmFileHandle::insert_record(const Rid& rid, char* buf) {
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        char tuple[PAGE_SIZE];
+        int len = encode_record(buf, tuple);
+        auto page_handle = fetch_page_handle(rid.page_no);
+        page_handle.page->wlatch();
+        if (slotted_insert(page_handle, tuple, len, rid.slot_no, 0) < 0) {
+            // 原页面的空间已经被其他记录占用：元组存放到其他页面，原位置只保存转发地址
+            Rid target = place_tuple(tuple, len, RM_SLOT_MOVED, rid.page_no);
+            if (slotted_insert(page_handle, (char *)&target, sizeof(Rid), rid.slot_no, RM_SLOT_REDIRECT) < 0) {
+                page_handle.page->wunlatch();
+                buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
+                erase_tuple(target);
+                throw InternalError("RmFileHandle::insert_record: no space left on page " + std::to_string(rid.page_no));
+            }
+        }
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
+        return;
+    }
     // 获得rid.page_no对应的page handle
     auto page_handle = fetch_page_handle(rid.page_no);
-    auto record = page_handle.get_slot(rid.slot_no);
+    page_handle.page->wlatch();
 
     // 设置bitmap的第slot_no位，表示这个槽装入了记录
     Bitmap::set(page_handle.bitmap, rid.slot_no);   
@@ -82,13 +155,10 @@ void RmFileHandle::insert_record(const Rid& rid, char* buf) {
     page_handle.page_hdr->num_records++;
 
     // 将buf读入到rid指示的位置处
-    memcpy(record, buf, file_hdr_.record_size);
+    page_handle.write_row(rid.slot_no, buf);
 
-    // 判断页面是否已满
-    if(page_handle.page_hdr->num_records == file_hdr_.num_records_per_page)
-    {
-        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
-    }
+    update_free_space_map(page_handle);
+    page_handle.page->wunlatch();
     buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
 }
 
@@ -101,18 +171,41 @@ void RmFileHandle::delete_record(const Rid& rid, Context* context) {
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑删除一条记录后页面未满的情况，需要调用release_page_handle()
+    // 注意考虑删除一条记录后页面未满的情况，需要更新空闲空间映射
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+        page_handle.page->wlatch();
+        if (!page_handle.is_record(rid.slot_no)) {
+            page_handle.page->wunlatch();
+            buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        RmSlot *slot = page_handle.get_slot_entry(rid.slot_no);
+        Rid target{RM_NO_PAGE, -1};
+        if (slot->len & RM_SLOT_REDIRECT) {
+            memcpy(&target, page_handle.page->get_data() + slot->offset, sizeof(Rid));
+        }
+        slotted_erase(page_handle, rid.slot_no);
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
+        // 迁移走的元组只能通过原位置的转发地址访问，释放原页面的锁之后再删除，避免同时持有两个页面的写锁
+        if (target.page_no != RM_NO_PAGE) {
+            erase_tuple(target);
+        }
+        return;
+    }
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->wlatch();
     if(!Bitmap::is_set(page_handle.bitmap, rid.slot_no)) { // 是否找到record
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
         throw PageNotExistError("  ", rid.page_no);
     }
     Bitmap::reset(page_handle.bitmap, rid.slot_no);
     page_handle.page_hdr->num_records--;
-    if(page_handle.page_hdr->num_records == file_hdr_.num_records_per_page - 1)
-    {
-        release_page_handle(page_handle);
-    }
-    buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+    update_free_space_map(page_handle);
+    page_handle.page->wunlatch();
+    buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
 }
 
 
@@ -126,12 +219,44 @@ void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context) {
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 更新记录
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        char tuple[PAGE_SIZE];
+        int len = encode_record(buf, tuple);
+        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+        page_handle.page->wlatch();
+        if (!page_handle.is_record(rid.slot_no)) {
+            page_handle.page->wunlatch();
+            buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        RmSlot *slot = page_handle.get_slot_entry(rid.slot_no);
+        Rid old_target{RM_NO_PAGE, -1};
+        if (slot->len & RM_SLOT_REDIRECT) {
+            memcpy(&old_target, page_handle.page->get_data() + slot->offset, sizeof(Rid));
+        }
+        // 先删除旧元组再放入新元组，新元组放不下时迁移到其他页面，原位置保存转发地址，从而保持rid不变
+        // 旧元组至少占用sizeof(Rid)字节，因此删除后一定能放下转发地址
+        slotted_erase(page_handle, rid.slot_no);
+        if (slotted_insert(page_handle, tuple, len, rid.slot_no, 0) < 0) {
+            Rid target = place_tuple(tuple, len, RM_SLOT_MOVED, rid.page_no);
+            slotted_insert(page_handle, (char *)&target, sizeof(Rid), rid.slot_no, RM_SLOT_REDIRECT);
+        }
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
+        if (old_target.page_no != RM_NO_PAGE) {
+            erase_tuple(old_target);
+        }
+        return;
+    }
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->wlatch();
     if(!Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {  // 是否找到record
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
         throw PageNotExistError("  ", rid.page_no);
     }
-    auto record = page_handle.get_slot(rid.slot_no);
-    memcpy(record, buf, file_hdr_.record_size);
+    page_handle.write_row(rid.slot_no, buf);
+    page_handle.page->wunlatch();
     buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
 }
 
@@ -155,9 +280,62 @@ RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
     return RmPageHandle(&file_hdr_, buffer_pool_manager_->fetch_page({fd_, page_no}));
 }
 
+/**
+ * @description: 判断PAX页面中是否有一个minipage恰好存放了指定字段，即该字段的值在页面内连续存放
+ * @param {int} col_offset 字段在记录中的偏移
+ * @param {int} col_len 字段长度
+ */
+bool RmFileHandle::is_pax_column(int col_offset, int col_len) const {
+    if (file_hdr_.page_format != RM_PAGE_PAX) {
+        return false;
+    }
+    int offset = 0;
+    for (int i = 0; i < file_hdr_.num_pax_cols; ++i) {
+        if (offset == col_offset) {
+            return file_hdr_.pax_col_lens[i] == col_len;
+        }
+        offset += file_hdr_.pax_col_lens[i];
+    }
+    return false;
+}
+
+/**
+ * @description: 在PAX页面上按列计算谓词，返回满足所有谓词的记录的槽号
+ * 每个谓词在一个minipage的连续值上计算，只有满足条件的记录才需要由上层拼接成完整的元组
+ * @param {int} page_no 页面号
+ * @param {vector<RmColumnFilter>&} filters 谓词，filter.col_offset对应的字段必须满足is_pax_column
+ * @param {vector<int>&} slot_nos 满足所有谓词的记录的槽号，按槽号递增排列
+ */
+void RmFileHandle::filter_page(int page_no, const std::vector<RmColumnFilter> &filters, std::vector<int> &slot_nos) const {
+    slot_nos.clear();
+    if (is_fsm_page(page_no)) {
+        return;
+    }
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    page_handle.page->rlatch();
+    if (page_handle.page_hdr->num_records > 0) {
+        int num_slots = file_hdr_.num_records_per_page;
+        std::vector<uint8_t> sel(num_slots);
+        for (int i = 0; i < num_slots; ++i) {
+            sel[i] = Bitmap::is_set(page_handle.bitmap, i);
+        }
+        for (auto &filter : filters) {
+            filter.eval(page_handle.get_minipage(filter.col_offset), num_slots, sel.data());
+        }
+        for (int i = 0; i < num_slots; ++i) {
+            if (sel[i]) {
+                slot_nos.push_back(i);
+            }
+        }
+    }
+    page_handle.page->runlatch();
+    buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+}
+
 /**
  * @description: 创建一个新的page handle
  * @return {RmPageHandle} 新的PageHandle
+ * @note 调用者需要持有latch_；新页面的页头还没有初始化，也还没有登记到空闲空间映射中
  */
 RmPageHandle RmFileHandle::create_new_page_handle() {
     // Todo:
@@ -166,44 +344,371 @@ RmPageHandle RmFileHandle::create_new_page_handle() {
     // 3.更新file_hdr_
     PageId page_id = {fd_, INVALID_PAGE_ID};
     Page* page = buffer_pool_manager_->new_page(&page_id);
-    RmPageHandle page_handle = RmPageHandle(&file_hdr_, page);  // 调用构造函数
-    // 更新数据
-    page_handle.page_hdr->num_records = 0;
-    page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
-    Bitmap::init(page_handle.bitmap, file_hdr_.bitmap_size);
     file_hdr_.num_pages++;
-    file_hdr_.first_free_page_no = page_id.page_no;
-
-    return page_handle;
+    if (is_fsm_page(page_id.page_no)) {
+        // 分配到了FSM页面的位置，先初始化FSM页面，所有表项为0，再分配一个数据页面
+        memset(page->get_data() + page->OFFSET_PAGE_HDR, 0, PAGE_SIZE - page->OFFSET_PAGE_HDR);
+        buffer_pool_manager_->unpin_page(page_id, true);
+        page_id = {fd_, INVALID_PAGE_ID};
+        page = buffer_pool_manager_->new_page(&page_id);
+        file_hdr_.num_pages++;
+    }
+    return RmPageHandle(&file_hdr_, page);  // 调用构造函数
 }
 
 /**
  * @brief 创建或获取一个空闲的page handle
+ * 每个线程按线程id散列到一个插入目标槽位，优先使用槽位中的目标页面，多个线程的插入分散在不同的页面上；
+ * 目标页面没有空间时才在空闲空间映射中查找新的页面，查找时跳过其他槽位正在使用的页面
  *
- * @return RmPageHandle 返回生成的空闲page handle
+ * @param exclude_page_no 调用者已经持有写锁的页面，不能选择该页面；此时只尝试加锁，加锁失败则分配新页面，避免死锁
+ * @return RmPageHandle 返回生成的空闲page handle，已经加了写锁
  * @note pin the page, remember to unpin it outside!
  */
-RmPageHandle RmFileHandle::create_page_handle() {
+RmPageHandle RmFileHandle::create_page_handle(int exclude_page_no) {
     // Todo:
     // 1. 判断file_hdr_中是否还有空闲页
     //     1.1 没有空闲页：使用缓冲池来创建一个新page；可直接调用create_new_page_handle()
     //     1.2 有空闲页：直接获取第一个空闲页
     // 2. 生成page handle并返回给上层
-    if(file_hdr_.first_free_page_no == RM_NO_PAGE)
-    {
-        return create_new_page_handle();
+    size_t target_idx = std::hash<std::thread::id>()(std::this_thread::get_id()) % RM_INSERT_TARGETS;
+    bool force_new = false;
+    while (true) {
+        int page_no = RM_NO_PAGE;
+        Page *new_page = nullptr;
+        {
+            std::scoped_lock lock{latch_};
+            int target = insert_targets_[target_idx];
+            if (!force_new && target != RM_NO_PAGE && target != exclude_page_no && get_fsm_bucket(target) > 0) {
+                page_no = target;
+            } else if (!force_new) {
+                page_no = fsm_search(1, exclude_page_no);
+            }
+            if (page_no == RM_NO_PAGE) {
+                // 新页面在登记到空闲空间映射之前等级为0，其他线程的插入不会选中它
+                new_page = create_new_page_handle().page;
+                page_no = new_page->get_page_id().page_no;
+            }
+            insert_targets_[target_idx] = page_no;
+        }
+        if (new_page != nullptr) {
+            // 扫描可能已经通过num_pages读到了新页面，因此释放latch_之后再等待页面锁，最后登记到空闲空间映射
+            RmPageHandle page_handle(&file_hdr_, new_page);
+            page_handle.page->wlatch();
+            page_handle.page_hdr->num_records = 0;
+            page_handle.page_hdr->num_slots = 0;
+            page_handle.page_hdr->free_space_offset = PAGE_SIZE;
+            Bitmap::init(page_handle.bitmap, file_hdr_.bitmap_size);
+            update_free_space_map(page_handle);
+            return page_handle;
+        }
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        if (exclude_page_no == RM_NO_PAGE) {
+            page_handle.page->wlatch();
+        } else if (!page_handle.page->try_wlatch()) {
+            buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+            force_new = true;
+            continue;
+        }
+        if (free_space_bucket(page_handle) > 0) {
+            return page_handle;
+        }
+        // 空闲空间映射中的等级已经过时（例如FSM页面在崩溃前没有写回），修正后继续查找
+        update_free_space_map(page_handle);
+        page_handle.page->wunlatch();
+        buffer_pool_manager_->unpin_page({fd_, page_no}, false);
     }
-    return fetch_page_handle(file_hdr_.first_free_page_no);
 }
 
 /**
- * @description: 当一个页面从没有空闲空间的状态变为有空闲空间状态时，更新文件头和页头中空闲页面相关的元数据
+ * @description: 计算页面的空闲等级
+ * @return {int} 0表示页面放不下一条最大长度的记录，1 ~ RM_FSM_BUCKETS-1表示空闲空间由少到多
  */
-void RmFileHandle::release_page_handle(RmPageHandle&page_handle) {
-    // Todo:
-    // 当page从已满变成未满，考虑如何更新：
-    // 1. page_handle.page_hdr->next_free_page_no
-    // 2. file_hdr_.first_free_page_no
-    page_handle.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
-    file_hdr_.first_free_page_no = page_handle.page->get_page_id().page_no;
+int RmFileHandle::free_space_bucket(const RmPageHandle &page_handle) const {
+    int free_bytes;
+    int max_len;
+    if (file_hdr_.page_format == RM_PAGE_SLOTTED) {
+        free_bytes = page_handle.free_space() - (int)sizeof(RmSlot);
+        max_len = max_tuple_len();
+    } else {
+        free_bytes = (file_hdr_.num_records_per_page - page_handle.page_hdr->num_records) * file_hdr_.record_size;
+        max_len = file_hdr_.record_size;
+    }
+    if (free_bytes < max_len) {
+        return 0;
+    }
+    return 1 + (free_bytes - max_len) * (RM_FSM_BUCKETS - 1) / PAGE_SIZE;
+}
+
+/**
+ * @description: 页面的空闲空间发生变化后，更新其在空闲空间映射中的等级
+ * @note 调用者需要持有该页面的写锁
+ */
+void RmFileHandle::update_free_space_map(const RmPageHandle &page_handle) {
+    int bucket = free_space_bucket(page_handle);
+    std::scoped_lock lock{latch_};
+    set_fsm_bucket(page_handle.page->get_page_id().page_no, bucket);
+}
+
+/**
+ * @description: 设置数据页面在空闲空间映射中的等级
+ * @note 调用者需要持有latch_
+ */
+void RmFileHandle::set_fsm_bucket(int page_no, int bucket) {
+    PageId fsm_page_id = {fd_, fsm_page_of(page_no)};
+    Page *fsm_page = buffer_pool_manager_->fetch_page(fsm_page_id);
+    auto fsm_hdr = reinterpret_cast<RmFsmPageHdr *>(fsm_page->get_data() + fsm_page->OFFSET_PAGE_HDR);
+    auto entries = reinterpret_cast<uint8_t *>(fsm_hdr + 1);
+    uint8_t &entry = entries[page_no - fsm_page_id.page_no - 1];
+    bool dirty = entry != bucket;
+    entry = bucket;
+    if (bucket > fsm_hdr->max_bucket) {
+        fsm_hdr->max_bucket = bucket;
+        dirty = true;
+    }
+    buffer_pool_manager_->unpin_page(fsm_page_id, dirty);
+    // 优先向页面号较小的页面插入，使记录尽量集中在文件前部
+    if (bucket > 0 && (file_hdr_.first_free_page_no == RM_NO_PAGE || page_no < file_hdr_.first_free_page_no)) {
+        file_hdr_.first_free_page_no = page_no;
+    }
+}
+
+/**
+ * @description: 读取数据页面在空闲空间映射中的等级
+ * @note 调用者需要持有latch_
+ */
+int RmFileHandle::get_fsm_bucket(int page_no) const {
+    PageId fsm_page_id = {fd_, fsm_page_of(page_no)};
+    Page *fsm_page = buffer_pool_manager_->fetch_page(fsm_page_id);
+    auto entries = reinterpret_cast<uint8_t *>(fsm_page->get_data() + fsm_page->OFFSET_PAGE_HDR + sizeof(RmFsmPageHdr));
+    int bucket = entries[page_no - fsm_page_id.page_no - 1];
+    buffer_pool_manager_->unpin_page(fsm_page_id, false);
+    return bucket;
+}
+
+/**
+ * @description: 在空闲空间映射中查找空闲等级不低于min_bucket的数据页面，只访问FSM页面，不需要读取数据页面
+ * 先检查上次找到的页面，通常可以直接命中；否则依次查找各个FSM页面，跳过等级上界不满足要求的FSM页面
+ * 其他线程正在使用的插入目标页面以及exclude_page_no不会被选中
+ * @param {int} min_bucket 要求的最低空闲等级
+ * @param {int} exclude_page_no 不能选择的页面
+ * @return {int} 找到的页面号，没有找到返回RM_NO_PAGE
+ * @note 调用者需要持有latch_
+ */
+int RmFileHandle::fsm_search(int min_bucket, int exclude_page_no) {
+    auto is_claimed = [&](int page_no) {
+        return page_no == exclude_page_no ||
+               std::find(insert_targets_, insert_targets_ + RM_INSERT_TARGETS, page_no) != insert_targets_ + RM_INSERT_TARGETS;
+    };
+    int hint = file_hdr_.first_free_page_no;
+    if (hint != RM_NO_PAGE && hint < file_hdr_.num_pages && !is_claimed(hint) && get_fsm_bucket(hint) >= min_bucket) {
+        return hint;
+    }
+    for (int fsm_page_no = RM_FIRST_RECORD_PAGE; fsm_page_no < file_hdr_.num_pages;
+         fsm_page_no += RM_FSM_ENTRIES_PER_PAGE + 1) {
+        PageId fsm_page_id = {fd_, fsm_page_no};
+        Page *fsm_page = buffer_pool_manager_->fetch_page(fsm_page_id);
+        auto fsm_hdr = reinterpret_cast<RmFsmPageHdr *>(fsm_page->get_data() + fsm_page->OFFSET_PAGE_HDR);
+        auto entries = reinterpret_cast<uint8_t *>(fsm_hdr + 1);
+        int found = RM_NO_PAGE;
+        bool dirty = false;
+        if (fsm_hdr->max_bucket >= min_bucket) {
+            int num_entries = std::min(RM_FSM_ENTRIES_PER_PAGE, file_hdr_.num_pages - fsm_page_no - 1);
+            int max_bucket = 0;
+            for (int i = 0; i < num_entries; ++i) {
+                max_bucket = std::max(max_bucket, (int)entries[i]);
+                if (entries[i] >= min_bucket && !is_claimed(fsm_page_no + 1 + i)) {
+                    found = fsm_page_no + 1 + i;
+                    break;
+                }
+            }
+            if (found == RM_NO_PAGE) {
+                fsm_hdr->max_bucket = max_bucket;
+                dirty = true;
+            }
+        }
+        buffer_pool_manager_->unpin_page(fsm_page_id, dirty);
+        if (found != RM_NO_PAGE) {
+            file_hdr_.first_free_page_no = found;
+            return found;
+        }
+    }
+    return RM_NO_PAGE;
+}
+
+/**
+ * @description: slotted page中一条元组可能占用的最大字节数
+ * @return {int} 定长部分 + 每个变长字段的长度前缀 + 变长字段的最大长度，且不小于一个转发地址的大小
+ */
+int RmFileHandle::max_tuple_len() const {
+    return std::max(file_hdr_.record_size + file_hdr_.num_var_cols * (int)sizeof(uint16_t), (int)sizeof(Rid));
+}
+
+/**
+ * @description: 将内存中的定长记录编码为slotted page中的变长元组
+ * 定长字段原样拷贝，变长字段去掉尾部填充的0，写成 长度(uint16_t) + 数据
+ * @param {char*} buf 内存中的定长记录，大小为file_hdr_.record_size
+ * @param {char*} tuple 编码结果，空间不小于max_tuple_len()
+ * @return {int} 编码后的元组长度
+ */
+int RmFileHandle::encode_record(const char *buf, char *tuple) const {
+    int src = 0;
+    int dst = 0;
+    for (int i = 0; i < file_hdr_.num_var_cols; ++i) {
+        int offset = file_hdr_.var_col_offsets[i];
+        int len = file_hdr_.var_col_lens[i];
+        memcpy(tuple + dst, buf + src, offset - src);
+        dst += offset - src;
+        uint16_t actual_len = len;
+        while (actual_len > 0 && buf[offset + actual_len - 1] == 0) {
+            actual_len--;
+        }
+        memcpy(tuple + dst, &actual_len, sizeof(uint16_t));
+        dst += sizeof(uint16_t);
+        memcpy(tuple + dst, buf + offset, actual_len);
+        dst += actual_len;
+        src = offset + len;
+    }
+    memcpy(tuple + dst, buf + src, file_hdr_.record_size - src);
+    dst += file_hdr_.record_size - src;
+    return dst;
+}
+
+/**
+ * @description: 将slotted page中的变长元组解码为内存中的定长记录，变长字段补0到最大长度
+ * @param {char*} tuple 页面中的元组
+ * @param {char*} buf 解码结果，大小为file_hdr_.record_size
+ */
+void RmFileHandle::decode_record(const char *tuple, char *buf) const {
+    int src = 0;
+    int dst = 0;
+    for (int i = 0; i < file_hdr_.num_var_cols; ++i) {
+        int offset = file_hdr_.var_col_offsets[i];
+        int len = file_hdr_.var_col_lens[i];
+        memcpy(buf + dst, tuple + src, offset - dst);
+        src += offset - dst;
+        uint16_t actual_len;
+        memcpy(&actual_len, tuple + src, sizeof(uint16_t));
+        src += sizeof(uint16_t);
+        memcpy(buf + offset, tuple + src, actual_len);
+        memset(buf + offset + actual_len, 0, len - actual_len);
+        src += actual_len;
+        dst = offset + len;
+    }
+    memcpy(buf + dst, tuple + src, file_hdr_.record_size - dst);
+}
+
+/**
+ * @description: 读取slotted page中一个槽上的记录，元组已经迁移时沿转发地址读取
+ * @param {RmPageHandle&} page_handle 记录所在的页面，由调用者pin住并加读锁
+ * @param {int} slot_no 槽号，调用者保证槽上有记录
+ * @param {char*} buf 存放解码之后的记录
+ */
+void RmFileHandle::read_slot(const RmPageHandle &page_handle, int slot_no, char *buf) const {
+    RmSlot *slot = page_handle.get_slot_entry(slot_no);
+    if (!(slot->len & RM_SLOT_REDIRECT)) {
+        decode_record(page_handle.page->get_data() + slot->offset, buf);
+        return;
+    }
+    // 元组已经迁移到其他页面，读取完成前保持原页面的读锁，防止元组再次迁移
+    Rid target;
+    memcpy(&target, page_handle.page->get_data() + slot->offset, sizeof(Rid));
+    RmPageHandle target_handle = fetch_page_handle(target.page_no);
+    target_handle.page->rlatch();
+    decode_record(target_handle.page->get_data() + target_handle.get_slot_entry(target.slot_no)->offset, buf);
+    target_handle.page->runlatch();
+    buffer_pool_manager_->unpin_page({fd_, target.page_no}, false);
+}
+
+/**
+ * @description: 在slotted page中放入一条元组
+ * @param {RmPageHandle&} page_handle 目标页面
+ * @param {char*} tuple 元组数据
+ * @param {int} len 元组长度
+ * @param {int} slot_no 指定放入的槽号，为-1时复用第一个空槽或者追加新槽
+ * @param {uint16_t} flags 槽目录项的标志位
+ * @return {int} 元组所在的槽号，空间不足时返回-1
+ */
+int RmFileHandle::slotted_insert(RmPageHandle &page_handle, const char *tuple, int len, int slot_no, uint16_t flags) {
+    // 每个元组至少占用sizeof(Rid)字节，保证更新时总能在原位置留下转发地址
+    int alloc_len = std::max(len, (int)sizeof(Rid));
+    RmPageHdr *page_hdr = page_handle.page_hdr;
+    if (slot_no < 0) {
+        slot_no = 0;
+        while (slot_no < page_hdr->num_slots && (page_handle.get_slot_entry(slot_no)->len & RM_SLOT_LEN_MASK) != 0) {
+            slot_no++;
+        }
+    } else if (slot_no < page_hdr->num_slots && (page_handle.get_slot_entry(slot_no)->len & RM_SLOT_LEN_MASK) != 0) {
+        throw InternalError("RmFileHandle::slotted_insert: slot " + std::to_string(slot_no) + " is occupied");
+    }
+    int new_slots = std::max(0, slot_no + 1 - page_hdr->num_slots);
+    if (page_handle.free_space() < alloc_len + new_slots * (int)sizeof(RmSlot)) {
+        return -1;
+    }
+    for (int i = page_hdr->num_slots; i <= slot_no; ++i) {
+        *page_handle.get_slot_entry(i) = {0, 0};
+    }
+    page_hdr->num_slots += new_slots;
+    page_hdr->free_space_offset -= alloc_len;
+    memcpy(page_handle.page->get_data() + page_hdr->free_space_offset, tuple, len);
+    RmSlot *slot = page_handle.get_slot_entry(slot_no);
+    slot->offset = page_hdr->free_space_offset;
+    slot->len = alloc_len | flags;
+    page_hdr->num_records++;
+    update_free_space_map(page_handle);
+    return slot_no;
+}
+
+/**
+ * @description: 删除slotted page中的一个元组，并压缩元组区使空闲空间保持连续
+ */
+void RmFileHandle::slotted_erase(RmPageHandle &page_handle, int slot_no) {
+    RmPageHdr *page_hdr = page_handle.page_hdr;
+    RmSlot *slot = page_handle.get_slot_entry(slot_no);
+    int offset = slot->offset;
+    int alloc_len = slot->len & RM_SLOT_LEN_MASK;
+    char *data = page_handle.page->get_data();
+    // 将位于被删除元组之前的元组整体后移
+    memmove(data + page_hdr->free_space_offset + alloc_len, data + page_hdr->free_space_offset,
+            offset - page_hdr->free_space_offset);
+    for (int i = 0; i < page_hdr->num_slots; ++i) {
+        RmSlot *curr = page_handle.get_slot_entry(i);
+        if ((curr->len & RM_SLOT_LEN_MASK) != 0 && curr->offset < offset) {
+            curr->offset += alloc_len;
+        }
+    }
+    page_hdr->free_space_offset += alloc_len;
+    *slot = {0, 0};
+    page_hdr->num_records--;
+    // 尾部的空槽可以直接回收
+    while (page_hdr->num_slots > 0 && (page_handle.get_slot_entry(page_hdr->num_slots - 1)->len & RM_SLOT_LEN_MASK) == 0) {
+        page_hdr->num_slots--;
+    }
+    update_free_space_map(page_handle);
+}
+
+/**
+ * @description: 找到能放下元组的页面并放入元组
+ * @param {int} exclude_page_no 调用者已经持有写锁的页面，没有则为RM_NO_PAGE
+ * @return {Rid} 元组的位置
+ */
+Rid RmFileHandle::place_tuple(const char *tuple, int len, uint16_t flags, int exclude_page_no) {
+    RmPageHandle page_handle = create_page_handle(exclude_page_no);
+    int page_no = page_handle.page->get_page_id().page_no;
+    // 页面的空闲等级大于0，一定能放下任意一条元组
+    int slot_no = slotted_insert(page_handle, tuple, len, -1, flags);
+    page_handle.page->wunlatch();
+    buffer_pool_manager_->unpin_page({fd_, page_no}, true);
+    return Rid{page_no, slot_no};
+}
+
+/**
+ * @description: 删除slotted page中指定位置上的元组（不处理转发地址）
+ */
+void RmFileHandle::erase_tuple(const Rid &rid) {
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->wlatch();
+    slotted_erase(page_handle, rid.slot_no);
+    page_handle.page->wunlatch();
+    buffer_pool_manager_->unpin_page({fd_, rid.page_no}, true);
 }
\ No newline at end of file
@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include <assert.h>
 
 #include <memory>
+#include <mutex>
 
 #include "bitmap.h"
 #include "common/context.h"
@@ -27,6 +28,7 @@ struct RmPageHandle {
     RmPageHdr *page_hdr;        // page->data的第一部分，存储页面元信息，指针指向首地址，长度为sizeof(RmPageHdr)
     char *bitmap;               // page->data的第二部分，存储页面的bitmap，指针指向首地址，长度为file_hdr->bitmap_size
     char *slots;                // page->data的第三部分，存储表的记录，指针指向首地址，每个slot的长度为file_hdr->record_size
+                                // slotted page没有bitmap，slots指向槽目录，元组存放在页尾的元组区
 
     RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : file_hdr(fhdr_), page(page_) {
         page_hdr = reinterpret_cast<RmPageHdr *>(page->get_data() + page->OFFSET_PAGE_HDR);
@@ -38,6 +40,79 @@ struct RmPageHandle {
     char* get_slot(int slot_no) const {
         return slots + slot_no * file_hdr->record_size;  // slots的首地址 + slot个数 * 每个slot的大小(每个record的大小)
     }
+
+    // PAX：返回记录中偏移为col_offset的字段所在minipage的首地址，minipage按字段偏移顺序依次存放
+    char* get_minipage(int col_offset) const {
+        return slots + file_hdr->num_records_per_page * col_offset;
+    }
+
+    // 定长页面和PAX页面：将slot_no上的记录读出到buf中，PAX页面需要从各个minipage中拼接
+    void read_row(int slot_no, char *buf) const {
+        if (file_hdr->page_format != RM_PAGE_PAX) {
+            memcpy(buf, get_slot(slot_no), file_hdr->record_size);
+            return;
+        }
+        int offset = 0;
+        for (int i = 0; i < file_hdr->num_pax_cols; ++i) {
+            int len = file_hdr->pax_col_lens[i];
+            memcpy(buf + offset, get_minipage(offset) + slot_no * len, len);
+            offset += len;
+        }
+    }
+
+    // 定长页面和PAX页面：将buf写入slot_no，PAX页面需要拆分到各个minipage中
+    void write_row(int slot_no, const char *buf) {
+        if (file_hdr->page_format != RM_PAGE_PAX) {
+            memcpy(get_slot(slot_no), buf, file_hdr->record_size);
+            return;
+        }
+        int offset = 0;
+        for (int i = 0; i < file_hdr->num_pax_cols; ++i) {
+            int len = file_hdr->pax_col_lens[i];
+            memcpy(get_minipage(offset) + slot_no * len, buf + offset, len);
+            offset += len;
+        }
+    }
+
+    // slotted page：返回第slot_no个槽目录项
+    RmSlot* get_slot_entry(int slot_no) const {
+        return reinterpret_cast<RmSlot *>(slots) + slot_no;
+    }
+
+    // slotted page：返回槽目录末尾与元组区之间的连续空闲字节数
+    int free_space() const {
+        int dir_end = (int)(slots - page->get_data()) + page_hdr->num_slots * (int)sizeof(RmSlot);
+        return page_hdr->free_space_offset - dir_end;
+    }
+
+    // 判断slot_no上是否存放了一条对外可见的记录（slotted page中迁移来的元组通过原位置的转发地址访问）
+    bool is_record(int slot_no) const {
+        if (file_hdr->page_format == RM_PAGE_SLOTTED) {
+            if (slot_no < 0 || slot_no >= page_hdr->num_slots) {
+                return false;
+            }
+            uint16_t len = get_slot_entry(slot_no)->len;
+            return (len & RM_SLOT_LEN_MASK) != 0 && (len & RM_SLOT_MOVED) == 0;
+        }
+        if (slot_no < 0 || slot_no >= file_hdr->num_records_per_page) {
+            return false;
+        }
+        return Bitmap::is_set(bitmap, slot_no);
+    }
+
+    // 返回curr之后下一条记录所在的slot_no，没有则返回-1
+    int next_record(int curr) const {
+        if (file_hdr->page_format == RM_PAGE_SLOTTED) {
+            for (int slot_no = curr + 1; slot_no < page_hdr->num_slots; ++slot_no) {
+                if (is_record(slot_no)) {
+                    return slot_no;
+                }
+            }
+            return -1;
+        }
+        int slot_no = Bitmap::next_bit(true, bitmap, file_hdr->num_records_per_page, curr);
+        return slot_no < file_hdr->num_records_per_page ? slot_no : -1;
+    }
 };
 
 /* 每个RmFileHandle对应一个表的数据文件，里面有多个page，每个page的数据封装在RmPageHandle中 */
@@ -50,6 +125,9 @@ class RmFileHandle {
     BufferPoolManager *buffer_pool_manager_;
     int fd_;        // 打开文件后产生的文件句柄
     RmFileHdr file_hdr_;    // 文件头，维护当前表文件的元数据
+    // 保护file_hdr_、空闲空间映射页面和insert_targets_；加锁顺序为先页面锁后latch_，持有latch_时不能等待页面锁
+    std::mutex latch_;
+    int insert_targets_[RM_INSERT_TARGETS];     // 各线程槽位当前的插入目标页面
 
    public:
     RmFileHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
@@ -60,19 +138,29 @@ class RmFileHandle {
         disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
+        std::fill(insert_targets_, insert_targets_ + RM_INSERT_TARGETS, RM_NO_PAGE);
     }
 
     RmFileHdr get_file_hdr() { return file_hdr_; }
     int GetFd() { return fd_; }
 
-    /* 判断指定位置上是否已经存在一条记录，通过Bitmap来判断 */
+    /* 判断指定位置上是否已经存在一条记录，定长页面通过Bitmap来判断，slotted page通过槽目录来判断 */
     bool is_record(const Rid &rid) const {
+        if (is_fsm_page(rid.page_no)) {
+            return false;
+        }
         RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-        return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        page_handle.page->rlatch();
+        bool exist = page_handle.is_record(rid.slot_no);  // page的slot_no位置上是否有record
+        page_handle.page->runlatch();
+        buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
+        return exist;
     }
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
+    void get_records(int page_no, const std::vector<int> &slot_nos, std::vector<std::unique_ptr<RmRecord>> &records) const;
+
     Rid insert_record(char *buf, Context *context);
 
     void insert_record(const Rid &rid, char *buf);
@@ -81,12 +169,51 @@ class RmFileHandle {
 
     void update_record(const Rid &rid, char *buf, Context *context);
 
-    RmPageHandle create_new_page_handle();
-
     RmPageHandle fetch_page_handle(int page_no) const;
 
+    bool is_pax_column(int col_offset, int col_len) const;
+
+    void filter_page(int page_no, const std::vector<RmColumnFilter> &filters, std::vector<int> &slot_nos) const;
+
+    // 判断page_no是否为空闲空间映射页面
+    static bool is_fsm_page(int page_no) {
+        return page_no >= RM_FIRST_RECORD_PAGE && (page_no - RM_FIRST_RECORD_PAGE) % (RM_FSM_ENTRIES_PER_PAGE + 1) == 0;
+    }
+
+    // 返回记录数据页面page_no空闲等级的FSM页面
+    static int fsm_page_of(int page_no) {
+        return page_no - (page_no - RM_FIRST_RECORD_PAGE) % (RM_FSM_ENTRIES_PER_PAGE + 1);
+    }
+
    private:
-    RmPageHandle create_page_handle();
+    RmPageHandle create_new_page_handle();
+
+    RmPageHandle create_page_handle(int exclude_page_no);
+
+    int free_space_bucket(const RmPageHandle &page_handle) const;
+
+    void update_free_space_map(const RmPageHandle &page_handle);
+
+    void set_fsm_bucket(int page_no, int bucket);
+
+    int get_fsm_bucket(int page_no) const;
+
+    int fsm_search(int min_bucket, int exclude_page_no);
+
+    // 以下为slotted page格式使用的辅助函数
+    int max_tuple_len() const;
+
+    int encode_record(const char *buf, char *tuple) const;
+
+    void decode_record(const char *tuple, char *buf) const;
+
+    void read_slot(const RmPageHandle &page_handle, int slot_no, char *buf) const;
+
+    int slotted_insert(RmPageHandle &page_handle, const char *tuple, int len, int slot_no, uint16_t flags);
+
+    void slotted_erase(RmPageHandle &page_handle, int slot_no);
+
+    Rid place_tuple(const char *tuple, int len, uint16_t flags, int exclude_page_no);
 
-    void release_page_handle(RmPageHandle &page_handle);
+    void erase_tuple(const Rid &rid);
 };
\ No newline at end of file
@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #include "bitmap.h"
 #include "rm_defs.h"
 #include "rm_file_handle.h"
+#include "system/sm_meta.h"
 
 /* 记录管理器，用于管理表的数据文件，进行文件的创建、打开、删除、关闭 */
 class RmManager {
@@ -31,7 +32,18 @@ class RmManager {
      * @param {string&} filename 要创建的文件名称
      * @param {int} record_size 表中记录的大小
      */ 
-    void create_file(const std::string& filename, int record_size) {
+    void create_file(const std::string& filename, int record_size) { create_file(filename, record_size, {}); }
+
+    /**
+     * @description: 创建表的数据文件并初始化相关信息，根据表的字段选择页面组织格式
+     * 包含VARCHAR字段的表使用slotted page，变长字段在页面中只占用实际长度；只包含定长字段的表使用定长槽位；
+     * 指定pax时使用PAX页面，VARCHAR字段按最大长度存放在minipage中
+     * @param {string&} filename 要创建的文件名称
+     * @param {int} record_size 表中记录的大小
+     * @param {vector<ColMeta>&} cols 表的字段，按偏移递增排列
+     * @param {bool} pax 是否使用PAX页面
+     */
+    void create_file(const std::string& filename, int record_size, const std::vector<ColMeta>& cols, bool pax = false) {
         if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
             throw InvalidRecordSizeError(record_size);
         }
@@ -43,10 +55,38 @@ class RmManager {
         file_hdr.record_size = record_size;
         file_hdr.num_pages = 1;
         file_hdr.first_free_page_no = RM_NO_PAGE;
-        // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
-        file_hdr.num_records_per_page =
-            (BITMAP_WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmFileHdr)) + 1) / (1 + record_size * BITMAP_WIDTH);
-        file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        file_hdr.format_version = RM_FORMAT_VERSION;
+        // 超出RM_MAX_VAR_COLS的变长字段按定长方式存储
+        for (auto &col : cols) {
+            if (!pax && col.type == TYPE_VARCHAR && file_hdr.num_var_cols < RM_MAX_VAR_COLS) {
+                file_hdr.var_col_offsets[file_hdr.num_var_cols] = col.offset;
+                file_hdr.var_col_lens[file_hdr.num_var_cols] = col.len;
+                file_hdr.num_var_cols++;
+            }
+        }
+        int page_hdr_size = (int)Page::OFFSET_PAGE_HDR + (int)sizeof(RmPageHdr);
+        if (file_hdr.num_var_cols > 0) {
+            file_hdr.page_format = RM_PAGE_SLOTTED;
+            // 每个元组至少占用sizeof(Rid)字节，槽目录项个数不会超过该上限
+            file_hdr.num_records_per_page = (PAGE_SIZE - page_hdr_size) / ((int)sizeof(RmSlot) + (int)sizeof(Rid));
+            file_hdr.bitmap_size = 0;
+        } else {
+            file_hdr.page_format = pax ? RM_PAGE_PAX : RM_PAGE_FIXED;
+            if (pax) {
+                // 每个字段一个minipage，字段过多时剩余字段合并到最后一个minipage
+                for (auto &col : cols) {
+                    if (file_hdr.num_pax_cols < RM_MAX_PAX_COLS) {
+                        file_hdr.pax_col_lens[file_hdr.num_pax_cols++] = col.len;
+                    } else {
+                        file_hdr.pax_col_lens[RM_MAX_PAX_COLS - 1] += col.len;
+                    }
+                }
+            }
+            // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
+            file_hdr.num_records_per_page =
+                (BITMAP_WIDTH * (PAGE_SIZE - 1 - page_hdr_size) + 1) / (1 + record_size * BITMAP_WIDTH);
+            file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        }
 
         // 将file header写入磁盘文件（名为file name，文件描述符为fd）中的第0页
         // head page直接写入磁盘，没有经过缓冲区的NewPage，那么也就不需要FlushPage
@@ -62,13 +102,19 @@ class RmManager {
 
     // 注意这里打开文件，创建并返回了record file handle的指针
     /**
-     * @description: 打开表的数据文件，并返回文件句柄
+     * @description: 打开表的数据文件，并返回文件句柄；文件格式的版本与RM_FORMAT_VERSION不同时关闭文件并抛出异常
      * @param {string&} filename 要打开的文件名称
      * @return {unique_ptr<RmFileHandle>} 文件句柄的指针
      */
     std::unique_ptr<RmFileHandle> open_file(const std::string& filename) {
         int fd = disk_manager_->open_file(filename);
-        return std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        auto file_handle = std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        if (file_handle->file_hdr_.format_version != RM_FORMAT_VERSION) {
+            int version = file_handle->file_hdr_.format_version;
+            disk_manager_->close_file(fd);
+            throw RecordFormatVersionError(filename, version, RM_FORMAT_VERSION);
+        }
+        return file_handle;
     }
     /**
      * @description: 关闭表的数据文件
@@ -9,16 +9,25 @@ MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
 See the Mulan PSL v2 for more details. */
 
 #include "rm_scan.h"
+
+#include <algorithm>
+
 #include "rm_file_handle.h"
 
 /**
  * @brief 初始化file_handle和rid
  * @param file_handle
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
-    // Todo:
+RmScan::RmScan(const RmFileHandle *file_handle) : RmScan(file_handle, RM_FIRST_RECORD_PAGE, -1) {}
+
+/**
+ * @brief 只扫描[begin_page, end_page)范围内的页面，用于把一张表的扫描分给多个线程
+ * @param end_page 为-1时扫描到文件末尾
+ */
+RmScan::RmScan(const RmFileHandle *file_handle, int begin_page, int end_page)
+    : file_handle_(file_handle), end_page_(end_page) {
     // 初始化file_handle和rid（指向第一个存放了记录的位置）
-    rid_.page_no = RM_FIRST_RECORD_PAGE;
+    rid_.page_no = std::max(begin_page, RM_FIRST_RECORD_PAGE);
     rid_.slot_no = -1;
     next(); // 找到第一条记录的页号与槽号
 }
@@ -30,11 +39,18 @@ void RmScan::next() {
     // Todo:
     // 找到文件中下一个存放了记录的非空闲位置，用rid_来指向这个位置
     bool find = false;
-    for(int page_no = rid_.page_no; page_no < file_handle_->file_hdr_.num_pages; ++page_no)
+    int end_page = end_page_ == -1 ? file_handle_->file_hdr_.num_pages : end_page_;
+    for(int page_no = rid_.page_no; page_no < end_page; ++page_no)
     {
+        if(RmFileHandle::is_fsm_page(page_no))  // 跳过空闲空间映射页面
+        {
+            continue;
+        }
         auto page_handle = file_handle_->fetch_page_handle(page_no);
-        int slot_no = Bitmap::next_bit(true, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page, rid_.slot_no);
-        if(slot_no < file_handle_->file_hdr_.num_records_per_page)
+        page_handle.page->rlatch();
+        int slot_no = page_handle.next_record(rid_.slot_no);
+        page_handle.page->runlatch();
+        if(slot_no != -1)
         {
             rid_ = {.page_no = page_no, .slot_no = slot_no};
             file_handle_->buffer_pool_manager_->unpin_page({file_handle_->fd_, page_no}, false);
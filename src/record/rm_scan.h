@@ -17,9 +17,12 @@ class RmFileHandle;
 class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
     Rid rid_;
+    int end_page_;      // 扫描到该页之前为止，-1表示扫描到文件末尾
 public:
     RmScan(const RmFileHandle *file_handle);
 
+    RmScan(const RmFileHandle *file_handle, int begin_page, int end_page);
+
     void next() override;
 
     bool is_end() const override;
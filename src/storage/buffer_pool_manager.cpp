@@ -255,4 +255,32 @@ void BufferPoolManager::flush_all_pages(int fd) {
             page->is_dirty_ = false;
         }
     } 
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 把文件fd在缓冲池中的所有页面写回磁盘，并把它们从缓冲池中移除
+ * 文件关闭之后fd可能被新打开的文件复用，缓冲池中不能留下旧文件的页面
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::remove_all_pages(int fd) {
+    std::scoped_lock lock{latch_};
+    for (size_t i = 0; i < pool_size_; ++i) {
+        Page *page = &pages_[i];
+        if (page->get_page_id().fd != fd || page->get_page_id().page_no == INVALID_PAGE_ID) {
+            continue;
+        }
+        if (page->is_dirty()) {
+            disk_manager_->write_page(fd, page->get_page_id().page_no, page->data_, PAGE_SIZE);
+            page->is_dirty_ = false;
+        }
+        if (page->pin_count_ != 0) {
+            continue;   // 仍在使用的页面只写回
+        }
+        page_table_.erase(page->get_page_id());
+        page->reset_memory();
+        page->id_ = {.fd = -1, .page_no = INVALID_PAGE_ID};
+        // 空闲帧只从free_list_分配，先从LRU链表中移除
+        replacer_->pin(static_cast<frame_id_t>(i));
+        free_list_.push_back(static_cast<frame_id_t>(i));
+    }
+}
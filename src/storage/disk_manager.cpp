@@ -127,6 +127,7 @@ void DiskManager::create_file(const std::string &path) {
     {
         throw UnixError();
     }
+    close(fd);  // 只创建文件，使用时再通过open_file打开
 }
 
 /**
@@ -144,6 +145,7 @@ void DiskManager::destroy_file(const std::string &path) {
         throw FileNotFoundError(path);
     }
     // 文件是否未关闭
+    std::lock_guard<std::mutex> lock(files_latch_);
     if(path2fd_.count(path))
     {
         throw FileNotClosedError(path);
@@ -173,6 +175,7 @@ int DiskManager::open_file(const std::string &path) {
     // {
     //     throw FileNotClosedError(path);
     // }
+    std::lock_guard<std::mutex> lock(files_latch_);
     auto it = path2fd_.find(path);
     if (it != path2fd_.end()) {
         // 如果文件已打开，关闭旧文件描述符
@@ -201,6 +204,7 @@ void DiskManager::close_file(int fd) {
     // 注意不能关闭未打开的文件，并且需要更新文件打开列表
 
     // 文件是否未打开
+    std::lock_guard<std::mutex> lock(files_latch_);
     if(!fd2path_.count(fd))
     {
         throw FileNotOpenError(fd); 
@@ -211,7 +215,7 @@ void DiskManager::close_file(int fd) {
         throw UnixError();
     }
     // 删除打开文件列表中的fd - path
-    auto it1 = path2fd_.find(this->get_file_name(fd)); //删除path2fd中相应的映射
+    auto it1 = path2fd_.find(fd2path_[fd]); //删除path2fd中相应的映射
     if (it1 != path2fd_.end()) {
         path2fd_.erase(it1);
     }
@@ -241,6 +245,7 @@ int DiskManager::get_file_size(const std::string &file_name) {
  * @param {int} fd 文件句柄
  */
 std::string DiskManager::get_file_name(int fd) {
+    std::lock_guard<std::mutex> lock(files_latch_);
     if (!fd2path_.count(fd)) {
         throw FileNotOpenError(fd);
     }
@@ -253,10 +258,14 @@ std::string DiskManager::get_file_name(int fd) {
  * @param {string} &file_name 文件名
  */
 int DiskManager::get_file_fd(const std::string &file_name) {
-    if (!path2fd_.count(file_name)) {
-        return open_file(file_name);
+    {
+        std::lock_guard<std::mutex> lock(files_latch_);
+        auto it = path2fd_.find(file_name);
+        if (it != path2fd_.end()) {
+            return it->second;
+        }
     }
-    return path2fd_[file_name];
+    return open_file(file_name);
 }
 
 
@@ -17,6 +17,7 @@ See the Mulan PSL v2 for more details. */
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -86,12 +87,16 @@ class DiskManager {
      * @param {int} fd 文件对应的句柄
      */
     page_id_t get_fd2pageno(int fd) { return fd2pageno_[fd]; }
-    int get_fd2path(const std::string& path) { return path2fd_[path]; }
+    int get_fd2path(const std::string& path) {
+        std::lock_guard<std::mutex> lock(files_latch_);
+        return path2fd_[path];
+    }
 
     static constexpr int MAX_FD = 8192;
 
    private:
-    // 文件打开列表，用于记录文件是否被打开
+    // 文件打开列表，用于记录文件是否被打开；LSM索引的后台线程会并发地创建、打开和关闭文件，由files_latch_保护
+    std::mutex files_latch_;
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
 
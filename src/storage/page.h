@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <shared_mutex>
+
 #include "common/config.h"
 
 /**
@@ -71,6 +73,17 @@ class Page {
 
     inline void set_page_lsn(lsn_t page_lsn) { memcpy(get_data() + OFFSET_LSN, &page_lsn, sizeof(lsn_t)); }
 
+    // 页面读写锁，保护页面数据在多个线程之间的并发访问，与pin_count_无关
+    inline void wlatch() { latch_.lock(); }
+
+    inline void wunlatch() { latch_.unlock(); }
+
+    inline bool try_wlatch() { return latch_.try_lock(); }
+
+    inline void rlatch() { latch_.lock_shared(); }
+
+    inline void runlatch() { latch_.unlock_shared(); }
+
    private:
     void reset_memory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
@@ -87,4 +100,7 @@ class Page {
 
     /** The pin count of this page. */
     int pin_count_ = 0;
+
+    /** 页面数据的读写锁 */
+    std::shared_mutex latch_;
 };
\ No newline at end of file
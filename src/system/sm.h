@@ -12,4 +12,6 @@ See the Mulan PSL v2 for more details. */
 
 #include "sm_manager.h"
 #include "sm_meta.h"
+#include "sm_stats.h"
 #include "sm_defs.h"
+#include "sm_index_build.h"
@@ -11,3 +11,26 @@ See the Mulan PSL v2 for more details. */
 
 #include "defs.h"
 #include <string>
+
+/* 表的存储方式，通过CREATE TABLE ... USING <storage>指定 */
+enum TabStorage {
+    STORAGE_ROW = 0,    // 行存储：定长槽位，包含VARCHAR字段时使用slotted page
+    STORAGE_PAX = 1,    // PAX：页面内按列划分minipage，适合只访问少数字段的分析型查询
+    STORAGE_COLUMNAR = 2    // 列存储：每个字段一个文件，按段压缩，适合以追加为主的事实表
+};
+
+/* 索引的访问方式，通过CREATE INDEX ... USING <method>指定 */
+enum IndexType {
+    INDEX_BTREE = 0,    // B+树：支持范围查询、INCLUDE列和只访问索引的扫描
+    INDEX_HASH = 1,     // 可扩展哈希：只支持所有索引字段上的等值查找，一次查找只读取一个桶页面
+    INDEX_LSM = 2       // LSM：插入删除只写内存中的memtable，后台写成有序的run并合并，适合以插入为主的表
+};
+
+inline std::string storage2str(TabStorage storage) {
+    std::map<TabStorage, std::string> m = {
+            {STORAGE_ROW, "ROW"},
+            {STORAGE_PAX, "PAX"},
+            {STORAGE_COLUMNAR, "COLUMNAR"}
+    };
+    return m.at(storage);
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "defs.h"
+
+/*
+ * CREATE INDEX CONCURRENTLY：扫描表、批量构建索引期间不阻塞对表的写入
+ * - 开始时登记一个旁路日志，之后写入这张表的语句把每次插入、删除(更新记为删除旧记录再插入新记录)
+ *   连同记录的内容按发生的顺序追加到日志中
+ * - 扫描看到的是登记之后某个时刻的记录，建完之后按顺序把日志回放到新索引上；
+ *   B+树的项按(key, rid)唯一，插入已有的项和删除没有的项都不做修改，所以扫描是否看到某次修改不影响回放的结果
+ * - 先不阻塞写入地回放日志直到剩余的修改足够少，再短暂地独占这张表的IndexBuildLatch，回放剩下的修改并切换到新索引；
+ *   每张表有自己的闩，只阻塞对这张表的写入
+ */
+
+constexpr size_t INDEX_BUILD_CATCHUP_ENTRIES = 1024;    // 旁路日志剩余的修改不超过这个数量时才阻塞写入完成切换
+constexpr int INDEX_BUILD_CATCHUP_ROUNDS = 8;           // 不阻塞写入地回放日志的最多轮数，写入比回放快时也能结束
+
+/* 建索引期间表上的一次修改 */
+struct IndexBuildLogEntry {
+    bool is_insert;             // true为插入，false为删除
+    Rid rid;
+    std::vector<char> rec;      // 插入的新记录或删除的旧记录
+};
+
+/* 一次在线建索引的旁路日志，写入的语句并发追加，建索引的线程分批取走回放 */
+class IndexBuildLog {
+   public:
+    void append(bool is_insert, const Rid &rid, const char *rec, int size) {
+        std::lock_guard<std::mutex> lock(latch_);
+        entries_.push_back({is_insert, rid, std::vector<char>(rec, rec + size)});
+    }
+
+    /* 取走目前为止追加的所有修改 */
+    std::vector<IndexBuildLogEntry> take() {
+        std::vector<IndexBuildLogEntry> entries;
+        std::lock_guard<std::mutex> lock(latch_);
+        entries.swap(entries_);
+        return entries;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(latch_);
+        return entries_.size();
+    }
+
+   private:
+    std::mutex latch_;
+    std::vector<IndexBuildLogEntry> entries_;
+};
+
+/*
+ * 写入表的语句与在线建索引之间的读写闩：语句在修改记录和索引期间共享持有，登记旁路日志和切换到新索引时独占持有
+ * 独占者先占住turnstile_，之后到来的语句在turnstile_上等待，正在执行的语句结束后独占者即可进入，
+ * 不会被源源不断的写入饿死。满足SharedLockable，配合std::shared_lock和std::unique_lock使用
+ */
+class IndexBuildLatch {
+   public:
+    void lock_shared() {
+        { std::lock_guard<std::mutex> turnstile(turnstile_); }
+        latch_.lock_shared();
+    }
+
+    void unlock_shared() { latch_.unlock_shared(); }
+
+    void lock() {
+        turnstile_.lock();
+        latch_.lock();
+    }
+
+    void unlock() {
+        latch_.unlock();
+        turnstile_.unlock();
+    }
+
+   private:
+    std::mutex turnstile_;
+    std::shared_mutex latch_;
+};
+
+/* 一张表上写入的语句与在线建索引之间的同步状态，每张表一个，与表的数据文件句柄同时建立和删除 */
+struct IndexBuildState {
+    IndexBuildLatch latch;                  // 写入这张表的语句共享持有，登记旁路日志和切换到新索引时独占持有
+    std::shared_ptr<IndexBuildLog> log;     // 正在进行的在线建索引的旁路日志，没有时为nullptr，由latch保护
+};
@@ -13,7 +13,11 @@ See the Mulan PSL v2 for more details. */
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <random>
+#include <thread>
 
 #include "index/ix.h"
 #include "record/rm.h"
@@ -98,50 +102,88 @@ void SmManager::open_db(const std::string& db_name) {
     std::ifstream ifs(DB_META_NAME);
     ifs >> db_; // 加载数据库元数据
     ifs.close();
+    // 加载统计信息，从未ANALYZE过的数据库没有统计信息文件
+    std::ifstream stats_ifs(DB_STATS_NAME);
+    if (stats_ifs) {
+        stats_ifs >> stats_;
+    }
     // 打开表文件和索引文件，同时更新fhs_和ihs_
     for(auto& entry : db_.tabs_)
     {
         auto& tab = entry.second;   // 获得表的元数据
+        index_builds_.emplace(tab.name, std::make_unique<IndexBuildState>());
+        if (tab.storage == STORAGE_COLUMNAR) {
+            chs_[tab.name] = cs_manager_->open_file(tab.name, tab.cols.size());
+            continue;
+        }
         fhs_[tab.name] = rm_manager_->open_file(tab.name);  // 加入tab.name - tab的RmFileHandle
         // 每个表上可能有多个索引，因此遍历打开表上的索引文件
         for(auto index : tab.indexes)
         {
-            std::string index_name = ix_manager_->get_index_name(tab.name, tab.cols);
+            if (index.type == INDEX_HASH) {
+                hash_ihs_[ix_manager_->get_hash_index_name(tab.name, index.cols)] =
+                    ix_manager_->open_hash_index(tab.name, index.cols);
+                continue;
+            }
+            if (index.type == INDEX_LSM) {
+                lsm_ihs_[ix_manager_->get_lsm_index_name(tab.name, index.cols)] =
+                    ix_manager_->open_lsm_index(tab.name, index.cols);
+                continue;
+            }
+            std::string index_name = ix_manager_->get_index_name(tab.name, index.cols);
             ihs_[index_name] = ix_manager_->open_index(tab.name, index.cols);   // 加入index_name - 对应的IxHandle
         }
     }
 }
 
 /**
- * @description: 把数据库相关的元数据刷入磁盘中
+ * @description: 把数据库相关的元数据和统计信息刷入磁盘中
  */
 void SmManager::flush_meta() {
     // 默认清空文件
     std::ofstream ofs(DB_META_NAME);
     ofs << db_;
+    std::ofstream stats_ofs(DB_STATS_NAME);
+    stats_ofs << stats_;
 }
 
 /**
  * @description: 关闭数据库并把数据落盘
  */
 void SmManager::close_db() {
-    // 首先将数据库元数据写回文件DB_META_NAME
-    std::ofstream ofs(DB_META_NAME);
-    ofs << db_;
+    // 首先将数据库元数据和统计信息写回文件
+    flush_meta();
     // 然后清理db_，让系统知道db_重置了
     db_.name_.clear();
     db_.tabs_.clear();
+    stats_.clear();
     // 关闭数据库表文件和索引文件
     for(auto& entry : fhs_)
     {
         rm_manager_->close_file(entry.second.get());     
     }
     fhs_.clear();
+    for(auto& entry : chs_)
+    {
+        cs_manager_->close_file(entry.second.get());
+    }
+    chs_.clear();
     for(auto& entry : ihs_)
     {
         ix_manager_->close_index(entry.second.get());
     }
     ihs_.clear();
+    for(auto& entry : hash_ihs_)
+    {
+        ix_manager_->close_hash_index(entry.second.get());
+    }
+    hash_ihs_.clear();
+    for(auto& entry : lsm_ihs_)
+    {
+        ix_manager_->close_lsm_index(entry.second.get());
+    }
+    lsm_ihs_.clear();
+    index_builds_.clear();
     // 回到根目录
     if(chdir("..") < 0)
     {
@@ -198,8 +240,10 @@ void SmManager::desc_table(const std::string& tab_name, Context* context) {
  * @param {string&} tab_name 表的名称
  * @param {vector<ColDef>&} col_defs 表的字段
  * @param {Context*} context 
+ * @param {TabStorage} storage 表的存储方式
  */
-void SmManager::create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context) {
+void SmManager::create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context,
+                             TabStorage storage) {
     if (db_.is_table(tab_name)) {
         throw TableExistsError(tab_name);
     }
@@ -207,6 +251,7 @@ void SmManager::create_table(const std::string& tab_name, const std::vector<ColD
     int curr_offset = 0;
     TabMeta tab;
     tab.name = tab_name;
+    tab.storage = storage;
     for (auto &col_def : col_defs) {
         ColMeta col = {.tab_name = tab_name,
                        .name = col_def.name,
@@ -219,7 +264,15 @@ void SmManager::create_table(const std::string& tab_name, const std::vector<ColD
     }
     // Create & open record file
     int record_size = curr_offset;  // record_size就是col meta所占的大小（表的元数据也是以记录的形式进行存储的）
-    rm_manager_->create_file(tab_name, record_size);
+    index_builds_.emplace(tab_name, std::make_unique<IndexBuildState>());
+    if (storage == STORAGE_COLUMNAR) {
+        cs_manager_->create_file(tab_name, tab.cols);
+        db_.tabs_[tab_name] = tab;
+        chs_.emplace(tab_name, cs_manager_->open_file(tab_name, tab.cols.size()));
+        flush_meta();
+        return;
+    }
+    rm_manager_->create_file(tab_name, record_size, tab.cols, storage == STORAGE_PAX);
     db_.tabs_[tab_name] = tab;
     // fhs_[tab_name] = rm_manager_->open_file(tab_name);
     fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
@@ -235,75 +288,457 @@ void SmManager::create_table(const std::string& tab_name, const std::vector<ColD
 void SmManager::drop_table(const std::string& tab_name, Context* context) {
     // 删除表，需要关闭并删除记录文件和索引文件，最后在ihs_和fhs_中删除该表有关的信息
     TabMeta &tab = db_.get_table(tab_name);
+    if (tab.storage == STORAGE_COLUMNAR) {
+        cs_manager_->close_file(chs_.at(tab_name).get());
+        cs_manager_->destroy_file(tab_name, tab.cols.size());
+        db_.tabs_.erase(tab_name);
+        chs_.erase(tab_name);
+        index_builds_.erase(tab_name);
+        stats_.erase_table(tab_name);
+        flush_meta();
+        return;
+    }
     // 删除记录文件
     rm_manager_->close_file(fhs_[tab.name].get());
     rm_manager_->destroy_file(tab_name);
     // 删除索引文件
-    for(auto& index : tab.indexes)
+    // drop_index会从tab.indexes中删除该索引，不能边遍历边删除
+    while(!tab.indexes.empty())
     {
-        drop_index(tab_name, index.cols, context);
+        auto cols = tab.indexes.back().cols;
+        drop_index(tab_name, cols, context);
     }
     // 删除fhs_和ihs_中的记录
     db_.tabs_.erase(tab_name);
     fhs_.erase(tab_name);   // ihs_在drop_index中删除了，不需要在此删除
+    index_builds_.erase(tab_name);
+    stats_.erase_table(tab_name);
     flush_meta();   // 写回到文件中
 }
 
 void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
+    create_indexes(tab_name, {col_names}, {}, INDEX_BTREE, true, context);
+}
+
+/**
+ * @description: 在一张表上创建一个或多个索引，所有索引共用一次对表的扫描
+ * 表的页面按范围分给多个线程，每个线程把抽取出的(key, rid)加入各个索引的外部排序中属于自己的分区，
+ * 扫描结束后每个索引多路归并各分区的run，自底向上构建B+树
+ * @param {string&} tab_name 表名称
+ * @param {vector<vector<string>>&} index_col_names 每个索引包含的字段名称
+ * @param {vector<string>&} include_col_names 每个索引都存放在叶子中的INCLUDE字段，可以为空
+ * @param {IndexType} index_type 索引的访问方式，哈希索引和LSM索引不支持INCLUDE字段
+ * @param {bool} unique 是否为唯一索引，只支持没有INCLUDE字段的B+树；表中已有重复的key时抛出UniqueKeyViolationError
+ * @param {Context*} context
+ * @param {int} num_threads 扫描表的线程数上限，0表示使用硬件线程数
+ */
+void SmManager::create_indexes(const std::string& tab_name, const std::vector<std::vector<std::string>>& index_col_names,
+                               const std::vector<std::string>& include_col_names, IndexType index_type, bool unique,
+                               Context* context, int num_threads) {
     // 获取表元数据
     TabMeta &tab = db_.get_table(tab_name);
-    IndexMeta index_meta = {tab_name};
-    std::vector<ColMeta>& col_meta = index_meta.cols;
-    
-    // 为每个列创建索引元数据
-    for (auto& col_name : col_names) {
-        auto col = tab.get_col(col_name);
-        col_meta.push_back(*col);  // 将列元数据加入 col_meta
-        index_meta.col_tot_len += col->len;
-        index_meta.col_num++;
-    }
+    std::vector<IndexMeta> index_metas = make_index_metas(tab, index_col_names, include_col_names, index_type, unique);
     if (context && !context->lock_mgr_->lock_exclusive_on_table(context->txn_, disk_manager_->get_fd2path(tab_name)))
         throw TransactionAbortException(context->txn_->get_transaction_id(), AbortReason::LOCK_ON_SHIRINKING);
+    if (index_type == INDEX_HASH) {
+        create_hash_indexes(tab, index_metas, context);
+        return;
+    }
+    if (index_type == INDEX_LSM) {
+        create_lsm_indexes(tab, index_metas, context);
+        return;
+    }
+    std::vector<std::unique_ptr<IxIndexHandle>> ihs;
+    try {
+        build_btree_indexes(tab, index_metas, context, num_threads, &ihs);
+    } catch (...) {
+        // 删除建了一部分的索引文件，之后可以重新建立
+        destroy_btree_files(tab.name, index_metas, ihs);
+        throw;
+    }
+    add_btree_indexes(tab, index_metas, ihs);
     
-    // 创建索引文件
-    ix_manager_->create_index(tab_name, col_meta);  // 只需创建一次索引
+    // 刷新元数据到磁盘
+    flush_meta();
+}
+
+/**
+ * @description: CREATE INDEX CONCURRENTLY：与create_indexes相同地扫描表、批量构建B+树，但扫描和构建期间不阻塞写入，
+ * 期间的修改记在旁路日志中，建完之后回放；只在回放最后一批修改并切换到新索引时短暂地阻塞写入
+ * 只在表上加意向读锁，与其他在这张表上独占加锁的DDL互斥
+ * @param {string&} tab_name 表名称
+ * @param {vector<vector<string>>&} index_col_names 每个索引包含的字段名称
+ * @param {vector<string>&} include_col_names 每个索引都存放在叶子中的INCLUDE字段，可以为空
+ * @param {IndexType} index_type 索引的访问方式，只支持B+树
+ * @param {Context*} context
+ * @param {int} num_threads 扫描表的线程数上限，0表示使用硬件线程数
+ */
+void SmManager::create_indexes_concurrently(const std::string& tab_name,
+                                            const std::vector<std::vector<std::string>>& index_col_names,
+                                            const std::vector<std::string>& include_col_names, IndexType index_type,
+                                            Context* context, int num_threads) {
+    // 哈希索引和LSM索引重复插入同一个(key, rid)时会留下重复的项，回放旁路日志不是幂等的
+    if (index_type == INDEX_HASH) {
+        throw HashIndexUnsupportedError("CREATE INDEX CONCURRENTLY");
+    }
+    if (index_type == INDEX_LSM) {
+        throw LsmIndexUnsupportedError("CREATE INDEX CONCURRENTLY");
+    }
+    TabMeta &tab = db_.get_table(tab_name);
+    std::vector<IndexMeta> index_metas = make_index_metas(tab, index_col_names, include_col_names, index_type, false);
+    if (context && !context->lock_mgr_->lock_IS_on_table(context->txn_, disk_manager_->get_fd2path(tab_name)))
+        throw TransactionAbortException(context->txn_->get_transaction_id(), AbortReason::LOCK_ON_SHIRINKING);
+
+    // 登记旁路日志：等待这张表上正在执行的写入结束，之后开始的写入都会追加到日志中
+    IndexBuildState& state = *index_builds_.at(tab_name);
+    auto build_log = std::make_shared<IndexBuildLog>();
+    {
+        std::unique_lock<IndexBuildLatch> lock(state.latch);
+        if (state.log != nullptr) {
+            throw IndexBuildInProgressError(tab_name);
+        }
+        state.log = build_log;
+    }
+    // 失败时注销旁路日志并删除建了一部分的索引文件，调用者持有state.latch
+    std::vector<std::unique_ptr<IxIndexHandle>> ihs;
+    auto abort_build = [&] {
+        state.log.reset();
+        destroy_btree_files(tab_name, index_metas, ihs);
+    };
+    try {
+        build_btree_indexes(tab, index_metas, context, num_threads, &ihs);
+        // 不阻塞写入地追赶旁路日志，剩余的修改足够少时再阻塞写入
+        for (int round = 0; round < INDEX_BUILD_CATCHUP_ROUNDS && build_log->size() > INDEX_BUILD_CATCHUP_ENTRIES;
+             ++round) {
+            replay_build_log(index_metas, ihs, build_log->take());
+        }
+    } catch (...) {
+        std::unique_lock<IndexBuildLatch> lock(state.latch);
+        abort_build();
+        throw;
+    }
+
+    // 切换：这张表上没有正在执行的写入，回放剩下的修改之后，之后的写入直接维护新索引
+    std::unique_lock<IndexBuildLatch> lock(state.latch);
+    try {
+        replay_build_log(index_metas, ihs, build_log->take());
+    } catch (...) {
+        abort_build();
+        throw;
+    }
+    state.log.reset();
+    add_btree_indexes(tab, index_metas, ihs);
+    flush_meta();
+}
+
+/**
+ * @description: 检查要创建的索引并生成它们的元数据，在创建任何索引文件之前检查，避免只建成一部分
+ */
+std::vector<IndexMeta> SmManager::make_index_metas(TabMeta& tab,
+                                                   const std::vector<std::vector<std::string>>& index_col_names,
+                                                   const std::vector<std::string>& include_col_names,
+                                                   IndexType index_type, bool unique) {
+    if (tab.storage == STORAGE_COLUMNAR) {
+        throw ColumnarUnsupportedError(tab.name, "index");
+    }
+    if (index_type == INDEX_HASH && !include_col_names.empty()) {
+        throw HashIndexUnsupportedError("INCLUDE columns");
+    }
+    if (index_type == INDEX_LSM && !include_col_names.empty()) {
+        throw LsmIndexUnsupportedError("INCLUDE columns");
+    }
+    if (index_type == INDEX_HASH && unique) {
+        throw HashIndexUnsupportedError("UNIQUE");
+    }
+    if (index_type == INDEX_LSM && unique) {
+        throw LsmIndexUnsupportedError("UNIQUE");
+    }
+    // INCLUDE字段排在rid之后，只有允许重复key的格式才有
+    if (unique && !include_col_names.empty()) {
+        throw UniqueIndexUnsupportedError("INCLUDE columns");
+    }
+    std::vector<IndexMeta> index_metas;
+    std::vector<std::string> index_names;
+    for (auto& col_names : index_col_names) {
+        IndexMeta index_meta = {tab.name};
+        index_meta.type = index_type;
+        index_meta.unique = unique;
+        // 为每个列创建索引元数据
+        for (auto& col_name : col_names) {
+            auto col = tab.get_col(col_name);
+            index_meta.cols.push_back(*col);  // 将列元数据加入 col_meta
+            index_meta.col_tot_len += col->len;
+            index_meta.col_num++;
+        }
+        // 已经是索引字段的列不必再存一份
+        for (auto& col_name : include_col_names) {
+            auto col = tab.get_col(col_name);
+            if (!index_meta.has_col(col_name)) {
+                index_meta.include_cols.push_back(*col);
+            }
+        }
+        int stored_len = index_meta.col_tot_len + (unique ? 0 : IX_RID_SUFFIX_LEN) + index_meta.include_len();
+        if (stored_len > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(stored_len);
+        }
+        auto index_name = ix_manager_->get_index_name(tab.name, index_meta.cols);
+        if (ix_manager_->exists(tab.name, index_meta.cols) ||
+            std::find(index_names.begin(), index_names.end(), index_name) != index_names.end()) {
+            throw IndexExistsError(tab.name, col_names);
+        }
+        index_metas.push_back(index_meta);
+        index_names.push_back(index_name);
+    }
+    return index_metas;
+}
+
+/**
+ * @description: 创建B+树索引文件，扫描一遍表为每个索引抽取(key, rid)，外部排序之后批量构建
+ * 建好的索引还没有加入表的元数据中；抛出异常时已经打开的句柄留在ihs中，由调用者用destroy_btree_files删除
+ * @param {vector<unique_ptr<IxIndexHandle>>*} ihs 依次追加每个索引打开的句柄
+ */
+void SmManager::build_btree_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context,
+                                    int num_threads, std::vector<std::unique_ptr<IxIndexHandle>>* ihs) {
+    // 获取记录文件句柄
+    auto file_handle = fhs_.at(tab.name).get();
+    int num_pages = file_handle->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
+    if (num_threads <= 0) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    int num_workers = std::max(1, std::min(num_threads, num_pages / IX_BUILD_MIN_PAGES_PER_THREAD));
     
-    // 打开索引文件并保存句柄
-    auto ih = ix_manager_->open_index(tab_name, col_meta);
+    // 创建并打开索引文件，每个索引一个外部排序，每个扫描线程一个分区，内存预算由各个索引平分
+    std::vector<std::unique_ptr<IxSorter>> sorters;
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        // 唯一索引不追加rid，单列key可以使用专用的查找内核
+        int format_version = index_metas[i].unique ? IX_FORMAT_VERSION : IX_FORMAT_DUPLICATE_KEYS;
+        ix_manager_->create_index(tab.name, index_metas[i].cols, format_version, index_metas[i].include_cols);
+        ihs->push_back(ix_manager_->open_index(tab.name, index_metas[i].cols));
+        sorters.push_back(std::make_unique<IxSorter>((*ihs)[i]->get_file_hdr(),
+                                                     ix_manager_->get_index_name(tab.name, index_metas[i].cols),
+                                                     IX_SORT_MEMORY_BUDGET / index_metas.size(), 0, num_workers));
+    }
     
-    // 获取记录文件句柄
-    auto file_handle = fhs_.at(tab_name).get();
+    // 扫描[begin_page, end_page)中的每一条记录，为每个索引抽取(key, rid)
+    auto extract = [&](int part, int begin_page, int end_page) {
+        std::vector<std::vector<char>> keys;
+        for (auto& index_meta : index_metas) {
+            keys.emplace_back(index_meta.col_tot_len + index_meta.include_len());
+        }
+        for (RmScan rm_scan(file_handle, begin_page, end_page); !rm_scan.is_end(); rm_scan.next()) {
+            auto rec = file_handle->get_record(rm_scan.rid(), context);  // 获取记录
+            for (size_t i = 0; i < index_metas.size(); ++i) {
+                // 获取联合键的值（多个列拼接在一起），之后是INCLUDE列
+                index_metas[i].make_key(rec->data, keys[i].data());
+                sorters[i]->add(keys[i].data(), rm_scan.rid(), part);
+            }
+        }
+    };
+    if (num_workers == 1) {
+        extract(0, RM_FIRST_RECORD_PAGE, -1);
+    } else {
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(num_workers);
+        for (int w = 0; w < num_workers; ++w) {
+            // 最后一个线程扫描到文件末尾
+            int begin_page = RM_FIRST_RECORD_PAGE + static_cast<int>(1LL * num_pages * w / num_workers);
+            int end_page = w + 1 == num_workers
+                               ? -1
+                               : RM_FIRST_RECORD_PAGE + static_cast<int>(1LL * num_pages * (w + 1) / num_workers);
+            workers.emplace_back([&, w, begin_page, end_page] {
+                try {
+                    extract(w, begin_page, end_page);
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
     
-    // 扫描表中的每一条记录，并将其插入索引
-    for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
-        auto rec = file_handle->get_record(rm_scan.rid(), context);  // 获取记录
-        
-        // 获取联合键的值（多个列拼接在一起）
-        std::vector<char> key;
-        for (const auto& col : col_meta) {
-            const char* col_data = rec->data + col.offset;
-            key.insert(key.end(), col_data, col_data + col.len);
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        // 按key有序地自底向上构建B+树，避免逐条插入引起的反复分裂
+        sorters[i]->finish();
+        if (!(*ihs)[i]->bulk_load(sorters[i].get(), IX_BULK_FILL_FACTOR)) {
+            throw UniqueKeyViolationError(tab.name, index_metas[i].col_names());
         }
+        sorters[i].reset();     // 删除临时文件
+    }
+}
+
+/**
+ * @description: 删除建立失败的B+树索引：关闭已经打开的句柄，删除已经创建的索引文件
+ * make_index_metas保证这些索引文件在建立之前都不存在，存在的文件都是这次建立的
+ */
+void SmManager::destroy_btree_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                                    std::vector<std::unique_ptr<IxIndexHandle>>& ihs) {
+    for (auto& ih : ihs) {
+        ix_manager_->close_index(ih.get());
+    }
+    ihs.clear();
+    for (auto& index_meta : index_metas) {
+        if (disk_manager_->is_file(ix_manager_->get_index_name(tab_name, index_meta.cols))) {
+            ix_manager_->destroy_index(tab_name, index_meta.cols);
+        }
+    }
+}
+
+/**
+ * @description: 把建好的B+树索引加入ihs_和表的元数据中，之后写入表的语句开始维护它们
+ */
+void SmManager::add_btree_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas,
+                                  std::vector<std::unique_ptr<IxIndexHandle>>& ihs) {
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        // 保存索引句柄
+        auto index_name = ix_manager_->get_index_name(tab.name, index_metas[i].cols);
+        assert(ihs_.count(index_name) == 0);
+        ihs_.emplace(index_name, std::move(ihs[i]));  // 使用 std::move 避免拷贝
         
-        // 将键和值插入索引，值是记录的 RID
-        ih->insert_entry(key.data(), rm_scan.rid(), context->txn_);
+        // 更新表元数据，标记列已经创建索引
+        tab.indexes.push_back(index_metas[i]);
+        for (auto& col : index_metas[i].cols) {
+            tab.get_col(col.name)->index = true;
+        }
     }
-    
-    // 保存索引句柄
-    auto index_name = ix_manager_->get_index_name(tab_name, col_meta);
-    assert(ihs_.count(index_name) == 0);
-    ihs_.emplace(index_name, std::move(ih));  // 使用 std::move 避免拷贝
-    
-    // 更新表元数据，标记列已经创建索引
-    tab.indexes.push_back(index_meta);
-    for (auto& col : col_meta) {
-        tab.get_col(col.name)->index = true;
+}
+
+/**
+ * @description: 按顺序把旁路日志中的修改应用到新建的索引上，插入已有的项和删除没有的项都不做修改
+ */
+void SmManager::replay_build_log(const std::vector<IndexMeta>& index_metas,
+                                 const std::vector<std::unique_ptr<IxIndexHandle>>& ihs,
+                                 const std::vector<IndexBuildLogEntry>& entries) {
+    char key[IX_MAX_COL_LEN];
+    for (auto& entry : entries) {
+        for (size_t i = 0; i < index_metas.size(); ++i) {
+            index_metas[i].make_key(entry.rec.data(), key);
+            if (entry.is_insert) {
+                ihs[i]->insert_entry(key, entry.rid, nullptr);
+            } else {
+                ihs[i]->delete_entry(key, entry.rid, nullptr);
+            }
+        }
+    }
+}
+
+/**
+ * @description: 创建哈希索引：扫描一遍表，把每条记录的(key, rid)逐条插入各个哈希索引
+ * 哈希索引的插入不会引起大范围的结构调整，不需要像B+树那样先排序再批量构建
+ */
+void SmManager::create_hash_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context) {
+    auto file_handle = fhs_.at(tab.name).get();
+    std::vector<std::unique_ptr<IxHashHandle>> ihs;
+    try {
+        for (auto& index_meta : index_metas) {
+            ix_manager_->create_hash_index(tab.name, index_meta.cols);
+            ihs.push_back(ix_manager_->open_hash_index(tab.name, index_meta.cols));
+        }
+        char key[IX_MAX_COL_LEN];
+        for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
+            auto rec = file_handle->get_record(rm_scan.rid(), context);
+            for (size_t i = 0; i < index_metas.size(); ++i) {
+                index_metas[i].make_key(rec->data, key);
+                ihs[i]->insert_entry(key, rm_scan.rid(), nullptr);
+            }
+        }
+    } catch (...) {
+        // 删除建了一部分的索引文件，之后可以重新建立
+        destroy_hash_files(tab.name, index_metas, ihs);
+        throw;
+    }
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        hash_ihs_.emplace(ix_manager_->get_hash_index_name(tab.name, index_metas[i].cols), std::move(ihs[i]));
+        tab.indexes.push_back(index_metas[i]);
+        for (auto& col : index_metas[i].cols) {
+            tab.get_col(col.name)->index = true;
+        }
     }
-    
-    // 刷新元数据到磁盘
     flush_meta();
 }
 
+/**
+ * @description: 删除建立失败的哈希索引：关闭已经打开的句柄，删除已经创建的索引文件
+ * make_index_metas保证这些索引文件在建立之前都不存在，存在的文件都是这次建立的
+ */
+void SmManager::destroy_hash_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                                   std::vector<std::unique_ptr<IxHashHandle>>& ihs) {
+    for (auto& ih : ihs) {
+        ix_manager_->close_hash_index(ih.get());
+    }
+    ihs.clear();
+    for (auto& index_meta : index_metas) {
+        if (disk_manager_->is_file(ix_manager_->get_hash_index_name(tab_name, index_meta.cols))) {
+            ix_manager_->destroy_hash_index(tab_name, index_meta.cols);
+        }
+    }
+}
+
+/**
+ * @description: 创建LSM索引：扫描一遍表，把每条记录的(key, rid)插入memtable，由后台线程写成run并合并，
+ * 最后等待所有memtable写出，建好的索引全部在磁盘上
+ */
+void SmManager::create_lsm_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context) {
+    auto file_handle = fhs_.at(tab.name).get();
+    std::vector<std::unique_ptr<IxLsmHandle>> ihs;
+    try {
+        for (auto& index_meta : index_metas) {
+            ix_manager_->create_lsm_index(tab.name, index_meta.cols);
+            ihs.push_back(ix_manager_->open_lsm_index(tab.name, index_meta.cols));
+        }
+        char key[IX_MAX_COL_LEN];
+        for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
+            auto rec = file_handle->get_record(rm_scan.rid(), context);
+            for (size_t i = 0; i < index_metas.size(); ++i) {
+                index_metas[i].make_key(rec->data, key);
+                ihs[i]->insert_entry(key, rm_scan.rid(), nullptr);
+            }
+        }
+        for (auto& ih : ihs) {
+            ih->flush();
+        }
+    } catch (...) {
+        // 停止后台线程，删除建了一部分的索引文件，之后可以重新建立
+        destroy_lsm_files(tab.name, index_metas, ihs);
+        throw;
+    }
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        lsm_ihs_.emplace(ix_manager_->get_lsm_index_name(tab.name, index_metas[i].cols), std::move(ihs[i]));
+        tab.indexes.push_back(index_metas[i]);
+        for (auto& col : index_metas[i].cols) {
+            tab.get_col(col.name)->index = true;
+        }
+    }
+    flush_meta();
+}
+
+/**
+ * @description: 删除建立失败的LSM索引：析构已经打开的句柄，停止后台线程并关闭已经写出的run，
+ * 再删除清单文件和其中记录的run；没有打开过的索引没有run，创建到一半的清单文件可能不完整，只删除清单文件
+ * make_index_metas保证这些索引文件在建立之前都不存在，存在的文件都是这次建立的
+ */
+void SmManager::destroy_lsm_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                                  std::vector<std::unique_ptr<IxLsmHandle>>& ihs) {
+    size_t num_opened = ihs.size();
+    ihs.clear();
+    for (size_t i = 0; i < index_metas.size(); ++i) {
+        std::string index_name = ix_manager_->get_lsm_index_name(tab_name, index_metas[i].cols);
+        if (!disk_manager_->is_file(index_name)) {
+            continue;
+        }
+        if (i < num_opened) {
+            ix_manager_->destroy_lsm_index(tab_name, index_metas[i].cols);
+        } else {
+            disk_manager_->destroy_file(index_name);
+        }
+    }
+}
 
 /**
  * @description: 删除索引
@@ -313,14 +748,28 @@ void SmManager::create_index(const std::string& tab_name, const std::vector<std:
  */
 void SmManager::drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
     // // 关闭索引文件然后删除它，清空ihs_中对应的index
-    std::string index_name = ix_manager_->get_index_name(tab_name, col_names);
-    // 关闭并删除索引文件
-    ix_manager_->close_index(ihs_[index_name].get());
-    ix_manager_->destroy_index(tab_name, col_names);
-    // 更新表的indexe和ihs_
     TabMeta& tab = db_.get_table(tab_name);
-    tab.indexes.erase(tab.get_index_meta(col_names));
-    ihs_.erase(index_name);
+    auto index_meta = tab.get_index_meta(col_names);
+    if (index_meta->type == INDEX_HASH) {
+        std::string index_name = ix_manager_->get_hash_index_name(tab_name, index_meta->cols);
+        ix_manager_->close_hash_index(hash_ihs_.at(index_name).get());
+        ix_manager_->destroy_hash_index(tab_name, index_meta->cols);
+        hash_ihs_.erase(index_name);
+    } else if (index_meta->type == INDEX_LSM) {
+        std::string index_name = ix_manager_->get_lsm_index_name(tab_name, index_meta->cols);
+        ix_manager_->close_lsm_index(lsm_ihs_.at(index_name).get());
+        lsm_ihs_.erase(index_name);
+        ix_manager_->destroy_lsm_index(tab_name, index_meta->cols);
+    } else {
+        std::string index_name = ix_manager_->get_index_name(tab_name, col_names);
+        // 关闭并删除索引文件
+        ix_manager_->close_index(ihs_[index_name].get());
+        ix_manager_->destroy_index(tab_name, col_names);
+        ihs_.erase(index_name);
+    }
+    // 更新表的indexe和ihs_
+    tab.indexes.erase(index_meta);
+    stats_.erase_index(tab_name, col_names);
     for(auto col_name : col_names)
     {
         auto index_col = tab.get_col(col_name);
@@ -344,4 +793,108 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<ColMet
         col_names.push_back(col.name);  // 记录索引名称
     }
     drop_index(tab_name, col_names, context);
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 收集表的统计信息，保存到DB_STATS_NAME中
+ * 数据页面不超过STATS_SAMPLE_PAGES时读取整张表，否则把页面均匀分成STATS_SAMPLE_PAGES段，每段随机读取一页，
+ * 由样本估计行数、每个字段的NDV和等深直方图；
+ * 每个B+树索引用IxScan读取一遍叶子，得到树高、叶子数、项数和不同key的个数，
+ * 索引项与表中的行一一对应，因此表的行数和索引第一个字段的NDV使用索引中的精确值
+ * @param {string&} tab_name 表名称
+ * @param {Context*} context
+ */
+void SmManager::analyze_table(const std::string& tab_name, Context* context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    if (tab.storage == STORAGE_COLUMNAR) {
+        throw ColumnarUnsupportedError(tab_name, "ANALYZE");
+    }
+    if (context && !context->lock_mgr_->lock_shared_on_table(context->txn_, disk_manager_->get_fd2path(tab_name)))
+        throw TransactionAbortException(context->txn_->get_transaction_id(), AbortReason::LOCK_ON_SHIRINKING);
+
+    TabStats stats;
+    stats.name = tab_name;
+    // 索引的统计信息，同时得到精确的行数和索引第一个字段的NDV
+    std::map<std::string, long long> exact_ndv;
+    long long exact_rows = -1;
+    for (auto& index : tab.indexes) {
+        if (index.type != INDEX_BTREE) {
+            continue;   // 哈希索引和LSM索引没有单一的树结构，不统计层次和叶子
+        }
+        auto ih = ihs_.at(ix_manager_->get_index_name(tab_name, index.cols)).get();
+        IndexStats index_stats;
+        for (auto& col : index.cols) {
+            index_stats.col_names.push_back(col.name);
+        }
+        index_stats.height = ih->get_height();
+        // 叶子中的key按顺序排列，与前一项不同就是一个新的值
+        std::string prev_key;
+        long long first_ndv = 0;
+        page_id_t prev_leaf = IX_NO_PAGE;
+        int first_len = index.cols[0].len;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_, true); !scan.is_end(); scan.next()) {
+            if (scan.iid().page_no != prev_leaf) {
+                prev_leaf = scan.iid().page_no;
+                index_stats.num_leaves++;
+            }
+            const char *key = scan.key();
+            if (index_stats.num_entries == 0 || memcmp(key, prev_key.data(), index.col_tot_len) != 0) {
+                if (index_stats.num_entries == 0 || memcmp(key, prev_key.data(), first_len) != 0) {
+                    first_ndv++;
+                }
+                index_stats.ndv++;
+                prev_key.assign(key, index.col_tot_len);
+            }
+            index_stats.num_entries++;
+        }
+        exact_rows = index_stats.num_entries;
+        exact_ndv[index.cols[0].name] = first_ndv;
+        stats.indexes.push_back(std::move(index_stats));
+    }
+
+    // 抽样读取表的页面，每个字段的样本为各行中该字段的原始值
+    auto file_handle = fhs_.at(tab_name).get();
+    int num_pages = file_handle->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
+    std::vector<std::vector<std::string>> samples(tab.cols.size());
+    long long sampled_rows = 0;
+    auto sample = [&](int begin_page, int end_page) {
+        for (RmScan rm_scan(file_handle, begin_page, end_page); !rm_scan.is_end(); rm_scan.next()) {
+            auto rec = file_handle->get_record(rm_scan.rid(), context);
+            for (size_t i = 0; i < tab.cols.size(); ++i) {
+                samples[i].emplace_back(rec->data + tab.cols[i].offset, tab.cols[i].len);
+            }
+            sampled_rows++;
+        }
+    };
+    stats.num_pages = num_pages;
+    if (num_pages <= STATS_SAMPLE_PAGES) {
+        sample(RM_FIRST_RECORD_PAGE, -1);
+        stats.sampled_pages = num_pages;
+        stats.num_rows = sampled_rows;
+    } else {
+        std::mt19937 rng(num_pages);    // 固定的种子，同样的表得到同样的统计信息
+        for (int i = 0; i < STATS_SAMPLE_PAGES; ++i) {
+            int begin = static_cast<int>(1LL * num_pages * i / STATS_SAMPLE_PAGES);
+            int end = static_cast<int>(1LL * num_pages * (i + 1) / STATS_SAMPLE_PAGES);
+            int page_no = RM_FIRST_RECORD_PAGE + begin + static_cast<int>(rng() % (end - begin));
+            sample(page_no, page_no + 1);
+        }
+        stats.sampled_pages = STATS_SAMPLE_PAGES;
+        stats.num_rows = std::llround(static_cast<double>(sampled_rows) * num_pages / STATS_SAMPLE_PAGES);
+    }
+    if (exact_rows >= 0) {
+        stats.num_rows = exact_rows;
+    }
+
+    for (size_t i = 0; i < tab.cols.size(); ++i) {
+        ColStats col_stats = ColStats::build(tab.cols[i], samples[i], stats.num_rows);
+        auto exact = exact_ndv.find(tab.cols[i].name);
+        if (exact != exact_ndv.end()) {
+            col_stats.ndv = exact->second;
+        }
+        stats.cols.push_back(std::move(col_stats));
+        std::vector<std::string>().swap(samples[i]);    // 尽早释放样本
+    }
+    stats_.set_table(std::move(stats));
+    flush_meta();
+}
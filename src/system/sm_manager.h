@@ -10,10 +10,13 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "column/cs.h"
 #include "index/ix.h"
 #include "record/rm_file_handle.h"
 #include "sm_defs.h"
+#include "sm_index_build.h"
 #include "sm_meta.h"
+#include "sm_stats.h"
 #include "common/context.h"
 
 class Context;
@@ -28,13 +31,19 @@ struct ColDef {
 class SmManager {
    public:
     DbMeta db_;             // 当前打开的数据库的元数据
+    DbStats stats_;         // 当前打开的数据库中ANALYZE过的表的统计信息
     std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;    // file name -> record file handle, 当前数据库中每张表的数据文件
     std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;   // file name -> index file handle, 当前数据库中每个索引的文件
+    std::unordered_map<std::string, std::unique_ptr<IxHashHandle>> hash_ihs_;   // file name -> hash index handle, 当前数据库中每个哈希索引的文件
+    std::unordered_map<std::string, std::unique_ptr<IxLsmHandle>> lsm_ihs_;     // file name -> LSM index handle, 当前数据库中每个LSM索引的清单文件
+    std::unordered_map<std::string, std::unique_ptr<CsTableHandle>> chs_;   // table name -> columnar table handle, 当前数据库中每张列存表的句柄
    private:
     DiskManager* disk_manager_;
     BufferPoolManager* buffer_pool_manager_;
     RmManager* rm_manager_;
     IxManager* ix_manager_;
+    std::unique_ptr<CsManager> cs_manager_;     // 列存表只直接读写磁盘文件，由SmManager自行创建
+    std::unordered_map<std::string, std::unique_ptr<IndexBuildState>> index_builds_;  // table name -> 表上写入与在线建索引的同步状态
 
    public:
     SmManager(DiskManager* disk_manager, BufferPoolManager* buffer_pool_manager, RmManager* rm_manager,
@@ -42,7 +51,8 @@ class SmManager {
         : disk_manager_(disk_manager),
           buffer_pool_manager_(buffer_pool_manager),
           rm_manager_(rm_manager),
-          ix_manager_(ix_manager) {}
+          ix_manager_(ix_manager),
+          cs_manager_(std::make_unique<CsManager>(disk_manager)) {}
 
     ~SmManager() {}
 
@@ -52,6 +62,33 @@ class SmManager {
 
     IxManager* get_ix_manager() { return ix_manager_; }  
 
+    /* 表上一个索引的句柄，B+树保存在ihs_中，哈希索引保存在hash_ihs_中，LSM索引保存在lsm_ihs_中 */
+    IxIndex* get_index_handle(const std::string& tab_name, const IndexMeta& index) {
+        if (index.type == INDEX_HASH) {
+            return hash_ihs_.at(ix_manager_->get_hash_index_name(tab_name, index.cols)).get();
+        }
+        if (index.type == INDEX_LSM) {
+            return lsm_ihs_.at(ix_manager_->get_lsm_index_name(tab_name, index.cols)).get();
+        }
+        return ihs_.at(ix_manager_->get_index_name(tab_name, index.cols)).get();
+    }
+
+    /**
+     * @brief 写入表的语句修改记录和索引之前调用，持有返回的锁直到修改完成：
+     * 持有期间表上的索引列表不会因为在线建索引而改变
+     *
+     * @param[out] build_log 表上正在在线建索引时为旁路日志，修改需要追加到其中，否则为nullptr
+     */
+    std::shared_lock<IndexBuildLatch> lock_table_write(const std::string& tab_name, IndexBuildLog** build_log) {
+        auto& state = *index_builds_.at(tab_name);
+        std::shared_lock<IndexBuildLatch> lock(state.latch);
+        *build_log = state.log.get();
+        return lock;
+    }
+
+    /* 判断表是否使用列存储，列存表的句柄保存在chs_中而不是fhs_中 */
+    bool is_columnar(const std::string& tab_name) { return db_.get_table(tab_name).storage == STORAGE_COLUMNAR; }
+
     bool is_dir(const std::string& db_name);
 
     void create_db(const std::string& db_name);
@@ -68,13 +105,54 @@ class SmManager {
 
     void desc_table(const std::string& tab_name, Context* context);
 
-    void create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context);
+    void create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context,
+                      TabStorage storage = STORAGE_ROW);
 
     void drop_table(const std::string& tab_name, Context* context);
 
     void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
 
+    void create_indexes(const std::string& tab_name, const std::vector<std::vector<std::string>>& index_col_names,
+                        const std::vector<std::string>& include_col_names, IndexType index_type, bool unique,
+                        Context* context, int num_threads = 0);
+
+    void create_indexes_concurrently(const std::string& tab_name,
+                                     const std::vector<std::vector<std::string>>& index_col_names,
+                                     const std::vector<std::string>& include_col_names, IndexType index_type,
+                                     Context* context, int num_threads = 0);
+
     void drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
+
     
     void drop_index(const std::string& tab_name, const std::vector<ColMeta>& col_names, Context* context);
+
+    void analyze_table(const std::string& tab_name, Context* context);
+
+   private:
+    std::vector<IndexMeta> make_index_metas(TabMeta& tab, const std::vector<std::vector<std::string>>& index_col_names,
+                                            const std::vector<std::string>& include_col_names, IndexType index_type,
+                                            bool unique);
+
+    void build_btree_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context,
+                             int num_threads, std::vector<std::unique_ptr<IxIndexHandle>>* ihs);
+
+    void destroy_btree_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                             std::vector<std::unique_ptr<IxIndexHandle>>& ihs);
+
+    void add_btree_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas,
+                           std::vector<std::unique_ptr<IxIndexHandle>>& ihs);
+
+    void replay_build_log(const std::vector<IndexMeta>& index_metas,
+                          const std::vector<std::unique_ptr<IxIndexHandle>>& ihs,
+                          const std::vector<IndexBuildLogEntry>& entries);
+
+    void create_hash_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context);
+
+    void destroy_hash_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                            std::vector<std::unique_ptr<IxHashHandle>>& ihs);
+
+    void create_lsm_indexes(TabMeta& tab, const std::vector<IndexMeta>& index_metas, Context* context);
+
+    void destroy_lsm_files(const std::string& tab_name, const std::vector<IndexMeta>& index_metas,
+                           std::vector<std::unique_ptr<IxLsmHandle>>& ihs);
 };
\ No newline at end of file
@@ -11,6 +11,7 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <string>
@@ -45,22 +46,71 @@ struct IndexMeta {
     int col_tot_len;                // 索引字段长度总和
     int col_num;                    // 索引字段数量
     std::vector<ColMeta> cols;      // 索引包含的字段
+    std::vector<ColMeta> include_cols;  // INCLUDE字段，只存放在叶子的索引项中，不参与查找
+    IndexType type = INDEX_BTREE;       // 索引的访问方式
+    bool unique = false;                // 唯一索引：B+树不追加rid，插入已有的key时报错；非唯一索引允许重复key
+
+    /* 从表的记录中按索引字段的顺序拼接出key，之后紧跟INCLUDE字段，key至少有col_tot_len + include_len()字节 */
+    void make_key(const char *rec_data, char *key) const {
+        int offset = 0;
+        for (auto &col : cols) {
+            memcpy(key + offset, rec_data + col.offset, col.len);
+            offset += col.len;
+        }
+        for (auto &col : include_cols) {
+            memcpy(key + offset, rec_data + col.offset, col.len);
+            offset += col.len;
+        }
+    }
+
+    int include_len() const {
+        int len = 0;
+        for (auto &col : include_cols) {
+            len += col.len;
+        }
+        return len;
+    }
+
+    std::vector<std::string> col_names() const {
+        std::vector<std::string> names;
+        for (auto &col : cols) {
+            names.push_back(col.name);
+        }
+        return names;
+    }
+
+    /* 索引项中是否存有该字段（索引字段或INCLUDE字段） */
+    bool has_col(const std::string &col_name) const {
+        auto match = [&](const ColMeta &col) { return col.name == col_name; };
+        return std::any_of(cols.begin(), cols.end(), match) ||
+               std::any_of(include_cols.begin(), include_cols.end(), match);
+    }
 
     friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
-        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num;
+        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num << " " << index.include_cols.size()
+           << " " << index.type << " " << index.unique;
         for(auto& col: index.cols) {
             os << "\n" << col;
         }
+        for(auto& col: index.include_cols) {
+            os << "\n" << col;
+        }
         return os;
     }
 
     friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
-        is >> index.tab_name >> index.col_tot_len >> index.col_num;
+        size_t include_num;
+        is >> index.tab_name >> index.col_tot_len >> index.col_num >> include_num >> index.type >> index.unique;
         for(int i = 0; i < index.col_num; ++i) {
             ColMeta col;
             is >> col;
             index.cols.push_back(col);
         }
+        for(size_t i = 0; i < include_num; ++i) {
+            ColMeta col;
+            is >> col;
+            index.include_cols.push_back(col);
+        }
         return is;
     }
 };
@@ -70,11 +120,13 @@ struct TabMeta {
     std::string name;                   // 表名称
     std::vector<ColMeta> cols;          // 表包含的字段
     std::vector<IndexMeta> indexes;     // 表上建立的索引
+    TabStorage storage = STORAGE_ROW;   // 表的存储方式
 
     TabMeta(){}
 
     TabMeta(const TabMeta &other) {
         name = other.name;
+        storage = other.storage;
         for(auto col : other.cols) cols.push_back(col);
     }
 
@@ -128,7 +180,7 @@ struct TabMeta {
     }
 
     friend std::ostream &operator<<(std::ostream &os, const TabMeta &tab) {
-        os << tab.name << '\n' << tab.cols.size() << '\n';
+        os << tab.name << ' ' << tab.storage << '\n' << tab.cols.size() << '\n';
         for (auto &col : tab.cols) {
             os << col << '\n';  // col是ColMeta类型，然后调用重载的ColMeta的操作符<<
         }
@@ -141,7 +193,7 @@ struct TabMeta {
 
     friend std::istream &operator>>(std::istream &is, TabMeta &tab) {
         size_t n;
-        is >> tab.name >> n;
+        is >> tab.name >> tab.storage >> n;
         for (size_t i = 0; i < n; i++) {
             ColMeta col;
             is >> col;
@@ -0,0 +1,264 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "sm_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "index/ix_index_handle.h"
+
+/* 直方图的边界是字段的原始字节，可能包含空格和'\0'，按十六进制写入文件 */
+static std::string to_hex(const std::string &raw) {
+    static const char *digits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(raw.size() * 2);
+    for (unsigned char c : raw) {
+        hex.push_back(digits[c >> 4]);
+        hex.push_back(digits[c & 0xf]);
+    }
+    return hex;
+}
+
+static std::string from_hex(const std::string &hex) {
+    auto value = [](char c) { return c <= '9' ? c - '0' : c - 'a' + 10; };
+    std::string raw(hex.size() / 2, '\0');
+    for (size_t i = 0; i < raw.size(); ++i) {
+        raw[i] = static_cast<char>(value(hex[2 * i]) << 4 | value(hex[2 * i + 1]));
+    }
+    return raw;
+}
+
+static double to_double(const char *val, ColType type) {
+    return type == TYPE_INT ? *reinterpret_cast<const int *>(val) : *reinterpret_cast<const float *>(val);
+}
+
+/**
+ * @brief 由字段的样本计算统计信息
+ * NDV：样本就是整张表时为精确值，否则用Haas和Stokes的Duj1估计量 n*d / (n - f1 + f1*n/N)，
+ * 其中n为样本行数，d为样本中不同值的个数，f1为样本中只出现一次的值的个数，N为表的行数
+ *
+ * @param sample 字段在样本各行中的原始值，会被排序
+ * @param num_rows 表的行数
+ */
+ColStats ColStats::build(const ColMeta &col, std::vector<std::string> &sample, long long num_rows) {
+    ColStats stats;
+    stats.name = col.name;
+    stats.type = col.type;
+    stats.len = col.len;
+    if (sample.empty()) {
+        return stats;
+    }
+    auto compare = [&](const std::string &a, const std::string &b) {
+        return ix_compare(a.data(), b.data(), col.type, col.len);
+    };
+    std::sort(sample.begin(), sample.end(), [&](const std::string &a, const std::string &b) { return compare(a, b) < 0; });
+    long long n = sample.size(), d = 0, f1 = 0;
+    for (size_t i = 0; i < sample.size();) {
+        size_t j = i + 1;
+        while (j < sample.size() && compare(sample[i], sample[j]) == 0) {
+            j++;
+        }
+        d++;
+        f1 += j - i == 1;
+        i = j;
+    }
+    if (n >= num_rows) {
+        stats.ndv = d;
+    } else {
+        double estimate = static_cast<double>(n) * d / (n - f1 + static_cast<double>(f1) * n / num_rows);
+        stats.ndv = std::max(d, std::min(num_rows, std::llround(estimate)));
+    }
+    // 等深直方图：样本中第i * n / buckets - 1行的值作为第i个桶的上界
+    long long buckets = std::min<long long>(STATS_HISTOGRAM_BUCKETS, n);
+    stats.bounds.push_back(sample.front());
+    for (long long i = 1; i <= buckets; ++i) {
+        stats.bounds.push_back(sample[i * n / buckets - 1]);
+    }
+    return stats;
+}
+
+/**
+ * @brief 估计字段小于val的行所占的比例
+ * 在val所在的桶内，数值类型按线性插值，字符串取桶的一半
+ */
+double ColStats::fraction_below(const char *val) const {
+    if (ix_compare(val, bounds.front().data(), type, len) <= 0) {
+        return 0;
+    }
+    if (ix_compare(val, bounds.back().data(), type, len) > 0) {
+        return 1;
+    }
+    // 第一个>=val的上界，val落在(bounds[i - 1], bounds[i]]中
+    size_t i = std::lower_bound(bounds.begin() + 1, bounds.end(), val,
+                                [&](const std::string &bound, const char *v) {
+                                    return ix_compare(bound.data(), v, type, len) < 0;
+                                }) - bounds.begin();
+    double within = 0.5;
+    if (type == TYPE_INT || type == TYPE_FLOAT) {
+        double lo = to_double(bounds[i - 1].data(), type), hi = to_double(bounds[i].data(), type);
+        within = (to_double(val, type) - lo) / (hi - lo);
+    }
+    return (i - 1 + within) / (bounds.size() - 1);
+}
+
+/**
+ * @brief 估计条件"字段 op val"的选择率
+ * 等值条件假设每个不同值的行数相同，范围条件使用直方图
+ *
+ * @param val 与字段类型相同、长度为len的原始值
+ * @return 满足条件的行所占的比例，在[0, 1]之间
+ */
+double ColStats::selectivity(CompOp op, const char *val) const {
+    if (bounds.empty()) {
+        return 0;   // ANALYZE时表为空
+    }
+    bool in_range = ix_compare(val, bounds.front().data(), type, len) >= 0 &&
+                    ix_compare(val, bounds.back().data(), type, len) <= 0;
+    double eq = in_range ? 1.0 / std::max(ndv, 1LL) : 0;
+    double below = fraction_below(val);
+    double sel;
+    switch (op) {
+        case OP_EQ: sel = eq; break;
+        case OP_NE: sel = 1 - eq; break;
+        case OP_LT: sel = below; break;
+        case OP_LE: sel = below + eq; break;
+        case OP_GT: sel = 1 - below - eq; break;
+        case OP_GE: sel = 1 - below; break;
+        default: throw InternalError("Unexpected op type");
+    }
+    return std::min(1.0, std::max(0.0, sel));
+}
+
+const ColStats *TabStats::get_col(const std::string &col_name) const {
+    auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColStats &col) { return col.name == col_name; });
+    return pos == cols.end() ? nullptr : &*pos;
+}
+
+const IndexStats *TabStats::get_index(const std::vector<std::string> &col_names) const {
+    auto pos = std::find_if(indexes.begin(), indexes.end(),
+                            [&](const IndexStats &index) { return index.col_names == col_names; });
+    return pos == indexes.end() ? nullptr : &*pos;
+}
+
+/**
+ * @brief 估计一组条件在该表上的选择率，假设各个条件相互独立
+ * 只使用该表上"字段 op 常量"形式的条件，其余条件(连接条件、没有统计信息的字段)视为选择率1
+ */
+double TabStats::selectivity(const std::vector<Condition> &conds) const {
+    double sel = 1;
+    for (auto &cond : conds) {
+        if (!cond.is_rhs_val || cond.lhs_col.tab_name != name || cond.rhs_val.raw == nullptr) {
+            continue;
+        }
+        const ColStats *col = get_col(cond.lhs_col.col_name);
+        if (col == nullptr || !is_compatible_type(col->type, cond.rhs_val.type) || cond.rhs_val.raw->size != col->len) {
+            continue;
+        }
+        sel *= col->selectivity(cond.op, cond.rhs_val.raw->data);
+    }
+    return sel;
+}
+
+void DbStats::erase_index(const std::string &tab_name, const std::vector<std::string> &col_names) {
+    auto pos = tabs_.find(tab_name);
+    if (pos == tabs_.end()) {
+        return;
+    }
+    auto &indexes = pos->second.indexes;
+    indexes.erase(std::remove_if(indexes.begin(), indexes.end(),
+                                 [&](const IndexStats &index) { return index.col_names == col_names; }),
+                  indexes.end());
+}
+
+std::ostream &operator<<(std::ostream &os, const ColStats &col) {
+    os << col.name << ' ' << col.type << ' ' << col.len << ' ' << col.ndv << ' ' << col.bounds.size();
+    for (auto &bound : col.bounds) {
+        os << ' ' << to_hex(bound);
+    }
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, ColStats &col) {
+    size_t n;
+    is >> col.name >> col.type >> col.len >> col.ndv >> n;
+    col.bounds.clear();
+    for (size_t i = 0; i < n; ++i) {
+        std::string hex;
+        is >> hex;
+        col.bounds.push_back(from_hex(hex));
+    }
+    return is;
+}
+
+std::ostream &operator<<(std::ostream &os, const IndexStats &index) {
+    os << index.col_names.size();
+    for (auto &col_name : index.col_names) {
+        os << ' ' << col_name;
+    }
+    return os << ' ' << index.height << ' ' << index.num_leaves << ' ' << index.num_entries << ' ' << index.ndv;
+}
+
+std::istream &operator>>(std::istream &is, IndexStats &index) {
+    size_t n;
+    is >> n;
+    index.col_names.resize(n);
+    for (auto &col_name : index.col_names) {
+        is >> col_name;
+    }
+    return is >> index.height >> index.num_leaves >> index.num_entries >> index.ndv;
+}
+
+std::ostream &operator<<(std::ostream &os, const TabStats &tab) {
+    os << tab.name << ' ' << tab.num_rows << ' ' << tab.num_pages << ' ' << tab.sampled_pages << '\n'
+       << tab.cols.size() << '\n';
+    for (auto &col : tab.cols) {
+        os << col << '\n';
+    }
+    os << tab.indexes.size() << '\n';
+    for (auto &index : tab.indexes) {
+        os << index << '\n';
+    }
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, TabStats &tab) {
+    size_t n;
+    is >> tab.name >> tab.num_rows >> tab.num_pages >> tab.sampled_pages >> n;
+    tab.cols.resize(n);
+    for (auto &col : tab.cols) {
+        is >> col;
+    }
+    is >> n;
+    tab.indexes.resize(n);
+    for (auto &index : tab.indexes) {
+        is >> index;
+    }
+    return is;
+}
+
+std::ostream &operator<<(std::ostream &os, const DbStats &db_stats) {
+    os << db_stats.tabs_.size() << '\n';
+    for (auto &entry : db_stats.tabs_) {
+        os << entry.second;
+    }
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, DbStats &db_stats) {
+    size_t n = 0;
+    is >> n;
+    for (size_t i = 0; i < n; ++i) {
+        TabStats tab;
+        is >> tab;
+        db_stats.tabs_[tab.name] = tab;
+    }
+    return is;
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+#include "sm_meta.h"
+
+/*
+ * ANALYZE收集的统计信息，保存在数据库目录下的DB_STATS_NAME中，供优化器估计条件的选择率和扫描的代价
+ * 统计信息只在ANALYZE时更新，之后的插入删除不会修改它，因此是近似值
+ */
+
+constexpr int STATS_SAMPLE_PAGES = 256;         // ANALYZE最多读取的表页面数量，页面更少时读取整张表
+constexpr int STATS_HISTOGRAM_BUCKETS = 32;     // 每个字段的等深直方图最多的桶数
+
+/* 字段的统计信息 */
+struct ColStats {
+    std::string name;                   // 字段名称
+    ColType type;                       // 字段类型
+    int len;                            // 字段长度
+    long long ndv = 0;                  // 不同值的个数，抽样时为估计值
+    // 等深直方图：bounds[0]为最小值，第i个桶为(bounds[i], bounds[i + 1]]，第一个桶包含最小值，
+    // 每个桶中的行数大致相同，值为字段在记录中的原始字节
+    std::vector<std::string> bounds;
+
+    static ColStats build(const ColMeta &col, std::vector<std::string> &sample, long long num_rows);
+
+    double selectivity(CompOp op, const char *val) const;
+
+    friend std::ostream &operator<<(std::ostream &os, const ColStats &col);
+
+    friend std::istream &operator>>(std::istream &is, ColStats &col);
+
+   private:
+    double fraction_below(const char *val) const;
+};
+
+/* B+树索引的统计信息 */
+struct IndexStats {
+    std::vector<std::string> col_names;     // 索引包含的字段名称
+    int height = 0;                         // 树的层数，只有一个根叶子时为1
+    int num_leaves = 0;                     // 非空叶子的数量
+    long long num_entries = 0;              // 索引项的数量
+    long long ndv = 0;                      // 不同key(所有索引字段)的个数
+
+    friend std::ostream &operator<<(std::ostream &os, const IndexStats &index);
+
+    friend std::istream &operator>>(std::istream &is, IndexStats &index);
+};
+
+/* 表的统计信息 */
+struct TabStats {
+    std::string name;               // 表名称
+    long long num_rows = 0;         // 行数，抽样并且表上没有B+树索引时为估计值
+    int num_pages = 0;              // 表文件中数据页面的数量
+    int sampled_pages = 0;          // ANALYZE读取的数据页面数量，等于num_pages时字段的统计信息是精确的
+    std::vector<ColStats> cols;
+    std::vector<IndexStats> indexes;
+
+    /* 字段的统计信息，没有时返回nullptr */
+    const ColStats *get_col(const std::string &col_name) const;
+
+    /* 索引的统计信息，没有时返回nullptr */
+    const IndexStats *get_index(const std::vector<std::string> &col_names) const;
+
+    double selectivity(const std::vector<Condition> &conds) const;
+
+    friend std::ostream &operator<<(std::ostream &os, const TabStats &tab);
+
+    friend std::istream &operator>>(std::istream &is, TabStats &tab);
+};
+
+/* 数据库中所有表的统计信息，没有ANALYZE过的表没有统计信息 */
+class DbStats {
+   private:
+    std::map<std::string, TabStats> tabs_;  // 表名-表的统计信息
+
+   public:
+    /* 表的统计信息，没有ANALYZE过时返回nullptr */
+    const TabStats *get_table(const std::string &tab_name) const {
+        auto pos = tabs_.find(tab_name);
+        return pos == tabs_.end() ? nullptr : &pos->second;
+    }
+
+    void set_table(TabStats stats) { tabs_[stats.name] = std::move(stats); }
+
+    void erase_table(const std::string &tab_name) { tabs_.erase(tab_name); }
+
+    void erase_index(const std::string &tab_name, const std::vector<std::string> &col_names);
+
+    void clear() { tabs_.clear(); }
+
+    friend std::ostream &operator<<(std::ostream &os, const DbStats &db_stats);
+
+    friend std::istream &operator>>(std::istream &is, DbStats &db_stats);
+};
@@ -0,0 +1,257 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "system/sm.h"
+#undef private  // for use private variables in "sm_manager.h"
+
+#include "analyze/analyze.h"
+#include "execution/executor_bitmap_heap_scan.h"
+#include "execution/executor_delete.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_seq_scan.h"
+#include "execution/executor_update.h"
+#include "execution/rid_bitmap.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/planner.h"
+#include "parser/parser.h"
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "BitmapHeapScanTest_db";   // 以数据库名作为根目录
+const std::string TEST_TAB_NAME = "table1";                 // 测试表名
+
+/**
+ * @brief RidBitmap求交的结果与std::set求交一致，遍历时页号有序、页面内的slot_no有序
+ */
+TEST(RidBitmapTest, IntersectMatchesSet) {
+    std::mt19937 rng(0);
+    for (int round = 0; round < 20; ++round) {
+        // 两个位图的页面部分重叠，slot_no的范围不同使每个页面的字数不同
+        int max_slot[2] = {64 + static_cast<int>(rng() % 300), 1 + static_cast<int>(rng() % 200)};
+        std::set<Rid> sets[2];
+        RidBitmap bitmaps[2];
+        for (int i = 0; i < 2; ++i) {
+            for (int n = 0; n < 2000; ++n) {
+                Rid rid = {static_cast<int>(rng() % 40) + i * 10, static_cast<int>(rng() % max_slot[i])};
+                sets[i].insert(rid);
+                bitmaps[i].add(rid);
+            }
+            ASSERT_EQ(bitmaps[i].size(), sets[i].size());
+        }
+        bitmaps[0].intersect_with(bitmaps[1]);
+        std::vector<Rid> expected;
+        std::set_intersection(sets[0].begin(), sets[0].end(), sets[1].begin(), sets[1].end(),
+                              std::back_inserter(expected));
+        ASSERT_EQ(bitmaps[0].size(), expected.size());
+        std::vector<Rid> result;
+        std::vector<int> slot_nos;
+        for (auto &[page_no, words] : bitmaps[0].pages()) {
+            RidBitmap::to_slots(words, &slot_nos);
+            ASSERT_FALSE(slot_nos.empty());     // 求交之后没有记录的页面被移除
+            for (int slot_no : slot_nos) {
+                result.push_back({page_no, slot_no});
+            }
+        }
+        ASSERT_EQ(result, expected);
+        std::set<int> pages;
+        for (auto &rid : expected) {
+            pages.insert(rid.page_no);
+        }
+        ASSERT_EQ(bitmaps[0].num_pages(), pages.size());
+    }
+    // 与空位图求交得到空位图
+    RidBitmap bitmap;
+    bitmap.add({1, 3});
+    bitmap.intersect_with(RidBitmap());
+    ASSERT_TRUE(bitmap.empty());
+    ASSERT_EQ(bitmap.num_pages(), 0u);
+}
+
+/**
+ * 测试位图堆扫描：输出与顺序扫描完全相同(包括顺序)，规划器按ANALYZE的统计信息跳过选择率低的索引
+ */
+class BitmapHeapScanTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<Transaction> txn_;
+    std::unique_ptr<Context> context_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        lock_manager_ = std::make_unique<LockManager>();
+        txn_ = std::make_unique<Transaction>(0);
+        context_ = std::make_unique<Context>(lock_manager_.get(), nullptr, txn_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static Value make_int(int v) {
+        Value value;
+        value.set_int(v);
+        return value;
+    }
+
+    static Condition make_cond(const std::string &col_name, CompOp op, int v) {
+        Condition cond = {{TEST_TAB_NAME, col_name}, op, true, {}, make_int(v)};
+        cond.rhs_val.init_raw(sizeof(int));
+        return cond;
+    }
+
+    /* 建表(id INT, grp INT, score INT)，grp = id % 50，score = id * 7919 % 1000，在grp和score上建索引 */
+    void fill_table(int rows) {
+        std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"grp", TYPE_INT, 4}, {"score", TYPE_INT, 4}};
+        sm_manager_->create_table(TEST_TAB_NAME, coldef, nullptr);
+        sm_manager_->create_indexes(TEST_TAB_NAME, {{"grp"}, {"score"}}, {}, INDEX_BTREE, false, nullptr);
+        std::vector<Rid> rids;
+        for (int id = 0; id < rows; ++id) {
+            InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME,
+                                  {make_int(id), make_int(id % 50), make_int(id * 7919 % 1000)}, context_.get());
+            insert.Next();
+            rids.push_back(insert.rid());
+        }
+        // 删除一部分记录，在页面中留下空槽
+        std::vector<Rid> deleted;
+        for (size_t i = 0; i < rids.size(); i += 3) {
+            deleted.push_back(rids[i]);
+        }
+        DeleteExecutor del(sm_manager_.get(), TEST_TAB_NAME, {}, deleted, context_.get());
+        del.Next();
+    }
+
+    /* 依次读出executor输出的每条记录的rid和内容 */
+    static std::vector<std::pair<Rid, std::string>> collect(AbstractExecutor *executor) {
+        std::vector<std::pair<Rid, std::string>> result;
+        for (executor->beginTuple(); !executor->is_end(); executor->nextTuple()) {
+            auto rec = executor->Next();
+            result.push_back({executor->rid(), std::string(rec->data, rec->size)});
+        }
+        return result;
+    }
+
+    /* 同样的条件下位图堆扫描与顺序扫描的输出相同 */
+    void check_matches_seq_scan(const std::vector<Condition> &conds,
+                                const std::vector<std::vector<std::string>> &index_col_names) {
+        SeqScanExecutor seq_scan(sm_manager_.get(), TEST_TAB_NAME, conds, context_.get());
+        BitmapHeapScanExecutor bitmap_scan(sm_manager_.get(), TEST_TAB_NAME, conds, index_col_names, context_.get());
+        auto expected = collect(&seq_scan);
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(collect(&bitmap_scan), expected);
+    }
+
+    /* 对sql生成执行计划，返回其中的扫描计划 */
+    std::shared_ptr<ScanPlan> plan_scan(const std::string &sql) {
+        Analyze analyze(sm_manager_.get());
+        Planner planner(sm_manager_.get());
+        Optimizer optimizer(sm_manager_.get(), &planner);
+        YY_BUFFER_STATE buf = yy_scan_string(sql.c_str());
+        EXPECT_EQ(yyparse(), 0);
+        auto query = analyze.do_analyze(ast::parse_tree);
+        yy_delete_buffer(buf);
+        std::shared_ptr<Plan> plan = optimizer.plan_query(query, context_.get());
+        plan = std::dynamic_pointer_cast<DMLPlan>(plan)->subplan_;
+        plan = std::dynamic_pointer_cast<ProjectionPlan>(plan)->subplan_;
+        return std::dynamic_pointer_cast<ScanPlan>(plan);
+    }
+};
+
+/**
+ * @brief 单个索引上的范围条件、等值条件，以及两个索引的位图求交，输出都与顺序扫描相同
+ */
+TEST_F(BitmapHeapScanTests, MatchesSeqScan) {
+    fill_table(20000);
+    // 范围条件
+    check_matches_seq_scan({make_cond("score", OP_GE, 100), make_cond("score", OP_LT, 150)}, {{"score"}});
+    // 等值条件，索引上的key有大量重复
+    check_matches_seq_scan({make_cond("grp", OP_EQ, 7)}, {{"grp"}});
+    // 两个索引的rid求交，另有不能使用索引的条件
+    check_matches_seq_scan({make_cond("grp", OP_LE, 10), make_cond("score", OP_GT, 900), make_cond("id", OP_NE, 4)},
+                           {{"grp"}, {"score"}});
+}
+
+/**
+ * @brief 包含VARCHAR字段的表使用slotted page，更新变长的元组迁移到其他页面之后，按原位置的rid读取，输出仍与顺序扫描相同
+ */
+TEST_F(BitmapHeapScanTests, MatchesSeqScanWithMovedTuples) {
+    std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"grp", TYPE_INT, 4}, {"note", TYPE_VARCHAR, 200}};
+    sm_manager_->create_table(TEST_TAB_NAME, coldef, nullptr);
+    sm_manager_->create_indexes(TEST_TAB_NAME, {{"grp"}}, {}, INDEX_BTREE, false, nullptr);
+    ASSERT_EQ(sm_manager_->fhs_.at(TEST_TAB_NAME)->file_hdr_.page_format, RM_PAGE_SLOTTED);
+    std::vector<Rid> rids;
+    for (int id = 0; id < 3000; ++id) {
+        Value note;
+        note.set_str("n" + std::to_string(id));
+        InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(id), make_int(id % 20), note},
+                              context_.get());
+        insert.Next();
+        rids.push_back(insert.rid());
+    }
+    // 加长一半记录的变长字段，原页面放不下的元组迁移到其他页面
+    Value note;
+    note.set_str(std::string(150, 'x'));
+    note.init_raw(200);
+    std::vector<Rid> updated;
+    for (size_t i = 0; i < rids.size(); i += 2) {
+        updated.push_back(rids[i]);
+    }
+    UpdateExecutor update(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "note"}, note}}, {}, updated,
+                          context_.get());
+    update.Next();
+    check_matches_seq_scan({make_cond("grp", OP_LT, 3)}, {{"grp"}});
+}
+
+/**
+ * @brief 没有统计信息时使用所有可用的索引；ANALYZE之后选择率超过BITMAP_SCAN_MAX_SELECTIVITY的索引不参与，
+ * 没有索引参与时使用顺序扫描
+ */
+TEST_F(BitmapHeapScanTests, PlannerSkipsUnselectiveIndexes) {
+    fill_table(20000);
+    auto scan = plan_scan("select * from table1 where score < 900;");
+    ASSERT_EQ(scan->tag, T_BitmapHeapScan);
+    ASSERT_EQ(scan->bitmap_index_col_names_, (std::vector<std::vector<std::string>>{{"score"}}));
+
+    sm_manager_->analyze_table(TEST_TAB_NAME, nullptr);
+    // 大约90%的记录满足条件
+    ASSERT_EQ(plan_scan("select * from table1 where score < 900;")->tag, T_SeqScan);
+    // 大约5%的记录满足条件
+    scan = plan_scan("select * from table1 where score < 50;");
+    ASSERT_EQ(scan->tag, T_BitmapHeapScan);
+    ASSERT_EQ(scan->bitmap_index_col_names_, (std::vector<std::vector<std::string>>{{"score"}}));
+    // grp上的条件选择率大约为80%，只使用score上的索引
+    scan = plan_scan("select * from table1 where grp < 40 and score < 50;");
+    ASSERT_EQ(scan->tag, T_BitmapHeapScan);
+    ASSERT_EQ(scan->bitmap_index_col_names_, (std::vector<std::vector<std::string>>{{"score"}}));
+    // 两个条件都有选择性时求交
+    scan = plan_scan("select * from table1 where grp <= 1 and score < 50;");
+    ASSERT_EQ(scan->tag, T_BitmapHeapScan);
+    ASSERT_EQ(scan->bitmap_index_col_names_, (std::vector<std::vector<std::string>>{{"grp"}, {"score"}}));
+}
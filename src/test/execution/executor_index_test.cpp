@@ -0,0 +1,224 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "system/sm.h"
+#undef private  // for use private variables in "sm_manager.h"
+
+#include "execution/executor_delete.h"
+#include "execution/executor_index_scan.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_update.h"
+#include "index/ix.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "ExecutorIndexTest_db";    // 以数据库名作为根目录
+const std::string TEST_TAB_NAME = "table1";                 // 测试表名
+
+/**
+ * 测试执行器对索引的维护和使用：多列索引、索引的字段顺序与表中的字段顺序不同时，
+ * INSERT、DELETE、UPDATE之后每个索引恰好包含每条记录的(key, rid)
+ */
+class ExecutorIndexTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static Value make_int(int v) {
+        Value value;
+        value.set_int(v);
+        return value;
+    }
+
+    /* 建表(a INT, b INT, c INT) */
+    void create_table() {
+        std::vector<ColDef> coldef = {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_INT, 4}};
+        sm_manager_->create_table(TEST_TAB_NAME, coldef, nullptr);
+    }
+
+    /* 检查表上的每个B+树索引恰好包含每条记录的(key, rid) */
+    void check_indexes() {
+        auto &tab = sm_manager_->db_.get_table(TEST_TAB_NAME);
+        RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+        for (auto &index : tab.indexes) {
+            auto ih = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(TEST_TAB_NAME, index));
+            std::map<std::string, std::set<Rid>> expected;
+            int num_records = 0;
+            char key[IX_MAX_COL_LEN];
+            for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+                auto rec = fh->get_record(scan.rid(), nullptr);
+                index.make_key(rec->data, key);
+                expected[std::string(key, index.col_tot_len)].insert(scan.rid());
+                num_records++;
+            }
+            int num_entries = 0;
+            for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+                 scan.next()) {
+                num_entries++;
+            }
+            ASSERT_EQ(num_entries, num_records);
+            for (auto &[k, rids] : expected) {
+                std::vector<Rid> result;
+                ASSERT_TRUE(ih->get_value(k.data(), &result, nullptr));
+                ASSERT_EQ(std::set<Rid>(result.begin(), result.end()), rids);
+            }
+        }
+    }
+};
+
+/**
+ * @brief 索引在tab.indexes中的位置与字段的位置不同，且包含多个字段：
+ * DELETE和UPDATE按索引而不是按字段找到索引句柄，并用完整的key删除这条记录自己的项
+ */
+TEST_F(ExecutorIndexTests, DeleteUpdateMaintainCompositeIndexes) {
+    create_table();
+    // tab.indexes[0]建在第2个字段上，tab.indexes[1]按(b, a)的顺序包含两个字段；第1个字段b上没有单独的索引
+    sm_manager_->create_indexes(TEST_TAB_NAME, {{"c"}, {"b", "a"}}, {}, INDEX_BTREE, false, nullptr);
+    Transaction txn(0);
+    Context context(nullptr, nullptr, &txn);
+    std::vector<Rid> rids;
+    for (int i = 0; i < 2000; ++i) {
+        // b的取值很少，同一个b下a各不相同，c有重复
+        InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(i), make_int(i % 7), make_int(i % 100)},
+                              &context);
+        insert.Next();
+        rids.push_back(insert.rid());
+    }
+    check_indexes();
+
+    std::mt19937 rng(0);
+    std::shuffle(rids.begin(), rids.end(), rng);
+    // 删除一部分记录：b相同的项中只删除这条记录的(key, rid)
+    DeleteExecutor del(sm_manager_.get(), TEST_TAB_NAME, {}, {rids.begin(), rids.begin() + 500}, &context);
+    del.Next();
+    rids.erase(rids.begin(), rids.begin() + 500);
+    check_indexes();
+
+    // 更新多列索引的第二个字段a，只有(b, a)上的索引需要维护
+    for (size_t i = 0; i < 300; ++i) {
+        Value a = make_int(10000 + static_cast<int>(i));
+        a.init_raw(4);
+        UpdateExecutor update(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "a"}, a}}, {}, {rids[i]},
+                              &context);
+        update.Next();
+    }
+    check_indexes();
+
+    // 同时更新两个索引包含的字段
+    Value b = make_int(3);
+    b.init_raw(4);
+    Value c = make_int(-1);
+    c.init_raw(4);
+    UpdateExecutor update(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "b"}, b}, {{TEST_TAB_NAME, "c"}, c}}, {},
+                          {rids.begin() + 300, rids.begin() + 400}, &context);
+    update.Next();
+    check_indexes();
+    auto &tab = sm_manager_->db_.get_table(TEST_TAB_NAME);
+    auto ih = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(TEST_TAB_NAME, tab.indexes[0]));
+    std::vector<Rid> result;
+    int minus_one = -1;
+    ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&minus_one), &result, nullptr));
+    ASSERT_EQ(result.size(), 100u);
+}
+
+/**
+ * @brief 多列索引上只有第一个字段的条件时，扫描边界的其余字段取最小值/最大值，
+ * 第一个字段等于边界值的项不论其余字段的取值都在扫描范围内
+ */
+TEST_F(ExecutorIndexTests, CompositeIndexScanBounds) {
+    create_table();
+    Transaction txn(0);
+    Context context(nullptr, nullptr, &txn);
+    for (int b = 0; b < 10; ++b) {
+        for (int c = -50; c < 50; ++c) {
+            InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(b * 100 + c), make_int(b), make_int(c)},
+                                  &context);
+            insert.Next();
+        }
+        // 第二个字段取该类型的最小值和最大值
+        for (int c : {std::numeric_limits<int>::min(), std::numeric_limits<int>::max()}) {
+            InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(-b), make_int(b), make_int(c)},
+                                  &context);
+            insert.Next();
+        }
+    }
+    auto make_cond = [](CompOp op, int v) {
+        Condition cond = {{TEST_TAB_NAME, "b"}, op, true, {}, make_int(v)};
+        cond.rhs_val.init_raw(4);
+        return cond;
+    };
+    std::vector<std::vector<Condition>> cases = {
+        {make_cond(OP_EQ, 5)}, {make_cond(OP_GE, 5)}, {make_cond(OP_GT, 5)},
+        {make_cond(OP_LE, 5)}, {make_cond(OP_LT, 5)}, {make_cond(OP_GT, 3), make_cond(OP_LE, 6)},
+        {make_cond(OP_EQ, 0)}, {make_cond(OP_EQ, 9)},
+    };
+    // 非唯一索引的key之后追加了rid，唯一索引没有；两种格式的边界都要覆盖
+    for (bool unique : {false, true}) {
+        sm_manager_->create_indexes(TEST_TAB_NAME, {{"b", "c"}}, {}, INDEX_BTREE, unique, nullptr);
+        for (auto &conds : cases) {
+            std::multiset<int> expected;
+            RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+            for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+                auto rec = fh->get_record(scan.rid(), nullptr);
+                int b = *reinterpret_cast<int *>(rec->data + 4);
+                bool match = std::all_of(conds.begin(), conds.end(), [&](const Condition &cond) {
+                    int v = cond.rhs_val.int_val;
+                    switch (cond.op) {
+                        case OP_EQ: return b == v;
+                        case OP_GE: return b >= v;
+                        case OP_GT: return b > v;
+                        case OP_LE: return b <= v;
+                        default: return b < v;
+                    }
+                });
+                if (match) {
+                    expected.insert(*reinterpret_cast<int *>(rec->data));
+                }
+            }
+            std::multiset<int> result;
+            IndexScanExecutor scan(sm_manager_.get(), TEST_TAB_NAME, conds, {"b", "c"}, nullptr);
+            for (scan.beginTuple(); !scan.is_end(); scan.nextTuple()) {
+                result.insert(*reinterpret_cast<int *>(scan.Next()->data));
+            }
+            ASSERT_EQ(result, expected) << "unique " << unique << ", op " << conds[0].op;
+        }
+        sm_manager_->drop_index(TEST_TAB_NAME, std::vector<std::string>{"b", "c"}, nullptr);
+    }
+}
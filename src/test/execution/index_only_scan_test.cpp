@@ -0,0 +1,224 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "system/sm.h"
+#undef private  // for use private variables in "sm_manager.h"
+
+#include "analyze/analyze.h"
+#include "execution/executor_delete.h"
+#include "execution/executor_index_only_scan.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_update.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/planner.h"
+#include "parser/parser.h"
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IndexOnlyScanTest_db";    // 以数据库名作为根目录
+const std::string TEST_TAB_NAME = "table1";                 // 测试表名
+const std::string TEST_TAB_NAME2 = "table2";                // 参与连接的表名
+
+/**
+ * 测试只访问索引的扫描：规划器只在查询涉及的字段都在索引项中时选择T_IndexOnlyScan，
+ * 从索引项还原出的记录与表中的记录在索引覆盖的字段上相同
+ */
+class IndexOnlyScanTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<Transaction> txn_;
+    std::unique_ptr<Context> context_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        lock_manager_ = std::make_unique<LockManager>();
+        txn_ = std::make_unique<Transaction>(0);
+        context_ = std::make_unique<Context>(lock_manager_.get(), nullptr, txn_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static Value make_int(int v) {
+        Value value;
+        value.set_int(v);
+        return value;
+    }
+
+    static Condition make_cond(const std::string &col_name, CompOp op, int v) {
+        Condition cond = {{TEST_TAB_NAME, col_name}, op, true, {}, make_int(v)};
+        cond.rhs_val.init_raw(sizeof(int));
+        return cond;
+    }
+
+    /* 建表(id INT, a INT, b INT, c INT)，a = id % 20，b = id * 3，c = id，在a上建INCLUDE (b)的索引 */
+    std::vector<Rid> fill_table(int rows) {
+        std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_INT, 4}};
+        sm_manager_->create_table(TEST_TAB_NAME, coldef, nullptr);
+        sm_manager_->create_indexes(TEST_TAB_NAME, {{"a"}}, {"b"}, INDEX_BTREE, false, nullptr);
+        std::vector<Rid> rids;
+        for (int id = 0; id < rows; ++id) {
+            InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME,
+                                  {make_int(id), make_int(id % 20), make_int(id * 3), make_int(id)}, context_.get());
+            insert.Next();
+            rids.push_back(insert.rid());
+        }
+        return rids;
+    }
+
+    /* 对sql生成执行计划，返回其中tab_name上的扫描计划 */
+    std::shared_ptr<ScanPlan> plan_scan(const std::string &sql, const std::string &tab_name = TEST_TAB_NAME) {
+        Analyze analyze(sm_manager_.get());
+        Planner planner(sm_manager_.get());
+        Optimizer optimizer(sm_manager_.get(), &planner);
+        YY_BUFFER_STATE buf = yy_scan_string(sql.c_str());
+        EXPECT_EQ(yyparse(), 0);
+        auto query = analyze.do_analyze(ast::parse_tree);
+        yy_delete_buffer(buf);
+        return find_scan(optimizer.plan_query(query, context_.get()), tab_name);
+    }
+
+    static std::shared_ptr<ScanPlan> find_scan(const std::shared_ptr<Plan> &plan, const std::string &tab_name) {
+        if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+            return x->tab_name_ == tab_name ? x : nullptr;
+        } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+            auto scan = find_scan(x->left_, tab_name);
+            return scan != nullptr ? scan : find_scan(x->right_, tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+            return find_scan(x->subplan_, tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+            return find_scan(x->subplan_, tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<DMLPlan>(plan)) {
+            return find_scan(x->subplan_, tab_name);
+        }
+        return nullptr;
+    }
+
+    /* a = key时，只访问索引的扫描输出的rid与索引扫描相同，还原出的a和b与表中的记录相同 */
+    void check_matches_heap(int key) {
+        std::vector<Condition> conds = {make_cond("a", OP_EQ, key)};
+        IndexScanExecutor index_scan(sm_manager_.get(), TEST_TAB_NAME, conds, {"a"}, context_.get());
+        std::multiset<Rid> expected;
+        for (index_scan.beginTuple(); !index_scan.is_end(); index_scan.nextTuple()) {
+            expected.insert(index_scan.rid());
+        }
+        IndexOnlyScanExecutor only_scan(sm_manager_.get(), TEST_TAB_NAME, conds, {"a"}, context_.get());
+        RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+        std::multiset<Rid> result;
+        for (only_scan.beginTuple(); !only_scan.is_end(); only_scan.nextTuple()) {
+            auto rec = only_scan.Next();
+            auto heap_rec = fh->get_record(only_scan.rid(), nullptr);
+            // a和b分别位于记录的第4和第8个字节处
+            ASSERT_EQ(*reinterpret_cast<int *>(rec->data + 4), key);
+            ASSERT_EQ(memcmp(rec->data + 4, heap_rec->data + 4, 8), 0) << "rid (" << only_scan.rid().page_no << ","
+                                                                       << only_scan.rid().slot_no << ")";
+            result.insert(only_scan.rid());
+        }
+        ASSERT_EQ(result, expected);
+    }
+};
+
+/**
+ * @brief 投影列、该表上的条件、连接条件和order by的列都在索引字段或INCLUDE字段中时才选择T_IndexOnlyScan，
+ * 任意一处用到索引之外的字段时使用普通的索引扫描
+ */
+TEST_F(IndexOnlyScanTests, PlannerRequiresCoveringIndex) {
+    fill_table(200);
+    std::vector<ColDef> coldef = {{"x", TYPE_INT, 4}, {"y", TYPE_INT, 4}};
+    sm_manager_->create_table(TEST_TAB_NAME2, coldef, nullptr);
+
+    // 投影列
+    ASSERT_EQ(plan_scan("select a, b from table1 where a = 5;")->tag, T_IndexOnlyScan);
+    ASSERT_EQ(plan_scan("select b from table1 where a = 5;")->tag, T_IndexOnlyScan);
+    ASSERT_EQ(plan_scan("select a, c from table1 where a = 5;")->tag, T_IndexScan);
+    ASSERT_EQ(plan_scan("select * from table1 where a = 5;")->tag, T_IndexScan);
+    // 该表上的其他条件
+    ASSERT_EQ(plan_scan("select a from table1 where a = 5 and b > 30;")->tag, T_IndexOnlyScan);
+    ASSERT_EQ(plan_scan("select a from table1 where a = 5 and c > 30;")->tag, T_IndexScan);
+    // order by的列
+    ASSERT_EQ(plan_scan("select a, b from table1 where a = 5 order by b;")->tag, T_IndexOnlyScan);
+    ASSERT_EQ(plan_scan("select a, b from table1 where a = 5 order by c;")->tag, T_IndexScan);
+    // 连接条件
+    auto scan = plan_scan("select table1.b, table2.y from table1, table2 where table1.a = 5 and table1.b = table2.x;");
+    ASSERT_EQ(scan->tag, T_IndexOnlyScan);
+    scan = plan_scan("select table1.b, table2.y from table1, table2 where table1.a = 5 and table1.c = table2.x;");
+    ASSERT_EQ(scan->tag, T_IndexScan);
+    // 另一张表的字段不影响这张表
+    scan = plan_scan("select table1.a, table2.x, table2.y from table1, table2 where table1.a = 5 and table2.y = 1;");
+    ASSERT_EQ(scan->tag, T_IndexOnlyScan);
+    // 不能等值匹配索引时不使用索引
+    ASSERT_NE(plan_scan("select a, b from table1 where c = 5;")->tag, T_IndexOnlyScan);
+}
+
+/**
+ * @brief 从索引项还原出的记录与表中的记录相同，UPDATE INCLUDE字段、索引字段以及DELETE之后仍然相同
+ */
+TEST_F(IndexOnlyScanTests, MatchesHeapAfterUpdate) {
+    auto rids = fill_table(5000);
+    for (int key = 0; key < 20; ++key) {
+        check_matches_heap(key);
+    }
+
+    // 只更新INCLUDE字段：索引的key不变，叶子中存放的b需要更新
+    std::vector<Rid> updated;
+    for (size_t i = 0; i < rids.size(); i += 3) {
+        updated.push_back(rids[i]);
+    }
+    Value b = make_int(-7);
+    b.init_raw(4);
+    UpdateExecutor update_b(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "b"}, b}}, {}, updated,
+                            context_.get());
+    update_b.Next();
+    for (int key = 0; key < 20; ++key) {
+        check_matches_heap(key);
+    }
+
+    // 更新索引字段，记录移到另一个key下
+    updated.clear();
+    for (size_t i = 1; i < rids.size(); i += 4) {
+        updated.push_back(rids[i]);
+    }
+    Value a = make_int(3);
+    a.init_raw(4);
+    UpdateExecutor update_a(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "a"}, a}}, {}, updated,
+                            context_.get());
+    update_a.Next();
+    // 删除一部分记录
+    std::vector<Rid> deleted;
+    for (size_t i = 2; i < rids.size(); i += 5) {
+        deleted.push_back(rids[i]);
+    }
+    DeleteExecutor del(sm_manager_.get(), TEST_TAB_NAME, {}, deleted, context_.get());
+    del.Next();
+    for (int key = 0; key < 20; ++key) {
+        check_matches_heap(key);
+    }
+}
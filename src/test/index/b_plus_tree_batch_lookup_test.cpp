@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "BPlusTreeBatchLookupTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";                     // 测试文件名的前缀
+
+/**
+ * 测试批量点查get_values：结果与逐个调用get_value一致，并发插入时仍能找到已有的key
+ */
+class BPlusTreeBatchLookupTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open(ColType type, int len) {
+        std::vector<ColMeta> cols = {{TEST_FILE_NAME, "col0", type, len, 0, true}};
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols);
+        return ix_manager_->open_index(filename, cols);
+    }
+};
+
+static std::string string_key(int v, int len) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key-%08d", v);
+    std::string key(buf);
+    key.resize(len, '\0');
+    return key;
+}
+
+/**
+ * @brief 有序、含重复和不存在的key的批量查找，与逐个get_value的结果一致
+ */
+TEST_F(BPlusTreeBatchLookupTests, MatchesGetValue) {
+    const int scale = 50000;
+    for (ColType type : {TYPE_INT, TYPE_STRING}) {
+        int len = type == TYPE_INT ? 4 : 24;
+        auto ih = create_and_open(type, len);
+        auto make_key = [&](int v) {
+            return type == TYPE_INT ? std::string(reinterpret_cast<const char *>(&v), sizeof(int))
+                                    : string_key(v, len);
+        };
+        std::vector<int> values(scale);
+        for (int i = 0; i < scale; ++i) {
+            values[i] = i * 2;  // 奇数不存在
+        }
+        std::shuffle(values.begin(), values.end(), std::mt19937(1));
+        for (int i = 0; i < scale; ++i) {
+            ASSERT_NE(ih->insert_entry(make_key(values[i]).data(), Rid{values[i], 0}, nullptr), -1);
+        }
+        std::mt19937 rng(2);
+        for (int batch_size : {1, 7, 100, 3000}) {
+            for (int span : {50, 2 * scale}) {
+                // 从[start, start + span)中随机取batch_size个值，排序之后查找
+                int start = static_cast<int>(rng() % (2 * scale));
+                std::vector<int> batch;
+                for (int i = 0; i < batch_size; ++i) {
+                    batch.push_back(start + static_cast<int>(rng() % span) - 1);
+                }
+                std::sort(batch.begin(), batch.end());
+                std::string keys;
+                for (int v : batch) {
+                    keys += make_key(v);
+                }
+                std::vector<Rid> result;
+                std::vector<int> key_index;
+                int found = ih->get_values(keys.data(), batch_size, &result, nullptr, &key_index);
+                ASSERT_EQ(found, static_cast<int>(result.size()));
+                ASSERT_EQ(result.size(), key_index.size());
+                size_t pos = 0;
+                for (int i = 0; i < batch_size; ++i) {
+                    std::vector<Rid> expected;
+                    if (ih->get_value(make_key(batch[i]).data(), &expected, nullptr)) {
+                        ASSERT_LT(pos, result.size());
+                        ASSERT_EQ(key_index[pos], i);
+                        ASSERT_EQ(result[pos], expected[0]);
+                        pos++;
+                    }
+                }
+                ASSERT_EQ(pos, result.size());
+            }
+        }
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief 一个线程插入新的key导致叶子不断分裂，另一个线程批量查找预先插入的key，全部都能找到
+ */
+TEST_F(BPlusTreeBatchLookupTests, ConcurrentInsert) {
+    const int scale = 20000;
+    auto ih = create_and_open(TYPE_INT, 4);
+    std::vector<int> existing;
+    for (int i = 0; i < scale; ++i) {
+        int v = i * 3;
+        existing.push_back(v);
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), Rid{v, 0}, nullptr), -1);
+    }
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        std::vector<int> values;
+        for (int i = 0; i < scale; ++i) {
+            values.push_back(i * 3 + 1);
+        }
+        std::shuffle(values.begin(), values.end(), std::mt19937(3));
+        for (int v : values) {
+            ih->insert_entry(reinterpret_cast<const char *>(&v), Rid{v, 0}, nullptr);
+        }
+        done = true;
+    });
+    std::mt19937 rng(4);
+    int rounds = 0;
+    while (!done || rounds < 10) {
+        int start = static_cast<int>(rng() % (scale - 500));
+        std::vector<Rid> result;
+        ASSERT_EQ(ih->get_values(reinterpret_cast<const char *>(&existing[start]), 500, &result, nullptr), 500);
+        for (int i = 0; i < 500; ++i) {
+            ASSERT_EQ(result[i].page_no, existing[start + i]);
+        }
+        rounds++;
+    }
+    writer.join();
+    ix_manager_->close_index(ih.get());
+}
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "BPlusTreeCompressTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";                  // 测试文件名的前缀
+
+/**
+ * 测试前缀压缩/后缀截断格式(IX_FORMAT_COMPRESSED_NODES)的索引：
+ * 随机插入/删除之后与std::map对比，并与旧格式比较字符串key索引的树高和页面数
+ */
+class BPlusTreeCompressTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static std::vector<ColMeta> make_cols(const std::vector<std::pair<ColType, int>> &types) {
+        std::vector<ColMeta> cols;
+        int offset = 0;
+        for (size_t i = 0; i < types.size(); ++i) {
+            cols.push_back({TEST_FILE_NAME, "col" + std::to_string(i), types[i].first, types[i].second, offset, true});
+            offset += types[i].second;
+        }
+        return cols;
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open(const std::vector<ColMeta> &cols, int format_version) {
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, format_version);
+        return ix_manager_->open_index(filename, cols);
+    }
+
+    // 树高，也就是一次点查需要访问的页面数
+    int tree_height(IxIndexHandle *ih) {
+        IxNodeGuard root = ih->fetch_node(ih->file_hdr_->root_page_);
+        return root->get_level() + 1;
+    }
+
+    // 遍历叶子链表，检查相邻叶子之间key有序、每个叶子中的key都小于它的high key
+    void check_leaves(IxIndexHandle *ih) {
+        int len = ih->file_hdr_->col_tot_len_;
+        std::vector<char> prev(len), key(len);
+        bool has_prev = false;
+        page_id_t page_no = ih->file_hdr_->first_leaf_;
+        while (page_no != IX_LEAF_HEADER_PAGE) {
+            IxNodeGuard leaf = ih->fetch_node(page_no);
+            for (int i = 0; i < leaf->get_size(); ++i) {
+                leaf->copy_key(i, key.data());
+                if (has_prev) {
+                    ASSERT_LT(ix_compare(prev.data(), key.data(), ih->file_hdr_), 0);
+                }
+                if (leaf->has_high_key()) {
+                    ASSERT_LT(ix_compare(key.data(), leaf->get_high_key(), ih->file_hdr_), 0);
+                }
+                prev = key;
+                has_prev = true;
+            }
+            page_no = leaf->get_next_leaf();
+        }
+    }
+};
+
+/**
+ * @brief 生成有公共前缀、长度不一的字符串，末尾以'\0'补齐到len
+ */
+static std::string random_string_key(std::mt19937 &rng, int len) {
+    static const char *prefixes[] = {"user/", "user/admin/", "order/2024/01/", "order/2024/02/", "z"};
+    std::string key = prefixes[rng() % 5];
+    int extra = static_cast<int>(rng() % 12);
+    for (int i = 0; i < extra; ++i) {
+        key.push_back(static_cast<char>('a' + rng() % 6));
+    }
+    key.resize(len, '\0');
+    return key;
+}
+
+/**
+ * @brief 按cols的布局生成原始key：字符串列使用random_string_key，INT列取较小的范围以产生重复的列值
+ */
+static std::string random_key(std::mt19937 &rng, const std::vector<ColMeta> &cols) {
+    std::string key;
+    for (auto &col : cols) {
+        if (col.type == TYPE_INT) {
+            int v = static_cast<int>(rng() % 7) - 3;
+            key.append(reinterpret_cast<const char *>(&v), sizeof(int));
+        } else {
+            std::string s = random_string_key(rng, col.len);
+            key += s.substr(0, col.len);
+        }
+    }
+    return key;
+}
+
+/**
+ * @brief 压缩格式下随机插入和删除字符串key、组合key，结果与std::map一致
+ * 调小btree_order_让树变高，覆盖内部结点的分裂和合并
+ */
+TEST_F(BPlusTreeCompressTests, RandomOpsMatchMap) {
+    std::vector<std::vector<ColMeta>> layouts = {
+        make_cols({{TYPE_STRING, 24}}),
+        make_cols({{TYPE_INT, 4}, {TYPE_STRING, 20}}),
+    };
+    for (auto &cols : layouts) {
+        for (int order : {6, 0}) {
+            auto ih = create_and_open(cols, IX_FORMAT_COMPRESSED_NODES);
+            ASSERT_TRUE(ih->file_hdr_->compressed_nodes());
+            if (order > 0) {
+                ih->file_hdr_->btree_order_ = order;
+            }
+            std::vector<ColType> types;
+            std::vector<int> lens;
+            for (auto &col : cols) {
+                types.push_back(col.type);
+                lens.push_back(col.len);
+            }
+            auto less = [&](const std::string &a, const std::string &b) {
+                return ix_compare(a.data(), b.data(), types, lens) < 0;
+            };
+            std::map<std::string, Rid, decltype(less)> mock(less);
+            std::mt19937 rng(order * 31 + static_cast<int>(cols.size()));
+            for (int round = 0; round < 20000; ++round) {
+                std::string key = random_key(rng, cols);
+                Rid rid = {round / 100, round % 100};
+                bool exist = mock.count(key) > 0;
+                if (rng() % 3 == 0) {
+                    ASSERT_EQ(ih->delete_entry(key.data(), nullptr), exist);
+                    mock.erase(key);
+                } else {
+                    page_id_t page_no = ih->insert_entry(key.data(), rid, nullptr);
+                    ASSERT_EQ(page_no == -1, exist);
+                    mock.emplace(key, rid);
+                }
+            }
+            check_leaves(ih.get());
+            std::vector<Rid> rids;
+            for (auto &[key, rid] : mock) {
+                rids.clear();
+                ASSERT_TRUE(ih->get_value(key.data(), &rids, nullptr));
+                ASSERT_EQ(rids[0], rid);
+            }
+            for (int round = 0; round < 1000; ++round) {
+                std::string key = random_key(rng, cols);
+                rids.clear();
+                ASSERT_EQ(ih->get_value(key.data(), &rids, nullptr), mock.count(key) > 0);
+            }
+            IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+            auto it = mock.begin();
+            while (!scan.is_end()) {
+                ASSERT_NE(it, mock.end());
+                ASSERT_EQ(scan.rid(), it->second);
+                ++it;
+                scan.next();
+            }
+            ASSERT_EQ(it, mock.end());
+            ix_manager_->close_index(ih.get());
+        }
+    }
+}
+
+/**
+ * @brief 压缩格式下字符串key索引的树高(每次点查访问的页面数)不高于旧格式，页面数少于旧格式
+ */
+TEST_F(BPlusTreeCompressTests, CompressedTreeIsSmaller) {
+    const int scale = 100000;
+    struct Case {
+        const char *name;
+        std::vector<ColMeta> cols;
+    };
+    std::vector<Case> cases = {
+        {"char(64)", make_cols({{TYPE_STRING, 64}})},
+        {"char(48),int", make_cols({{TYPE_STRING, 48}, {TYPE_INT, 4}})},
+    };
+    for (auto &c : cases) {
+        int len = 0;
+        for (auto &col : c.cols) {
+            len += col.len;
+        }
+        // 形如"customer-00012345@example.com"的key，随机顺序插入
+        std::vector<std::string> keys;
+        for (int i = 0; i < scale; ++i) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "customer-%08d@example.com", i * 7);
+            std::string key(buf);
+            key.resize(c.cols[0].len, '\0');
+            if (c.cols.size() > 1) {
+                int v = i % 3;
+                key.append(reinterpret_cast<const char *>(&v), sizeof(int));
+            }
+            ASSERT_EQ(static_cast<int>(key.size()), len);
+            keys.push_back(key);
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(5));
+        int heights[2];
+        int pages[2];
+        for (int version : {IX_FORMAT_NORMALIZED_KEYS, IX_FORMAT_COMPRESSED_NODES}) {
+            auto ih = create_and_open(c.cols, version);
+            for (int i = 0; i < scale; ++i) {
+                ASSERT_NE(ih->insert_entry(keys[i].data(), Rid{i, 0}, nullptr), -1);
+            }
+            std::vector<Rid> rids;
+            for (int i = 0; i < scale; ++i) {
+                rids.clear();
+                ASSERT_TRUE(ih->get_value(keys[i].data(), &rids, nullptr));
+                ASSERT_EQ(rids[0].page_no, i);
+            }
+            int idx = version == IX_FORMAT_COMPRESSED_NODES;
+            heights[idx] = tree_height(ih.get());
+            pages[idx] = ih->file_hdr_->num_pages_ - IX_INIT_NUM_PAGES + 1;
+            ix_manager_->close_index(ih.get());
+        }
+        EXPECT_LE(heights[1], heights[0]);
+        EXPECT_LT(pages[1], pages[0]);
+    }
+}
+
+/**
+ * @brief lower_bound/upper_bound与std::map的lower_bound/upper_bound位置一致，
+ * 包括比所有key都小的key(落在第一个叶子的第0项之前)和落在截断的分隔key与孩子的第0个key之间的key
+ */
+TEST_F(BPlusTreeCompressTests, BoundsMatchMap) {
+    auto cols = make_cols({{TYPE_STRING, 24}});
+    for (int version : {IX_FORMAT_RAW_KEYS, IX_FORMAT_COMPRESSED_NODES}) {
+        auto ih = create_and_open(cols, version);
+        ih->file_hdr_->btree_order_ = 6;
+        auto less = [&](const std::string &a, const std::string &b) {
+            return ix_compare(a.data(), b.data(), TYPE_STRING, 24) < 0;
+        };
+        std::map<std::string, Rid, decltype(less)> mock(less);
+        std::mt19937 rng(version);
+        for (int round = 0; round < 5000; ++round) {
+            std::string key = random_key(rng, cols);
+            Rid rid = {round, 0};
+            if (mock.emplace(key, rid).second) {
+                ASSERT_NE(ih->insert_entry(key.data(), rid, nullptr), -1);
+            }
+        }
+        // [leaf_begin, pos)中的项数就是pos在mock中的位置
+        auto rank = [&](const Iid &pos) {
+            std::vector<Rid> rids;
+            return ih->get_rids(ih->leaf_begin(), pos, &rids, false);
+        };
+        std::vector<std::string> probes = {std::string(24, '\0'), std::string(24, 'z')};
+        for (auto &[key, rid] : mock) {
+            probes.push_back(key);
+        }
+        for (int round = 0; round < 2000; ++round) {
+            probes.push_back(random_key(rng, cols));
+        }
+        for (auto &probe : probes) {
+            ASSERT_EQ(rank(ih->lower_bound(probe.data())), std::distance(mock.begin(), mock.lower_bound(probe)));
+            ASSERT_EQ(rank(ih->upper_bound(probe.data())), std::distance(mock.begin(), mock.upper_bound(probe)));
+        }
+        ix_manager_->close_index(ih.get());
+    }
+}
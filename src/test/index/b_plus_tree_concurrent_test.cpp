@@ -1,5 +1,6 @@
 #include <chrono>  // NOLINT
 #include <cstdio>
+#include <deque>
 #include <functional>
 #include <random>  // for std::default_random_engine
 #include <thread>  // NOLINT
@@ -103,7 +104,7 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
                 << "max_size=" << leaf->get_max_size() << ",min_size=" << leaf->get_min_size() << "</TD></TR>\n";
             out << "<TR>";
             for (int i = 0; i < leaf->get_size(); i++) {
-                out << "<TD>" << *reinterpret_cast<int*>(leaf->get_key(i)) << "</TD>\n";
+                out << "<TD>" << leaf->key_at(i) << "</TD>\n";
             }
             out << "</TR>";
             // Print table end
@@ -154,19 +155,17 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
             }
             // Print leaves
             for (int i = 0; i < inner->get_size(); i++) {
-                IxNodeHandle *child_node = ih->fetch_node(inner->value_at(i));
-                ToGraph(ih, child_node, bpm, out);  // 继续递归
+                IxNodeGuard child_node = ih->fetch_node(inner->value_at(i));
+                ToGraph(ih, child_node.get(), bpm, out);  // 继续递归
                 if (i > 0) {
-                    IxNodeHandle *sibling_node = ih->fetch_node(inner->value_at(i - 1));
+                    IxNodeGuard sibling_node = ih->fetch_node(inner->value_at(i - 1));
                     if (!sibling_node->is_leaf_page() && !child_node->is_leaf_page()) {
                         out << "{rank=same " << internal_prefix << sibling_node->get_page_no() << " " << internal_prefix
                             << child_node->get_page_no() << "};\n";
                     }
-                    bpm->unpin_page(sibling_node->get_page_id(), false);
                 }
             }
         }
-        bpm->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -179,8 +178,8 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
         std::ofstream out(outf);
         out << "digraph G {" << std::endl;
         
-        IxNodeHandle *node = ih_->fetch_node(ih_->file_hdr_->root_page_);
-        ToGraph(ih_.get(), node, bpm, out);
+        IxNodeGuard node = ih_->fetch_node(ih_->file_hdr_->root_page_);
+        ToGraph(ih_.get(), node.get(), bpm, out);
         out << "}" << std::endl;
         out.close();
 
@@ -206,16 +205,13 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
         // check leaf list
         page_id_t leaf_no = ih->file_hdr_->first_leaf_;
         while (leaf_no != IX_LEAF_HEADER_PAGE) {
-            IxNodeHandle *curr = ih->fetch_node(leaf_no);
-            IxNodeHandle *prev = ih->fetch_node(curr->get_prev_leaf());
-            IxNodeHandle *next = ih->fetch_node(curr->get_next_leaf());
+            IxNodeGuard curr = ih->fetch_node(leaf_no);
+            IxNodeGuard prev = ih->fetch_node(curr->get_prev_leaf());
+            IxNodeGuard next = ih->fetch_node(curr->get_next_leaf());
             // Ensure prev->next == curr && next->prev == curr
             ASSERT_EQ(prev->get_next_leaf(), leaf_no);
             ASSERT_EQ(next->get_prev_leaf(), leaf_no);
             leaf_no = curr->get_next_leaf();
-            buffer_pool_manager_->unpin_page(curr->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(prev->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(next->get_page_id(), false);
         }
     }
 
@@ -226,13 +222,12 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
      * @param now_page_no 当前遍历到的结点
      */
     void check_tree(const IxIndexHandle *ih, int now_page_no) {
-        IxNodeHandle *node = ih->fetch_node(now_page_no);
+        IxNodeGuard node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
-            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
         for (int i = 0; i < node->get_size(); i++) {                 // 遍历node的所有孩子
-            IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
+            IxNodeGuard child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
             // check first key
@@ -248,11 +243,8 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
                 ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
             }
 
-            buffer_pool_manager_->unpin_page(child->get_page_id(), false);
-
             check_tree(ih, node->value_at(i));  // 递归子树
         }
-        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -462,4 +454,119 @@ TEST_F(BPlusTreeConcurrentTest, MixScaleTest) {
         scan.next();
     }
     EXPECT_EQ(size, keys.size() - delete_keys.size());
-}
\ No newline at end of file
+}
+/**
+ * @brief 一半线程持续查找已有的key，另一半线程插入新的key使叶子结点不断分裂
+ * 查找线程不应因为分裂而找不到已有的key(B-link的右移)
+ */
+TEST_F(BPlusTreeConcurrentTest, LookupDuringSplitTest) {
+    const int64_t scale = 10000;
+    const int thread_num = 8;
+    const int order = 16;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    // 预先插入偶数key，之后并发插入的奇数key穿插在它们之间，使整棵树的叶子结点都会分裂
+    Transaction transaction(0);
+    for (int64_t key = 2; key <= 2 * scale; key += 2) {
+        Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(key)};
+        ih_->insert_entry((const char *)&key, rid, &transaction);
+    }
+
+    auto worker = [&](uint64_t thread_itr) {
+        Transaction txn(0);
+        std::vector<Rid> rids;
+        int64_t group = thread_num / 2;
+        for (int64_t i = static_cast<int64_t>(thread_itr / 2); i < scale; i += group) {
+            if (thread_itr % 2 == 0) {
+                int64_t key = 2 * i + 1;
+                Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(key)};
+                EXPECT_NE(ih_->insert_entry((const char *)&key, rid, &txn), -1);
+            } else {
+                int64_t key = 2 * i + 2;
+                rids.clear();
+                EXPECT_TRUE(ih_->get_value((const char *)&key, &rids, &txn));
+                EXPECT_EQ(rids.size(), 1);
+            }
+        }
+    };
+    LaunchParallelTest(thread_num, worker);
+
+    int64_t current_key = 1;
+    IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+    while (!scan.is_end()) {
+        EXPECT_EQ(scan.rid().slot_no, current_key);
+        current_key++;
+        scan.next();
+    }
+    EXPECT_EQ(current_key, 2 * scale + 1);
+    check_tree(ih_.get(), ih_->file_hdr_->root_page_);
+}
+
+// helper function for mixed workload: 80% lookup, 10% insert, 10% delete
+// 每个线程只插入和删除自己区间内的key，结束时删除剩余的key，使B+树恢复为预先插入的key
+void MixedHelper(IxIndexHandle *tree, int64_t preload, int64_t num_ops, uint64_t thread_itr = 0) {
+    Transaction *transaction = new Transaction(0);
+    std::mt19937_64 rng(thread_itr);
+    std::uniform_int_distribution<int64_t> hot_key(1, preload);
+
+    int64_t next_key = preload + 1 + static_cast<int64_t>(thread_itr) * num_ops;
+    std::deque<int64_t> own_keys;
+    std::vector<Rid> rids;
+    for (int64_t i = 0; i < num_ops; i++) {
+        int op = rng() % 10;
+        if (op < 8) {
+            int64_t key = hot_key(rng);
+            rids.clear();
+            EXPECT_TRUE(tree->get_value((const char *)&key, &rids, transaction));
+            EXPECT_EQ(rids.size(), 1);
+        } else if (op == 8 || own_keys.empty()) {
+            int64_t key = next_key++;
+            Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(key)};
+            EXPECT_NE(tree->insert_entry((const char *)&key, rid, transaction), -1);
+            own_keys.push_back(key);
+        } else {
+            int64_t key = own_keys.front();
+            own_keys.pop_front();
+            EXPECT_TRUE(tree->delete_entry((const char *)&key, transaction));
+        }
+    }
+    for (auto key : own_keys) {
+        EXPECT_TRUE(tree->delete_entry((const char *)&key, transaction));
+    }
+
+    delete transaction;
+}
+
+/**
+ * @brief 1~64个线程并发执行查找/插入/删除混合负载，每轮结束后只剩下预先插入的key
+ */
+TEST_F(BPlusTreeConcurrentTest, MixedWorkload) {
+    const int64_t preload = 20000;
+    const int64_t total_ops = 200000;
+    const int order = 64;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    Transaction transaction(0);
+    for (int64_t key = 1; key <= preload; key++) {
+        Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(key)};
+        ih_->insert_entry((const char *)&key, rid, &transaction);
+    }
+
+    for (int thread_num = 1; thread_num <= 64; thread_num *= 2) {
+        LaunchParallelTest(thread_num, MixedHelper, ih_.get(), preload, total_ops / thread_num);
+
+        // 每轮结束后B+树中应只剩下预先插入的key
+        int64_t current_key = 1;
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        while (!scan.is_end()) {
+            EXPECT_EQ(scan.rid().slot_no, current_key);
+            current_key++;
+            scan.next();
+        }
+        EXPECT_EQ(current_key, preload + 1);
+    }
+}
@@ -101,7 +101,7 @@ class BPlusTreeTests : public ::testing::Test {
                 << "max_size=" << leaf->get_max_size() << ",min_size=" << leaf->get_min_size() << "</TD></TR>\n";
             out << "<TR>";
             for (int i = 0; i < leaf->get_size(); i++) {
-                out << "<TD>" << *reinterpret_cast<int*>(leaf->get_key(i)) << "</TD>\n";
+                out << "<TD>" << leaf->key_at(i) << "</TD>\n";
             }
             out << "</TR>";
             // Print table end
@@ -152,19 +152,17 @@ class BPlusTreeTests : public ::testing::Test {
             }
             // Print leaves
             for (int i = 0; i < inner->get_size(); i++) {
-                IxNodeHandle *child_node = ih->fetch_node(inner->value_at(i));
-                ToGraph(ih, child_node, bpm, out);  // 继续递归
+                IxNodeGuard child_node = ih->fetch_node(inner->value_at(i));
+                ToGraph(ih, child_node.get(), bpm, out);  // 继续递归
                 if (i > 0) {
-                    IxNodeHandle *sibling_node = ih->fetch_node(inner->value_at(i - 1));
+                    IxNodeGuard sibling_node = ih->fetch_node(inner->value_at(i - 1));
                     if (!sibling_node->is_leaf_page() && !child_node->is_leaf_page()) {
                         out << "{rank=same " << internal_prefix << sibling_node->get_page_no() << " " << internal_prefix
                             << child_node->get_page_no() << "};\n";
                     }
-                    bpm->unpin_page(sibling_node->get_page_id(), false);
                 }
             }
         }
-        bpm->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -177,8 +175,8 @@ class BPlusTreeTests : public ::testing::Test {
         std::ofstream out(outf);
         out << "digraph G {" << std::endl;
         
-        IxNodeHandle *node = ih_->fetch_node(ih_->file_hdr_->root_page_);
-        ToGraph(ih_.get(), node, bpm, out);
+        IxNodeGuard node = ih_->fetch_node(ih_->file_hdr_->root_page_);
+        ToGraph(ih_.get(), node.get(), bpm, out);
         out << "}" << std::endl;
         out.close();
 
@@ -204,16 +202,13 @@ class BPlusTreeTests : public ::testing::Test {
         // check leaf list
         page_id_t leaf_no = ih->file_hdr_->first_leaf_;
         while (leaf_no != IX_LEAF_HEADER_PAGE) {
-            IxNodeHandle *curr = ih->fetch_node(leaf_no);
-            IxNodeHandle *prev = ih->fetch_node(curr->get_prev_leaf());
-            IxNodeHandle *next = ih->fetch_node(curr->get_next_leaf());
+            IxNodeGuard curr = ih->fetch_node(leaf_no);
+            IxNodeGuard prev = ih->fetch_node(curr->get_prev_leaf());
+            IxNodeGuard next = ih->fetch_node(curr->get_next_leaf());
             // Ensure prev->next == curr && next->prev == curr
             ASSERT_EQ(prev->get_next_leaf(), leaf_no);
             ASSERT_EQ(next->get_prev_leaf(), leaf_no);
             leaf_no = curr->get_next_leaf();
-            buffer_pool_manager_->unpin_page(curr->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(prev->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(next->get_page_id(), false);
         }
     }
 
@@ -224,13 +219,12 @@ class BPlusTreeTests : public ::testing::Test {
      * @param now_page_no 当前遍历到的结点
      */
     void check_tree(const IxIndexHandle *ih, int now_page_no) {
-        IxNodeHandle *node = ih->fetch_node(now_page_no);
+        IxNodeGuard node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
-            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
         for (int i = 0; i < node->get_size(); i++) {                 // 遍历node的所有孩子
-            IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
+            IxNodeGuard child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
             // check first key
@@ -246,11 +240,8 @@ class BPlusTreeTests : public ::testing::Test {
                 ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
             }
 
-            buffer_pool_manager_->unpin_page(child->get_page_id(), false);
-
             check_tree(ih, node->value_at(i));  // 递归子树
         }
-        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -491,4 +482,40 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     }
     std::cout << "Insert keys count: " << add_cnt << '\n' << "Delete keys count: " << del_cnt << '\n';
     check_all(ih_.get(), mock);
-}
\ No newline at end of file
+}
+/**
+ * @brief 删除所有的key之后树为空，根结点仍然是一个没有key的叶子，之后可以继续插入
+ */
+TEST_F(BPlusTreeTests, DeleteAllThenReinsert) {
+    const int order = 4;
+    ih_->file_hdr_->btree_order_ = order;
+    for (int scale : {1, 50}) {
+        for (int round = 0; round < 2; ++round) {
+            std::multimap<int, Rid> mock;
+            for (int key = 1; key <= scale; key++) {
+                Rid rid = {.page_no = round, .slot_no = key};
+                ASSERT_NE(ih_->insert_entry((const char *)&key, rid, txn_.get()), -1);
+                mock.insert(std::make_pair(key, rid));
+            }
+            check_all(ih_.get(), mock);
+            for (int key = scale; key >= 1; key--) {
+                ASSERT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+            }
+            // 根结点是first_leaf_和last_leaf_指向的唯一叶子
+            page_id_t root_page = ih_->file_hdr_->root_page_;
+            ASSERT_NE(root_page, INVALID_PAGE_ID);
+            ASSERT_EQ(ih_->file_hdr_->first_leaf_, root_page);
+            ASSERT_EQ(ih_->file_hdr_->last_leaf_, root_page);
+            {
+                IxNodeGuard root = ih_->fetch_node(root_page);
+                ASSERT_TRUE(root->is_leaf_page());
+                ASSERT_EQ(root->get_size(), 0);
+            }
+            ASSERT_EQ(ih_->leaf_begin(), ih_->leaf_end());
+            std::vector<Rid> rids;
+            int key = 1;
+            ASSERT_FALSE(ih_->get_value((const char *)&key, &rids, txn_.get()));
+            ASSERT_FALSE(ih_->delete_entry((const char *)&key, txn_.get()));
+        }
+    }
+}
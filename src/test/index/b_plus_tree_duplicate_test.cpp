@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "BPlusTreeDuplicateTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";                   // 测试文件名的前缀
+
+/**
+ * 测试允许重复key的索引(IX_FORMAT_DUPLICATE_KEYS)：同一个key可以对应多条记录，
+ * 按(key, rid)插入和删除，点查返回key的所有rid，范围查询可以按rid排序返回
+ */
+class BPlusTreeDuplicateTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open(ColType type, int len, int format_version = IX_FORMAT_DUPLICATE_KEYS) {
+        std::vector<ColMeta> cols = {{TEST_FILE_NAME, "col0", type, len, 0, true}};
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, format_version);
+        return ix_manager_->open_index(filename, cols);
+    }
+};
+
+static std::string string_key(int v, int len) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "city-%03d", v);
+    std::string key(buf);
+    key.resize(len, '\0');
+    return key;
+}
+
+/**
+ * @brief 低基数的列上随机插入、删除(key, rid)，结果与std::set<pair<key, rid>>一致
+ * 调小btree_order_让同一个key的项跨越多个叶子
+ */
+TEST_F(BPlusTreeDuplicateTests, RandomOpsMatchMultiset) {
+    for (ColType type : {TYPE_INT, TYPE_STRING}) {
+        for (int order : {6, 0}) {
+            int len = type == TYPE_INT ? 4 : 16;
+            auto ih = create_and_open(type, len);
+            ASSERT_TRUE(ih->file_hdr_->rid_suffix());
+            ASSERT_EQ(ih->file_hdr_->key_len(), len);
+            if (order > 0) {
+                ih->file_hdr_->btree_order_ = order;
+            }
+            auto make_key = [&](int v) {
+                return type == TYPE_INT ? std::string(reinterpret_cast<const char *>(&v), sizeof(int))
+                                        : string_key(v, len);
+            };
+            const int cardinality = 20;
+            std::set<std::pair<int, Rid>> mock;
+            std::vector<std::pair<int, Rid>> inserted;
+            std::mt19937 rng(order * 7 + type);
+            for (int round = 0; round < 20000; ++round) {
+                if (!inserted.empty() && rng() % 3 == 0) {
+                    size_t pos = rng() % inserted.size();
+                    auto [v, rid] = inserted[pos];
+                    bool exist = mock.erase({v, rid}) > 0;
+                    ASSERT_EQ(ih->delete_entry(make_key(v).data(), rid, nullptr), exist);
+                    inserted[pos] = inserted.back();
+                    inserted.pop_back();
+                } else {
+                    int v = static_cast<int>(rng() % cardinality);
+                    Rid rid = {static_cast<int>(rng() % 1000), static_cast<int>(rng() % 50)};
+                    bool fresh = mock.insert({v, rid}).second;
+                    ASSERT_EQ(ih->insert_entry(make_key(v).data(), rid, nullptr) != -1, fresh);
+                    if (fresh) {
+                        inserted.push_back({v, rid});
+                    }
+                }
+            }
+            // 删除不存在的(key, rid)失败
+            ASSERT_FALSE(ih->delete_entry(make_key(cardinality).data(), Rid{0, 0}, nullptr));
+            std::vector<Rid> rids;
+            for (int v = 0; v <= cardinality; ++v) {
+                std::vector<Rid> expected;
+                for (auto it = mock.lower_bound({v, IX_MIN_RID}); it != mock.end() && it->first == v; ++it) {
+                    expected.push_back(it->second);
+                }
+                rids.clear();
+                ASSERT_EQ(ih->get_value(make_key(v).data(), &rids, nullptr), !expected.empty());
+                ASSERT_EQ(rids, expected);  // 按rid有序
+                // [lower_bound, upper_bound)恰好是该key的所有项
+                rids.clear();
+                ih->get_rids(ih->lower_bound(make_key(v).data()), ih->upper_bound(make_key(v).data()), &rids);
+                ASSERT_EQ(rids, expected);
+            }
+            // 全表扫描按(key, rid)有序
+            IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+            for (auto &entry : mock) {
+                ASSERT_FALSE(scan.is_end());
+                ASSERT_EQ(scan.rid(), entry.second);
+                scan.next();
+            }
+            ASSERT_TRUE(scan.is_end());
+            ix_manager_->close_index(ih.get());
+        }
+    }
+}
+
+/**
+ * @brief 范围查询返回的rid按堆表位置排序，批量点查返回每个key的所有rid
+ */
+TEST_F(BPlusTreeDuplicateTests, RangeRidsSortedAndBatchLookup) {
+    auto ih = create_and_open(TYPE_INT, 4);
+    std::vector<std::pair<int, Rid>> entries;
+    for (int i = 0; i < 30000; ++i) {
+        int v = (i * 7919) % 100;   // 每个key对应300条记录，分散在不同的页面上
+        Rid rid = {i / 50, i % 50};
+        entries.push_back({v, rid});
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr), -1);
+    }
+    int lo = 10;
+    int hi = 20;
+    std::vector<Rid> expected;
+    for (auto &[v, rid] : entries) {
+        if (v >= lo && v < hi) {
+            expected.push_back(rid);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    std::vector<Rid> rids;
+    ASSERT_EQ(ih->get_rids(ih->lower_bound(reinterpret_cast<const char *>(&lo)),
+                           ih->lower_bound(reinterpret_cast<const char *>(&hi)), &rids),
+              static_cast<int>(expected.size()));
+    ASSERT_EQ(rids, expected);
+    // 不排序时按(key, rid)的顺序返回
+    rids.clear();
+    ih->get_rids(ih->lower_bound(reinterpret_cast<const char *>(&lo)),
+                 ih->lower_bound(reinterpret_cast<const char *>(&hi)), &rids, false);
+    ASSERT_EQ(rids.size(), expected.size());
+    ASSERT_FALSE(std::is_sorted(rids.begin(), rids.end()));
+
+    std::vector<int> keys = {3, 3, 50, 150};
+    std::vector<int> key_index;
+    rids.clear();
+    ASSERT_EQ(ih->get_values(reinterpret_cast<const char *>(keys.data()), 4, &rids, nullptr, &key_index), 3);
+    ASSERT_EQ(rids.size(), 900u);
+    ASSERT_EQ(std::count(key_index.begin(), key_index.end(), 1), 300);
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief INCLUDE列存放在rid之后，不影响(key, rid)的顺序，get_entry可以读回key、rid和INCLUDE列；
+ * 逐条插入与外部排序批量构建得到相同的索引项
+ */
+TEST_F(BPlusTreeDuplicateTests, IncludeColumns) {
+    std::vector<ColMeta> cols = {{TEST_FILE_NAME, "grp", TYPE_INT, 4, 0, true}};
+    std::vector<ColMeta> include_cols = {{TEST_FILE_NAME, "name", TYPE_STRING, 8, 4, false},
+                                         {TEST_FILE_NAME, "score", TYPE_FLOAT, 4, 12, false}};
+    auto make_entry = [](int grp, int i) {
+        char buf[16];
+        memcpy(buf, &grp, sizeof(int));
+        memset(buf + 4, 0, 8);
+        snprintf(buf + 4, 8, "n%d", i);
+        float score = 0.5f * (i - 7);
+        memcpy(buf + 12, &score, sizeof(float));
+        return std::string(buf, sizeof(buf));
+    };
+    const int scale = 5000;
+    std::unique_ptr<IxIndexHandle> ihs[2];
+    for (int i = 0; i < 2; ++i) {
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, IX_FORMAT_DUPLICATE_KEYS, include_cols);
+        ihs[i] = ix_manager_->open_index(filename, cols);
+    }
+    auto hdr = ihs[0]->file_hdr_;
+    ASSERT_EQ(hdr->include_num_, 2);
+    ASSERT_EQ(hdr->key_len(), 4);
+    ASSERT_EQ(hdr->include_len(), 12);
+    ASSERT_EQ(hdr->include_offset(), 4 + IX_RID_SUFFIX_LEN);
+    // 逐条插入，再从rid较大的一半中删除偶数项
+    for (int i = 0; i < scale; ++i) {
+        ASSERT_NE(ihs[0]->insert_entry(make_entry(i % 10, i).data(), Rid{i, 0}, nullptr), -1);
+    }
+    for (int i = 0; i < scale; i += 2) {
+        if (i >= scale / 2) {
+            ASSERT_TRUE(ihs[0]->delete_entry(make_entry(i % 10, i).data(), Rid{i, 0}, nullptr));
+        }
+    }
+    {
+        IxSorter sorter(hdr, "include");
+        for (int i = 0; i < scale; ++i) {
+            if (i < scale / 2 || i % 2 == 1) {
+                sorter.add(make_entry(i % 10, i).data(), Rid{i, 0});
+            }
+        }
+        sorter.finish();
+        ihs[1]->bulk_load(&sorter, IX_BULK_FILL_FACTOR);
+    }
+    for (auto &ih : ihs) {
+        // 按(grp, rid)有序地读回每一项
+        std::vector<std::pair<int, int>> expected;
+        for (int i = 0; i < scale; ++i) {
+            if (i < scale / 2 || i % 2 == 1) {
+                expected.push_back({i % 10, i});
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        for (auto &[grp, i] : expected) {
+            ASSERT_FALSE(scan.is_end());
+            char key[IX_MAX_COL_LEN];
+            Rid rid = ih->get_entry(scan.iid(), key);
+            ASSERT_EQ(rid, (Rid{i, 0}));
+            std::string entry = make_entry(grp, i);
+            ASSERT_EQ(memcmp(key, entry.data(), 4), 0);
+            ASSERT_EQ(memcmp(key + hdr->include_offset(), entry.data() + 4, 12), 0);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+        // 查找时不需要INCLUDE列，grp = 4的项中只剩下rid较小的一半
+        int grp = 4;
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&grp), &rids, nullptr));
+        ASSERT_EQ(rids.size(), static_cast<size_t>(scale / 10 / 2));
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief 不同基数的列上允许重复key的索引中，每个key能找到所有重复的项
+ */
+TEST_F(BPlusTreeDuplicateTests, LowCardinality) {
+    const int scale = 100000;
+    for (int cardinality : {10, 1000}) {
+        auto ih = create_and_open(TYPE_STRING, 16);
+        for (int i = 0; i < scale; ++i) {
+            ASSERT_NE(ih->insert_entry(string_key(i % cardinality, 16).data(), Rid{i / 100, i % 100}, nullptr), -1);
+        }
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih->get_value(string_key(1, 16).data(), &rids, nullptr));
+        ASSERT_EQ(rids.size(), static_cast<size_t>(scale / cardinality));
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief 检查以page_no为根的子树中内部结点的分隔key：
+ * 压缩结点中的分隔key是截断之后的前缀，删除孩子的第0个key时也不更新，
+ * 因此只保证第i个key不大于第i个孩子的第0个key，且第i个孩子的最后一个key小于第i+1个key
+ */
+static void check_separators(IxIndexHandle *ih, page_id_t page_no) {
+    IxNodeGuard node = ih->fetch_node(page_no);
+    if (node->is_leaf_page()) {
+        return;
+    }
+    int len = ih->file_hdr_->col_tot_len_;
+    std::vector<char> first(len);
+    std::vector<char> last(len);
+    for (int i = 0; i < node->get_size(); i++) {
+        IxNodeGuard child = ih->fetch_node(node->value_at(i));
+        ASSERT_GT(child->get_size(), 0);
+        child->copy_key(0, first.data());
+        child->copy_key(child->get_size() - 1, last.data());
+        if (i != 0) {
+            ASSERT_LE(node->compare_key(i, first.data()), 0);
+        }
+        if (i + 1 < node->get_size()) {
+            ASSERT_GT(node->compare_key(i + 1, last.data()), 0);
+        }
+        check_separators(ih, node->value_at(i));
+    }
+}
+
+/**
+ * @brief 随机插入、删除重复的key之后，压缩的内部结点中的分隔key仍然界定每个孩子的范围
+ */
+TEST_F(BPlusTreeDuplicateTests, CompressedSeparatorsBoundChildren) {
+    for (ColType type : {TYPE_INT, TYPE_STRING}) {
+        int len = type == TYPE_INT ? 4 : 64;
+        auto ih = create_and_open(type, len);
+        ASSERT_TRUE(ih->file_hdr_->compressed_nodes());
+        auto make_key = [&](int v) {
+            return type == TYPE_INT ? std::string(reinterpret_cast<const char *>(&v), sizeof(int))
+                                    : string_key(v, len);
+        };
+        std::vector<std::pair<int, Rid>> inserted;
+        std::mt19937 rng(type);
+        for (int round = 0; round < 60000; ++round) {
+            if (!inserted.empty() && rng() % 5 < 2) {
+                size_t pos = rng() % inserted.size();
+                auto [v, rid] = inserted[pos];
+                ASSERT_TRUE(ih->delete_entry(make_key(v).data(), rid, nullptr));
+                inserted[pos] = inserted.back();
+                inserted.pop_back();
+            } else {
+                int v = static_cast<int>(rng() % 50);
+                Rid rid = {round, 0};
+                ASSERT_NE(ih->insert_entry(make_key(v).data(), rid, nullptr), -1);
+                inserted.push_back({v, rid});
+            }
+            if (round % 10000 == 9999) {
+                check_separators(ih.get(), ih->file_hdr_->root_page_);
+            }
+        }
+        ASSERT_FALSE(ih->fetch_node(ih->file_hdr_->root_page_)->is_leaf_page());  // 至少有两层
+        ix_manager_->close_index(ih.get());
+    }
+}
@@ -101,7 +101,7 @@ class BPlusTreeTests : public ::testing::Test {
                 << "max_size=" << leaf->get_max_size() << ",min_size=" << leaf->get_min_size() << "</TD></TR>\n";
             out << "<TR>";
             for (int i = 0; i < leaf->get_size(); i++) {
-                out << "<TD>" << *reinterpret_cast<int*>(leaf->get_key(i)) << "</TD>\n";
+                out << "<TD>" << leaf->key_at(i) << "</TD>\n";
             }
             out << "</TR>";
             // Print table end
@@ -152,19 +152,17 @@ class BPlusTreeTests : public ::testing::Test {
             }
             // Print leaves
             for (int i = 0; i < inner->get_size(); i++) {
-                IxNodeHandle *child_node = ih->fetch_node(inner->value_at(i));
-                ToGraph(ih, child_node, bpm, out);  // 继续递归
+                IxNodeGuard child_node = ih->fetch_node(inner->value_at(i));
+                ToGraph(ih, child_node.get(), bpm, out);  // 继续递归
                 if (i > 0) {
-                    IxNodeHandle *sibling_node = ih->fetch_node(inner->value_at(i - 1));
+                    IxNodeGuard sibling_node = ih->fetch_node(inner->value_at(i - 1));
                     if (!sibling_node->is_leaf_page() && !child_node->is_leaf_page()) {
                         out << "{rank=same " << internal_prefix << sibling_node->get_page_no() << " " << internal_prefix
                             << child_node->get_page_no() << "};\n";
                     }
-                    bpm->unpin_page(sibling_node->get_page_id(), false);
                 }
             }
         }
-        bpm->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -177,8 +175,8 @@ class BPlusTreeTests : public ::testing::Test {
         std::ofstream out(outf);
         out << "digraph G {" << std::endl;
         
-        IxNodeHandle *node = ih_->fetch_node(ih_->file_hdr_->root_page_);
-        ToGraph(ih_.get(), node, bpm, out);
+        IxNodeGuard node = ih_->fetch_node(ih_->file_hdr_->root_page_);
+        ToGraph(ih_.get(), node.get(), bpm, out);
         out << "}" << std::endl;
         out.close();
 
@@ -204,16 +202,13 @@ class BPlusTreeTests : public ::testing::Test {
         // check leaf list
         page_id_t leaf_no = ih->file_hdr_->first_leaf_;
         while (leaf_no != IX_LEAF_HEADER_PAGE) {
-            IxNodeHandle *curr = ih->fetch_node(leaf_no);
-            IxNodeHandle *prev = ih->fetch_node(curr->get_prev_leaf());
-            IxNodeHandle *next = ih->fetch_node(curr->get_next_leaf());
+            IxNodeGuard curr = ih->fetch_node(leaf_no);
+            IxNodeGuard prev = ih->fetch_node(curr->get_prev_leaf());
+            IxNodeGuard next = ih->fetch_node(curr->get_next_leaf());
             // Ensure prev->next == curr && next->prev == curr
             ASSERT_EQ(prev->get_next_leaf(), leaf_no);
             ASSERT_EQ(next->get_prev_leaf(), leaf_no);
             leaf_no = curr->get_next_leaf();
-            buffer_pool_manager_->unpin_page(curr->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(prev->get_page_id(), false);
-            buffer_pool_manager_->unpin_page(next->get_page_id(), false);
         }
     }
 
@@ -224,13 +219,12 @@ class BPlusTreeTests : public ::testing::Test {
      * @param now_page_no 当前遍历到的结点
      */
     void check_tree(const IxIndexHandle *ih, int now_page_no) {
-        IxNodeHandle *node = ih->fetch_node(now_page_no);
+        IxNodeGuard node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
-            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
         for (int i = 0; i < node->get_size(); i++) {                 // 遍历node的所有孩子
-            IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
+            IxNodeGuard child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
             // check first key
@@ -246,11 +240,8 @@ class BPlusTreeTests : public ::testing::Test {
                 ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
             }
 
-            buffer_pool_manager_->unpin_page(child->get_page_id(), false);
-
             check_tree(ih, node->value_at(i));  // 递归子树
         }
-        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
 
     /**
@@ -412,4 +403,43 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
         scan.next();
     }
     EXPECT_EQ(current_key, keys.size() + 1);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 文件头中没有格式版本(版本字段加入之前的旧文件，页面布局可能不同)或版本未知的索引文件不能打开
+ */
+TEST_F(BPlusTreeTests, RejectOldFormatTest) {
+    const std::vector<std::string> cols = {"col2"};
+    ix_manager_->create_index(TEST_FILE_NAME, {{.tab_name = TEST_FILE_NAME, .name = "col2", .type = TYPE_INT,
+                                                .len = 4, .offset = 4}});
+    std::string ix_name = ix_manager_->get_index_name(TEST_FILE_NAME, cols);
+    char page[PAGE_SIZE] = {};
+    int fd = disk_manager_->open_file(ix_name);
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, page, PAGE_SIZE);
+    disk_manager_->close_file(fd);
+    // 文件头的最后两个int是format_version_和include_num_，tot_len_存放在开头
+    int tot_len = *reinterpret_cast<int *>(page);
+    ASSERT_EQ(*reinterpret_cast<int *>(page + tot_len - 2 * sizeof(int)), IX_FORMAT_VERSION);
+    auto write_hdr = [&](int len, int version) {
+        char hdr[PAGE_SIZE];
+        memcpy(hdr, page, PAGE_SIZE);
+        *reinterpret_cast<int *>(hdr) = len;
+        *reinterpret_cast<int *>(hdr + tot_len - 2 * sizeof(int)) = version;
+        int fd = disk_manager_->open_file(ix_name);
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, hdr, PAGE_SIZE);
+        disk_manager_->close_file(fd);
+    };
+
+    // 版本字段加入之前的文件头在last_leaf_之后结束
+    write_hdr(tot_len - 2 * sizeof(int), IX_FORMAT_VERSION);
+    ASSERT_THROW(ix_manager_->open_index(TEST_FILE_NAME, cols), IndexFormatVersionError);
+    // 未知的版本
+    write_hdr(tot_len, IX_FORMAT_DUPLICATE_KEYS + 1);
+    ASSERT_THROW(ix_manager_->open_index(TEST_FILE_NAME, cols), IndexFormatVersionError);
+    // 拒绝时已经关闭了文件，恢复文件头之后可以正常打开
+    write_hdr(tot_len, IX_FORMAT_VERSION);
+    auto ih = ix_manager_->open_index(TEST_FILE_NAME, cols);
+    ASSERT_EQ(ih->file_hdr_->format_version_, IX_FORMAT_VERSION);
+    ix_manager_->close_index(ih.get());
+    ASSERT_NO_THROW(ix_manager_->destroy_index(TEST_FILE_NAME, cols));
+}
@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "index/ix_search.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+#include "system/sm.h"
+
+const std::string TEST_DB_NAME = "IxBulkTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";       // 测试文件名的前缀
+
+/**
+ * 测试CREATE INDEX使用的外部排序和自底向上的批量构建
+ */
+class IxBulkTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static std::vector<ColMeta> make_cols(const std::vector<std::pair<ColType, int>> &types) {
+        std::vector<ColMeta> cols;
+        int offset = 0;
+        for (size_t i = 0; i < types.size(); ++i) {
+            cols.push_back({TEST_FILE_NAME, "col" + std::to_string(i), types[i].first, types[i].second, offset, true});
+            offset += types[i].second;
+        }
+        return cols;
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open(const std::vector<ColMeta> &cols) {
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, IX_FORMAT_DUPLICATE_KEYS);
+        return ix_manager_->open_index(filename, cols);
+    }
+
+    // 叶子结点的数量
+    int num_leaves(IxIndexHandle *ih) {
+        int count = 0;
+        for (page_id_t page_no = ih->file_hdr_->first_leaf_; page_no != IX_LEAF_HEADER_PAGE;) {
+            IxNodeGuard leaf = ih->fetch_node(page_no);
+            page_no = leaf->get_next_leaf();
+            count++;
+        }
+        return count;
+    }
+
+    // 除最后一个叶子之外平均每个叶子的键值对数量，以及叶子能容纳的键值对数量
+    std::pair<double, int> leaf_fill(IxIndexHandle *ih) {
+        int count = 0;
+        long entries = 0;
+        int cap = 0;
+        for (page_id_t page_no = ih->file_hdr_->first_leaf_; page_no != IX_LEAF_HEADER_PAGE;) {
+            IxNodeGuard leaf = ih->fetch_node(page_no);
+            page_no = leaf->get_next_leaf();
+            cap = leaf->get_max_size() - 1;     // 达到max_size时会分裂
+            if (page_no != IX_LEAF_HEADER_PAGE) {
+                entries += leaf->get_size();
+                count++;
+            }
+        }
+        return {count == 0 ? 0 : static_cast<double>(entries) / count, cap};
+    }
+
+    // 索引中的所有键值对与mock一致：逐个点查得到key的所有rid，并且全表扫描的顺序与mock相同
+    // mock中相同key的rid按从小到大的顺序排列
+    template <typename Map>
+    void check_index(IxIndexHandle *ih, const Map &mock) {
+        std::vector<Rid> rids;
+        for (auto it = mock.begin(); it != mock.end();) {
+            auto range = mock.equal_range(it->first);
+            rids.clear();
+            ASSERT_TRUE(ih->get_value(it->first.data(), &rids, nullptr));
+            ASSERT_EQ(rids.size(), static_cast<size_t>(std::distance(range.first, range.second)));
+            for (auto &rid : rids) {
+                ASSERT_EQ(rid, it->second);
+                ++it;
+            }
+        }
+        IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        auto it = mock.begin();
+        while (!scan.is_end()) {
+            ASSERT_NE(it, mock.end());
+            ASSERT_EQ(scan.rid(), it->second);
+            ++it;
+            scan.next();
+        }
+        ASSERT_EQ(it, mock.end());
+    }
+};
+
+static std::string int_key(int v) { return std::string(reinterpret_cast<const char *>(&v), sizeof(int)); }
+
+static std::string string_key(std::mt19937 &rng, int len) {
+    static const char *prefixes[] = {"user/", "order/2024/", "z"};
+    std::string key = prefixes[rng() % 3];
+    int extra = 1 + static_cast<int>(rng() % 10);
+    for (int i = 0; i < extra; ++i) {
+        key.push_back(static_cast<char>('a' + rng() % 8));
+    }
+    key.resize(len, '\0');
+    return key;
+}
+
+/**
+ * @brief 内存预算很小时外部排序会写出多个run，归并之后的结果与按(key, rid)排序一致
+ */
+TEST_F(IxBulkTests, SorterSpillsAndMerges) {
+    std::mt19937 rng(3);
+    auto cols = make_cols({{TYPE_INT, 4}, {TYPE_FLOAT, 4}});
+    auto ih = create_and_open(cols);
+    const IxFileHdr *hdr = ih->get_file_hdr();
+    ASSERT_TRUE(hdr->normalized_keys());
+    for (size_t budget : {size_t(1) << 30, size_t(12 * 1000)}) {
+        std::vector<std::pair<std::string, Rid>> input;
+        IxSorter sorter(hdr, "sorter_test", budget, 4);
+        for (int i = 0; i < 20000; ++i) {
+            int a = static_cast<int>(rng() % 2000) - 1000;
+            float b = static_cast<float>(static_cast<int>(rng() % 200) - 100) / 8;
+            std::string key = int_key(a) + std::string(reinterpret_cast<const char *>(&b), sizeof(float));
+            Rid rid = {i, i % 7};
+            input.emplace_back(key, rid);
+            sorter.add(key.data(), rid);
+        }
+        sorter.finish();
+        if (budget < 100000) {
+            ASSERT_GT(sorter.num_runs(), 1u);
+        } else {
+            ASSERT_EQ(sorter.num_runs(), 0u);
+        }
+        // rid随输入顺序递增，按key稳定排序即为按(key, rid)排序
+        std::vector<ColType> types = {TYPE_INT, TYPE_FLOAT};
+        std::vector<int> lens = {4, 4};
+        std::stable_sort(input.begin(), input.end(), [&](const auto &x, const auto &y) {
+            return ix_compare(x.first.data(), y.first.data(), types, lens) < 0;
+        });
+        const char *key;
+        Rid rid;
+        char raw[IX_MAX_COL_LEN];
+        for (auto &[expected_key, expected_rid] : input) {
+            ASSERT_TRUE(sorter.next(&key, &rid));
+            ix_denormalize_key(hdr, key, raw);
+            ASSERT_EQ(memcmp(raw, expected_key.data(), hdr->key_len()), 0);
+            ASSERT_EQ(rid, expected_rid);
+        }
+        ASSERT_FALSE(sorter.next(&key, &rid));
+    }
+    ix_manager_->close_index(ih.get());
+    // 临时文件在析构时删除
+    ASSERT_FALSE(disk_manager_->is_file("sorter_test.0.run0"));
+}
+
+/**
+ * @brief 多个线程并发地向各自的分区添加数据，归并结果与按分区顺序拼接之后的稳定排序一致
+ * (rid按分区、分区内的顺序递增，也就是按(key, rid)排序)
+ */
+TEST_F(IxBulkTests, PartitionedSorterMatchesStableSort) {
+    auto cols = make_cols({{TYPE_INT, 4}});
+    auto ih = create_and_open(cols);
+    const IxFileHdr *hdr = ih->get_file_hdr();
+    const int num_parts = 3;
+    const int per_part = 10000;
+    std::vector<std::vector<std::pair<int, Rid>>> inputs(num_parts);
+    std::mt19937 rng(8);
+    for (int part = 0; part < num_parts; ++part) {
+        for (int i = 0; i < per_part; ++i) {
+            inputs[part].emplace_back(static_cast<int>(rng() % 3000), Rid{part, i});
+        }
+    }
+    IxSorter sorter(hdr, "partition_test", 3 * 8 * 1000, 2, num_parts);
+    std::vector<std::thread> workers;
+    for (int part = 0; part < num_parts; ++part) {
+        workers.emplace_back([&, part] {
+            for (auto &[key, rid] : inputs[part]) {
+                sorter.add(reinterpret_cast<const char *>(&key), rid, part);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    sorter.finish();
+    ASSERT_GT(sorter.num_runs(), static_cast<size_t>(num_parts));
+    std::vector<std::pair<int, Rid>> expected;
+    for (auto &input : inputs) {
+        expected.insert(expected.end(), input.begin(), input.end());
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto &x, const auto &y) { return x.first < y.first; });
+    const char *key;
+    Rid rid;
+    char raw[IX_MAX_COL_LEN];
+    for (auto &[expected_key, expected_rid] : expected) {
+        ASSERT_TRUE(sorter.next(&key, &rid));
+        ix_denormalize_key(hdr, key, raw);
+        ASSERT_EQ(*reinterpret_cast<const int *>(raw), expected_key);
+        ASSERT_EQ(rid, expected_rid);
+    }
+    ASSERT_FALSE(sorter.next(&key, &rid));
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 批量构建的索引与mock一致，填充率决定叶子数量，构建之后可以正常插入和删除
+ */
+TEST_F(IxBulkTests, BulkLoadMatchesMap) {
+    std::vector<std::vector<ColMeta>> layouts = {
+        make_cols({{TYPE_INT, 4}}),
+        make_cols({{TYPE_STRING, 24}}),
+    };
+    for (auto &cols : layouts) {
+        std::vector<ColType> types;
+        std::vector<int> lens;
+        for (auto &col : cols) {
+            types.push_back(col.type);
+            lens.push_back(col.len);
+        }
+        auto less = [&](const std::string &a, const std::string &b) {
+            return ix_compare(a.data(), b.data(), types, lens) < 0;
+        };
+        int leaves_prev = 0;
+        for (double fill : {0.5, 1.0}) {
+            std::mt19937 rng(17);
+            auto random_key = [&]() {
+                return cols[0].type == TYPE_INT ? int_key(static_cast<int>(rng() % 200000)) : string_key(rng, 24);
+            };
+            auto ih = create_and_open(cols);
+            std::multimap<std::string, Rid, decltype(less)> mock(less);
+            IxSorter sorter(ih->get_file_hdr(), "bulk_test", 64 * 1024);
+            for (int i = 0; i < 30000; ++i) {
+                std::string key = random_key();
+                Rid rid = {i / 100, i % 100};
+                sorter.add(key.data(), rid);
+                mock.emplace(key, rid);     // 重复的key全部保留，rid递增，排在相同key的最后
+            }
+            sorter.finish();
+            ih->bulk_load(&sorter, fill);
+            check_index(ih.get(), mock);
+            int leaves = num_leaves(ih.get());
+            if (leaves_prev > 0) {
+                ASSERT_LT(leaves, leaves_prev);    // 填充率越高，叶子越少
+            }
+            leaves_prev = leaves;
+            // 构建之后的树可以正常修改
+            for (int i = 0; i < 10000; ++i) {
+                std::string key = random_key();
+                if (i % 2 == 0) {
+                    // 删除该key的第一项，也就是rid最小的一项
+                    auto it = mock.find(key);
+                    ASSERT_EQ(ih->delete_entry(key.data(), nullptr), it != mock.end());
+                    if (it != mock.end()) {
+                        mock.erase(it);
+                    }
+                } else {
+                    Rid rid = {1000 + i, 0};
+                    mock.emplace(key, rid);
+                    ASSERT_NE(ih->insert_entry(key.data(), rid, nullptr), -1);
+                }
+            }
+            check_index(ih.get(), mock);
+            ix_manager_->close_index(ih.get());
+        }
+    }
+}
+
+/**
+ * @brief 外部排序+批量构建的索引与逐条插入的索引查找结果相同，叶子数不多于逐条插入，
+ * 除最后一个叶子之外每个叶子都按填充率装满
+ */
+TEST_F(IxBulkTests, BulkLoadPacksLeaves) {
+    const int scale = 300000;
+    auto cols = make_cols({{TYPE_INT, 4}});
+    std::vector<int> keys(scale);
+    for (int i = 0; i < scale; ++i) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    int leaves[2];
+    for (const char *method : {"insert", "bulk"}) {
+        auto ih = create_and_open(cols);
+        if (strcmp(method, "insert") == 0) {
+            for (int i = 0; i < scale; ++i) {
+                ih->insert_entry(reinterpret_cast<const char *>(&keys[i]), Rid{i, 0}, nullptr);
+            }
+        } else {
+            IxSorter sorter(ih->get_file_hdr(), "bench", 1 << 20);
+            for (int i = 0; i < scale; ++i) {
+                sorter.add(reinterpret_cast<const char *>(&keys[i]), Rid{i, 0});
+            }
+            sorter.finish();
+            ih->bulk_load(&sorter, IX_BULK_FILL_FACTOR);
+        }
+        leaves[strcmp(method, "bulk") == 0] = num_leaves(ih.get());
+        if (strcmp(method, "bulk") == 0) {
+            auto [avg, cap] = leaf_fill(ih.get());
+            // 按填充率截断时最多少装一个键值对
+            EXPECT_GE(avg, IX_BULK_FILL_FACTOR * cap - 1) << "capacity " << cap;
+        }
+        std::vector<Rid> rids;
+        for (int i = 0; i < scale; i += 97) {
+            rids.clear();
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&keys[i]), &rids, nullptr));
+            ASSERT_EQ(rids[0].page_no, i);
+        }
+        ix_manager_->close_index(ih.get());
+    }
+    EXPECT_LE(leaves[1], leaves[0]);
+}
+
+/**
+ * @brief 一条create index在一次多线程扫描中为同一张表建立多个索引，结果与逐条插入相同：
+ * 每个key对应表中所有具有该key的记录，按rid排列
+ */
+TEST_F(IxBulkTests, CreateIndexesSinglePass) {
+    auto rm = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+    auto sm = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm.get(), ix_manager_.get());
+    std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"grp", TYPE_INT, 4}, {"name", TYPE_STRING, 16}};
+    sm->create_table(TEST_FILE_NAME, coldef, nullptr);
+    RmFileHandle *fh = sm->fhs_.at(TEST_FILE_NAME).get();
+    const int scale = 60000;
+    std::multimap<int, Rid> by_id;
+    std::multimap<std::pair<int, std::string>, Rid> by_grp_name;
+    std::mt19937 rng(21);
+    char buf[24];
+    for (int i = 0; i < scale; ++i) {
+        int id = static_cast<int>(rng() % 30000);
+        int grp = static_cast<int>(rng() % 10);
+        std::string name = "n" + std::to_string(rng() % 500);
+        name.resize(16, '\0');
+        memcpy(buf, &id, 4);
+        memcpy(buf + 4, &grp, 4);
+        memcpy(buf + 8, name.data(), 16);
+        Rid rid = fh->insert_record(buf, nullptr);
+        by_id.emplace(id, rid);
+        by_grp_name.emplace(std::make_pair(grp, name), rid);
+    }
+    ASSERT_GT(fh->get_file_hdr().num_pages, 4 * IX_BUILD_MIN_PAGES_PER_THREAD);
+    sm->create_indexes(TEST_FILE_NAME, {{"id"}, {"grp", "name"}}, {}, INDEX_BTREE, false, nullptr, 4);
+    ASSERT_EQ(sm->db_.get_table(TEST_FILE_NAME).indexes.size(), 2u);
+    ASSERT_THROW(sm->create_indexes(TEST_FILE_NAME, {{"name"}, {"name"}}, {}, INDEX_BTREE, false, nullptr),
+                 IndexExistsError);
+    ASSERT_FALSE(ix_manager_->exists(TEST_FILE_NAME, std::vector<std::string>{"name"}));
+
+    IxIndexHandle *id_index = sm->ihs_.at(ix_manager_->get_index_name(TEST_FILE_NAME, std::vector<std::string>{"id"})).get();
+    IxScan scan(id_index, id_index->leaf_begin(), id_index->leaf_end(), buffer_pool_manager_.get());
+    for (auto &[id, rid] : by_id) {
+        ASSERT_FALSE(scan.is_end());
+        ASSERT_EQ(scan.rid(), rid);
+        scan.next();
+    }
+    ASSERT_TRUE(scan.is_end());
+    IxIndexHandle *grp_index = sm->ihs_.at(ix_manager_->get_index_name(TEST_FILE_NAME, std::vector<std::string>{"grp", "name"})).get();
+    std::vector<Rid> rids;
+    for (auto it = by_grp_name.begin(); it != by_grp_name.end();) {
+        std::string raw(reinterpret_cast<const char *>(&it->first.first), 4);
+        raw += it->first.second;
+        rids.clear();
+        ASSERT_TRUE(grp_index->get_value(raw.data(), &rids, nullptr));
+        ASSERT_EQ(rids.size(), by_grp_name.count(it->first));
+        for (auto &rid : rids) {
+            ASSERT_EQ(rid, it->second);
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief 唯一索引不追加rid，单列INT/FLOAT/CHAR key仍使用专用的查找内核；非唯一索引使用允许重复key的格式
+ * 表中已有重复的key时不能建立唯一索引，建了一部分的索引文件被删除
+ */
+TEST_F(IxBulkTests, UniqueIndexKeepsKeyKernels) {
+    auto rm = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+    auto sm = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm.get(), ix_manager_.get());
+    std::vector<ColDef> coldef = {{"id", TYPE_INT, 4},   {"score", TYPE_FLOAT, 4}, {"name", TYPE_STRING, 16},
+                                  {"grp", TYPE_INT, 4}, {"tag", TYPE_INT, 4}};
+    sm->create_table(TEST_FILE_NAME, coldef, nullptr);
+    RmFileHandle *fh = sm->fhs_.at(TEST_FILE_NAME).get();
+    const int scale = 5000;
+    char buf[32];
+    for (int i = 0; i < scale; ++i) {
+        int id = i * 7 % scale;
+        float score = static_cast<float>(i) / 4;
+        std::string name = "n" + std::to_string(i);
+        name.resize(16, '\0');
+        int grp = i % 10;
+        int tag = i % 3;
+        memcpy(buf, &id, 4);
+        memcpy(buf + 4, &score, 4);
+        memcpy(buf + 8, name.data(), 16);
+        memcpy(buf + 24, &grp, 4);
+        memcpy(buf + 28, &tag, 4);
+        fh->insert_record(buf, nullptr);
+    }
+    sm->create_indexes(TEST_FILE_NAME, {{"id"}, {"score"}, {"name"}}, {}, INDEX_BTREE, true, nullptr);
+    sm->create_indexes(TEST_FILE_NAME, {{"grp"}}, {}, INDEX_BTREE, false, nullptr);
+    auto index = [&](const std::string &col) {
+        return sm->ihs_.at(ix_manager_->get_index_name(TEST_FILE_NAME, std::vector<std::string>{col})).get();
+    };
+    struct Case {
+        const char *col;
+        IxKeyLayout layout;
+    };
+    for (auto &c : {Case{"id", IxKeyLayout::INT}, Case{"score", IxKeyLayout::FLOAT}, Case{"name", IxKeyLayout::CHAR}}) {
+        const IxFileHdr *hdr = index(c.col)->get_file_hdr();
+        ASSERT_FALSE(hdr->rid_suffix());
+        ASSERT_EQ(ix_key_layout(hdr), c.layout);
+    }
+    ASSERT_TRUE(index("grp")->get_file_hdr()->rid_suffix());
+    ASSERT_EQ(ix_key_layout(index("grp")->get_file_hdr()), IxKeyLayout::NORMALIZED);
+
+    // 两种格式的索引都能找到表中的记录
+    std::vector<Rid> rids;
+    int id = 42;
+    ASSERT_TRUE(index("id")->get_value(reinterpret_cast<const char *>(&id), &rids, nullptr));
+    ASSERT_EQ(rids.size(), 1u);
+    rids.clear();
+    int grp = 3;
+    ASSERT_TRUE(index("grp")->get_value(reinterpret_cast<const char *>(&grp), &rids, nullptr));
+    ASSERT_EQ(rids.size(), static_cast<size_t>(scale / 10));
+
+    // (score, tag)建成之后tag上有重复的key，两个索引都不保留
+    ASSERT_THROW(sm->create_indexes(TEST_FILE_NAME, {{"score", "tag"}, {"tag"}}, {}, INDEX_BTREE, true, nullptr),
+                 UniqueKeyViolationError);
+    ASSERT_FALSE(ix_manager_->exists(TEST_FILE_NAME, std::vector<std::string>{"score", "tag"}));
+    ASSERT_FALSE(ix_manager_->exists(TEST_FILE_NAME, std::vector<std::string>{"tag"}));
+    ASSERT_THROW(sm->create_indexes(TEST_FILE_NAME, {{"id", "tag"}}, {"name"}, INDEX_BTREE, true, nullptr),
+                 UniqueIndexUnsupportedError);
+    ASSERT_EQ(sm->db_.get_table(TEST_FILE_NAME).indexes.size(), 4u);
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxHashTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";       // 测试文件名的前缀
+
+/**
+ * 测试可扩展哈希索引：同一个key可以对应多条记录，按(key, rid)插入和删除，
+ * 点查返回key的所有rid；桶分裂、目录加倍、溢出页以及关闭之后重新打开
+ */
+class IxHashTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    std::vector<ColMeta> make_cols(ColType type, int len) { return {{TEST_FILE_NAME, "col0", type, len, 0, true}}; }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxHashHandle> create_and_open(const std::vector<ColMeta> &cols, std::string *filename = nullptr) {
+        std::string name = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_hash_index(name, cols);
+        if (filename != nullptr) {
+            *filename = name;
+        }
+        return ix_manager_->open_hash_index(name, cols);
+    }
+};
+
+static std::string make_key(ColType type, int v, int len) {
+    if (type == TYPE_INT) {
+        return std::string(reinterpret_cast<const char *>(&v), sizeof(int));
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key-%06d", v);
+    std::string key(buf);
+    key.resize(len, '\0');
+    return key;
+}
+
+/* 检查索引中每个key的rid与mock一致 */
+static void check_index(IxHashHandle *ih, ColType type, int len, const std::set<std::pair<int, Rid>> &mock,
+                        int max_key) {
+    std::vector<Rid> rids;
+    for (int v = 0; v <= max_key; ++v) {
+        std::vector<Rid> expected;
+        for (auto it = mock.lower_bound({v, Rid{-1, -1}}); it != mock.end() && it->first == v; ++it) {
+            expected.push_back(it->second);
+        }
+        rids.clear();
+        ASSERT_EQ(ih->get_value(make_key(type, v, len).data(), &rids, nullptr), !expected.empty());
+        std::sort(rids.begin(), rids.end());
+        ASSERT_EQ(rids, expected);
+    }
+}
+
+/**
+ * @brief 随机插入、删除(key, rid)，结果与std::set<pair<key, rid>>一致；
+ * 高基数时目录不断加倍，低基数时同一个key的项超过一个桶，需要溢出页
+ */
+TEST_F(IxHashTests, RandomOpsMatchMultiset) {
+    for (ColType type : {TYPE_INT, TYPE_STRING}) {
+        for (int cardinality : {20, 5000}) {
+            int len = type == TYPE_INT ? 4 : 16;
+            auto ih = create_and_open(make_cols(type, len));
+            std::set<std::pair<int, Rid>> mock;
+            std::vector<std::pair<int, Rid>> inserted;
+            std::mt19937 rng(cardinality * 7 + type);
+            for (int round = 0; round < 30000; ++round) {
+                if (!inserted.empty() && rng() % 3 == 0) {
+                    size_t pos = rng() % inserted.size();
+                    auto [v, rid] = inserted[pos];
+                    bool exist = mock.erase({v, rid}) > 0;
+                    ASSERT_EQ(ih->delete_entry(make_key(type, v, len).data(), rid, nullptr), exist);
+                    inserted[pos] = inserted.back();
+                    inserted.pop_back();
+                } else {
+                    int v = static_cast<int>(rng() % cardinality);
+                    Rid rid = {static_cast<int>(rng() % 1000), static_cast<int>(rng() % 50)};
+                    bool fresh = mock.insert({v, rid}).second;
+                    ASSERT_EQ(ih->insert_entry(make_key(type, v, len).data(), rid, nullptr) != -1, fresh);
+                    if (fresh) {
+                        inserted.push_back({v, rid});
+                    }
+                }
+            }
+            // 删除不存在的(key, rid)失败
+            ASSERT_FALSE(ih->delete_entry(make_key(type, cardinality, len).data(), Rid{0, 0}, nullptr));
+            check_index(ih.get(), type, len, mock, cardinality);
+            if (cardinality > 1000) {
+                ASSERT_GT(ih->file_hdr_.global_depth_, 0);
+            }
+            ix_manager_->close_hash_index(ih.get());
+        }
+    }
+}
+
+/**
+ * @brief 同一个key的记录填满多个页面时链接溢出页；全部删除之后溢出页回到空闲链表，再次插入时复用
+ */
+TEST_F(IxHashTests, DuplicateKeysUseOverflowPages) {
+    auto ih = create_and_open(make_cols(TYPE_INT, 4));
+    int capacity = ih->file_hdr_.bucket_capacity_;
+    int n = capacity * 5;
+    int key = 42;
+    for (int i = 0; i < n; ++i) {
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{i / 10, i % 10}, nullptr), -1);
+    }
+    std::vector<Rid> rids;
+    ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&key), &rids, nullptr));
+    ASSERT_EQ(static_cast<int>(rids.size()), n);
+    // 分裂不能把相同的key分开，目录不会无限加倍
+    ASSERT_LT(ih->file_hdr_.global_depth_, IX_HASH_MAX_GLOBAL_DEPTH);
+    int num_pages = ih->file_hdr_.num_pages_;
+
+    for (int i = 0; i < n; ++i) {
+        ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&key), Rid{i / 10, i % 10}, nullptr));
+    }
+    rids.clear();
+    ASSERT_FALSE(ih->get_value(reinterpret_cast<const char *>(&key), &rids, nullptr));
+    ASSERT_NE(ih->file_hdr_.first_free_page_, IX_NO_PAGE);
+
+    for (int i = 0; i < n; ++i) {
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{i / 10, i % 10}, nullptr), -1);
+    }
+    ASSERT_EQ(ih->file_hdr_.num_pages_, num_pages);
+    ix_manager_->close_hash_index(ih.get());
+}
+
+/**
+ * @brief 关闭之后重新打开，目录和文件头从磁盘恢复，之后继续插入不会覆盖已有页面
+ */
+TEST_F(IxHashTests, ReopenKeepsEntries) {
+    auto cols = make_cols(TYPE_INT, 4);
+    std::string filename;
+    auto ih = create_and_open(cols, &filename);
+    std::set<std::pair<int, Rid>> mock;
+    const int scale = 20000;
+    for (int i = 0; i < scale; ++i) {
+        int v = (i * 7919) % 4000;
+        Rid rid = {i / 50, i % 50};
+        mock.insert({v, rid});
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr), -1);
+    }
+    int global_depth = ih->file_hdr_.global_depth_;
+    ASSERT_GT(static_cast<int>(ih->file_hdr_.dir_pages_.size()), 0);
+    ix_manager_->close_hash_index(ih.get());
+
+    ih = ix_manager_->open_hash_index(filename, cols);
+    ASSERT_EQ(ih->file_hdr_.global_depth_, global_depth);
+    check_index(ih.get(), TYPE_INT, 4, mock, 4000);
+    for (int i = scale; i < scale * 2; ++i) {
+        int v = (i * 7919) % 4000;
+        Rid rid = {i / 50, i % 50};
+        mock.insert({v, rid});
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr), -1);
+    }
+    check_index(ih.get(), TYPE_INT, 4, mock, 4000);
+    ix_manager_->close_hash_index(ih.get());
+}
+
+/**
+ * @brief 浮点数的+0.0和-0.0相等，必须落在同一个桶中
+ */
+TEST_F(IxHashTests, FloatNegativeZero) {
+    auto ih = create_and_open(make_cols(TYPE_FLOAT, 4));
+    float pos_zero = 0.0f;
+    float neg_zero = -0.0f;
+    ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&neg_zero), Rid{1, 1}, nullptr), -1);
+    std::vector<Rid> rids;
+    ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&pos_zero), &rids, nullptr));
+    ASSERT_EQ(rids, std::vector<Rid>({Rid{1, 1}}));
+    ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&pos_zero), Rid{1, 1}, nullptr));
+    ix_manager_->close_hash_index(ih.get());
+}
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxInnerCacheTest_db";     // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";                // 测试文件名的前缀
+
+/**
+ * 测试B+树的内部结点缓存：快照覆盖叶子之上的所有层，经过快照下降直接到达目标叶子；
+ * 并发插入删除时快照过期、失效和重建，点查结果始终正确；预算限制缓存的层数
+ */
+class IxInnerCacheTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(8192, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    std::vector<ColMeta> make_cols() { return {{TEST_FILE_NAME, "col0", TYPE_INT, 4, 0, true}}; }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面；order为0时使用页面能容纳的阶数
+    std::unique_ptr<IxIndexHandle> create_and_open(int order) {
+        std::string name = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(name, make_cols());
+        auto ih = ix_manager_->open_index(name, make_cols());
+        if (order > 0) {
+            ih->file_hdr_->btree_order_ = order;
+        }
+        return ih;
+    }
+
+    /* 插入0..n-1打乱顺序之后的key，rid为{key, 0} */
+    void insert_keys(IxIndexHandle *ih, int n) {
+        std::vector<int> keys(n);
+        for (int i = 0; i < n; ++i) {
+            keys[i] = i;
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(n));
+        for (int key : keys) {
+            ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, nullptr);
+        }
+    }
+};
+
+/**
+ * @brief 快照的层数等于树高减一；刚建立的快照对每个key都直接给出包含它的叶子，不需要右移
+ */
+TEST_F(IxInnerCacheTests, SnapshotRoutesToLeaf) {
+    const int n = 20000;
+    auto ih = create_and_open(8);
+    insert_keys(ih.get(), n);
+    ih->set_inner_cache_budget(IX_INNER_CACHE_DEFAULT_BUDGET);  // 丢弃插入期间建立的快照，下次下降时重建
+    int probe = 0;
+    std::vector<Rid> rids;
+    ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&probe), &rids, nullptr));
+    auto cache = ih->get_inner_cache();
+    ASSERT_NE(cache, nullptr);
+    ASSERT_GE(ih->get_height(), 5);
+    ASSERT_EQ(cache->num_levels(), ih->get_height() - 1);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(cache->data_) % IX_INNER_CACHE_ALIGN, 0u);
+
+    char buf[IX_MAX_COL_LEN];
+    for (int v = -1; v <= n; ++v) {
+        const char *key = ih->to_index_key(reinterpret_cast<const char *>(&v), IX_MIN_RID, buf);
+        IxPath path;
+        IxNodeGuard leaf = ih->fetch_node(cache->route(key, false, &path));
+        ASSERT_TRUE(leaf->is_leaf_page());
+        ASSERT_FALSE(leaf->need_move_right(key));
+        rids.clear();
+        ASSERT_EQ(ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr), v >= 0 && v < n);
+        if (v >= 0 && v < n) {
+            ASSERT_EQ(rids, (std::vector<Rid>{Rid{v, 0}}));
+        }
+    }
+    ASSERT_EQ(ih->get_inner_cache(), cache);    // 没有修改时快照不会重建
+
+    // 之后的插入在右端分裂叶子，下降时发现需要右移之后重建快照
+    for (int v = n; v < n + 1000; ++v) {
+        ih->insert_entry(reinterpret_cast<const char *>(&v), Rid{v, 0}, nullptr);
+    }
+    ASSERT_NE(ih->get_inner_cache(), cache);
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 预算只够缓存上面几层时只缓存这几层，预算为0时不缓存，查找结果不变
+ */
+TEST_F(IxInnerCacheTests, BudgetLimitsLevels) {
+    const int n = 20000;
+    auto ih = create_and_open(8);
+    insert_keys(ih.get(), n);
+    int height = ih->get_height();
+    int full_levels = 0;
+    for (size_t budget : {IX_INNER_CACHE_DEFAULT_BUDGET, size_t(4096), size_t(0)}) {
+        ih->set_inner_cache_budget(budget);
+        std::vector<Rid> rids;
+        for (int v = 0; v < n; v += 7) {
+            rids.clear();
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr));
+            ASSERT_EQ(rids, (std::vector<Rid>{Rid{v, 0}}));
+        }
+        auto cache = ih->get_inner_cache();
+        if (budget == 0) {
+            ASSERT_EQ(cache, nullptr);
+            continue;
+        }
+        ASSERT_LE(cache->mem_used(), budget);
+        if (budget == IX_INNER_CACHE_DEFAULT_BUDGET) {
+            full_levels = cache->num_levels();
+            ASSERT_EQ(full_levels, height - 1);
+        } else {
+            ASSERT_GT(cache->num_levels(), 0);
+            ASSERT_LT(cache->num_levels(), full_levels);
+        }
+    }
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 多个线程并发插入和点查，同时删除一部分key引起合并(独占整棵树时丢弃快照)，
+ * 每个线程总能查到自己已经插入、没有删除的key，最后的内容与预期一致
+ */
+TEST_F(IxInnerCacheTests, ConcurrentSplitsAndMerges) {
+    const int num_threads = 4;
+    const int per_thread = 6000;
+    auto ih = create_and_open(16);
+    insert_keys(ih.get(), 2000);    // [0, 2000)预先插入，之后被删除
+
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            std::vector<Rid> rids;
+            for (int i = 0; i < per_thread; ++i) {
+                int key = 2000 + i * num_threads + t;
+                ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, nullptr);
+                int probe = 2000 + static_cast<int>(rng() % (i + 1)) * num_threads + t;
+                rids.clear();
+                if (!ih->get_value(reinterpret_cast<const char *>(&probe), &rids, nullptr) ||
+                    rids != std::vector<Rid>{Rid{probe, 0}}) {
+                    failed = true;
+                }
+            }
+        });
+    }
+    threads.emplace_back([&] {
+        for (int key = 0; key < 2000; ++key) {
+            if (!ih->delete_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, nullptr)) {
+                failed = true;
+            }
+        }
+    });
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_FALSE(failed);
+
+    int expected = 2000;
+    for (IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+         scan.next()) {
+        ASSERT_EQ(scan.rid(), (Rid{expected, 0}));
+        expected++;
+    }
+    ASSERT_EQ(expected, 2000 + num_threads * per_thread);
+    std::vector<Rid> rids;
+    for (int v = 0; v < expected; v += 3) {
+        rids.clear();
+        ASSERT_EQ(ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr), v >= 2000);
+    }
+    ix_manager_->close_index(ih.get());
+}
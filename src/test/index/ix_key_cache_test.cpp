@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxKeyCacheTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";           // 测试文件名的前缀
+
+/**
+ * 测试B+树前面的内存key缓存：FULL和LAZY两种模式下点查结果与B+树一致，
+ * 插入删除同步维护缓存，超过内存预算时FULL模式停用缓存、LAZY模式淘汰缓存项
+ */
+class IxKeyCacheTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    std::vector<ColMeta> make_cols() { return {{TEST_FILE_NAME, "col0", TYPE_INT, 4, 0, true}}; }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open(std::string *filename = nullptr) {
+        std::string name = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(name, make_cols(), IX_FORMAT_DUPLICATE_KEYS);
+        if (filename != nullptr) {
+            *filename = name;
+        }
+        return ix_manager_->open_index(name, make_cols());
+    }
+};
+
+/* 检查每个key的点查结果与mock一致 */
+static void check_index(IxIndexHandle *ih, const std::set<std::pair<int, Rid>> &mock, int max_key) {
+    std::vector<Rid> rids;
+    for (int v = 0; v <= max_key; ++v) {
+        std::vector<Rid> expected;
+        for (auto it = mock.lower_bound({v, IX_MIN_RID}); it != mock.end() && it->first == v; ++it) {
+            expected.push_back(it->second);
+        }
+        // 查两次，第二次LAZY模式也会命中缓存
+        for (int round = 0; round < 2; ++round) {
+            rids.clear();
+            ASSERT_EQ(ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr), !expected.empty());
+            ASSERT_EQ(rids, expected);
+        }
+    }
+}
+
+/**
+ * @brief 随机插入、删除(key, rid)并穿插点查，两种模式的结果都与std::set<pair<key, rid>>一致
+ */
+TEST_F(IxKeyCacheTests, RandomOpsMatchMultiset) {
+    for (IxKeyCacheMode mode : {IX_KEY_CACHE_FULL, IX_KEY_CACHE_LAZY}) {
+        ix_manager_->set_key_cache_options({mode, IX_KEY_CACHE_DEFAULT_BUDGET});
+        std::string filename;
+        auto ih = create_and_open(&filename);
+        ASSERT_TRUE(ih->has_key_cache());
+        const int cardinality = 500;
+        std::set<std::pair<int, Rid>> mock;
+        std::vector<std::pair<int, Rid>> inserted;
+        std::mt19937 rng(mode);
+        std::vector<Rid> rids;
+        for (int round = 0; round < 30000; ++round) {
+            int op = rng() % 4;
+            if (op == 0 && !inserted.empty()) {
+                size_t pos = rng() % inserted.size();
+                auto [v, rid] = inserted[pos];
+                mock.erase({v, rid});
+                ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&v), rid, nullptr));
+                inserted[pos] = inserted.back();
+                inserted.pop_back();
+            } else if (op == 1) {
+                int v = static_cast<int>(rng() % cardinality);
+                rids.clear();
+                bool found = ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr);
+                auto it = mock.lower_bound({v, IX_MIN_RID});
+                ASSERT_EQ(found, it != mock.end() && it->first == v);
+            } else {
+                int v = static_cast<int>(rng() % cardinality);
+                Rid rid = {static_cast<int>(rng() % 1000), static_cast<int>(rng() % 50)};
+                bool fresh = mock.insert({v, rid}).second;
+                ASSERT_EQ(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr) != -1, fresh);
+                if (fresh) {
+                    inserted.push_back({v, rid});
+                }
+            }
+        }
+        check_index(ih.get(), mock, cardinality);
+        ASSERT_GT(ih->get_key_cache()->hits(), 0u);
+
+        // 重新打开时FULL模式从叶子重建缓存，点查全部命中缓存
+        ix_manager_->close_index(ih.get());
+        ih = ix_manager_->open_index(filename, make_cols());
+        check_index(ih.get(), mock, cardinality);
+        if (mode == IX_KEY_CACHE_FULL) {
+            ASSERT_EQ(ih->get_key_cache()->misses(), 0u);
+        }
+        ix_manager_->close_index(ih.get());
+    }
+    ix_manager_->set_key_cache_options({});
+}
+
+/**
+ * @brief FULL模式超过内存预算时停用缓存，点查回到B+树；LAZY模式淘汰缓存项，占用的内存不超过预算
+ */
+TEST_F(IxKeyCacheTests, MemoryBudget) {
+    const int scale = 5000;
+    const size_t budget = 1000 * (4 + sizeof(Rid) + IX_KEY_CACHE_ENTRY_OVERHEAD);
+    for (IxKeyCacheMode mode : {IX_KEY_CACHE_FULL, IX_KEY_CACHE_LAZY}) {
+        auto ih = create_and_open();
+        ih->enable_key_cache({mode, budget});
+        std::set<std::pair<int, Rid>> mock;
+        for (int i = 0; i < scale; ++i) {
+            Rid rid = {i / 50, i % 50};
+            mock.insert({i, rid});
+            ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&i), rid, nullptr), -1);
+        }
+        check_index(ih.get(), mock, scale);
+        ASSERT_LE(ih->get_key_cache()->mem_used(), budget);
+        if (mode == IX_KEY_CACHE_FULL) {
+            ASSERT_FALSE(ih->has_key_cache());
+        } else {
+            ASSERT_TRUE(ih->has_key_cache());
+            ASSERT_GT(ih->get_key_cache()->size(), 0u);
+        }
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief LAZY模式下并发插入和点查：读者查找已经插入完成的key时一定能找到，不会读到过期的"不存在"
+ */
+TEST_F(IxKeyCacheTests, LazyConcurrentInsertAndLookup) {
+    auto ih = create_and_open();
+    ih->enable_key_cache({IX_KEY_CACHE_LAZY, IX_KEY_CACHE_DEFAULT_BUDGET});
+    const int scale = 20000;
+    std::atomic<int> published{0};  // [0, published)中的key已经插入完成
+    std::atomic<bool> failed{false};
+    std::thread writer([&] {
+        for (int i = 0; i < scale; ++i) {
+            if (ih->insert_entry(reinterpret_cast<const char *>(&i), Rid{i, 0}, nullptr) == -1) {
+                failed = true;
+            }
+            published.store(i + 1, std::memory_order_release);
+        }
+    });
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            std::vector<Rid> rids;
+            while (published.load(std::memory_order_acquire) < scale) {
+                int n = published.load(std::memory_order_acquire);
+                // 既查找已经插入的key，也查找即将插入的key，使缓存中出现"不存在"的项
+                int v = static_cast<int>(rng() % (n + 10));
+                rids.clear();
+                bool found = ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr);
+                if (v < n && (!found || rids != std::vector<Rid>{Rid{v, 0}})) {
+                    failed = true;
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    ASSERT_FALSE(failed);
+    std::vector<Rid> rids;
+    for (int i = 0; i < scale; ++i) {
+        rids.clear();
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&i), &rids, nullptr));
+    }
+    ix_manager_->close_index(ih.get());
+}
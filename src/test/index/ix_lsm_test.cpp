@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxLsmTest_db";   // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";       // 测试文件名的前缀
+
+using Entries = std::set<std::pair<int, Rid>>;
+
+/**
+ * 测试LSM索引：随机插入删除之后任意范围的扫描与std::set一致，后台线程写出和合并run，
+ * 关闭之后重新打开内容不变，并比较与B+树的插入吞吐量
+ */
+class IxLsmTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::vector<ColMeta> cols_ = {{TEST_FILE_NAME, "col0", TYPE_INT, 4, 0, true}};
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    /* [lo, hi]范围内的扫描结果与mock一致 */
+    void check_range(IxLsmHandle *ih, const Entries &mock, int lo, int hi) {
+        auto begin = mock.lower_bound({lo, IX_MIN_RID});
+        auto end = mock.upper_bound({hi, IX_MAX_RID});
+        IxLsmScan scan(ih, ih->lower_bound(reinterpret_cast<const char *>(&lo)),
+                       ih->upper_bound(reinterpret_cast<const char *>(&hi)));
+        for (auto it = begin; it != end; ++it) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(scan.rid(), it->second);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+    }
+
+    void check_all(IxLsmHandle *ih, const Entries &mock) {
+        IxLsmScan scan(ih, ih->leaf_begin(), ih->leaf_end());
+        for (auto &entry : mock) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(scan.rid(), entry.second);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+    }
+
+    /* 清单中的run从新到旧层号不减，合并之后的旧run文件已经删除 */
+    void check_runs(IxLsmHandle *ih) {
+        auto runs = ih->get_runs();
+        for (size_t i = 1; i < runs.size(); ++i) {
+            ASSERT_LE(runs[i - 1].level, runs[i].level);
+        }
+        std::string name = ix_manager_->get_lsm_index_name(TEST_FILE_NAME, cols_);
+        for (int id = 0; id < ih->next_run_id_; ++id) {
+            bool listed = std::any_of(runs.begin(), runs.end(), [&](const IxLsmRunMeta &run) { return run.id == id; });
+            ASSERT_EQ(disk_manager_->is_file(IxLsmHandle::run_file_name(name, id)), listed);
+        }
+    }
+};
+
+/**
+ * @brief memtable很小，随机插入删除期间不断写出run并合并；任意时刻的范围扫描、点查都与std::set一致
+ */
+TEST_F(IxLsmTests, RandomOpsMatchSet) {
+    ix_manager_->create_lsm_index(TEST_FILE_NAME, cols_);
+    auto ih = ix_manager_->open_lsm_index(TEST_FILE_NAME, cols_);
+    ih->set_memtable_entries(300);
+    const int cardinality = 2000;
+    Entries mock;
+    std::mt19937 rng(48);
+    for (int i = 0; i < 40000; ++i) {
+        int v = static_cast<int>(rng() % cardinality);
+        if (rng() % 3 == 0 && !mock.empty()) {
+            // 删除一个已有的项，偶尔删除不存在的项
+            auto it = mock.lower_bound({v, IX_MIN_RID});
+            if (it == mock.end() || rng() % 10 == 0) {
+                Rid rid = {static_cast<int>(rng() % 100000), 1};
+                ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&v), rid, nullptr));
+                mock.erase({v, rid});
+            } else {
+                ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&it->first), it->second, nullptr));
+                mock.erase(it);
+            }
+        } else {
+            Rid rid = {i, static_cast<int>(rng() % 4)};
+            ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr);
+            mock.insert({v, rid});
+        }
+        if (i % 1000 == 999) {
+            int lo = static_cast<int>(rng() % (cardinality + 10)) - 5;
+            check_range(ih.get(), mock, lo, lo + static_cast<int>(rng() % (i % 2000 == 999 ? 5 : cardinality)));
+            std::vector<Rid> rids;
+            bool found = ih->get_value(reinterpret_cast<const char *>(&lo), &rids, nullptr);
+            auto begin = mock.lower_bound({lo, IX_MIN_RID}), end = mock.upper_bound({lo, IX_MAX_RID});
+            ASSERT_EQ(found, begin != end);
+            ASSERT_EQ(rids.size(), static_cast<size_t>(std::distance(begin, end)));
+        }
+    }
+    check_all(ih.get(), mock);
+    ih->flush();
+    check_all(ih.get(), mock);
+    check_runs(ih.get());
+    auto runs = ih->get_runs();
+    ASSERT_TRUE(std::any_of(runs.begin(), runs.end(), [](const IxLsmRunMeta &run) { return run.level > 0; }));
+    // 删除所有项之后合并到最底层，删除标记被丢弃
+    for (auto &entry : mock) {
+        ih->delete_entry(reinterpret_cast<const char *>(&entry.first), entry.second, nullptr);
+    }
+    mock.clear();
+    check_all(ih.get(), mock);
+    ix_manager_->close_lsm_index(ih.get());
+}
+
+/**
+ * @brief 关闭时memtable写成run并写回清单，重新打开之后内容不变，并且可以继续写入；删除索引时删除所有文件
+ */
+TEST_F(IxLsmTests, ReopenKeepsEntries) {
+    ix_manager_->create_lsm_index(TEST_FILE_NAME, cols_);
+    Entries mock;
+    std::mt19937 rng(49);
+    for (int round = 0; round < 3; ++round) {
+        auto ih = ix_manager_->open_lsm_index(TEST_FILE_NAME, cols_);
+        check_all(ih.get(), mock);
+        ih->set_memtable_entries(1000);
+        for (int i = 0; i < 5000; ++i) {
+            int v = static_cast<int>(rng() % 500);
+            Rid rid = {round, i};
+            ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr);
+            mock.insert({v, rid});
+        }
+        for (auto it = mock.begin(); it != mock.end();) {
+            if (rng() % 4 == 0) {
+                ih->delete_entry(reinterpret_cast<const char *>(&it->first), it->second, nullptr);
+                it = mock.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        check_range(ih.get(), mock, 100, 200);
+        ix_manager_->close_lsm_index(ih.get());
+    }
+    auto ih = ix_manager_->open_lsm_index(TEST_FILE_NAME, cols_);
+    check_all(ih.get(), mock);
+    check_runs(ih.get());
+    auto runs = ih->get_runs();
+    ix_manager_->close_lsm_index(ih.get());
+    ih.reset();
+
+    std::string name = ix_manager_->get_lsm_index_name(TEST_FILE_NAME, cols_);
+    ASSERT_TRUE(ix_manager_->exists(TEST_FILE_NAME, cols_));
+    ix_manager_->destroy_lsm_index(TEST_FILE_NAME, cols_);
+    ASSERT_FALSE(ix_manager_->exists(TEST_FILE_NAME, cols_));
+    for (auto &run : runs) {
+        ASSERT_FALSE(disk_manager_->is_file(IxLsmHandle::run_file_name(name, run.id)));
+    }
+}
+
+/**
+ * @brief 随机分布的key分别逐条插入B+树与LSM索引，所有run写出和合并之后两个索引的内容相同
+ */
+TEST_F(IxLsmTests, MatchesBTreeAfterFlush) {
+    const int scale = 300000;
+    std::vector<int> keys(scale);
+    std::mt19937 rng(50);
+    for (auto &key : keys) {
+        key = static_cast<int>(rng() % (scale * 4));
+    }
+    ix_manager_->create_index(TEST_FILE_NAME, cols_, IX_FORMAT_DUPLICATE_KEYS);
+    auto btree = ix_manager_->open_index(TEST_FILE_NAME, cols_);
+    for (int i = 0; i < scale; ++i) {
+        btree->insert_entry(reinterpret_cast<const char *>(&keys[i]), Rid{i, 0}, nullptr);
+    }
+
+    ix_manager_->create_lsm_index(TEST_FILE_NAME, cols_);
+    auto lsm = ix_manager_->open_lsm_index(TEST_FILE_NAME, cols_);
+    for (int i = 0; i < scale; ++i) {
+        lsm->insert_entry(reinterpret_cast<const char *>(&keys[i]), Rid{i, 0}, nullptr);
+    }
+    lsm->flush();
+
+    // 两个索引的内容相同
+    long long count = 0;
+    IxScan btree_scan(btree.get(), btree->leaf_begin(), btree->leaf_end(), buffer_pool_manager_.get());
+    for (IxLsmScan scan(lsm.get(), lsm->leaf_begin(), lsm->leaf_end()); !scan.is_end(); scan.next()) {
+        ASSERT_FALSE(btree_scan.is_end());
+        ASSERT_EQ(scan.rid(), btree_scan.rid());
+        btree_scan.next();
+        count++;
+    }
+    ASSERT_TRUE(btree_scan.is_end());
+    ASSERT_EQ(count, scale);
+    ix_manager_->close_index(btree.get());
+    ix_manager_->close_lsm_index(lsm.get());
+}
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxRangeDeleteTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";              // 测试文件名的前缀
+
+using Entries = std::set<std::pair<int, Rid>>;
+
+/**
+ * 测试B+树的范围删除、批量删除和延迟合并：删除之后的内容与std::set一致，
+ * 整理之后树的结构仍然正确，欠满的叶子被合并
+ */
+class IxRangeDeleteTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open() {
+        std::vector<ColMeta> cols = {{TEST_FILE_NAME, "col0", TYPE_INT, 4, 0, true}};
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, IX_FORMAT_DUPLICATE_KEYS);
+        return ix_manager_->open_index(filename, cols);
+    }
+
+    /* 按key的顺序扫描整个索引，与mock比较 */
+    void check_entries(IxIndexHandle *ih, const Entries &mock) {
+        IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get(), true);
+        for (auto &[v, rid] : mock) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(*reinterpret_cast<const int *>(scan.key()), v);
+            ASSERT_EQ(scan.rid(), rid);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+    }
+
+    /**
+     * @brief 检查树的结构：父结点指针、父结点中的key不大于孩子的所有key、叶子链表的前后指针
+     * @return 欠满的非根叶子数量
+     */
+    int check_tree(IxIndexHandle *ih, page_id_t page_no, int *leaves) {
+        IxNodeGuard node = ih->fetch_node(page_no);
+        if (node->is_leaf_page()) {
+            (*leaves)++;
+            IxNodeGuard prev = ih->fetch_node(node->get_prev_leaf());
+            IxNodeGuard next = ih->fetch_node(node->get_next_leaf());
+            EXPECT_EQ(prev->get_next_leaf(), page_no);
+            EXPECT_EQ(next->get_prev_leaf(), page_no);
+            return !node->is_root_page() && node->get_size() < node->get_min_size();
+        }
+        int underfull = 0;
+        for (int i = 0; i < node->get_size(); i++) {
+            IxNodeGuard child = ih->fetch_node(node->value_at(i));
+            EXPECT_EQ(child->get_parent_page_no(), page_no);
+            // 只在叶子中删除之后，父结点中的key仍然是孩子范围的下界，但不一定等于孩子的第一个key
+            if (i != 0 && child->get_size() > 0) {
+                EXPECT_LE(node->key_at(i), child->key_at(0));
+            }
+            if (i + 1 < node->get_size() && child->get_size() > 0) {
+                EXPECT_LE(child->key_at(child->get_size() - 1), node->key_at(i + 1));
+            }
+            underfull += check_tree(ih, node->value_at(i), leaves);
+        }
+        return underfull;
+    }
+};
+
+/**
+ * @brief 随机穿插范围删除、批量删除、逐项删除和插入，急切合并和延迟合并两种模式的结果都与std::set一致；
+ * 整理之后树的结构正确，欠满的叶子基本都被合并
+ */
+TEST_F(IxRangeDeleteTests, DeletesMatchSet) {
+    for (bool lazy : {false, true}) {
+        auto ih = create_and_open();
+        ih->file_hdr_->btree_order_ = 16;   // 叶子较小，删除会产生很多欠满的叶子
+        ih->set_lazy_merge(lazy);
+        const int cardinality = 5000;
+        std::mt19937 rng(46 + lazy);
+        Entries mock;
+        int next_page = 0;
+        auto insert_some = [&](int n) {
+            for (int i = 0; i < n; ++i) {
+                int v = static_cast<int>(rng() % cardinality);
+                Rid rid = {next_page++, 0};
+                mock.insert({v, rid});
+                ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr), -1);
+            }
+        };
+        insert_some(30000);
+        for (int round = 0; round < 200; ++round) {
+            switch (round % 4) {
+                case 0: {
+                    int lo = static_cast<int>(rng() % cardinality);
+                    int hi = lo + static_cast<int>(rng() % 300);
+                    int expected = 0;
+                    for (auto it = mock.lower_bound({lo, IX_MIN_RID}); it != mock.end() && it->first < hi;) {
+                        it = mock.erase(it);
+                        expected++;
+                    }
+                    ASSERT_EQ(ih->delete_range(reinterpret_cast<const char *>(&lo),
+                                               reinterpret_cast<const char *>(&hi), nullptr),
+                              expected);
+                    break;
+                }
+                case 1: {
+                    // 随机选取一批项，其中一部分不在索引中
+                    std::vector<std::pair<int, Rid>> victims;
+                    for (auto &entry : mock) {
+                        if (rng() % 20 == 0) {
+                            victims.push_back(entry);
+                        }
+                    }
+                    for (int i = 0; i < 50; ++i) {
+                        victims.push_back({static_cast<int>(rng() % cardinality), Rid{-1, i}});
+                    }
+                    std::shuffle(victims.begin(), victims.end(), rng);
+                    std::vector<int> keys;
+                    std::vector<Rid> rids;
+                    int expected = 0;
+                    for (auto &[v, rid] : victims) {
+                        keys.push_back(v);
+                        rids.push_back(rid);
+                        expected += static_cast<int>(mock.erase({v, rid}));
+                    }
+                    ASSERT_EQ(ih->delete_entries(reinterpret_cast<const char *>(keys.data()), rids.data(),
+                                                 static_cast<int>(keys.size()), nullptr),
+                              expected);
+                    break;
+                }
+                case 2: {
+                    for (int i = 0; i < 50 && !mock.empty(); ++i) {
+                        auto it = mock.lower_bound({static_cast<int>(rng() % cardinality), IX_MIN_RID});
+                        if (it == mock.end()) {
+                            continue;
+                        }
+                        ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&it->first), it->second, nullptr));
+                        mock.erase(it);
+                    }
+                    break;
+                }
+                default:
+                    insert_some(300);
+            }
+            if (round % 20 == 19) {
+                check_entries(ih.get(), mock);
+            }
+        }
+        // 删除一段开头和结尾都不设界的范围
+        int mid = cardinality / 2;
+        ASSERT_EQ(ih->delete_range(nullptr, reinterpret_cast<const char *>(&mid), nullptr),
+                  std::distance(mock.begin(), mock.lower_bound({mid, IX_MIN_RID})));
+        mock.erase(mock.begin(), mock.lower_bound({mid, IX_MIN_RID}));
+        int tail = cardinality - 100;
+        ASSERT_EQ(ih->delete_range(reinterpret_cast<const char *>(&tail), nullptr, nullptr),
+                  std::distance(mock.lower_bound({tail, IX_MIN_RID}), mock.end()));
+        mock.erase(mock.lower_bound({tail, IX_MIN_RID}), mock.end());
+
+        ih->set_lazy_merge(false);  // 停止后台线程并整理剩下的叶子
+        check_entries(ih.get(), mock);
+        int leaves = 0;
+        int underfull = check_tree(ih.get(), ih->file_hdr_->root_page_, &leaves);
+        // 压缩结点只合并不重分配，只剩一个孩子的父结点下的叶子也无法合并，允许留下少量欠满的叶子
+        ASSERT_LE(underfull * 10, leaves);
+        // 整理之后仍然可以正常插入和删除
+        insert_some(2000);
+        check_entries(ih.get(), mock);
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief 延迟合并时后台线程整理叶子，同时读者点查始终不被删除的key，结果一定正确
+ */
+TEST_F(IxRangeDeleteTests, LazyMergeConcurrentLookups) {
+    auto ih = create_and_open();
+    ih->file_hdr_->btree_order_ = 16;
+    ih->set_lazy_merge(true);
+    const int scale = 30000;
+    for (int i = 0; i < scale; ++i) {
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&i), Rid{i, 0}, nullptr), -1);
+    }
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+    // 写者反复批量删除、重新插入不是3的倍数的key，3的倍数的key始终存在
+    std::thread writer([&] {
+        std::mt19937 rng(0);
+        for (int round = 0; round < 30; ++round) {
+            int lo = static_cast<int>(rng() % scale);
+            std::vector<int> keys;
+            std::vector<Rid> rids;
+            for (int k = lo; k < std::min(scale, lo + 3000); ++k) {
+                if (k % 3 != 0) {
+                    keys.push_back(k);
+                    rids.push_back(Rid{k, 0});
+                }
+            }
+            if (ih->delete_entries(reinterpret_cast<const char *>(keys.data()), rids.data(),
+                                   static_cast<int>(keys.size()), nullptr) != static_cast<int>(keys.size())) {
+                failed = true;
+            }
+            for (size_t j = 0; j < keys.size(); ++j) {
+                if (ih->insert_entry(reinterpret_cast<const char *>(&keys[j]), rids[j], nullptr) == -1) {
+                    failed = true;
+                }
+            }
+        }
+        done = true;
+    });
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&, t] {
+            std::mt19937 rng(t + 1);
+            std::vector<Rid> rids;
+            while (!done) {
+                int v = static_cast<int>(rng() % (scale / 3)) * 3;
+                rids.clear();
+                if (!ih->get_value(reinterpret_cast<const char *>(&v), &rids, nullptr) ||
+                    rids != std::vector<Rid>{Rid{v, 0}}) {
+                    failed = true;
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    ASSERT_FALSE(failed);
+    ih->set_lazy_merge(false);
+    Entries mock;
+    for (int i = 0; i < scale; ++i) {
+        mock.insert({i, Rid{i, 0}});
+    }
+    check_entries(ih.get(), mock);
+    int leaves = 0;
+    check_tree(ih.get(), ih->file_hdr_->root_page_, &leaves);
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 删除中间一半的项时，逐项删除、批量删除、范围删除以及延迟合并的范围删除留下相同的项和页面数
+ */
+TEST_F(IxRangeDeleteTests, DeleteMethodsAgree) {
+    const int scale = 200000;
+    const int lo = scale / 4;
+    const int hi = lo + scale / 2;
+    int pages[4];
+    for (int method = 0; method < 4; ++method) {
+        auto ih = create_and_open();
+        {
+            IxSorter sorter(ih->get_file_hdr(), "bench");
+            for (int i = 0; i < scale; ++i) {
+                sorter.add(reinterpret_cast<const char *>(&i), Rid{i, 0});
+            }
+            sorter.finish();
+            ih->bulk_load(&sorter, IX_BULK_FILL_FACTOR);
+        }
+        ih->set_lazy_merge(method == 3);
+        std::vector<int> keys;
+        std::vector<Rid> rids;
+        for (int i = lo; i < hi; ++i) {
+            keys.push_back(i);
+            rids.push_back(Rid{i, 0});
+        }
+        if (method == 0) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&keys[i]), rids[i], nullptr));
+            }
+        } else if (method == 1) {
+            ASSERT_EQ(ih->delete_entries(reinterpret_cast<const char *>(keys.data()), rids.data(),
+                                         static_cast<int>(keys.size()), nullptr),
+                      hi - lo);
+        } else {
+            ASSERT_EQ(ih->delete_range(reinterpret_cast<const char *>(&lo), reinterpret_cast<const char *>(&hi),
+                                       nullptr),
+                      hi - lo);
+        }
+        ih->set_lazy_merge(false);
+        pages[method] = ih->file_hdr_->num_pages_;
+        std::vector<Rid> left;
+        ih->get_rids(ih->leaf_begin(), ih->leaf_end(), &left, false);
+        ASSERT_EQ(static_cast<int>(left.size()), scale - (hi - lo));
+        ix_manager_->close_index(ih.get());
+    }
+    for (int method = 1; method < 4; ++method) {
+        EXPECT_EQ(pages[method], pages[0]);
+    }
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "IxScanTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";       // 测试文件名的前缀
+
+/**
+ * 测试按叶子批量读取的IxScan：任意[lower, upper)范围内的项与std::multimap一致，
+ * 批缓冲中的key与get_entry读出的相同
+ */
+class IxScanTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    int num_files_ = 0;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    // 每次使用新的文件名，避免缓冲池中残留已关闭文件的页面
+    std::unique_ptr<IxIndexHandle> create_and_open() {
+        std::vector<ColMeta> cols = {{TEST_FILE_NAME, "col0", TYPE_INT, 4, 0, true}};
+        std::string filename = TEST_FILE_NAME + "_" + std::to_string(num_files_++);
+        ix_manager_->create_index(filename, cols, IX_FORMAT_DUPLICATE_KEYS);
+        return ix_manager_->open_index(filename, cols);
+    }
+};
+
+/**
+ * @brief 随机插入删除之后，随机范围的扫描结果与std::multimap一致，包括空范围和跨越很多叶子的范围
+ */
+TEST_F(IxScanTests, RangesMatchMultimap) {
+    auto ih = create_and_open();
+    ih->file_hdr_->btree_order_ = 8;    // 叶子较小，范围跨越很多叶子，删除之后会出现合并
+    const int cardinality = 3000;
+    std::multimap<int, Rid> mock;
+    std::mt19937 rng(45);
+    for (int i = 0; i < 20000; ++i) {
+        int v = static_cast<int>(rng() % cardinality);
+        Rid rid = {i, 0};
+        mock.insert({v, rid});
+        ASSERT_NE(ih->insert_entry(reinterpret_cast<const char *>(&v), rid, nullptr), -1);
+    }
+    for (auto it = mock.begin(); it != mock.end();) {
+        if (it->first % 3 == 0) {
+            ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&it->first), it->second, nullptr));
+            it = mock.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int round = 0; round < 300; ++round) {
+        int lo = static_cast<int>(rng() % (cardinality + 10)) - 5;
+        int hi = lo + static_cast<int>(rng() % (round % 2 == 0 ? 20 : cardinality));
+        std::vector<std::pair<int, Rid>> expected(mock.lower_bound(lo), mock.upper_bound(hi));
+        bool with_keys = round % 3 == 0;
+        IxScan scan(ih.get(), ih->lower_bound(reinterpret_cast<const char *>(&lo)),
+                    ih->upper_bound(reinterpret_cast<const char *>(&hi)), buffer_pool_manager_.get(), with_keys);
+        for (auto &[v, rid] : expected) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(scan.rid(), rid);
+            if (with_keys) {
+                ASSERT_EQ(*reinterpret_cast<const int *>(scan.key()), v);
+                char key[IX_MAX_COL_LEN];
+                ASSERT_EQ(ih->get_entry(scan.iid(), key), rid);     // iid()仍然指向当前项
+                ASSERT_EQ(memcmp(key, scan.key(), ih->file_hdr_->col_tot_len_), 0);
+            }
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+    }
+    // 整个索引
+    IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+    for (auto &[v, rid] : mock) {
+        ASSERT_FALSE(scan.is_end());
+        ASSERT_EQ(scan.rid(), rid);
+        scan.next();
+    }
+    ASSERT_TRUE(scan.is_end());
+    ix_manager_->close_index(ih.get());
+}
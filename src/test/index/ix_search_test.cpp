@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "index/ix_index_handle.h"
+#include "index/ix_key.h"
+#include "index/ix_search.h"
+
+/**
+ * @brief 构造只用于结点内查找的文件头
+ */
+static IxFileHdr make_hdr(const std::vector<ColType> &types, const std::vector<int> &lens) {
+    IxFileHdr hdr;
+    hdr.col_num_ = static_cast<int>(types.size());
+    hdr.col_types_ = types;
+    hdr.col_lens_ = lens;
+    hdr.col_tot_len_ = 0;
+    for (int len : lens) {
+        hdr.col_tot_len_ += len;
+    }
+    return hdr;
+}
+
+/**
+ * @brief 按hdr描述的布局生成一个随机key
+ */
+static void random_key(const IxFileHdr &hdr, std::mt19937 &rng, char *dest) {
+    int offset = 0;
+    for (int i = 0; i < hdr.col_num_; ++i) {
+        switch (hdr.col_types_[i]) {
+            case TYPE_INT: {
+                int v = static_cast<int>(rng() % 2000) - 1000;    // 范围较小，保证有重复的列值
+                memcpy(dest + offset, &v, sizeof(int));
+                break;
+            }
+            case TYPE_FLOAT: {
+                float v = static_cast<float>(static_cast<int>(rng() % 2000) - 1000) / 4;
+                if (rng() % 50 == 0) {
+                    v = -0.0f;
+                }
+                memcpy(dest + offset, &v, sizeof(float));
+                break;
+            }
+            default:
+                for (int j = 0; j < hdr.col_lens_[i]; ++j) {
+                    dest[offset + j] = static_cast<char>('a' + rng() % 4);
+                }
+        }
+        offset += hdr.col_lens_[i];
+    }
+}
+
+/**
+ * @brief 生成num个互不相同且有序的key，连续存放在keys中
+ */
+static std::vector<char> sorted_keys(const IxFileHdr &hdr, std::mt19937 &rng, int num) {
+    int len = hdr.col_tot_len_;
+    std::vector<std::vector<char>> rows;
+    std::vector<char> buf(len);
+    while (static_cast<int>(rows.size()) < num) {
+        random_key(hdr, rng, buf.data());
+        rows.push_back(buf);
+    }
+    auto less = [&](const std::vector<char> &a, const std::vector<char> &b) {
+        return ix_compare(a.data(), b.data(), hdr.col_types_, hdr.col_lens_) < 0;
+    };
+    auto equal = [&](const std::vector<char> &a, const std::vector<char> &b) {
+        return ix_compare(a.data(), b.data(), hdr.col_types_, hdr.col_lens_) == 0;
+    };
+    std::sort(rows.begin(), rows.end(), less);
+    rows.erase(std::unique(rows.begin(), rows.end(), equal), rows.end());
+    std::vector<char> keys;
+    for (auto &row : rows) {
+        keys.insert(keys.end(), row.begin(), row.end());
+    }
+    return keys;
+}
+
+/**
+ * @brief 各个查找内核与逐个调用ix_compare的顺序查找结果一致
+ */
+TEST(IxSearchTest, KernelsMatchLinearScan) {
+    std::mt19937 rng(2024);
+    std::vector<IxFileHdr> hdrs = {
+        make_hdr({TYPE_INT}, {4}),
+        make_hdr({TYPE_FLOAT}, {4}),
+        make_hdr({TYPE_STRING}, {6}),
+        make_hdr({TYPE_INT, TYPE_STRING}, {4, 3}),
+    };
+    std::vector<IxKeyLayout> expected = {IxKeyLayout::INT, IxKeyLayout::FLOAT, IxKeyLayout::CHAR,
+                                         IxKeyLayout::GENERIC};
+    for (size_t h = 0; h < hdrs.size(); ++h) {
+        IxFileHdr &hdr = hdrs[h];
+        ASSERT_EQ(ix_key_layout(&hdr), expected[h]);
+        ix_init_search_kernels(&hdr);
+        for (int num : {0, 1, 2, 7, 8, 9, 31, 64, 65, 200}) {
+            std::vector<char> keys = sorted_keys(hdr, rng, num);
+            int n = static_cast<int>(keys.size()) / hdr.col_tot_len_;
+            std::vector<char> target(hdr.col_tot_len_);
+            for (int round = 0; round < 200; ++round) {
+                // 一半的target取自已有的key
+                if (n > 0 && round % 2 == 0) {
+                    memcpy(target.data(), keys.data() + (rng() % n) * hdr.col_tot_len_, hdr.col_tot_len_);
+                } else {
+                    random_key(hdr, rng, target.data());
+                }
+                int lower = 0, upper = 0;
+                for (int i = 0; i < n; ++i) {
+                    int res = ix_compare(keys.data() + i * hdr.col_tot_len_, target.data(), hdr.col_types_,
+                                         hdr.col_lens_);
+                    lower += res < 0;
+                    upper += res <= 0;
+                }
+                ASSERT_EQ(hdr.lower_bound_fn_(&hdr, keys.data(), n, target.data()), lower);
+                ASSERT_EQ(hdr.upper_bound_fn_(&hdr, keys.data(), n, target.data()), upper);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 将按原始格式连续存放的key逐个规范化
+ */
+static std::vector<char> normalize_all(const IxFileHdr &hdr, const std::vector<char> &raw) {
+    std::vector<char> norm(raw.size());
+    for (size_t off = 0; off < raw.size(); off += hdr.col_tot_len_) {
+        ix_normalize_key(&hdr, raw.data() + off, norm.data() + off);
+    }
+    return norm;
+}
+
+/**
+ * @brief 规范化key的memcmp顺序与原始key的ix_compare顺序一致，并且可以还原
+ */
+TEST(IxSearchTest, NormalizedKeyOrder) {
+    std::mt19937 rng(11);
+    std::vector<IxFileHdr> hdrs = {
+        make_hdr({TYPE_INT}, {4}),
+        make_hdr({TYPE_FLOAT}, {4}),
+        make_hdr({TYPE_STRING}, {5}),
+        make_hdr({TYPE_INT, TYPE_FLOAT, TYPE_STRING}, {4, 4, 3}),
+    };
+    for (auto &hdr : hdrs) {
+        int len = hdr.col_tot_len_;
+        std::vector<char> a(len), b(len), na(len), nb(len), back(len);
+        for (int round = 0; round < 20000; ++round) {
+            random_key(hdr, rng, a.data());
+            random_key(hdr, rng, b.data());
+            if (round % 4 == 0) {
+                b = a;
+            }
+            ix_normalize_key(&hdr, a.data(), na.data());
+            ix_normalize_key(&hdr, b.data(), nb.data());
+            int expected = ix_compare(a.data(), b.data(), hdr.col_types_, hdr.col_lens_);
+            int res = memcmp(na.data(), nb.data(), len);
+            ASSERT_EQ((res > 0) - (res < 0), (expected > 0) - (expected < 0));
+            ix_denormalize_key(&hdr, na.data(), back.data());
+            ASSERT_EQ(ix_compare(back.data(), a.data(), hdr.col_types_, hdr.col_lens_), 0);
+        }
+    }
+}
+
+/**
+ * @brief 规范化格式的索引使用的查找内核与原始key的顺序查找结果一致
+ */
+TEST(IxSearchTest, NormalizedKernelsMatchLinearScan) {
+    std::mt19937 rng(99);
+    std::vector<IxFileHdr> hdrs = {
+        make_hdr({TYPE_INT, TYPE_INT}, {4, 4}),
+        make_hdr({TYPE_FLOAT, TYPE_INT}, {4, 4}),
+        make_hdr({TYPE_INT, TYPE_STRING}, {4, 9}),
+        make_hdr({TYPE_STRING, TYPE_FLOAT}, {2, 4}),
+    };
+    for (auto &hdr : hdrs) {
+        hdr.format_version_ = IX_FORMAT_NORMALIZED_KEYS;
+        ASSERT_EQ(ix_key_layout(&hdr), IxKeyLayout::NORMALIZED);
+        ix_init_search_kernels(&hdr);
+        int len = hdr.col_tot_len_;
+        for (int num : {0, 1, 7, 8, 33, 64, 65, 300}) {
+            std::vector<char> raw = sorted_keys(hdr, rng, num);
+            std::vector<char> norm = normalize_all(hdr, raw);
+            int n = static_cast<int>(raw.size()) / len;
+            std::vector<char> target(len), norm_target(len);
+            for (int round = 0; round < 200; ++round) {
+                if (n > 0 && round % 2 == 0) {
+                    memcpy(target.data(), raw.data() + (rng() % n) * len, len);
+                } else {
+                    random_key(hdr, rng, target.data());
+                }
+                ix_normalize_key(&hdr, target.data(), norm_target.data());
+                int lower = 0, upper = 0;
+                for (int i = 0; i < n; ++i) {
+                    int res = ix_compare(raw.data() + i * len, target.data(), hdr.col_types_, hdr.col_lens_);
+                    lower += res < 0;
+                    upper += res <= 0;
+                }
+                ASSERT_EQ(hdr.lower_bound_fn_(&hdr, norm.data(), n, norm_target.data()), lower);
+                ASSERT_EQ(hdr.upper_bound_fn_(&hdr, norm.data(), n, norm_target.data()), upper);
+            }
+        }
+    }
+}
@@ -0,0 +1,149 @@
+#undef NDEBUG
+
+#define private public
+#include "column/cs.h"
+#undef private
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 测试各编码方式的压缩和解码：整段解码和按行解码都与原始数据一致，并且选择了预期的编码方式
+ */
+TEST(ColumnStoreTest, CodecTest) {
+    const int num_values = CS_SEGMENT_ROWS;
+    auto check = [&](ColType type, int len, const std::vector<char> &values, int expected_encoding) {
+        std::vector<char> data;
+        int encoding = CsCodec::encode(type, len, values.data(), num_values, data);
+        assert(encoding == expected_encoding);
+        std::vector<char> decoded((size_t)num_values * len);
+        CsCodec::decode(encoding, len, data.data(), num_values, decoded.data());
+        assert(decoded == values);
+        std::vector<char> value(len);
+        for (int row = 0; row < num_values; row += 97) {
+            CsCodec::decode_value(encoding, len, data.data(), row, value.data());
+            assert(memcmp(value.data(), values.data() + (size_t)row * len, len) == 0);
+        }
+    };
+
+    // 重复较多的INT：RLE
+    std::vector<char> ints(num_values * sizeof(int));
+    for (int i = 0; i < num_values; ++i) {
+        int v = i / 512;
+        memcpy(ints.data() + i * sizeof(int), &v, sizeof(int));
+    }
+    check(TYPE_INT, sizeof(int), ints, CS_ENC_RLE);
+
+    // 取值范围较小的INT：参考系编码
+    for (int i = 0; i < num_values; ++i) {
+        int v = -1000000 + rand() % 1000;
+        memcpy(ints.data() + i * sizeof(int), &v, sizeof(int));
+    }
+    check(TYPE_INT, sizeof(int), ints, CS_ENC_FOR);
+
+    // 取值随机的INT：不压缩
+    for (int i = 0; i < num_values; ++i) {
+        int v = rand() * (rand() % 2 ? 1 : -1);
+        memcpy(ints.data() + i * sizeof(int), &v, sizeof(int));
+    }
+    check(TYPE_INT, sizeof(int), ints, CS_ENC_PLAIN);
+
+    // 取值较少的CHAR：字典编码
+    const int len = 16;
+    std::vector<char> strs((size_t)num_values * len, 0);
+    for (int i = 0; i < num_values; ++i) {
+        std::string s = "city_" + std::to_string(rand() % 37);
+        memcpy(strs.data() + (size_t)i * len, s.c_str(), s.size());
+    }
+    check(TYPE_STRING, len, strs, CS_ENC_DICT);
+}
+
+/**
+ * @brief 测试列存表：追加的行跨越多个段，删除和撤销删除，关闭后重新打开数据保持不变
+ */
+TEST(ColumnStoreTest, TableTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto cs_manager = std::make_unique<CsManager>(disk_manager.get());
+
+    std::string tab_name = "columnar_table";
+    // (INT, CHAR(8), FLOAT)
+    std::vector<ColMeta> cols = {{.tab_name = tab_name, .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+                                 {.tab_name = tab_name, .name = "b", .type = TYPE_STRING, .len = 8, .offset = 4},
+                                 {.tab_name = tab_name, .name = "c", .type = TYPE_FLOAT, .len = 4, .offset = 12}};
+    const int record_size = 16;
+    if (disk_manager->is_file(tab_name)) {
+        cs_manager->destroy_file(tab_name, cols.size());
+    }
+    cs_manager->create_file(tab_name, cols);
+    auto table = cs_manager->open_file(tab_name, cols.size());
+
+    const int num_rows = CS_SEGMENT_ROWS * 2 + 100;
+    std::vector<std::string> mock;
+    std::vector<Rid> rids;
+    char buf[record_size];
+    for (int i = 0; i < num_rows; ++i) {
+        memset(buf, 0, record_size);
+        int a = i % 1000;
+        float c = i * 0.5f;
+        std::string b = "k" + std::to_string(i % 13);
+        memcpy(buf, &a, sizeof(int));
+        memcpy(buf + 4, b.c_str(), b.size());
+        memcpy(buf + 12, &c, sizeof(float));
+        rids.push_back(table->insert_record(buf));
+        mock.emplace_back(buf, record_size);
+    }
+    assert(table->segments_.size() == 2);
+    assert(table->num_segments() == 3);
+    assert(rids[CS_SEGMENT_ROWS].page_no == 1 && rids[CS_SEGMENT_ROWS].slot_no == 0);
+
+    // 删除每第7行，再撤销其中一行的删除
+    std::vector<bool> deleted(num_rows, false);
+    for (int i = 0; i < num_rows; i += 7) {
+        table->delete_record(rids[i]);
+        deleted[i] = true;
+    }
+    table->insert_record(rids[7], mock[7].c_str());
+    deleted[7] = false;
+
+    auto check = [&](CsTableHandle *handle) {
+        int row = 0;
+        std::vector<uint8_t> sel;
+        std::vector<char> values;
+        for (int seg_no = 0; seg_no < handle->num_segments(); ++seg_no) {
+            int seg_rows = handle->read_visibility(seg_no, sel);
+            for (int col_idx = 0; col_idx < (int)cols.size(); ++col_idx) {
+                auto &col = cols[col_idx];
+                handle->read_column(seg_no, col_idx, seg_rows, values);
+                for (int i = 0; i < seg_rows; ++i) {
+                    assert(memcmp(values.data() + (size_t)i * col.len, mock[row + i].data() + col.offset, col.len) == 0);
+                }
+            }
+            for (int i = 0; i < seg_rows; ++i) {
+                assert(sel[i] == !deleted[row + i]);
+                assert(handle->is_record(rids[row + i]) == !deleted[row + i]);
+            }
+            row += seg_rows;
+        }
+        assert(row == num_rows);
+        for (int i = 1; i < num_rows; i += 331) {
+            if (!deleted[i]) {
+                auto rec = handle->get_record(rids[i]);
+                assert(memcmp(rec->data, mock[i].data(), record_size) == 0);
+            }
+        }
+    };
+    check(table.get());
+
+    // 关闭时开放段写入列文件，重新打开后记录号和删除标记保持不变
+    cs_manager->close_file(table.get());
+    table = cs_manager->open_file(tab_name, cols.size());
+    assert(table->segments_.size() == 3);
+    check(table.get());
+
+    cs_manager->close_file(table.get());
+    cs_manager->destroy_file(tab_name, cols.size());
+}
@@ -8,6 +8,8 @@
 #include <cstring>
 #include <ctime>
 #include <iostream>
+#include <map>
+#include <thread>
 #include <unordered_map>
 
 #include "gtest/gtest.h"
@@ -223,4 +225,399 @@ TEST(RecordManagerTest, MultipleFilesTest) {
         std::string filename = filenames[i];
         rm_manager->destroy_file(filename);
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 测试包含VARCHAR字段的表使用的slotted page格式
+ */
+TEST(RecordManagerTest, SlottedPageTest) {
+    srand((unsigned)time(nullptr));
+
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+
+    std::string filename = "slotted.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    // (INT, VARCHAR(200), INT, VARCHAR(100))
+    std::vector<ColMeta> cols = {{.tab_name = filename, .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+                                 {.tab_name = filename, .name = "b", .type = TYPE_VARCHAR, .len = 200, .offset = 4},
+                                 {.tab_name = filename, .name = "c", .type = TYPE_INT, .len = 4, .offset = 204},
+                                 {.tab_name = filename, .name = "d", .type = TYPE_VARCHAR, .len = 100, .offset = 208}};
+    int record_size = 308;
+    rm_manager->create_file(filename, record_size, cols);
+    auto file_handle = rm_manager->open_file(filename);
+    assert(file_handle->file_hdr_.page_format == RM_PAGE_SLOTTED);
+    assert(file_handle->file_hdr_.num_var_cols == 2);
+
+    // 变长字段随机取一个长度，长度之后补0
+    auto rand_record = [&](char *buf) {
+        rand_buf(record_size, buf);
+        for (auto &col : cols) {
+            if (col.type == TYPE_VARCHAR) {
+                int len = rand() % (col.len + 1);
+                memset(buf + col.offset + len, 0, col.len - len);
+            }
+        }
+    };
+
+    char write_buf[PAGE_SIZE];
+    for (int round = 0; round < 2000; round++) {
+        double insert_prob = 1. - mock.size() / 500.;
+        double dice = rand() * 1. / RAND_MAX;
+        if (mock.empty() || dice < insert_prob) {
+            rand_record(write_buf);
+            Rid rid = file_handle->insert_record(write_buf, context);
+            mock[rid] = std::string(write_buf, record_size);
+        } else {
+            auto it = mock.begin();
+            std::advance(it, rand() % mock.size());
+            Rid rid = it->first;
+            int op = rand() % 3;
+            if (op == 0) {
+                // 更新可能使元组变长，需要迁移到其他页面，rid保持不变
+                rand_record(write_buf);
+                file_handle->update_record(rid, write_buf, context);
+                mock[rid] = std::string(write_buf, record_size);
+            } else if (op == 1) {
+                file_handle->delete_record(rid, context);
+                mock.erase(rid);
+            } else {
+                // 模拟事务回滚：删除后在原位置重新插入
+                std::string old = it->second;
+                file_handle->delete_record(rid, context);
+                file_handle->insert_record(rid, (char *)old.c_str());
+            }
+        }
+        if (round % 100 == 0) {
+            rm_manager->close_file(file_handle.get());
+            file_handle = rm_manager->open_file(filename);
+        }
+        check_equal(file_handle.get(), mock);
+    }
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试空闲空间映射：跨越多个FSM页面，删除后的空闲空间能被后续插入重新利用
+ */
+TEST(RecordManagerTest, FreeSpaceMapTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "fsm.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = RM_MAX_RECORD_SIZE;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    int records_per_page = file_handle->file_hdr_.num_records_per_page;
+
+    // 写满第一个FSM页面管理的所有数据页面，再多写一个页面
+    char write_buf[PAGE_SIZE];
+    std::vector<Rid> rids;
+    int num_records = (RM_FSM_ENTRIES_PER_PAGE + 1) * records_per_page;
+    for (int i = 0; i < num_records; i++) {
+        *(int *)write_buf = i;
+        rids.push_back(file_handle->insert_record(write_buf, context));
+        assert(!RmFileHandle::is_fsm_page(rids.back().page_no));
+    }
+    int second_fsm_page = RM_FIRST_RECORD_PAGE + RM_FSM_ENTRIES_PER_PAGE + 1;
+    assert(RmFileHandle::is_fsm_page(second_fsm_page));
+    assert(file_handle->file_hdr_.num_pages == second_fsm_page + 2);
+    assert(rids.back().page_no == second_fsm_page + 1);
+
+    // 删除前部页面中的一条记录，下一条记录应插入到该位置
+    Rid hole = rids[records_per_page * 10 + 3];
+    file_handle->delete_record(hole, context);
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    *(int *)write_buf = -1;
+    Rid rid = file_handle->insert_record(write_buf, context);
+    assert(rid == hole);
+    // 所有页面再次写满，新记录写入新分配的页面
+    rid = file_handle->insert_record(write_buf, context);
+    assert(rid.page_no == second_fsm_page + 2);
+
+    size_t cnt = 0;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        cnt++;
+    }
+    assert(cnt == rids.size() + 1);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 最初格式的数据文件头中没有format_version(读出为0)，页面编号与当前格式不同，打开时拒绝而不是错误地读取
+ */
+TEST(RecordManagerTest, RejectOldFormatTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "old_format.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 8);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_EQ(file_handle->file_hdr_.format_version, RM_FORMAT_VERSION);
+    rm_manager->close_file(file_handle.get());
+
+    // 最初的文件头只有5个int：record_size, num_pages, num_records_per_page, first_free_page_no, bitmap_size
+    int fd = disk_manager->open_file(filename);
+    char page[PAGE_SIZE] = {};
+    int old_hdr[5] = {8, 1, 400, RM_NO_PAGE, 50};
+    memcpy(page, old_hdr, sizeof(old_hdr));
+    disk_manager->write_page(fd, RM_FILE_HDR_PAGE, page, PAGE_SIZE);
+    disk_manager->close_file(fd);
+    ASSERT_THROW(rm_manager->open_file(filename), RecordFormatVersionError);
+    ASSERT_NO_THROW(rm_manager->destroy_file(filename));     // 拒绝时已经关闭了文件
+}
+
+/**
+ * @brief 测试PAX页面：记录按字段拆分到minipage后仍能正确读写，按列过滤的结果与逐条比较一致
+ */
+TEST(RecordManagerTest, PaxPageTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+
+    std::string filename = "pax.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    // (INT, CHAR(16), INT)
+    std::vector<ColMeta> cols = {{.tab_name = filename, .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+                                 {.tab_name = filename, .name = "b", .type = TYPE_STRING, .len = 16, .offset = 4},
+                                 {.tab_name = filename, .name = "c", .type = TYPE_INT, .len = 4, .offset = 20}};
+    int record_size = 24;
+    rm_manager->create_file(filename, record_size, cols, true);
+    auto file_handle = rm_manager->open_file(filename);
+    assert(file_handle->file_hdr_.page_format == RM_PAGE_PAX);
+    assert(file_handle->file_hdr_.num_pax_cols == 3);
+    assert(file_handle->is_pax_column(4, 16));
+    assert(!file_handle->is_pax_column(0, 8));
+
+    char write_buf[PAGE_SIZE];
+    for (int round = 0; round < 5000; round++) {
+        double insert_prob = 1. - mock.size() / 2000.;
+        double dice = rand() * 1. / RAND_MAX;
+        rand_buf(record_size, write_buf);
+        if (mock.empty() || dice < insert_prob) {
+            Rid rid = file_handle->insert_record(write_buf, context);
+            mock[rid] = std::string(write_buf, record_size);
+        } else {
+            auto it = mock.begin();
+            std::advance(it, rand() % mock.size());
+            Rid rid = it->first;
+            if (rand() % 2 == 0) {
+                file_handle->update_record(rid, write_buf, context);
+                mock[rid] = std::string(write_buf, record_size);
+            } else {
+                file_handle->delete_record(rid, context);
+                mock.erase(rid);
+            }
+        }
+    }
+    check_equal(file_handle.get(), mock);
+
+    // a < threshold，只在a所在的minipage上计算
+    int threshold = 0;
+    memcpy(&threshold, mock.begin()->second.data(), sizeof(int));
+    RmColumnFilter filter{0, [threshold](const char *values, int num_values, uint8_t *sel) {
+                              for (int i = 0; i < num_values; ++i) {
+                                  int value;
+                                  memcpy(&value, values + i * sizeof(int), sizeof(int));
+                                  sel[i] &= static_cast<uint8_t>(value < threshold);
+                              }
+                          }};
+    size_t num_matched = 0;
+    std::vector<int> slot_nos;
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+        file_handle->filter_page(page_no, {filter}, slot_nos);
+        for (int slot_no : slot_nos) {
+            auto it = mock.find(Rid{page_no, slot_no});
+            assert(it != mock.end());
+            int value;
+            memcpy(&value, it->second.data(), sizeof(int));
+            assert(value < threshold);
+        }
+        num_matched += slot_nos.size();
+    }
+    size_t expected = 0;
+    for (auto &entry : mock) {
+        int value;
+        memcpy(&value, entry.second.data(), sizeof(int));
+        expected += value < threshold;
+    }
+    assert(num_matched == expected);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 1~32个线程并发插入同一个表，检查记录不丢失、不覆盖
+ */
+TEST(RecordManagerTest, ConcurrentInsertTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    const int num_records = 64000;
+    const int record_size = 64;
+    std::string filename = "concurrent_insert.txt";
+    // (INT, INT, VARCHAR(56))，分别测试定长格式和slotted page格式
+    std::vector<ColMeta> var_cols = {
+        {.tab_name = filename, .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+        {.tab_name = filename, .name = "b", .type = TYPE_INT, .len = 4, .offset = 4},
+        {.tab_name = filename, .name = "c", .type = TYPE_VARCHAR, .len = 56, .offset = 8}};
+    for (bool slotted : {false, true}) {
+        for (int num_threads = 1; num_threads <= 32; num_threads *= 2) {
+            if (disk_manager->is_file(filename)) {
+                disk_manager->destroy_file(filename);
+            }
+            rm_manager->create_file(filename, record_size, slotted ? var_cols : std::vector<ColMeta>{});
+            auto file_handle = rm_manager->open_file(filename);
+
+            std::vector<std::vector<Rid>> rids(num_threads);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < num_threads; t++) {
+                threads.emplace_back([&, t]() {
+                    char buf[record_size] = {};
+                    for (int i = t; i < num_records; i += num_threads) {
+                        *(int *)buf = t;
+                        *(int *)(buf + 4) = i;
+                        snprintf(buf + 8, record_size - 8, "%d", i);
+                        rids[t].push_back(file_handle->insert_record(buf, nullptr));
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            // 每条记录都能按rid读出，且rid互不相同
+            std::unordered_map<Rid, int, rid_hash_t, rid_equal_t> seen;
+            for (int t = 0; t < num_threads; t++) {
+                for (auto &rid : rids[t]) {
+                    auto rec = file_handle->get_record(rid, nullptr);
+                    ASSERT_EQ(*(int *)rec->data, t);
+                    bool inserted = seen.emplace(rid, *(int *)(rec->data + 4)).second;
+                    ASSERT_TRUE(inserted);
+                }
+            }
+            size_t cnt = 0;
+            for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+                cnt++;
+            }
+            ASSERT_EQ(cnt, (size_t)num_records);
+            ASSERT_EQ(seen.size(), (size_t)num_records);
+            rm_manager->close_file(file_handle.get());
+            rm_manager->destroy_file(filename);
+        }
+    }
+}
+
+/**
+ * @brief 按页面批量读取记录与逐条读取的结果一致，包括slotted page中因更新变长而迁移到其他页面的记录
+ */
+TEST(RecordManagerTest, GetRecordsTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    const int record_size = 64;
+    std::string filename = "get_records.txt";
+    // (INT, INT, VARCHAR(56))，分别测试定长格式和slotted page格式
+    std::vector<ColMeta> var_cols = {
+        {.tab_name = filename, .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+        {.tab_name = filename, .name = "b", .type = TYPE_INT, .len = 4, .offset = 4},
+        {.tab_name = filename, .name = "c", .type = TYPE_VARCHAR, .len = 56, .offset = 8}};
+    for (bool slotted : {false, true}) {
+        if (disk_manager->is_file(filename)) {
+            disk_manager->destroy_file(filename);
+        }
+        rm_manager->create_file(filename, record_size, slotted ? var_cols : std::vector<ColMeta>{});
+        auto file_handle = rm_manager->open_file(filename);
+
+        std::map<Rid, std::string> mock;
+        char buf[record_size];
+        for (int i = 0; i < 3000; i++) {
+            memset(buf, 0, record_size);
+            *(int *)buf = i;
+            snprintf(buf + 8, record_size - 8, "%d", i);
+            Rid rid = file_handle->insert_record(buf, nullptr);
+            mock[rid] = std::string(buf, record_size);
+        }
+        // 删除一部分记录，加长另一部分记录的变长字段；slotted page中原页面放不下的元组迁移到其他页面
+        Rid deleted = mock.begin()->first;
+        int i = 0;
+        for (auto it = mock.begin(); it != mock.end(); i++) {
+            if (i % 5 == 0) {
+                file_handle->delete_record(it->first, nullptr);
+                it = mock.erase(it);
+                continue;
+            }
+            if (i % 2 == 0) {
+                memcpy(buf, it->second.data(), record_size);
+                memset(buf + 8, 'x', record_size - 9);
+                file_handle->update_record(it->first, buf, nullptr);
+                it->second = std::string(buf, record_size);
+            }
+            ++it;
+        }
+        if (slotted) {
+            int num_redirects = 0;
+            for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+                if (RmFileHandle::is_fsm_page(page_no)) {
+                    continue;
+                }
+                RmPageHandle page_handle = file_handle->fetch_page_handle(page_no);
+                for (int slot_no = 0; slot_no < page_handle.page_hdr->num_slots; slot_no++) {
+                    num_redirects += (page_handle.get_slot_entry(slot_no)->len & RM_SLOT_REDIRECT) != 0;
+                }
+                buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), false);
+            }
+            ASSERT_GT(num_redirects, 0);
+        }
+
+        std::map<int, std::vector<int>> pages;  // page_no -> 有序的slot_no
+        for (auto &entry : mock) {
+            pages[entry.first.page_no].push_back(entry.first.slot_no);
+        }
+        std::vector<std::unique_ptr<RmRecord>> records;
+        for (auto &[page_no, slot_nos] : pages) {
+            file_handle->get_records(page_no, slot_nos, records);
+            ASSERT_EQ(records.size(), slot_nos.size());
+            for (size_t j = 0; j < slot_nos.size(); j++) {
+                ASSERT_EQ(std::string(records[j]->data, record_size), mock.at(Rid{page_no, slot_nos[j]}));
+            }
+        }
+        // 选中的槽上没有记录时报错，并且不残留页面的pin
+        ASSERT_THROW(file_handle->get_records(deleted.page_no, {deleted.slot_no}, records), RecordNotFoundError);
+        rm_manager->close_file(file_handle.get());
+        rm_manager->destroy_file(filename);
+    }
+}
@@ -0,0 +1,407 @@
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "system/sm.h"
+#undef private  // for use private variables in "sm_manager.h"
+
+#include "execution/executor_delete.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_update.h"
+#include "index/ix.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+#include "transaction/transaction_manager.h"
+
+const std::string TEST_DB_NAME = "SmOnlineIndexTest_db";    // 以数据库名作为根目录
+const std::string TEST_TAB_NAME = "table1";                 // 测试表名
+
+/**
+ * 测试CREATE INDEX CONCURRENTLY：建索引期间并发的插入、更新、删除记在旁路日志中并在切换时回放，
+ * 建好的索引与表中的记录一致；切换之后写入的语句维护新索引
+ */
+class SmOnlineIndexTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    static Value make_int(int v) {
+        Value value;
+        value.set_int(v);
+        return value;
+    }
+
+    /* 建表(id INT, val INT)并直接写入rows行，val = id % 1000，返回每行的rid */
+    std::vector<Rid> fill_table(int rows) {
+        std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"val", TYPE_INT, 4}};
+        sm_manager_->create_table(TEST_TAB_NAME, coldef, nullptr);
+        RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+        std::vector<Rid> rids;
+        char buf[8];
+        for (int id = 0; id < rows; ++id) {
+            int val = id % 1000;
+            memcpy(buf, &id, 4);
+            memcpy(buf + 4, &val, 4);
+            rids.push_back(fh->insert_record(buf, nullptr));
+        }
+        return rids;
+    }
+
+    /* 检查val上的索引与表中的记录一致：索引中恰好是每条记录的(val, rid) */
+    void check_index() {
+        auto &tab = sm_manager_->db_.get_table(TEST_TAB_NAME);
+        ASSERT_EQ(tab.indexes.size(), 1u);
+        auto ih = static_cast<IxIndexHandle *>(sm_manager_->get_index_handle(TEST_TAB_NAME, tab.indexes[0]));
+        RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+        std::map<int, std::set<Rid>> expected;
+        int num_records = 0;
+        for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+            auto rec = fh->get_record(scan.rid(), nullptr);
+            expected[*reinterpret_cast<int *>(rec->data + 4)].insert(scan.rid());
+            num_records++;
+        }
+        int num_entries = 0;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+             scan.next()) {
+            num_entries++;
+        }
+        ASSERT_EQ(num_entries, num_records);
+        for (auto &[val, rids] : expected) {
+            std::vector<Rid> result;
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&val), &result, nullptr));
+            ASSERT_EQ(std::set<Rid>(result.begin(), result.end()), rids) << "val " << val;
+        }
+    }
+
+    /* 占用进程中几乎所有的文件描述符，只留下一个空闲的描述符执行fn，fn应当因为没有描述符可用而抛出UnixError */
+    template <typename F>
+    void with_one_free_fd(F fn) {
+        rlimit old_limit;
+        ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &old_limit), 0);
+        rlimit limit = old_limit;
+        limit.rlim_cur = std::min<rlim_t>(old_limit.rlim_cur, 1024);
+        ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+        std::vector<int> fds;
+        for (int fd; (fd = open("/dev/null", O_RDONLY)) >= 0;) {
+            fds.push_back(fd);
+        }
+        close(fds.back());
+        fds.pop_back();
+        bool thrown = false;
+        try {
+            fn();
+        } catch (UnixError &) {
+            thrown = true;
+        }
+        for (int fd : fds) {
+            close(fd);
+        }
+        ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &old_limit), 0);
+        ASSERT_TRUE(thrown);
+    }
+};
+
+/**
+ * @brief 多个线程不断插入、更新、删除各自的记录，同时在线建索引；建完之后再写入一段时间，索引始终与表一致
+ */
+TEST_F(SmOnlineIndexTests, ConcurrentWritesDuringBuild) {
+    const int rows = 30000;
+    const int num_writers = 3;
+    auto rids = fill_table(rows);
+
+    std::atomic<bool> built{false};
+    std::atomic<int> ops_during_build{0};
+    std::vector<std::thread> writers;
+    std::vector<std::exception_ptr> errors(num_writers);
+    for (int t = 0; t < num_writers; ++t) {
+        writers.emplace_back([&, t] {
+            try {
+                Transaction txn(t);
+                Context context(nullptr, nullptr, &txn);
+                std::mt19937 rng(t);
+                // 线程t负责id % num_writers == t的预置记录和自己插入的记录
+                std::vector<Rid> own;
+                for (int id = t; id < rows; id += num_writers) {
+                    own.push_back(rids[id]);
+                }
+                int next_id = rows + t;
+                for (int after = 0; after < 2000; after += built ? 1 : 0) {
+                    int op = static_cast<int>(rng() % 3);
+                    if (op == 0 || own.empty()) {
+                        InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME,
+                                              {make_int(next_id), make_int(next_id % 1000)}, &context);
+                        insert.Next();
+                        own.push_back(insert.rid());
+                        next_id += num_writers;
+                    } else if (op == 1) {
+                        Rid rid = own[rng() % own.size()];
+                        Value val = make_int(static_cast<int>(rng() % 1000));
+                        val.init_raw(4);
+                        UpdateExecutor update(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "val"}, val}}, {},
+                                              {rid}, &context);
+                        update.Next();
+                    } else {
+                        size_t pos = rng() % own.size();
+                        DeleteExecutor del(sm_manager_.get(), TEST_TAB_NAME, {}, {own[pos]}, &context);
+                        del.Next();
+                        own[pos] = own.back();
+                        own.pop_back();
+                    }
+                    if (!built) {
+                        ops_during_build++;
+                    }
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    // 等写入开始之后再建索引
+    while (ops_during_build < 100) {
+        std::this_thread::yield();
+    }
+    sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_BTREE, nullptr, 2);
+    built = true;
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    ASSERT_EQ(sm_manager_->index_builds_.at(TEST_TAB_NAME)->log, nullptr);
+    check_index();
+}
+
+/**
+ * @brief 建索引之前构造、之后执行的写入语句也维护新索引
+ */
+TEST_F(SmOnlineIndexTests, ExecutorCreatedBeforeSwitch) {
+    fill_table(5000);
+    Transaction txn(0);
+    Context context(nullptr, nullptr, &txn);
+    InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(5000), make_int(5000)}, &context);
+    sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_BTREE, nullptr);
+    insert.Next();
+    check_index();
+}
+
+/**
+ * @brief 建索引期间中止的事务：回滚对表的修改同样追加到旁路日志中。
+ * 建索引的扫描可能在事务写入之前或之后看到表，从这两个时刻的表回放旁路日志，结果都与回滚之后的表相同
+ */
+TEST_F(SmOnlineIndexTests, AbortedWriteDuringBuild) {
+    auto rids = fill_table(1000);
+    auto &state = *sm_manager_->index_builds_.at(TEST_TAB_NAME);
+    state.log = std::make_shared<IndexBuildLog>();      // 相当于在线建索引已经登记了旁路日志
+    // 表中的(val, rid)，即val上的索引应有的项
+    auto snapshot = [&] {
+        std::set<std::pair<int, Rid>> entries;
+        RmFileHandle *fh = sm_manager_->fhs_.at(TEST_TAB_NAME).get();
+        for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+            auto rec = fh->get_record(scan.rid(), nullptr);
+            entries.insert({*reinterpret_cast<int *>(rec->data + 4), scan.rid()});
+        }
+        return entries;
+    };
+    auto before = snapshot();
+
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, sm_manager_.get());
+    disk_manager_->create_file(LOG_FILE_NAME);
+    LogManager log_manager(disk_manager_.get());
+    Transaction txn(0);
+    Context context(nullptr, &log_manager, &txn);
+    InsertExecutor insert(sm_manager_.get(), TEST_TAB_NAME, {make_int(1000), make_int(1)}, &context);
+    insert.Next();
+    Value val = make_int(-1);
+    val.init_raw(4);
+    UpdateExecutor update(sm_manager_.get(), TEST_TAB_NAME, {{{TEST_TAB_NAME, "val"}, val}}, {}, {rids[10]},
+                          &context);
+    update.Next();
+    DeleteExecutor del(sm_manager_.get(), TEST_TAB_NAME, {}, {rids[20]}, &context);
+    del.Next();
+    auto written = snapshot();
+    txn_manager.abort(&txn, &log_manager);
+    auto expected = snapshot();
+    ASSERT_EQ(expected, before);
+
+    // 与B+树的回放相同：插入已有的项和删除没有的项都不做修改
+    auto entries = state.log->take();
+    state.log.reset();
+    for (auto *start : {&before, &written}) {
+        auto replayed = *start;
+        for (auto &entry : entries) {
+            std::pair<int, Rid> item = {*reinterpret_cast<const int *>(entry.rec.data() + 4), entry.rid};
+            if (entry.is_insert) {
+                replayed.insert(item);
+            } else {
+                replayed.erase(item);
+            }
+        }
+        ASSERT_EQ(replayed, expected);
+    }
+}
+
+/**
+ * @brief 切换时独占的闩只属于建索引的表：持有期间这张表上的写入等待，其他表上的写入不受影响
+ */
+TEST_F(SmOnlineIndexTests, SwitchBlocksOnlyIndexedTable) {
+    fill_table(100);
+    const std::string other = "table2";
+    sm_manager_->create_table(other, {{"id", TYPE_INT, 4}, {"val", TYPE_INT, 4}}, nullptr);
+    auto insert_into = [&](const std::string &tab_name) {
+        return std::async(std::launch::async, [&, tab_name] {
+            Transaction txn(0);
+            Context context(nullptr, nullptr, &txn);
+            InsertExecutor(sm_manager_.get(), tab_name, {make_int(1), make_int(1)}, &context).Next();
+        });
+    };
+    std::unique_lock<IndexBuildLatch> lock(sm_manager_->index_builds_.at(TEST_TAB_NAME)->latch);
+    auto blocked = insert_into(TEST_TAB_NAME);
+    auto other_insert = insert_into(other);
+    bool other_done = other_insert.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    bool blocked_waiting = blocked.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout;
+    lock.unlock();  // 先放开闩再检查，检查失败时等待中的写入也能结束
+    blocked.get();
+    other_insert.get();
+    ASSERT_TRUE(other_done);
+    ASSERT_TRUE(blocked_waiting);
+}
+
+/**
+ * @brief 建索引失败时关闭并删除已经建了一部分的索引文件，不登记索引，之后可以重新建立
+ * 占用进程中几乎所有的文件描述符，使第一个索引文件打开之后创建第二个索引文件失败
+ */
+TEST_F(SmOnlineIndexTests, FailedBuildRemovesFiles) {
+    fill_table(5000);
+    for (bool concurrently : {false, true}) {
+        // 第一个索引文件创建之后一直打开，创建第二个索引文件时没有描述符可用
+        with_one_free_fd([&] {
+            if (concurrently) {
+                sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}, {"id"}}, {}, INDEX_BTREE, nullptr);
+            } else {
+                sm_manager_->create_indexes(TEST_TAB_NAME, {{"val"}, {"id"}}, {}, INDEX_BTREE, false, nullptr);
+            }
+        });
+        ASSERT_FALSE(disk_manager_->is_file(ix_manager_->get_index_name(TEST_TAB_NAME, std::vector<std::string>{"val"})));
+        ASSERT_FALSE(disk_manager_->is_file(ix_manager_->get_index_name(TEST_TAB_NAME, std::vector<std::string>{"id"})));
+        ASSERT_TRUE(sm_manager_->ihs_.empty());
+        ASSERT_EQ(sm_manager_->index_builds_.at(TEST_TAB_NAME)->log, nullptr);
+        ASSERT_TRUE(sm_manager_->db_.get_table(TEST_TAB_NAME).indexes.empty());
+    }
+
+    // 失败之后可以重新建立
+    sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_BTREE, nullptr);
+    check_index();
+}
+
+/**
+ * @brief 哈希索引建立失败时同样关闭并删除已经创建的索引文件，之后可以重新建立
+ */
+TEST_F(SmOnlineIndexTests, FailedHashBuildRemovesFiles) {
+    fill_table(5000);
+    // 第一个哈希索引打开之后一直占用描述符，创建第二个哈希索引文件失败
+    with_one_free_fd(
+        [&] { sm_manager_->create_indexes(TEST_TAB_NAME, {{"val"}, {"id"}}, {}, INDEX_HASH, false, nullptr); });
+    auto &tab = sm_manager_->db_.get_table(TEST_TAB_NAME);
+    for (auto &col_name : {"val", "id"}) {
+        ASSERT_FALSE(disk_manager_->is_file(ix_manager_->get_hash_index_name(TEST_TAB_NAME, {*tab.get_col(col_name)})));
+    }
+    ASSERT_TRUE(sm_manager_->hash_ihs_.empty());
+    ASSERT_TRUE(tab.indexes.empty());
+
+    // 失败之后可以重新建立
+    sm_manager_->create_indexes(TEST_TAB_NAME, {{"val"}}, {}, INDEX_HASH, false, nullptr);
+    auto ih = sm_manager_->get_index_handle(TEST_TAB_NAME, tab.indexes[0]);
+    for (int val : {0, 7, 999}) {
+        std::vector<Rid> result;
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&val), &result, nullptr));
+        ASSERT_EQ(result.size(), 5u);
+    }
+}
+
+/**
+ * @brief LSM索引建立失败时停止已经打开的索引的后台线程，删除清单文件，之后可以重新建立
+ * 第二个索引的清单文件改名时目标位置是一个目录，第一个索引已经打开之后创建第二个索引失败
+ */
+TEST_F(SmOnlineIndexTests, FailedLsmBuildRemovesFiles) {
+    fill_table(5000);
+    auto &tab = sm_manager_->db_.get_table(TEST_TAB_NAME);
+    std::string tmp_name = ix_manager_->get_lsm_index_name(TEST_TAB_NAME, {*tab.get_col("id")}) + ".tmp";
+    disk_manager_->create_dir(tmp_name);
+    ASSERT_THROW(sm_manager_->create_indexes(TEST_TAB_NAME, {{"val"}, {"id"}}, {}, INDEX_LSM, false, nullptr),
+                 UnixError);
+    ASSERT_EQ(rmdir(tmp_name.c_str()), 0);
+    for (auto &col_name : {"val", "id"}) {
+        ASSERT_FALSE(disk_manager_->is_file(ix_manager_->get_lsm_index_name(TEST_TAB_NAME, {*tab.get_col(col_name)})));
+    }
+    ASSERT_TRUE(sm_manager_->lsm_ihs_.empty());
+    ASSERT_TRUE(tab.indexes.empty());
+
+    // 失败之后可以重新建立
+    sm_manager_->create_indexes(TEST_TAB_NAME, {{"val"}, {"id"}}, {}, INDEX_LSM, false, nullptr);
+    auto ih = sm_manager_->get_index_handle(TEST_TAB_NAME, tab.indexes[0]);
+    for (int val : {0, 7, 999}) {
+        std::vector<Rid> result;
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&val), &result, nullptr));
+        ASSERT_EQ(result.size(), 5u);
+    }
+}
+
+/**
+ * @brief 哈希索引和LSM索引不支持在线建立；同一张表上同时只能有一个在线建索引
+ */
+TEST_F(SmOnlineIndexTests, Unsupported) {
+    fill_table(100);
+    ASSERT_THROW(sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_HASH, nullptr),
+                 HashIndexUnsupportedError);
+    ASSERT_THROW(sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_LSM, nullptr),
+                 LsmIndexUnsupportedError);
+    sm_manager_->index_builds_.at(TEST_TAB_NAME)->log = std::make_shared<IndexBuildLog>();
+    ASSERT_THROW(sm_manager_->create_indexes_concurrently(TEST_TAB_NAME, {{"val"}}, {}, INDEX_BTREE, nullptr),
+                 IndexBuildInProgressError);
+    sm_manager_->index_builds_.at(TEST_TAB_NAME)->log.reset();
+    ASSERT_TRUE(sm_manager_->db_.get_table(TEST_TAB_NAME).indexes.empty());
+}
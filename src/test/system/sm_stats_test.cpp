@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "index/ix.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+#include "system/sm.h"
+
+const std::string TEST_DB_NAME = "SmStatsTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";        // 测试表名的前缀
+
+/**
+ * 测试ANALYZE收集的统计信息：行数、字段的NDV和等深直方图、B+树索引的高度和叶子数，以及写入DB_STATS_NAME之后读回
+ */
+class SmStatsTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    /* 建表(id INT, score FLOAT, name CHAR(name_len))并插入rows行：id为0..rows-1打乱顺序，score在[0, 100)中均匀分布，
+     * name有num_names种取值，返回所有的score */
+    std::vector<float> fill_table(const std::string &tab_name, int rows, int name_len, int num_names) {
+        std::vector<ColDef> coldef = {{"id", TYPE_INT, 4}, {"score", TYPE_FLOAT, 4}, {"name", TYPE_STRING, name_len}};
+        sm_manager_->create_table(tab_name, coldef, nullptr);
+        RmFileHandle *fh = sm_manager_->fhs_.at(tab_name).get();
+        std::vector<int> ids(rows);
+        for (int i = 0; i < rows; ++i) {
+            ids[i] = i;
+        }
+        std::mt19937 rng(rows);
+        std::shuffle(ids.begin(), ids.end(), rng);
+        std::vector<float> scores;
+        std::vector<char> buf(8 + name_len);
+        for (int i = 0; i < rows; ++i) {
+            float score = static_cast<float>(rng() % 100000) / 1000;
+            std::string name = "name" + std::to_string(rng() % num_names);
+            name.resize(name_len, '\0');
+            memcpy(buf.data(), &ids[i], 4);
+            memcpy(buf.data() + 4, &score, 4);
+            memcpy(buf.data() + 8, name.data(), name_len);
+            fh->insert_record(buf.data(), nullptr);
+            scores.push_back(score);
+        }
+        return scores;
+    }
+};
+
+/**
+ * @brief 表的页面较少时读取整张表，行数、NDV和直方图的边界都是精确的，范围条件的选择率接近实际比例
+ */
+TEST_F(SmStatsTests, SmallTableIsExact) {
+    const int rows = 5000;
+    auto scores = fill_table(TEST_FILE_NAME, rows, 16, 37);
+    sm_manager_->analyze_table(TEST_FILE_NAME, nullptr);
+    const TabStats *stats = sm_manager_->stats_.get_table(TEST_FILE_NAME);
+    ASSERT_NE(stats, nullptr);
+    ASSERT_EQ(stats->num_rows, rows);
+    ASSERT_EQ(stats->sampled_pages, stats->num_pages);
+    ASSERT_EQ(stats->get_col("id")->ndv, rows);
+    ASSERT_EQ(stats->get_col("name")->ndv, 37);
+    ASSERT_EQ(stats->get_col("score")->ndv, static_cast<long long>(std::set<float>(scores.begin(), scores.end()).size()));
+
+    const ColStats *id = stats->get_col("id");
+    ASSERT_EQ(id->bounds.size(), static_cast<size_t>(STATS_HISTOGRAM_BUCKETS + 1));
+    ASSERT_EQ(*reinterpret_cast<const int *>(id->bounds.front().data()), 0);
+    ASSERT_EQ(*reinterpret_cast<const int *>(id->bounds.back().data()), rows - 1);
+    for (int v : {-10, 0, 1, 777, 2500, 4998, 4999, 7000}) {
+        double lt = std::min(std::max(v, 0), rows) / static_cast<double>(rows);
+        ASSERT_NEAR(id->selectivity(OP_LT, reinterpret_cast<const char *>(&v)), lt, 0.01);
+        ASSERT_NEAR(id->selectivity(OP_GE, reinterpret_cast<const char *>(&v)), 1 - lt, 0.01);
+        double eq = v >= 0 && v < rows ? 1.0 / rows : 0;
+        ASSERT_DOUBLE_EQ(id->selectivity(OP_EQ, reinterpret_cast<const char *>(&v)), eq);
+    }
+    const ColStats *score = stats->get_col("score");
+    for (float v : {5.5f, 33.3f, 50.0f, 99.0f}) {
+        double lt = std::count_if(scores.begin(), scores.end(), [&](float s) { return s < v; }) / static_cast<double>(rows);
+        ASSERT_NEAR(score->selectivity(OP_LT, reinterpret_cast<const char *>(&v)), lt, 0.03);
+    }
+    // 多个条件按相互独立估计
+    Condition id_cond = {{TEST_FILE_NAME, "id"}, OP_LT, true};
+    id_cond.rhs_val.set_int(rows / 2);
+    id_cond.rhs_val.init_raw(4);
+    Condition name_cond = {{TEST_FILE_NAME, "name"}, OP_EQ, true};
+    name_cond.rhs_val.set_str("name3");
+    name_cond.rhs_val.init_raw(16);
+    ASSERT_NEAR(stats->selectivity({id_cond, name_cond}), 0.5 / 37, 0.002);
+}
+
+/**
+ * @brief 页面较多时抽样：没有索引时行数和NDV为估计值；
+ * 有B+树索引时行数和索引第一个字段的NDV来自索引，索引的项数、叶子数和高度与实际一致
+ */
+TEST_F(SmStatsTests, LargeTableIsSampled) {
+    const int rows = 60000;
+    fill_table(TEST_FILE_NAME, rows, 100, 2000);
+    RmFileHandle *fh = sm_manager_->fhs_.at(TEST_FILE_NAME).get();
+    ASSERT_GT(fh->get_file_hdr().num_pages, 4 * STATS_SAMPLE_PAGES);
+
+    sm_manager_->analyze_table(TEST_FILE_NAME, nullptr);
+    const TabStats *stats = sm_manager_->stats_.get_table(TEST_FILE_NAME);
+    ASSERT_EQ(stats->sampled_pages, STATS_SAMPLE_PAGES);
+    ASSERT_NEAR(stats->num_rows, rows, rows * 0.05);
+    // id全部不同、name每种取值出现约30次，抽样估计的NDV在实际值的一半到两倍之间
+    ASSERT_GT(stats->get_col("id")->ndv, rows / 2);
+    ASSERT_GT(stats->get_col("name")->ndv, 1000);
+    ASSERT_LT(stats->get_col("name")->ndv, 4000);
+    int v = rows / 4;
+    ASSERT_NEAR(stats->get_col("id")->selectivity(OP_LE, reinterpret_cast<const char *>(&v)), 0.25, 0.05);
+
+    sm_manager_->create_indexes(TEST_FILE_NAME, {{"name"}, {"id", "score"}}, {}, INDEX_BTREE, false, nullptr);
+    sm_manager_->analyze_table(TEST_FILE_NAME, nullptr);
+    stats = sm_manager_->stats_.get_table(TEST_FILE_NAME);
+    ASSERT_EQ(stats->num_rows, rows);
+    ASSERT_EQ(stats->get_col("id")->ndv, rows);
+    ASSERT_EQ(stats->get_col("name")->ndv, 2000);
+    ASSERT_EQ(stats->indexes.size(), 2u);
+    for (auto &index_stats : stats->indexes) {
+        auto ih = sm_manager_->ihs_.at(ix_manager_->get_index_name(TEST_FILE_NAME, index_stats.col_names)).get();
+        ASSERT_EQ(index_stats.num_entries, rows);
+        ASSERT_EQ(index_stats.ndv, index_stats.col_names[0] == "name" ? 2000 : rows);
+        ASSERT_GE(index_stats.height, 2);
+        // 沿叶子链表数出叶子的数量
+        int leaves = 0;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end(); scan.next()) {
+            leaves += scan.iid().slot_no == 0;
+        }
+        ASSERT_EQ(index_stats.num_leaves, leaves);
+    }
+}
+
+/**
+ * @brief 统计信息随元数据写入DB_STATS_NAME，读回之后完全相同；删除索引和表时删除对应的统计信息
+ */
+TEST_F(SmStatsTests, PersistAndDrop) {
+    fill_table(TEST_FILE_NAME, 3000, 8, 10);
+    fill_table(TEST_FILE_NAME + "_b", 100, 8, 3);
+    sm_manager_->create_indexes(TEST_FILE_NAME, {{"name"}}, {}, INDEX_BTREE, false, nullptr);
+    sm_manager_->analyze_table(TEST_FILE_NAME, nullptr);
+    sm_manager_->analyze_table(TEST_FILE_NAME + "_b", nullptr);
+    ASSERT_EQ(sm_manager_->stats_.get_table(TEST_FILE_NAME)->indexes.size(), 1u);
+
+    auto read_back = [] {
+        DbStats stats;
+        std::ifstream ifs(DB_STATS_NAME);
+        ifs >> stats;
+        std::ostringstream os;
+        os << stats;
+        return os.str();
+    };
+    std::ostringstream expected;
+    expected << sm_manager_->stats_;
+    ASSERT_EQ(read_back(), expected.str());
+
+    sm_manager_->drop_index(TEST_FILE_NAME, std::vector<std::string>{"name"}, nullptr);
+    ASSERT_TRUE(sm_manager_->stats_.get_table(TEST_FILE_NAME)->indexes.empty());
+    sm_manager_->drop_table(TEST_FILE_NAME + "_b", nullptr);
+    ASSERT_EQ(sm_manager_->stats_.get_table(TEST_FILE_NAME + "_b"), nullptr);
+    expected.str("");
+    expected << sm_manager_->stats_;
+    ASSERT_EQ(read_back(), expected.str());
+}
@@ -117,28 +117,48 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
     {
         WriteRecord* &wr = *it;
         WType wtype = wr->GetWriteType();
+        auto &tab_name = wr->GetTableName();
+        auto &rid = wr->GetRid();
+        if (sm_manager_->is_columnar(tab_name)) {
+            if (wtype == WType::INSERT_TUPLE) {
+                sm_manager_->chs_.at(tab_name)->delete_record(rid);
+            } else if (wtype == WType::DELETE_TUPLE) {
+                sm_manager_->chs_.at(tab_name)->insert_record(rid, wr->GetRecord().data);
+            }
+            continue;
+        }
+        // 与写入的语句一样持有表的在线建索引闩：表上正在在线建索引时，回滚同样是对表的修改，
+        // 需要把逆操作追加到旁路日志中，否则回放之后新索引中会留下指向已释放(之后可能被重用)的rid的项
+        IndexBuildLog *build_log;
+        auto build_lock = sm_manager_->lock_table_write(tab_name, &build_log);
+        auto fh_ = sm_manager_->fhs_.at(tab_name).get();
         if(wtype == WType::INSERT_TUPLE)
         {
-            auto &tab_name = wr->GetTableName();
-            auto fh_ = sm_manager_->fhs_.at(tab_name).get();
-            auto &rid = wr->GetRid();
+            if (build_log != nullptr) {
+                auto rec = fh_->get_record(rid, context);
+                build_log->append(false, rid, rec->data, rec->size);
+            }
             fh_->delete_record(rid, context);
         }
         else if(wtype == WType::DELETE_TUPLE)
         {
             auto &rec = wr->GetRecord();
-            auto &tab_name = wr->GetTableName();
-            auto fh_ = sm_manager_->fhs_.at(tab_name).get();
-            auto &rid = wr->GetRid();
             fh_->insert_record(rid, rec.data);
+            if (build_log != nullptr) {
+                build_log->append(true, rid, rec.data, rec.size);
+            }
         }
         else if(wtype == WType::UPDATE_TUPLE)
         {
             auto &rec = wr->GetRecord();
-            auto &tab_name = wr->GetTableName();
-            auto fh_ = sm_manager_->fhs_.at(tab_name).get();
-            auto &rid = wr->GetRid();
+            if (build_log != nullptr) {
+                auto new_rec = fh_->get_record(rid, context);
+                build_log->append(false, rid, new_rec->data, new_rec->size);
+            }
             fh_->update_record(rid, rec.data, context);
+            if (build_log != nullptr) {
+                build_log->append(true, rid, rec.data, rec.size);
+            }
         }
     }
 